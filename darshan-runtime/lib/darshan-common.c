@@ -248,6 +248,32 @@ struct darshan_common_val_counter *darshan_track_common_val_counters(
     return(found);
 }
 
+void darshan_common_val_table_merge(struct darshan_common_val_table *dst,
+    struct darshan_common_val_table *src)
+{
+    int i;
+
+    for(i = 0; i < src->count; i++)
+        darshan_common_val_table_add(dst, src->vals[i], src->freqs[i]);
+
+    return;
+}
+
+void darshan_common_val_table_finalize(struct darshan_common_val_table *table,
+    int64_t *val_p, int64_t *cnt_p)
+{
+    int i;
+
+    for(i = 0; i < table->count; i++)
+    {
+        DARSHAN_UPDATE_COMMON_VAL_COUNTERS(val_p, cnt_p, &(table->vals[i]), 1,
+            table->freqs[i], 1);
+    }
+
+    memset(table, 0, sizeof(*table));
+    return;
+}
+
 #ifdef HAVE_MPI
 void darshan_variance_reduce(void *invec, void *inoutvec, int *len,
     MPI_Datatype *dt)
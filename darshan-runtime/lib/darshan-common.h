@@ -44,27 +44,31 @@
  *      * 100 MiB - 1 GiB
  *      * 1 GiB+
  */
-#define DARSHAN_BUCKET_INC(__bucket_base_p, __value) do {\
+#define DARSHAN_BUCKET_INC(__bucket_base_p, __value) \
+    DARSHAN_BUCKET_ADD(__bucket_base_p, __value, 1)
+
+/* same as DARSHAN_BUCKET_INC(), for '__count' accesses of the same size */
+#define DARSHAN_BUCKET_ADD(__bucket_base_p, __value, __count) do {\
     if(__value < 101) \
-        *(__bucket_base_p) += 1; \
+        *(__bucket_base_p) += __count; \
     else if(__value < 1025) \
-        *(__bucket_base_p + 1) += 1; \
+        *(__bucket_base_p + 1) += __count; \
     else if(__value < 10241) \
-        *(__bucket_base_p + 2) += 1; \
+        *(__bucket_base_p + 2) += __count; \
     else if(__value < 102401) \
-        *(__bucket_base_p + 3) += 1; \
+        *(__bucket_base_p + 3) += __count; \
     else if(__value < 1048577) \
-        *(__bucket_base_p + 4) += 1; \
+        *(__bucket_base_p + 4) += __count; \
     else if(__value < 4194305) \
-        *(__bucket_base_p + 5) += 1; \
+        *(__bucket_base_p + 5) += __count; \
     else if(__value < 10485761) \
-        *(__bucket_base_p + 6) += 1; \
+        *(__bucket_base_p + 6) += __count; \
     else if(__value < 104857601) \
-        *(__bucket_base_p + 7) += 1; \
+        *(__bucket_base_p + 7) += __count; \
     else if(__value < 1073741825) \
-        *(__bucket_base_p + 8) += 1; \
+        *(__bucket_base_p + 8) += __count; \
     else \
-        *(__bucket_base_p + 9) += 1; \
+        *(__bucket_base_p + 9) += __count; \
 } while(0)
 
 /* maximum number of common values that darshan will track per file at runtime */
@@ -142,6 +146,28 @@ struct darshan_common_val_counter
     int freq;
 };
 
+/* size of the open-addressing index used by common value tables; must be a
+ * power of two, and larger than DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT
+ */
+#define DARSHAN_COMMON_VAL_TABLE_SIZE 64
+
+/* fixed-size table for tracking the frequencies of up to
+ * DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT distinct scalar values (e.g., access
+ * sizes or strides) at runtime, without allocating memory per value. The
+ * most common values are only computed at finalize time.
+ */
+struct darshan_common_val_table
+{
+    int64_t vals[DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT];
+    int64_t freqs[DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT];
+    /* index into vals/freqs plus one, or 0 for an empty slot */
+    unsigned char slots[DARSHAN_COMMON_VAL_TABLE_SIZE];
+    int count;
+};
+
+/* assumed size of a CPU cache line, for laying out frequently updated data */
+#define DARSHAN_CACHE_LINE_SIZE 64
+
 /* i/o type (read or write) */
 enum darshan_io_type
 {
@@ -284,6 +310,291 @@ struct darshan_common_val_counter *darshan_track_common_val_counters(
     int nvals,
     int *common_val_count);
 
+/* darshan_common_val_table_add()
+ *
+ * Add 'freq' occurrences of the value 'val' to the common value table
+ * 'table'. Values not already in the table are ignored once the table
+ * is holding DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT distinct values.
+ */
+static inline void darshan_common_val_table_add(
+    struct darshan_common_val_table *table, int64_t val, int64_t freq)
+{
+    unsigned int slot;
+    int ndx;
+
+    /* multiplicative hash, using the top bits of the product */
+    slot = (unsigned int)(((uint64_t)val * 0x9E3779B97F4A7C15ULL) >> 58) &
+        (DARSHAN_COMMON_VAL_TABLE_SIZE - 1);
+    while(table->slots[slot])
+    {
+        ndx = table->slots[slot] - 1;
+        if(table->vals[ndx] == val)
+        {
+            table->freqs[ndx] += freq;
+            return;
+        }
+        slot = (slot + 1) & (DARSHAN_COMMON_VAL_TABLE_SIZE - 1);
+    }
+
+    /* we can add a new one as long as we haven't hit the limit */
+    if(table->count < DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT)
+    {
+        ndx = table->count++;
+        table->vals[ndx] = val;
+        table->freqs[ndx] = freq;
+        table->slots[slot] = ndx + 1;
+    }
+
+    return;
+}
+
+/* darshan_common_val_table_merge()
+ *
+ * Add all value frequencies tracked in common value table 'src' to the
+ * common value table 'dst'.
+ */
+void darshan_common_val_table_merge(
+    struct darshan_common_val_table *dst,
+    struct darshan_common_val_table *src);
+
+/* darshan_common_val_table_finalize()
+ *
+ * Add the most common values tracked in 'table' to the 4 common value
+ * counters starting at 'val_p' and the 4 corresponding count counters
+ * starting at 'cnt_p', then reset the table. Zero values are tracked
+ * but never stored in the common value counters.
+ */
+void darshan_common_val_table_finalize(
+    struct darshan_common_val_table *table,
+    int64_t *val_p,
+    int64_t *cnt_p);
+
+/* reduce spans of counters of two records of the same file (or other
+ * object) into one, as done when reducing shared records. '__spans' is an
+ * X-macro listing the spans of the counter array, as X(op, first, last),
+ * where op is one of the reduction functions below (e.g., "sum" for
+ * darshan_reduce_counters_sum()), and first and last are the indices of the
+ * first and last counters of the span.  Listing the spans at build time
+ * lets the compiler reduce each span with straight-line code. Counters that
+ * are not covered by any span (e.g., common values or fastest/slowest rank
+ * info) are left untouched in '__out' and must be reduced by the module.
+ */
+#define DARSHAN_REDUCE_COUNTER_SPANS(__spans, __in, __inout, __out) do { \
+    const int64_t *in_ = (__in); \
+    const int64_t *inout_ = (__inout); \
+    int64_t *out_ = (__out); \
+    __spans(DARSHAN_REDUCE_COUNTER_SPAN) \
+} while(0)
+#define DARSHAN_REDUCE_COUNTER_SPAN(__op, __first, __last) \
+    darshan_reduce_counters_##__op(in_ + (__first), inout_ + (__first), \
+        out_ + (__first), (__last) - (__first) + 1);
+
+/* same as DARSHAN_REDUCE_COUNTER_SPANS, for floating point counters */
+#define DARSHAN_REDUCE_FCOUNTER_SPANS(__spans, __in, __inout, __out) do { \
+    const double *in_ = (__in); \
+    const double *inout_ = (__inout); \
+    double *out_ = (__out); \
+    __spans(DARSHAN_REDUCE_FCOUNTER_SPAN) \
+} while(0)
+#define DARSHAN_REDUCE_FCOUNTER_SPAN(__op, __first, __last) \
+    darshan_reduce_fcounters_##__op(in_ + (__first), inout_ + (__first), \
+        out_ + (__first), (__last) - (__first) + 1);
+
+/* the reduction functions use AVX-512 or AVX2 instructions for as much of
+ * each span as possible when Darshan is built for a CPU that supports them
+ * (e.g., with -march=native), and scalar code otherwise
+ */
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/* sum */
+static inline void darshan_reduce_counters_sum(const int64_t *restrict in,
+    const int64_t *restrict inout, int64_t *restrict out, int n)
+{
+    int i = 0;
+
+#ifdef __AVX512F__
+    for(; i + 8 <= n; i += 8)
+        _mm512_storeu_si512(&out[i], _mm512_add_epi64(
+            _mm512_loadu_si512(&in[i]), _mm512_loadu_si512(&inout[i])));
+#endif
+#ifdef __AVX2__
+    for(; i + 4 <= n; i += 4)
+        _mm256_storeu_si256((__m256i *)&out[i], _mm256_add_epi64(
+            _mm256_loadu_si256((const __m256i *)&in[i]),
+            _mm256_loadu_si256((const __m256i *)&inout[i])));
+#endif
+    for(; i < n; i++)
+        out[i] = in[i] + inout[i];
+
+    return;
+}
+
+/* sum, where a negative (invalid) sum is stored as -1 exactly */
+static inline void darshan_reduce_counters_sum_valid(const int64_t *restrict in,
+    const int64_t *restrict inout, int64_t *restrict out, int n)
+{
+    int i = 0;
+
+#ifdef __AVX512F__
+    __m512i sum512;
+    for(; i + 8 <= n; i += 8)
+    {
+        sum512 = _mm512_add_epi64(_mm512_loadu_si512(&in[i]),
+            _mm512_loadu_si512(&inout[i]));
+        sum512 = _mm512_mask_mov_epi64(sum512, _mm512_cmplt_epi64_mask(
+            sum512, _mm512_setzero_si512()), _mm512_set1_epi64(-1));
+        _mm512_storeu_si512(&out[i], sum512);
+    }
+#endif
+#ifdef __AVX2__
+    __m256i sum256;
+    for(; i + 4 <= n; i += 4)
+    {
+        sum256 = _mm256_add_epi64(_mm256_loadu_si256((const __m256i *)&in[i]),
+            _mm256_loadu_si256((const __m256i *)&inout[i]));
+        /* or negative sums with an all ones mask */
+        sum256 = _mm256_or_si256(sum256,
+            _mm256_cmpgt_epi64(_mm256_setzero_si256(), sum256));
+        _mm256_storeu_si256((__m256i *)&out[i], sum256);
+    }
+#endif
+    for(; i < n; i++)
+    {
+        out[i] = in[i] + inout[i];
+        if(out[i] < 0)
+            out[i] = -1;
+    }
+
+    return;
+}
+
+/* max */
+static inline void darshan_reduce_counters_max(const int64_t *restrict in,
+    const int64_t *restrict inout, int64_t *restrict out, int n)
+{
+    int i = 0;
+
+#ifdef __AVX512F__
+    for(; i + 8 <= n; i += 8)
+        _mm512_storeu_si512(&out[i], _mm512_max_epi64(
+            _mm512_loadu_si512(&in[i]), _mm512_loadu_si512(&inout[i])));
+#endif
+#ifdef __AVX2__
+    __m256i a256, b256;
+    for(; i + 4 <= n; i += 4)
+    {
+        a256 = _mm256_loadu_si256((const __m256i *)&in[i]);
+        b256 = _mm256_loadu_si256((const __m256i *)&inout[i]);
+        _mm256_storeu_si256((__m256i *)&out[i], _mm256_blendv_epi8(
+            b256, a256, _mm256_cmpgt_epi64(a256, b256)));
+    }
+#endif
+    for(; i < n; i++)
+        out[i] = (in[i] > inout[i]) ? in[i] : inout[i];
+
+    return;
+}
+
+/* value of the incoming record */
+static inline void darshan_reduce_counters_in(const int64_t *restrict in,
+    const int64_t *restrict inout, int64_t *restrict out, int n)
+{
+    int i;
+
+    for(i = 0; i < n; i++)
+        out[i] = in[i];
+
+    return;
+}
+
+/* sum */
+static inline void darshan_reduce_fcounters_sum(const double *restrict in,
+    const double *restrict inout, double *restrict out, int n)
+{
+    int i = 0;
+
+#ifdef __AVX512F__
+    for(; i + 8 <= n; i += 8)
+        _mm512_storeu_pd(&out[i], _mm512_add_pd(_mm512_loadu_pd(&in[i]),
+            _mm512_loadu_pd(&inout[i])));
+#endif
+#ifdef __AVX2__
+    for(; i + 4 <= n; i += 4)
+        _mm256_storeu_pd(&out[i], _mm256_add_pd(_mm256_loadu_pd(&in[i]),
+            _mm256_loadu_pd(&inout[i])));
+#endif
+    for(; i < n; i++)
+        out[i] = in[i] + inout[i];
+
+    return;
+}
+
+/* max */
+static inline void darshan_reduce_fcounters_max(const double *restrict in,
+    const double *restrict inout, double *restrict out, int n)
+{
+    int i = 0;
+
+    /* the max instructions return the second operand unless the first is
+     * greater, just like the scalar code
+     */
+#ifdef __AVX512F__
+    for(; i + 8 <= n; i += 8)
+        _mm512_storeu_pd(&out[i], _mm512_max_pd(_mm512_loadu_pd(&in[i]),
+            _mm512_loadu_pd(&inout[i])));
+#endif
+#ifdef __AVX2__
+    for(; i + 4 <= n; i += 4)
+        _mm256_storeu_pd(&out[i], _mm256_max_pd(_mm256_loadu_pd(&in[i]),
+            _mm256_loadu_pd(&inout[i])));
+#endif
+    for(; i < n; i++)
+        out[i] = (in[i] > inout[i]) ? in[i] : inout[i];
+
+    return;
+}
+
+/* min non-zero (if available) value */
+static inline void darshan_reduce_fcounters_min_nonzero(const double *restrict in,
+    const double *restrict inout, double *restrict out, int n)
+{
+    int i = 0;
+
+#ifdef __AVX512F__
+    __m512d a512, b512;
+    __mmask8 m512;
+    for(; i + 8 <= n; i += 8)
+    {
+        a512 = _mm512_loadu_pd(&in[i]);
+        b512 = _mm512_loadu_pd(&inout[i]);
+        m512 = (_mm512_cmp_pd_mask(a512, b512, _CMP_LT_OQ) &
+            _mm512_cmp_pd_mask(a512, _mm512_setzero_pd(), _CMP_GT_OQ)) |
+            _mm512_cmp_pd_mask(b512, _mm512_setzero_pd(), _CMP_EQ_OQ);
+        _mm512_storeu_pd(&out[i], _mm512_mask_mov_pd(b512, m512, a512));
+    }
+#endif
+#ifdef __AVX2__
+    __m256d a256, b256, m256;
+    for(; i + 4 <= n; i += 4)
+    {
+        a256 = _mm256_loadu_pd(&in[i]);
+        b256 = _mm256_loadu_pd(&inout[i]);
+        m256 = _mm256_or_pd(_mm256_and_pd(
+            _mm256_cmp_pd(a256, b256, _CMP_LT_OQ),
+            _mm256_cmp_pd(a256, _mm256_setzero_pd(), _CMP_GT_OQ)),
+            _mm256_cmp_pd(b256, _mm256_setzero_pd(), _CMP_EQ_OQ));
+        _mm256_storeu_pd(&out[i], _mm256_blendv_pd(b256, a256, m256));
+    }
+#endif
+    for(; i < n; i++)
+        out[i] = ((in[i] < inout[i] && in[i] > 0) || inout[i] == 0) ?
+            in[i] : inout[i];
+
+    return;
+}
+
 #ifdef HAVE_MPI
 /* darshan_variance_reduce()
  *
@@ -29,13 +29,23 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#include <sys/file.h>
 #include <sys/vfs.h>
 #include <zlib.h>
 #include <assert.h>
+#ifdef HAVE_LIBZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_LIBLZ4
+#include <lz4frame.h>
+#endif
 
 #ifdef HAVE_MPI
 #include <mpi.h>
 #endif
+#ifdef HAVE_CPUID_H
+#include <cpuid.h>
+#endif
 
 #include "uthash.h"
 #include "darshan.h"
@@ -50,8 +60,14 @@ extern char* __progname;
 extern char* __progname_full;
 struct darshan_core_runtime *__darshan_core = NULL;
 double __darshan_core_wtime_offset = 0;
+#ifdef __DARSHAN_TSC_TIMER
+double __darshan_core_tsc_period = 0;
+static double darshan_tsc_frequency = 0;
+static int darshan_tsc_calibrated = 0;
+#endif
 #ifdef HAVE_STDATOMIC_H
 atomic_flag __darshan_core_mutex = ATOMIC_FLAG_INIT;
+atomic_int __darshan_core_enabled = 0;
 #else
 pthread_mutex_t __darshan_core_mutex = PTHREAD_MUTEX_INITIALIZER;
 #endif
@@ -62,12 +78,266 @@ static int my_rank = 0;
 static int nprocs = 1;
 static int darshan_mem_alignment = 1;
 static size_t darshan_mod_mem_quota = DARSHAN_MOD_MEM_MAX;
+static size_t darshan_name_mem_quota = DARSHAN_NAME_MEM_MAX;
+static size_t darshan_sys_page_size = 4096;
+static size_t darshan_mod_mem_budget[DARSHAN_MAX_MODS];
+static int darshan_mod_mem_budget_explicit[DARSHAN_MAX_MODS];
+static int darshan_mod_mem_budgets_set = 0;
+static int darshan_record_overflow_policy = DARSHAN_RECORD_OVERFLOW_DROP;
+static int darshan_huge_page_mode = DARSHAN_HUGE_PAGES_NONE;
+static size_t darshan_huge_page_size = 2 * 1024 * 1024;
+
+/* log compression method (a darshan_comp_type) and level, where level 0
+ * selects the compressor's default level
+ */
+static int darshan_log_comp_type = DARSHAN_ZLIB_COMP;
+static int darshan_log_comp_level = 0;
 static int orig_parent_pid = 0;
 static int parent_pid;
 
 static struct darshan_core_mnt_data mnt_data_array[DARSHAN_MAX_MNTS];
 static int mnt_data_count = 0;
 
+/* the mount table is discovered by one process per node and shared with
+ * the other processes on the node: with MPI, the lowest rank on each node
+ * broadcasts it to the others; without MPI, it is cached in a shared memory
+ * file, which is valid as long as the contents of the mount table file
+ * (and thus the discovered mount points) do not change
+ */
+#if defined(HAVE_MPI) && MPI_VERSION >= 3
+#define DARSHAN_MNT_NODE_SHARE 1
+#endif
+#define DARSHAN_MNT_CACHE_DIR "/dev/shm"
+
+struct darshan_mnt_cache
+{
+    uint64_t magic;
+    uint64_t mtab_hash;
+    int count;
+    struct darshan_core_mnt_data mnts[DARSHAN_MAX_MNTS];
+};
+
+#ifdef HAVE_MPI
+/* shared record reductions queued by module redux functions at shutdown
+ * time. Records shared by all processes are reduced together in a single
+ * collective, and records shared by a subset of processes are reduced to
+ * the lowest sharing rank over a binomial tree of their sharing processes.
+ * In both cases, each record is followed by the variance state of its time
+ * and bytes counters (if requested).
+ */
+struct darshan_shared_redux
+{
+    int mod_id;
+    void *rec_buf;
+    int rec_count;
+    int rec_size;
+    MPI_User_function *rec_op;
+    struct darshan_core_name_record_ref **rec_refs; /* name of each record */
+    int var_off[2]; /* offsets of the time and bytes variance counters */
+    size_t elem_size; /* size of each record with its variance state */
+    int global_count; /* number of records shared by all processes */
+};
+static struct darshan_shared_redux darshan_shared_redux_list[DARSHAN_MAX_MODS];
+static int darshan_shared_redux_count = 0;
+/* the core whose shared records are being reduced, and whether any
+ * process has records shared by a subset of processes
+ */
+static struct darshan_core_runtime *darshan_shared_redux_core = NULL;
+static int darshan_shared_redux_partial = 0;
+
+/* to bound the memory used on each process, and keep message sizes well
+ * within the range of int counts, the records sent in each step of the
+ * reduction of records shared by a subset of processes are split into
+ * rounds of about this many bytes per process
+ */
+#define DARSHAN_SHARED_REDUX_BATCH (64*1024*1024)
+#define DARSHAN_SHARED_REDUX_ROUND(__id, __rounds) \
+    ((int)((__id) % (uint64_t)(__rounds)))
+
+/* records shared by all processes are reduced as an array of fixed-size
+ * slots, each holding a record (of any module) and its variance state,
+ * preceded by this header which identifies the module's reduction, so
+ * that the reduction operator can be applied to any range of slots
+ */
+struct darshan_shared_redux_slot
+{
+    int redux_ndx;
+    int pad;
+};
+
+/* header of a record sent to its parent in the reduction tree */
+struct darshan_shared_redux_hdr
+{
+    darshan_record_id id;
+    int mod_id;
+    int pad;
+};
+/* a record shared by a subset of processes, which children in the
+ * reduction tree send records to, and which is sent on to the parent
+ */
+struct darshan_shared_redux_dest
+{
+    darshan_record_id id;
+    int mod_id;
+    struct darshan_shared_redux *redux;
+    struct darshan_core_name_record_ref *ref;
+    char *rec;
+    char *elem;
+};
+
+/* shared record detection hash-partitions record ids over all processes,
+ * so that the "owner" of each id can count the processes that registered
+ * it. To bound the memory used on each process, ids are further split into
+ * rounds, so that no process sends more than this many ids (on average) in
+ * a single round.
+ */
+#define DARSHAN_SHARED_DETECT_BATCH (64*1024)
+
+/* an id sent to its owner, and the owner's answer */
+struct darshan_shared_detect_req
+{
+    darshan_record_id id;
+    uint64_t mod_flags;
+};
+struct darshan_shared_detect_resp
+{
+    uint64_t global_mod_flags;
+    int rank_count;
+    int first_rank;
+    int redux_parent;
+    int redux_step;
+};
+/* used by owners to sort the ids they received, keeping their position
+ * and the rank they were received from
+ */
+struct darshan_shared_detect_ndx
+{
+    darshan_record_id id;
+    int pos;
+    int rank;
+};
+#endif
+
+/* with DARSHAN_COMPRESS_THREADS, module regions are compressed at shutdown
+ * time by a pool of threads while the following modules produce their
+ * output, as independent compressed streams of up to this many input bytes
+ * each (darshan-util decompresses concatenated streams transparently)
+ */
+#define DARSHAN_COMP_CHUNK_SIZE (256*1024)
+
+struct darshan_comp_region;
+struct darshan_comp_chunk
+{
+    char *in;
+    int in_len;
+    char *out; /* this chunk's slot in the region's output buffer */
+    size_t out_size;
+    int out_len;
+    int ret;
+    struct darshan_comp_region *region;
+    struct darshan_comp_chunk *next; /* next queued chunk */
+};
+struct darshan_comp_region
+{
+    char *buf; /* compressed output, contiguous once all chunks are done */
+    int len;
+    int ret;
+    int chunk_count;
+    int chunks_left;
+    struct darshan_comp_chunk *chunks;
+};
+struct darshan_comp_pool
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cond; /* signaled when chunks are queued */
+    pthread_cond_t done_cond; /* signaled when a region is compressed */
+    struct darshan_comp_chunk *head;
+    struct darshan_comp_chunk *tail;
+    int stop;
+    int thread_count;
+    pthread_t *threads;
+    double wait_time; /* time spent waiting for regions to be compressed */
+    double comp_time; /* time spent compressing, summed over chunks */
+    struct darshan_comp_region regions[DARSHAN_MAX_MODS];
+};
+
+/* module regions are appended to the log in batches of this many regions,
+ * so that a single offset scan is needed per batch. Two batches are used
+ * in turn, so that the regions of one batch are produced while the writes
+ * of the other are in flight.
+ */
+#define DARSHAN_LOG_BATCH_SIZE 2
+
+#if defined(HAVE_MPI) && \
+    (MPI_VERSION > 3 || (MPI_VERSION == 3 && MPI_SUBVERSION >= 1))
+#define DARSHAN_LOG_IWRITE_ALL 1
+#endif
+/* node aggregation needs MPI_COMM_TYPE_SHARED */
+#if defined(HAVE_MPI) && MPI_VERSION >= 3
+#define DARSHAN_LOG_NODE_AGG 1
+#endif
+
+struct darshan_log_batch
+{
+    int count;
+    int mod_ids[DARSHAN_LOG_BATCH_SIZE];
+    char *bufs[DARSHAN_LOG_BATCH_SIZE];
+    int lens[DARSHAN_LOG_BATCH_SIZE];
+    int rets[DARSHAN_LOG_BATCH_SIZE];
+    /* global offset and length of each region, set when issued (only
+     * valid on rank 0 for the first batch appended to the log)
+     */
+    uint64_t offs[DARSHAN_LOG_BATCH_SIZE];
+    uint64_t global_lens[DARSHAN_LOG_BATCH_SIZE];
+    /* compression scratch buffers owned by the batch */
+    char *scratch[DARSHAN_LOG_BATCH_SIZE];
+    size_t scratch_sizes[DARSHAN_LOG_BATCH_SIZE];
+    int scratch_huge_pages[DARSHAN_LOG_BATCH_SIZE];
+    /* state of the writes in flight, from darshan_log_batch_issue() until
+     * darshan_log_batch_wait()
+     */
+    int issued;
+    int err;
+#ifdef HAVE_MPI
+    MPI_Request reqs[DARSHAN_LOG_BATCH_SIZE];
+    int req_count;
+#endif
+    int write_fd;
+    uint64_t write_offs[DARSHAN_LOG_BATCH_SIZE];
+    pthread_t write_thread;
+    int write_thread_started;
+#ifdef DARSHAN_LOG_NODE_AGG
+    /* node leader's buffer of its node's data for each region */
+    char *agg_buf;
+    size_t agg_buf_size;
+    int agg_buf_huge_pages;
+#endif
+};
+
+#ifdef DARSHAN_LOG_NODE_AGG
+/* with DARSHAN_NODE_AGGREGATION, the processes of each node gather their
+ * log regions to a node leader, and only the leaders compute offsets and
+ * write to the log, so that the number of processes taking part in each
+ * write is the number of nodes rather than the number of processes
+ */
+struct darshan_log_node_agg
+{
+    MPI_Comm node_comm;
+    MPI_Comm leader_comm; /* MPI_COMM_NULL on non-leaders */
+    int node_rank;
+    int node_size;
+    /* leader only: the region lengths of each local process, the gather
+     * counts and displacements of one region, and the file offsets of each
+     * local process's regions when they are written per process
+     */
+    int *lens;
+    int *counts;
+    int *displs;
+    MPI_Offset *offs;
+};
+static struct darshan_log_node_agg *darshan_node_agg = NULL;
+#endif
+
 /* paths prefixed with the following directories are not tracked by darshan */
 char* darshan_path_exclusions[] = {
     "/etc/",
@@ -94,6 +364,25 @@ char* darshan_path_inclusions[] = {
 /* allow users to override the path exclusions */
 char** user_darshan_path_exclusions = NULL;
 
+/* path exclusions, inclusions, and mount points are compiled into a single
+ * byte trie at initialization time, so that the longest matching prefix of a
+ * path can be found with one walk of the path. The children of each node are
+ * kept in a list of siblings within the node array, with node 0 as the root.
+ */
+#define DARSHAN_PATH_TRIE_EXCLUDE 1
+#define DARSHAN_PATH_TRIE_INCLUDE 2
+struct darshan_path_trie_node
+{
+    char c;
+    char flags; /* DARSHAN_PATH_TRIE_* flags of prefixes ending at this node */
+    int mnt_index; /* index into mnt_data_array, or -1 */
+    int first_child;
+    int next_sibling;
+};
+static struct darshan_path_trie_node *darshan_path_trie = NULL;
+static int darshan_path_trie_count = 0;
+static int darshan_path_trie_size = 0;
+
 #ifdef DARSHAN_BGQ
 extern void bgq_runtime_initialize();
 #endif
@@ -128,21 +417,64 @@ extern void darshan_instrument_lustre_file(const char *filepath, int fd);
 static void *darshan_init_mmap_log(
     struct darshan_core_runtime* core, int jobid);
 #endif
+static void darshan_core_init_timer(
+    void);
 static void darshan_log_record_hints_and_ver(
     struct darshan_core_runtime* core);
+static void darshan_log_record_timer(
+    struct darshan_core_runtime* core);
+static void darshan_log_record_partial(
+    struct darshan_core_runtime* core);
+static void darshan_init_mod_mem_budgets(
+    void);
+static void darshan_init_huge_pages(
+    void);
+static void darshan_init_log_comp(
+    void);
+static void *darshan_huge_page_reserve(
+    size_t size, int prot, int flags);
 static void darshan_get_exe_and_mounts(
     struct darshan_core_runtime *core, int argc, char **argv);
+static void darshan_discover_mounts(
+    char **fs_exclusions);
+static void darshan_get_mounts(
+    struct darshan_core_runtime *core);
+static int darshan_mnt_cache_read(
+    int fd, uint64_t mtab_hash);
+static int darshan_mnt_index_from_path(
+    const char *path);
 static void darshan_fs_info_from_path(
     const char *path, struct darshan_fs_info *fs_info);
+static void darshan_build_path_trie(
+    void);
+static int darshan_path_trie_new_node(
+    char c);
+static int darshan_path_trie_insert(
+    const char *prefix, int flags, int mnt_index);
+static int darshan_path_trie_match(
+    const char *path, int *mnt_index);
+static struct darshan_core_name_chunk *darshan_alloc_name_chunk(
+    size_t size);
+static void darshan_free_name_chunk(
+    struct darshan_core_name_chunk *chunk);
 static int darshan_add_name_record_ref(
     struct darshan_core_runtime *core, darshan_record_id rec_id,
-    const char *name, darshan_module_id mod_id);
+    const char *name, darshan_module_id mod_id, int overflow);
+#ifndef __DARSHAN_ENABLE_MMAP_LOGS
+static void darshan_remove_name_record_ref(
+    struct darshan_core_runtime *core,
+    struct darshan_core_name_record_ref *ref);
+static void darshan_compact_dead_name_records(
+    struct darshan_core_runtime *core);
+#endif
 static void darshan_get_user_name(
     char *user);
 #ifdef HAVE_MPI
 static void darshan_get_shared_records(
     struct darshan_core_runtime *core, darshan_record_id **shared_recs,
     int *shared_rec_cnt);
+static void darshan_reduce_shared_records(
+    struct darshan_core_runtime *core);
 #endif
 static void darshan_get_logfile_name(
     char* logfile_name, struct darshan_core_runtime* core);
@@ -159,14 +491,83 @@ static int darshan_log_write_header(
     darshan_core_log_fh log_fh, struct darshan_core_runtime *core);
 static int darshan_log_append(
     darshan_core_log_fh log_fh, struct darshan_core_runtime *core,
-    void *buf, int count, uint64_t *inout_off);
+    void **bufs, int *counts, int buf_count, uint64_t *inout_off);
+static int darshan_log_write_region(
+    darshan_core_log_fh log_fh, struct darshan_core_runtime *core,
+    char *buf, int len, int comp_ret, uint64_t *inout_off);
+static int darshan_core_reserve_scratch_buf(
+    char **buf, size_t *buf_size, int *huge_pages, size_t size);
+static void darshan_core_free_scratch_buf(
+    char **buf, size_t *buf_size, int *huge_pages);
+static int darshan_core_reserve_comp_buf(
+    struct darshan_core_runtime *core, size_t size);
+static void darshan_core_free_comp_buf(
+    struct darshan_core_runtime *core);
 void darshan_log_close(
     darshan_core_log_fh log_fh);
 void darshan_log_finalize(
     char *logfile_name, double start_log_time);
+static size_t darshan_compress_bound(
+    size_t len);
+static int darshan_compress_buffer(
+    void **pointers, int *lengths, int count, char *comp_buf,
+    size_t comp_buf_size, int *comp_buf_length);
 static int darshan_deflate_buffer(
     void **pointers, int *lengths, int count, char *comp_buf,
-    int *comp_buf_length);
+    size_t comp_buf_size, int *comp_buf_length);
+#ifdef HAVE_LIBZSTD
+static int darshan_zstd_buffer(
+    void **pointers, int *lengths, int count, char *comp_buf,
+    size_t comp_buf_size, int *comp_buf_length);
+#endif
+#ifdef HAVE_LIBLZ4
+static int darshan_lz4_buffer(
+    void **pointers, int *lengths, int count, char *comp_buf,
+    size_t comp_buf_size, int *comp_buf_length);
+#endif
+static struct darshan_comp_pool *darshan_comp_pool_start(
+    int thread_count);
+static void darshan_comp_pool_queue(
+    struct darshan_comp_pool *pool, int mod_id, void *buf, int len);
+static struct darshan_comp_region *darshan_comp_pool_wait(
+    struct darshan_comp_pool *pool, int mod_id);
+static void darshan_comp_pool_stop(
+    struct darshan_comp_pool *pool);
+static int darshan_log_batch_compress(
+    struct darshan_log_batch *batch, int mod_id, void *buf, int len);
+static void darshan_log_batch_add(
+    struct darshan_log_batch *batch, int mod_id, char *buf, int len,
+    int comp_ret);
+static int darshan_log_batch_issue(
+    darshan_core_log_fh log_fh, struct darshan_core_runtime *core,
+    struct darshan_log_batch *batch, uint64_t *inout_off);
+static int darshan_log_batch_wait(
+    struct darshan_log_batch *batch);
+static void darshan_log_batch_free(
+    struct darshan_log_batch *batch);
+#ifdef HAVE_MPI
+static void darshan_log_scan_offsets(
+    MPI_Comm comm, MPI_Offset *lens, int count, MPI_Offset *my_offs,
+    struct darshan_log_batch *batch, uint64_t *inout_off);
+#endif
+#ifdef DARSHAN_LOG_NODE_AGG
+static struct darshan_log_node_agg *darshan_log_node_agg_start(
+    struct darshan_core_runtime *core);
+static void darshan_log_node_agg_stop(
+    struct darshan_log_node_agg *agg);
+static int darshan_log_batch_issue_node_agg(
+    darshan_core_log_fh log_fh, struct darshan_log_batch *batch,
+    uint64_t *inout_off);
+#endif
+static size_t darshan_module_mem_committed(
+    struct darshan_core_module *mod);
+static int darshan_module_mem_grow(
+    struct darshan_core_runtime *core, struct darshan_core_module *mod,
+    size_t rec_len, int overflow);
+static void darshan_module_mem_release(
+    struct darshan_core_module *mod);
+static void darshan_core_drop_record(
+    struct darshan_core_module *mod, darshan_record_id rec_id);
 static void darshan_core_cleanup(
     struct darshan_core_runtime* core);
 static void darshan_core_fork_child_cb(void);
@@ -226,6 +627,9 @@ void darshan_core_initialize(int argc, char **argv)
     if (__darshan_core != NULL || getenv("DARSHAN_DISABLE"))
         return;
 
+    /* select the timer backend before taking any timestamps */
+    darshan_core_init_timer();
+
     init_start = darshan_core_wtime_absolute();
     if(getenv("DARSHAN_INTERNAL_TIMING"))
     {
@@ -279,6 +683,10 @@ void darshan_core_initialize(int argc, char **argv)
             jobid = orig_parent_pid;
     }
 
+    tmpval = sysconf(_SC_PAGESIZE);
+    if(tmpval > 0)
+        darshan_sys_page_size = tmpval;
+
     /* set the memory quota for darshan modules' records */
     envstr = getenv(DARSHAN_MOD_MEM_OVERRIDE);
     if(envstr)
@@ -291,6 +699,38 @@ void darshan_core_initialize(int argc, char **argv)
         }
     }
 
+    /* set the memory quota for record names */
+    envstr = getenv(DARSHAN_NAME_MEM_OVERRIDE);
+    if(envstr)
+    {
+        ret = sscanf(envstr, "%lf", &tmpfloat);
+        /* silently ignore if the env variable is set poorly */
+        if(ret == 1 && tmpfloat > 0)
+        {
+            darshan_name_mem_quota = tmpfloat * 1024 * 1024; /* convert from MiB */
+        }
+    }
+
+    /* split the module memory quota into per-module budgets */
+    darshan_init_mod_mem_budgets();
+
+    /* set the policy for records that don't fit in module memory */
+    envstr = getenv(DARSHAN_RECORD_OVERFLOW_OVERRIDE);
+    if(envstr)
+    {
+        /* silently ignore if the env variable is set poorly */
+        if(strcmp(envstr, "aggregate") == 0)
+            darshan_record_overflow_policy = DARSHAN_RECORD_OVERFLOW_AGGREGATE;
+        else if(strcmp(envstr, "evict") == 0)
+            darshan_record_overflow_policy = DARSHAN_RECORD_OVERFLOW_EVICT;
+    }
+
+    /* back darshan's larger memory regions with huge pages, if requested */
+    darshan_init_huge_pages();
+
+    /* select the log compression method */
+    darshan_init_log_comp();
+
     /* allocate structure to track darshan core runtime information */
     init_core = malloc(sizeof(*init_core));
     if(init_core)
@@ -307,6 +747,11 @@ void darshan_core_initialize(int argc, char **argv)
         }
 #endif
 
+        /* collect information about mounted file systems, before any
+         * process may return early below
+         */
+        darshan_get_mounts(init_core);
+
         /* setup fork handlers if not using MPI */
         if(!using_mpi && !orig_parent_pid)
         {
@@ -316,20 +761,20 @@ void darshan_core_initialize(int argc, char **argv)
         /* set PID that initialized Darshan runtime */
         init_core->pid = init_pid;
 
-        /* TODO: do we alloc new memory as we go or just do everything up front? */
-
 #ifndef __DARSHAN_ENABLE_MMAP_LOGS
-        /* just allocate memory for each log file region */
+        /* just allocate memory for each fixed-size log file region; name
+         * and module record memory is allocated as records are registered
+         */
         init_core->log_hdr_p = malloc(sizeof(struct darshan_header));
         init_core->log_job_p = malloc(sizeof(struct darshan_job));
         init_core->log_exemnt_p = malloc(DARSHAN_EXE_LEN+1);
-        init_core->log_name_p = malloc(DARSHAN_NAME_RECORD_BUF_SIZE);
-        init_core->log_mod_p = malloc(darshan_mod_mem_quota);
 
         if(!(init_core->log_hdr_p) || !(init_core->log_job_p) ||
-           !(init_core->log_exemnt_p) || !(init_core->log_name_p) ||
-           !(init_core->log_mod_p))
+           !(init_core->log_exemnt_p))
         {
+            free(init_core->log_hdr_p);
+            free(init_core->log_job_p);
+            free(init_core->log_exemnt_p);
             free(init_core);
             return;
         }
@@ -337,8 +782,6 @@ void darshan_core_initialize(int argc, char **argv)
         memset(init_core->log_hdr_p, 0, sizeof(struct darshan_header));
         memset(init_core->log_job_p, 0, sizeof(struct darshan_job));
         memset(init_core->log_exemnt_p, 0, DARSHAN_EXE_LEN+1);
-        memset(init_core->log_name_p, 0, DARSHAN_NAME_RECORD_BUF_SIZE);
-        memset(init_core->log_mod_p, 0, darshan_mod_mem_quota);
 #else
         /* if mmap logs are enabled, we need to initialize the mmap region
          * before setting the corresponding log file region pointers
@@ -359,7 +802,7 @@ void darshan_core_initialize(int argc, char **argv)
         init_core->log_name_p = (void *)
             ((char *)init_core->log_exemnt_p + DARSHAN_EXE_LEN + 1);
         init_core->log_mod_p = (void *)
-            ((char *)init_core->log_name_p + DARSHAN_NAME_RECORD_BUF_SIZE);
+            ((char *)init_core->log_name_p + darshan_name_mem_quota);
 
         /* set header fields needed for the mmap log mechanism */
         init_core->log_hdr_p->comp_type = DARSHAN_NO_COMP;
@@ -381,9 +824,11 @@ void darshan_core_initialize(int argc, char **argv)
          * hints with the darshan job information
          */
         darshan_log_record_hints_and_ver(init_core);
+        darshan_log_record_timer(init_core);
 
-        /* collect information about command line and mounted file systems */
+        /* record the command line and mounted file systems */
         darshan_get_exe_and_mounts(init_core, argc, argv);
+        darshan_build_path_trie();
 
         /* determine if/when DXT should be enabled by looking for triggers */
         char *trigger_conf = getenv("DXT_TRIGGER_CONF_PATH");
@@ -399,6 +844,7 @@ void darshan_core_initialize(int argc, char **argv)
         __DARSHAN_CORE_LOCK();
         __darshan_core = init_core;
         __darshan_core_wtime_offset = init_start;
+        __DARSHAN_CORE_SET_ENABLED(1);
         __DARSHAN_CORE_UNLOCK();
 
         /* bootstrap any modules with static initialization routines */
@@ -447,6 +893,9 @@ void darshan_core_shutdown(int write_log)
     double rec1 = 0, rec2 = 0;
     double mod1[DARSHAN_MAX_MODS] = {0};
     double mod2[DARSHAN_MAX_MODS] = {0};
+    double mod_redux[DARSHAN_MAX_MODS] = {0};
+    double mod_out[DARSHAN_MAX_MODS] = {0};
+    double redux1 = 0, redux2 = 0;
     double header1 = 0, header2 = 0;
     double tm_end;
     int active_mods[DARSHAN_MAX_MODS] = {0};
@@ -455,6 +904,14 @@ void darshan_core_shutdown(int write_log)
     darshan_core_log_fh log_fh;
     int log_created = 0;
     int meta_remain = 0;
+    struct darshan_comp_pool *comp_pool = NULL;
+    int comp_threads = 0;
+    struct darshan_log_batch log_batches[2] = {{0}};
+    int log_batch = 0;
+    int last_active_mod = -1;
+    double write_wait1 = 0, write_wait_tm = 0;
+    char *envstr;
+    double comp_tm = 0, comp_serial_tm = 0;
     char *m;
     int i;
     int ret;
@@ -462,7 +919,9 @@ void darshan_core_shutdown(int write_log)
     darshan_record_id *shared_recs = NULL;
     darshan_record_id *mod_shared_recs = NULL;
     int shared_rec_cnt = 0;
+    int log_opts[3];
 #endif
+    double agg1 = 0, agg2 = 0;
 
     /* disable darhan-core while we shutdown */
     __DARSHAN_CORE_LOCK();
@@ -471,6 +930,7 @@ void darshan_core_shutdown(int write_log)
         __DARSHAN_CORE_UNLOCK();
         return;
     }
+    __DARSHAN_CORE_SET_ENABLED(0);
     final_core = __darshan_core;
     __darshan_core = NULL;
     __DARSHAN_CORE_UNLOCK();
@@ -508,9 +968,12 @@ void darshan_core_shutdown(int write_log)
     unlink(final_core->mmap_log_name);
 #endif
 
-    final_core->comp_buf = malloc(darshan_mod_mem_quota);
+    /* NOTE: the compression buffer is grown as needed when appending
+     * to the log, so just start with enough room for most modules
+     */
+    ret = darshan_core_reserve_comp_buf(final_core, DARSHAN_MOD_MEM_CHUNK_SIZE);
     logfile_name = malloc(__DARSHAN_PATH_MAX);
-    if(!final_core->comp_buf || !logfile_name)
+    if(ret < 0 || !logfile_name)
         goto cleanup;
 
     /* set which modules were used locally */
@@ -527,6 +990,28 @@ void darshan_core_shutdown(int write_log)
         PMPI_Allreduce(MPI_IN_PLACE, active_mods, DARSHAN_MAX_MODS, MPI_INT,
             MPI_SUM, final_core->mpi_comm);
 
+        /* rank 0 records the compression method in the log header, so all
+         * processes compress their log regions the way it does, and they
+         * must also agree on whether to write through node leaders
+         */
+        log_opts[0] = darshan_log_comp_type;
+        log_opts[1] = darshan_log_comp_level;
+        log_opts[2] = (getenv("DARSHAN_NODE_AGGREGATION") != NULL);
+        PMPI_Bcast(log_opts, 3, MPI_INT, 0, final_core->mpi_comm);
+        darshan_log_comp_type = log_opts[0];
+        darshan_log_comp_level = log_opts[1];
+
+#ifdef DARSHAN_LOG_NODE_AGG
+        if(log_opts[2])
+        {
+            if(internal_timing_flag)
+                agg1 = darshan_core_wtime_absolute();
+            darshan_node_agg = darshan_log_node_agg_start(final_core);
+            if(internal_timing_flag)
+                agg2 = darshan_core_wtime_absolute();
+        }
+#endif
+
         /* reduce to report first start and last end time across all ranks at rank 0 */
         if(my_rank == 0)
         {
@@ -545,7 +1030,7 @@ void darshan_core_shutdown(int write_log)
                 1, MPI_INT64_T, MPI_MAX, 0, final_core->mpi_comm);
         }
 
-        /* get a list of records which are shared across all processes */
+        /* get a list of records which are shared by multiple processes */
         darshan_get_shared_records(final_core, &shared_recs, &shared_rec_cnt);
 
         mod_shared_recs = malloc(shared_rec_cnt * sizeof(darshan_record_id));
@@ -571,6 +1056,9 @@ void darshan_core_shutdown(int write_log)
         }
     }
 
+    /* record how many records each module had to drop */
+    darshan_log_record_partial(final_core);
+
     /* get the log file name */
     darshan_get_logfile_name(logfile_name, final_core);
     if(strlen(logfile_name) == 0)
@@ -609,6 +1097,105 @@ void darshan_core_shutdown(int write_log)
     /* error out if unable to write name records */
     DARSHAN_CHECK_ERR(ret, "unable to write name records to log file %s", logfile_name);
 
+#ifdef HAVE_MPI
+    /* give each locally registered module an opportunity to reduce shared
+     * records, and then reduce the shared records queued by all modules
+     * in a single collective
+     */
+    if(using_mpi && !getenv("DARSHAN_DISABLE_SHARED_REDUCTION"))
+    {
+        for(i = 0; i < DARSHAN_MAX_MODS; i++)
+        {
+            struct darshan_core_module* this_mod = final_core->mod_array[i];
+            struct darshan_core_name_record_ref *ref = NULL;
+            int mod_shared_rec_cnt = 0;
+            int j;
+
+            if(!active_mods[i] || !this_mod ||
+               !this_mod->mod_funcs.mod_redux_func)
+                continue;
+
+            if(internal_timing_flag)
+                mod1[i] = darshan_core_wtime_absolute();
+
+            /* set the shared record list for this module. Records shared
+             * by a subset of processes are only included for modules that
+             * leave their reduction to darshan-core, as the redux function
+             * is then not called on all processes.
+             */
+            for(j = 0; j < shared_rec_cnt; j++)
+            {
+                HASH_FIND(hlink, final_core->name_hash, &shared_recs[j],
+                    sizeof(darshan_record_id), ref);
+                assert(ref);
+
+                if(DARSHAN_MOD_FLAG_ISSET(ref->global_mod_flags, i) &&
+                   (ref->global_rank_count == nprocs ||
+                    this_mod->mod_funcs.mod_redux_partial))
+                {
+                    mod_shared_recs[mod_shared_rec_cnt++] = shared_recs[j];
+                }
+            }
+
+            if(mod_shared_rec_cnt > 0)
+            {
+                int redux_cnt = darshan_shared_redux_count;
+
+                darshan_shared_redux_core = final_core;
+                this_mod->mod_funcs.mod_redux_func(
+                    this_mod->rec_buf_start, final_core->mpi_comm,
+                    mod_shared_recs, mod_shared_rec_cnt);
+                if(darshan_shared_redux_count > redux_cnt)
+                    darshan_shared_redux_list[redux_cnt].mod_id = i;
+            }
+
+            if(internal_timing_flag)
+                mod_redux[i] = darshan_core_wtime_absolute() - mod1[i];
+        }
+
+        if(internal_timing_flag)
+            redux1 = darshan_core_wtime_absolute();
+        darshan_reduce_shared_records(final_core);
+        if(internal_timing_flag)
+            redux2 = darshan_core_wtime_absolute();
+    }
+#endif
+
+    /* if requested, compress the module output buffers with a pool of
+     * threads (the calling thread included). The output buffers of all
+     * locally registered modules are queued up front, split into chunks
+     * that are compressed as independent streams, so that later modules
+     * are compressed while earlier modules' data is being written.
+     */
+    envstr = getenv("DARSHAN_COMPRESS_THREADS");
+    if(envstr)
+        comp_threads = atoi(envstr);
+    if(comp_threads > 1)
+        comp_pool = darshan_comp_pool_start(comp_threads - 1);
+    if(comp_pool)
+    {
+        for(i = 0; i < DARSHAN_MAX_MODS; i++)
+        {
+            struct darshan_core_module* this_mod = final_core->mod_array[i];
+            void* mod_buf;
+            int mod_buf_sz;
+
+            if(!active_mods[i] || !this_mod)
+                continue;
+
+            if(internal_timing_flag)
+                mod_out[i] = darshan_core_wtime_absolute();
+
+            mod_buf = this_mod->rec_buf_start;
+            mod_buf_sz = this_mod->rec_buf_p - this_mod->rec_buf_start;
+            this_mod->mod_funcs.mod_output_func(&mod_buf, &mod_buf_sz);
+            darshan_comp_pool_queue(comp_pool, i, mod_buf, mod_buf_sz);
+
+            if(internal_timing_flag)
+                mod_out[i] = darshan_core_wtime_absolute() - mod_out[i];
+        }
+    }
+
     /* loop over globally used darshan modules and:
      *      - get final output buffer
      *      - compress (zlib) provided output buffer
@@ -616,11 +1203,22 @@ void darshan_core_shutdown(int write_log)
      *      - add module map info (file offset/length) to log header
      *      - shutdown the module
      */
+    /* NOTE: the compressed regions are appended in batches, alternating
+     * between two batches so that the next batch is produced while the
+     * writes of the previous one are in flight
+     */
+    for(i = 0; i < DARSHAN_MAX_MODS; i++)
+    {
+        if(active_mods[i])
+            last_active_mod = i;
+    }
     for(i = 0; i < DARSHAN_MAX_MODS; i++)
     {
         struct darshan_core_module* this_mod = final_core->mod_array[i];
+        struct darshan_log_batch *batch = &log_batches[log_batch];
         void* mod_buf = NULL;
         int mod_buf_sz = 0;
+        int j;
 
         if(!active_mods[i])
         {
@@ -632,51 +1230,56 @@ void darshan_core_shutdown(int write_log)
         if(internal_timing_flag)
             mod1[i] = darshan_core_wtime_absolute();
 
-        /* if module is registered locally, perform module shutdown operations */
-        if(this_mod)
+        /* the writes of this batch must complete before it is reused */
+        if(batch->issued)
         {
-            mod_buf = final_core->mod_array[i]->rec_buf_start;
-            mod_buf_sz = final_core->mod_array[i]->rec_buf_p - mod_buf;
-
-#ifdef HAVE_MPI
-            if(using_mpi)
-            {
-                struct darshan_core_name_record_ref *ref = NULL;
-                int mod_shared_rec_cnt = 0;
-                int j;
+            if(internal_timing_flag)
+                write_wait1 = darshan_core_wtime_absolute();
+            ret = darshan_log_batch_wait(batch);
+            if(internal_timing_flag)
+                write_wait_tm += darshan_core_wtime_absolute() - write_wait1;
+            DARSHAN_CHECK_ERR(ret, "unable to write module data to log file %s",
+                logfile_name);
+        }
 
-                /* set the shared record list for this module */
-                for(j = 0; j < shared_rec_cnt; j++)
-                {
-                    HASH_FIND(hlink, final_core->name_hash, &shared_recs[j],
-                        sizeof(darshan_record_id), ref);
-                    assert(ref);
+        if(comp_pool)
+        {
+            /* use this module's precompressed data */
+            struct darshan_comp_region *region =
+                darshan_comp_pool_wait(comp_pool, i);
 
-                    if(DARSHAN_MOD_FLAG_ISSET(ref->global_mod_flags, i))
-                    {
-                        mod_shared_recs[mod_shared_rec_cnt++] = shared_recs[j];
-                    }
-                }
+            darshan_log_batch_add(batch, i, region->buf, region->len,
+                region->ret);
+        }
+        else
+        {
+            /* if module is registered locally, perform module shutdown operations */
+            if(this_mod)
+            {
+                mod_buf = final_core->mod_array[i]->rec_buf_start;
+                mod_buf_sz = final_core->mod_array[i]->rec_buf_p - mod_buf;
 
-                /* allow the module an opportunity to reduce shared files */
-                if(this_mod->mod_funcs.mod_redux_func && (mod_shared_rec_cnt > 0) &&
-                   (!getenv("DARSHAN_DISABLE_SHARED_REDUCTION")))
-                {
-                    this_mod->mod_funcs.mod_redux_func(mod_buf, final_core->mpi_comm,
-                        mod_shared_recs, mod_shared_rec_cnt);
-                }
+                /* get the final output buffer */
+                this_mod->mod_funcs.mod_output_func(&mod_buf, &mod_buf_sz);
             }
-#endif
 
-            /* get the final output buffer */
-            this_mod->mod_funcs.mod_output_func(&mod_buf, &mod_buf_sz);
+            (void)darshan_log_batch_compress(batch, i, mod_buf, mod_buf_sz);
         }
 
-        /* append this module's data to the darshan log */
-        final_core->log_hdr_p->mod_map[i].off = gz_fp;
-        ret = darshan_log_append(log_fh, final_core, mod_buf, mod_buf_sz, &gz_fp);
-        final_core->log_hdr_p->mod_map[i].len =
-            gz_fp - final_core->log_hdr_p->mod_map[i].off;
+        /* append the batch's data to the darshan log once it is full */
+        ret = 0;
+        if(batch->count == DARSHAN_LOG_BATCH_SIZE || i == last_active_mod)
+        {
+            ret = darshan_log_batch_issue(log_fh, final_core, batch, &gz_fp);
+            for(j = 0; j < batch->count; j++)
+            {
+                final_core->log_hdr_p->mod_map[batch->mod_ids[j]].off =
+                    batch->offs[j];
+                final_core->log_hdr_p->mod_map[batch->mod_ids[j]].len =
+                    batch->global_lens[j];
+            }
+            log_batch = !log_batch;
+        }
 
         if(internal_timing_flag)
             mod2[i] = darshan_core_wtime_absolute();
@@ -686,6 +1289,24 @@ void darshan_core_shutdown(int write_log)
             darshan_module_names[i], logfile_name);
     }
 
+    /* complete the writes in flight */
+    if(internal_timing_flag)
+        write_wait1 = darshan_core_wtime_absolute();
+    ret = darshan_log_batch_wait(&log_batches[0]);
+    ret |= darshan_log_batch_wait(&log_batches[1]);
+    if(internal_timing_flag)
+        write_wait_tm += darshan_core_wtime_absolute() - write_wait1;
+    DARSHAN_CHECK_ERR(ret, "unable to write module data to log file %s",
+        logfile_name);
+
+    if(comp_pool)
+    {
+        comp_tm = comp_pool->wait_time;
+        comp_serial_tm = comp_pool->comp_time;
+        darshan_comp_pool_stop(comp_pool);
+        comp_pool = NULL;
+    }
+
     if(internal_timing_flag)
         header1 = darshan_core_wtime_absolute();
     ret = darshan_log_write_header(log_fh, final_core);
@@ -706,6 +1327,8 @@ void darshan_core_shutdown(int write_log)
         double job_tm;
         double rec_tm;
         double mod_tm[DARSHAN_MAX_MODS];
+        double redux_tm;
+        double agg_tm;
         double all_tm;
 
         tm_end = darshan_core_wtime_absolute();
@@ -715,9 +1338,11 @@ void darshan_core_shutdown(int write_log)
         job_tm = job2 - job1;
         rec_tm = rec2 - rec1;
         all_tm = tm_end - start_log_time;
+        redux_tm = redux2 - redux1;
+        agg_tm = agg2 - agg1;
         for(i = 0; i < DARSHAN_MAX_MODS; i++)
         {
-            mod_tm[i] = mod2[i] - mod1[i];
+            mod_tm[i] = mod2[i] - mod1[i] + mod_redux[i] + mod_out[i];
         }
 
 #ifdef HAVE_MPI
@@ -733,8 +1358,18 @@ void darshan_core_shutdown(int write_log)
                     MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
                 PMPI_Reduce(MPI_IN_PLACE, &rec_tm, 1,
                     MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
+                PMPI_Reduce(MPI_IN_PLACE, &redux_tm, 1,
+                    MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
+                PMPI_Reduce(MPI_IN_PLACE, &agg_tm, 1,
+                    MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
                 PMPI_Reduce(MPI_IN_PLACE, &all_tm, 1,
                     MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
+                PMPI_Reduce(MPI_IN_PLACE, &write_wait_tm, 1,
+                    MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
+                PMPI_Reduce(MPI_IN_PLACE, &comp_tm, 1,
+                    MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
+                PMPI_Reduce(MPI_IN_PLACE, &comp_serial_tm, 1,
+                    MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
                 PMPI_Reduce(MPI_IN_PLACE, mod_tm, DARSHAN_MAX_MODS,
                     MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
             }
@@ -748,8 +1383,18 @@ void darshan_core_shutdown(int write_log)
                     MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
                 PMPI_Reduce(&rec_tm, &rec_tm, 1,
                     MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
+                PMPI_Reduce(&redux_tm, &redux_tm, 1,
+                    MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
+                PMPI_Reduce(&agg_tm, &agg_tm, 1,
+                    MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
                 PMPI_Reduce(&all_tm, &all_tm, 1,
                     MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
+                PMPI_Reduce(&write_wait_tm, &write_wait_tm, 1,
+                    MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
+                PMPI_Reduce(&comp_tm, &comp_tm, 1,
+                    MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
+                PMPI_Reduce(&comp_serial_tm, &comp_serial_tm, 1,
+                    MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
                 PMPI_Reduce(mod_tm, mod_tm, DARSHAN_MAX_MODS,
                     MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
 
@@ -764,6 +1409,26 @@ void darshan_core_shutdown(int write_log)
         darshan_core_fprintf(stderr, "darshan:job_write\t%d\t%f\n", nprocs, job_tm);
         darshan_core_fprintf(stderr, "darshan:hash_write\t%d\t%f\n", nprocs, rec_tm);
         darshan_core_fprintf(stderr, "darshan:header_write\t%d\t%f\n", nprocs, header_tm);
+        if(using_mpi)
+            darshan_core_fprintf(stderr, "darshan:shared_redux\t%d\t%f\n", nprocs, redux_tm);
+        /* time to set up the node and node leader communicators */
+        if(agg2 > 0)
+            darshan_core_fprintf(stderr, "darshan:node_agg_setup\t%d\t%f\n", nprocs, agg_tm);
+        /* time spent blocked on module data writes that did not overlap
+         * with producing the following modules' data
+         */
+        darshan_core_fprintf(stderr, "darshan:mod_write_wait\t%d\t%f\n", nprocs, write_wait_tm);
+        if(comp_threads > 1)
+        {
+            /* time shutdown spent waiting on the compression thread pool,
+             * and the time the compression would have taken serially
+             */
+            darshan_core_fprintf(stderr, "darshan:compress\t%d\t%f\n", nprocs, comp_tm);
+            darshan_core_fprintf(stderr, "darshan:compress_serial\t%d\t%f\n", nprocs, comp_serial_tm);
+            if(comp_tm > 0)
+                darshan_core_fprintf(stderr, "darshan:compress_speedup\t%d\t%f\n",
+                    nprocs, comp_serial_tm / comp_tm);
+        }
         for(i = 0; i < DARSHAN_MAX_MODS; i++)
         {
             if(active_mods[i])
@@ -774,6 +1439,13 @@ void darshan_core_shutdown(int write_log)
     }
 
 cleanup:
+    darshan_log_batch_free(&log_batches[0]);
+    darshan_log_batch_free(&log_batches[1]);
+#ifdef DARSHAN_LOG_NODE_AGG
+    darshan_log_node_agg_stop(darshan_node_agg);
+    darshan_node_agg = NULL;
+#endif
+    darshan_comp_pool_stop(comp_pool);
     for(i = 0; i < DARSHAN_MAX_MODS; i++)
         if(final_core->mod_array[i])
             final_core->mod_array[i]->mod_funcs.mod_cleanup_func();
@@ -793,6 +1465,10 @@ cleanup:
 /* *********************************** */
 
 #ifdef __DARSHAN_ENABLE_MMAP_LOGS
+#ifndef HUGETLBFS_MAGIC
+#define HUGETLBFS_MAGIC 0x958458f6
+#endif
+
 static void *darshan_init_mmap_log(struct darshan_core_runtime* core, int jobid)
 {
     int ret;
@@ -806,21 +1482,27 @@ static void *darshan_init_mmap_log(struct darshan_core_runtime* core, int jobid)
     char *envstr;
     char *mmap_log_path;
     void *mmap_p;
+    struct statfs statfsbuf;
 
     sys_page_size = sysconf(_SC_PAGESIZE);
     assert(sys_page_size > 0);
 
-    mmap_size = sizeof(struct darshan_header) + DARSHAN_JOB_RECORD_SIZE +
-        + DARSHAN_NAME_RECORD_BUF_SIZE + darshan_mod_mem_quota;
-    if(mmap_size % sys_page_size)
-        mmap_size = ((mmap_size / sys_page_size) + 1) * sys_page_size;
-
     envstr = getenv(DARSHAN_MMAP_LOG_PATH_OVERRIDE);
     if(envstr)
         mmap_log_path = envstr;
     else
         mmap_log_path = DARSHAN_DEF_MMAP_LOG_PATH;
 
+    /* files on hugetlbfs are backed by (and sized in) huge pages */
+    if(statfs(mmap_log_path, &statfsbuf) == 0 &&
+       statfsbuf.f_type == HUGETLBFS_MAGIC && statfsbuf.f_bsize > 0)
+        sys_page_size = statfsbuf.f_bsize;
+
+    mmap_size = sizeof(struct darshan_header) + DARSHAN_JOB_RECORD_SIZE +
+        + darshan_name_mem_quota + darshan_mod_mem_quota;
+    if(mmap_size % sys_page_size)
+        mmap_size = ((mmap_size / sys_page_size) + 1) * sys_page_size;
+
     darshan_get_user_name(cuser);
 
     /* generate a random number to help differentiate the temporary log */
@@ -883,6 +1565,14 @@ static void *darshan_init_mmap_log(struct darshan_core_runtime* core, int jobid)
     /* close darshan log file (this does *not* unmap the log file) */
     close(mmap_fd);
 
+#ifdef MADV_HUGEPAGE
+    /* shared memory file systems may back the log with transparent huge
+     * pages if asked to
+     */
+    if(darshan_huge_page_mode != DARSHAN_HUGE_PAGES_NONE)
+        (void)madvise(mmap_p, mmap_size, MADV_HUGEPAGE);
+#endif
+
     return(mmap_p);
 }
 #endif
@@ -933,40 +1623,183 @@ static void darshan_log_record_hints_and_ver(struct darshan_core_runtime* core)
     return;
 }
 
-static int mnt_data_cmp(const void* a, const void* b)
+/* record which timer backend is in use in the job metadata */
+static void darshan_log_record_timer(struct darshan_core_runtime* core)
 {
-    const struct darshan_core_mnt_data *d_a = (const struct darshan_core_mnt_data*)a;
-    const struct darshan_core_mnt_data *d_b = (const struct darshan_core_mnt_data*)b;
-
-    if(strlen(d_a->path) > strlen(d_b->path))
-        return(-1);
-    else if(strlen(d_a->path) < strlen(d_b->path))
-        return(1);
+    char timer[64];
+    int meta_remain;
+
+#ifdef __DARSHAN_RDTSCP_FREQUENCY
+    sprintf(timer, "timer=rdtscp\ntsc_freq=%llu\n",
+        (unsigned long long)__DARSHAN_RDTSCP_FREQUENCY);
+#elif defined(__DARSHAN_TSC_TIMER)
+    if(__darshan_core_tsc_period > 0)
+        sprintf(timer, "timer=tsc\ntsc_freq=%.0f\n", darshan_tsc_frequency);
     else
-        return(0);
+        sprintf(timer, "timer=clock_gettime\n");
+#else
+    sprintf(timer, "timer=clock_gettime\n");
+#endif
+
+    meta_remain = DARSHAN_JOB_METADATA_LEN -
+        strlen(core->log_job_p->metadata) - 1;
+    if(meta_remain >= strlen(timer))
+        strcat(core->log_job_p->metadata, timer);
+
+    return;
 }
 
-/* adds an entry to table of mounted file systems */
-static void add_entry(char* buf, int* space_left, struct mntent* entry)
+/* record the number of records each module failed to register (summed
+ * across all processes) in the job metadata, distinguishing records that
+ * were dropped from those folded into overflow records
+ */
+static void darshan_log_record_partial(struct darshan_core_runtime* core)
 {
-    int i;
-    int ret;
-    char tmp_mnt[256];
-    struct statfs statfsbuf;
+    /* dropped counts followed by folded counts */
+    uint64_t counts[2 * DARSHAN_MAX_MODS] = {0};
+    const char *keys[2] = {"mem_partial", "mem_folded"};
+    char partial[DARSHAN_JOB_METADATA_LEN];
+    uint64_t *key_counts;
+    int meta_remain;
+    int len;
+    int i, k;
 
-    /* avoid adding the same mount points multiple times -- to limit
-     * storage space and potential statfs, ioctl, etc calls
-     */
-    for(i = 0; i < mnt_data_count; i++)
+    for(i = 0; i < DARSHAN_MAX_MODS; i++)
     {
-        if((strncmp(mnt_data_array[i].path, entry->mnt_dir, DARSHAN_MAX_MNT_PATH) == 0) &&
-           (strncmp(mnt_data_array[i].type, entry->mnt_type, DARSHAN_MAX_MNT_PATH) == 0))
-            return;
+        if(core->mod_array[i])
+        {
+            counts[i] = core->mod_array[i]->rec_dropped;
+            counts[DARSHAN_MAX_MODS + i] = core->mod_array[i]->rec_folded;
+        }
     }
 
-    strncpy(mnt_data_array[mnt_data_count].path, entry->mnt_dir,
-        DARSHAN_MAX_MNT_PATH-1);
-    strncpy(mnt_data_array[mnt_data_count].type, entry->mnt_type,
+#ifdef HAVE_MPI
+    if(using_mpi)
+    {
+        if(my_rank == 0)
+            PMPI_Reduce(MPI_IN_PLACE, counts, 2 * DARSHAN_MAX_MODS,
+                MPI_UINT64_T, MPI_SUM, 0, core->mpi_comm);
+        else
+        {
+            PMPI_Reduce(counts, counts, 2 * DARSHAN_MAX_MODS,
+                MPI_UINT64_T, MPI_SUM, 0, core->mpi_comm);
+            return;
+        }
+    }
+#endif
+
+    for(k = 0; k < 2; k++)
+    {
+        key_counts = &counts[k * DARSHAN_MAX_MODS];
+
+        /* e.g., "mem_partial=POSIX:1024,STDIO:12" */
+        len = sprintf(partial, "%s=", keys[k]);
+        for(i = 0; i < DARSHAN_KNOWN_MODULE_COUNT; i++)
+        {
+            if(key_counts[i] == 0)
+                continue;
+            if(len + strlen(darshan_module_names[i]) + 22 >= sizeof(partial))
+                break;
+            len += sprintf(&partial[len], "%s%s:%" PRIu64,
+                (partial[len-1] == '=') ? "" : ",", darshan_module_names[i],
+                key_counts[i]);
+        }
+        if(partial[len-1] == '=')
+            continue;
+        strcat(partial, "\n");
+
+        meta_remain = DARSHAN_JOB_METADATA_LEN -
+            strlen(core->log_job_p->metadata) - 1;
+        if(meta_remain >= strlen(partial))
+            strcat(core->log_job_p->metadata, partial);
+    }
+
+    return;
+}
+
+/* detect whether the TSC is suitable for timing, and if so calibrate its
+ * frequency against CLOCK_MONOTONIC. Otherwise, clock_gettime() is used.
+ * Calibration is only done once per process, as the frequency of an
+ * invariant TSC does not change.
+ */
+static void darshan_core_init_timer()
+{
+#ifdef __DARSHAN_TSC_TIMER
+    unsigned int eax, ebx, ecx, edx;
+    unsigned int flag;
+    unsigned long long ts1, ts2;
+    struct timespec tp1, tp2;
+    double elapsed;
+
+    if(darshan_tsc_calibrated)
+        return;
+    darshan_tsc_calibrated = 1;
+
+    if(getenv("DARSHAN_DISABLE_TSC_TIMER"))
+        return;
+
+    /* the CPU must support RDTSCP and have an invariant TSC, which ticks
+     * at a constant rate regardless of frequency scaling and sleep states
+     */
+    if(!__get_cpuid(0x80000001, &eax, &ebx, &ecx, &edx) || !(edx & (1 << 27)))
+        return;
+    if(!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1 << 8)))
+        return;
+
+    /* count TSC ticks over a short interval of CLOCK_MONOTONIC time */
+    clock_gettime(CLOCK_MONOTONIC, &tp1);
+    ts1 = __rdtscp(&flag);
+    do
+    {
+        clock_gettime(CLOCK_MONOTONIC, &tp2);
+        ts2 = __rdtscp(&flag);
+        elapsed = (double)(tp2.tv_sec - tp1.tv_sec) +
+            1.0e-9 * (double)(tp2.tv_nsec - tp1.tv_nsec);
+    } while(elapsed < DARSHAN_TSC_CALIBRATION_TIME);
+
+    if(ts2 <= ts1)
+        return;
+
+    darshan_tsc_frequency = (double)(ts2 - ts1) / elapsed;
+    __darshan_core_tsc_period = 1.0 / darshan_tsc_frequency;
+#endif
+
+    return;
+}
+
+static int mnt_data_cmp(const void* a, const void* b)
+{
+    const struct darshan_core_mnt_data *d_a = (const struct darshan_core_mnt_data*)a;
+    const struct darshan_core_mnt_data *d_b = (const struct darshan_core_mnt_data*)b;
+
+    if(strlen(d_a->path) > strlen(d_b->path))
+        return(-1);
+    else if(strlen(d_a->path) < strlen(d_b->path))
+        return(1);
+    else
+        return(0);
+}
+
+/* adds an entry to table of mounted file systems */
+static void add_entry(struct mntent* entry)
+{
+    int i;
+    int ret;
+    struct statfs statfsbuf;
+
+    /* avoid adding the same mount points multiple times -- to limit
+     * storage space and potential statfs, ioctl, etc calls
+     */
+    for(i = 0; i < mnt_data_count; i++)
+    {
+        if((strncmp(mnt_data_array[i].path, entry->mnt_dir, DARSHAN_MAX_MNT_PATH) == 0) &&
+           (strncmp(mnt_data_array[i].type, entry->mnt_type, DARSHAN_MAX_MNT_PATH) == 0))
+            return;
+    }
+
+    strncpy(mnt_data_array[mnt_data_count].path, entry->mnt_dir,
+        DARSHAN_MAX_MNT_PATH-1);
+    strncpy(mnt_data_array[mnt_data_count].type, entry->mnt_type,
         DARSHAN_MAX_MNT_TYPE-1);
     /* NOTE: we now try to detect the preferred block size for each file
      * system using fstatfs().  On Lustre we assume a size of 1 MiB
@@ -1014,41 +1847,108 @@ static void add_entry(char* buf, int* space_left, struct mntent* entry)
     }
 #endif
 
-    /* store mount information with the job-level metadata in darshan log */
-    ret = snprintf(tmp_mnt, 256, "\n%s\t%s",
-        entry->mnt_type, entry->mnt_dir);
-    if(ret < 256 && strlen(tmp_mnt) <= (*space_left))
-    {
-        strcat(buf, tmp_mnt);
-        (*space_left) -= strlen(tmp_mnt);
-    }
-
     mnt_data_count++;
     return;
 }
 
-/* darshan_get_exe_and_mounts()
- *
- * collects command line and list of mounted file systems into a string that
- * will be stored with the job-level metadata
+/* fills in the table of mounted file systems, in mount table order. We
+ * make two passes through mounted file systems; in the first pass we grab
+ * any non-nfs mount points, then on the second pass we grab nfs mount
+ * points
  */
-static void darshan_get_exe_and_mounts(struct darshan_core_runtime *core,
-    int argc, char **argv)
+static void darshan_discover_mounts(char **fs_exclusions)
 {
     FILE* tab;
     struct mntent *entry;
     char* exclude;
-    char* truncate_string = "<TRUNCATED>";
-    int truncate_offset;
-    int space_left = DARSHAN_EXE_LEN;
-    FILE *fh;
-    int i, ii;
-    char cmdl[DARSHAN_EXE_LEN];
     int tmp_index = 0;
     int skip = 0;
-    char* env_exclusions;
-    char* string;
-    char* token;
+
+    mnt_data_count = 0;
+
+    tab = setmntent("/etc/mtab", "r");
+    if(!tab)
+        return;
+    /* loop through list of mounted file systems */
+    while(mnt_data_count<DARSHAN_MAX_MNTS && (entry = getmntent(tab)) != NULL)
+    {
+        /* filter out excluded fs types */
+        tmp_index = 0;
+        skip = 0;
+        while((exclude = fs_exclusions[tmp_index]))
+        {
+            if(!(strcmp(exclude, entry->mnt_type)))
+            {
+                skip =1;
+                break;
+            }
+            tmp_index++;
+        }
+
+        if(skip || (strcmp(entry->mnt_type, "nfs") == 0))
+            continue;
+
+        add_entry(entry);
+    }
+    endmntent(tab);
+
+    tab = setmntent("/etc/mtab", "r");
+    if(!tab)
+        return;
+    /* loop through list of mounted file systems */
+    while(mnt_data_count<DARSHAN_MAX_MNTS && (entry = getmntent(tab)) != NULL)
+    {
+        if(strcmp(entry->mnt_type, "nfs") != 0)
+            continue;
+
+        add_entry(entry);
+    }
+    endmntent(tab);
+
+    return;
+}
+
+/* reads the mount table cached in shared memory into mnt_data_array, if it
+ * is valid for the given mount table file hash. Returns 1 on success, 0 if
+ * the table has to be discovered again.
+ */
+static int darshan_mnt_cache_read(int fd, uint64_t mtab_hash)
+{
+    struct darshan_mnt_cache *cache;
+    int ret = 0;
+
+    cache = mmap(NULL, sizeof(*cache), PROT_READ, MAP_SHARED, fd, 0);
+    if(cache == MAP_FAILED)
+        return(0);
+
+    if(cache->magic == DARSHAN_MAGIC_NR && cache->mtab_hash == mtab_hash &&
+       cache->count >= 0 && cache->count <= DARSHAN_MAX_MNTS)
+    {
+        mnt_data_count = cache->count;
+        memcpy(mnt_data_array, cache->mnts,
+            mnt_data_count * sizeof(mnt_data_array[0]));
+        ret = 1;
+    }
+    munmap(cache, sizeof(*cache));
+
+    return(ret);
+}
+
+/* fills in the table of mounted file systems, discovering it on only one
+ * process per node (see DARSHAN_MNT_NODE_SHARE and struct darshan_mnt_cache).
+ * This is collective over the processes on each node, so MPI processes must
+ * call it before they may give up on initializing Darshan.
+ */
+static void darshan_get_mounts(struct darshan_core_runtime *core)
+{
+    char cache_path[__DARSHAN_PATH_MAX];
+    char buf[4096];
+    struct darshan_mnt_cache *cache;
+    struct stat statbuf;
+    uint64_t mtab_hash;
+    ssize_t len;
+    int cached;
+    int fd;
 
     /* skip these fs types */
     static char* fs_exclusions[] = {
@@ -1068,11 +1968,138 @@ static void darshan_get_exe_and_mounts(struct darshan_core_runtime *core,
         NULL
     };
 
+    /* no fs types are skipped if the user set DARSHAN_EXCLUDE_DIRS */
+    if(getenv("DARSHAN_EXCLUDE_DIRS"))
+        fs_exclusions[0] = NULL;
+
+#ifdef DARSHAN_MNT_NODE_SHARE
+    if(using_mpi)
+    {
+        MPI_Comm node_comm;
+        int node_rank;
+
+        PMPI_Comm_split_type(core->mpi_comm, MPI_COMM_TYPE_SHARED, my_rank,
+            MPI_INFO_NULL, &node_comm);
+        PMPI_Comm_rank(node_comm, &node_rank);
+        if(node_rank == 0)
+            darshan_discover_mounts(fs_exclusions);
+        PMPI_Bcast(&mnt_data_count, 1, MPI_INT, 0, node_comm);
+        PMPI_Bcast(mnt_data_array, mnt_data_count * sizeof(mnt_data_array[0]),
+            MPI_BYTE, 0, node_comm);
+        PMPI_Comm_free(&node_comm);
+        return;
+    }
+#endif
+    if(using_mpi || getenv("DARSHAN_DISABLE_MNT_CACHE"))
+    {
+        darshan_discover_mounts(fs_exclusions);
+        return;
+    }
+
+    /* the cache is only valid for the same mount table and fs type
+     * exclusions, and for builds that collect the same mount information
+     */
+#ifdef DARSHAN_LUSTRE
+    snprintf(buf, sizeof(buf), "lustre %d", (fs_exclusions[0] != NULL));
+#else
+    snprintf(buf, sizeof(buf), "%d", (fs_exclusions[0] != NULL));
+#endif
+    mtab_hash = darshan_hash((unsigned char *)buf, strlen(buf), 0);
+    fd = open("/etc/mtab", O_RDONLY);
+    if(fd < 0)
+    {
+        darshan_discover_mounts(fs_exclusions);
+        return;
+    }
+    while((len = read(fd, buf, sizeof(buf))) > 0)
+        mtab_hash = darshan_hash((unsigned char *)buf, len, mtab_hash);
+    close(fd);
+
+    snprintf(cache_path, __DARSHAN_PATH_MAX, "%s/darshan-mnts-%s-%d",
+        DARSHAN_MNT_CACHE_DIR, DARSHAN_LOG_VERSION, (int)getuid());
+    fd = open(cache_path, O_RDWR|O_CREAT|O_NOFOLLOW, 0600);
+    if(fd < 0 || fstat(fd, &statbuf) < 0 || statbuf.st_uid != getuid())
+    {
+        if(fd >= 0)
+            close(fd);
+        darshan_discover_mounts(fs_exclusions);
+        return;
+    }
+
+    /* readers share the lock; the first process to find the cache empty
+     * or stale discovers the mounts and updates it with the lock held
+     * exclusively, while the others wait to read its result
+     */
+    if(statbuf.st_size == sizeof(*cache) && flock(fd, LOCK_SH) == 0)
+    {
+        cached = darshan_mnt_cache_read(fd, mtab_hash);
+        flock(fd, LOCK_UN);
+        if(cached)
+        {
+            close(fd);
+            return;
+        }
+    }
+
+    if(flock(fd, LOCK_EX) < 0)
+    {
+        close(fd);
+        darshan_discover_mounts(fs_exclusions);
+        return;
+    }
+    if(fstat(fd, &statbuf) == 0 && statbuf.st_size == sizeof(*cache) &&
+       darshan_mnt_cache_read(fd, mtab_hash))
+    {
+        flock(fd, LOCK_UN);
+        close(fd);
+        return;
+    }
+
+    darshan_discover_mounts(fs_exclusions);
+    if(ftruncate(fd, sizeof(*cache)) == 0)
+    {
+        cache = mmap(NULL, sizeof(*cache), PROT_READ|PROT_WRITE, MAP_SHARED,
+            fd, 0);
+        if(cache != MAP_FAILED)
+        {
+            cache->magic = DARSHAN_MAGIC_NR;
+            cache->mtab_hash = mtab_hash;
+            cache->count = mnt_data_count;
+            memcpy(cache->mnts, mnt_data_array,
+                mnt_data_count * sizeof(mnt_data_array[0]));
+            munmap(cache, sizeof(*cache));
+        }
+    }
+    flock(fd, LOCK_UN);
+    close(fd);
+
+    return;
+}
+
+/* darshan_get_exe_and_mounts()
+ *
+ * collects command line and list of mounted file systems into a string that
+ * will be stored with the job-level metadata
+ */
+static void darshan_get_exe_and_mounts(struct darshan_core_runtime *core,
+    int argc, char **argv)
+{
+    char* truncate_string = "<TRUNCATED>";
+    int truncate_offset;
+    int space_left = DARSHAN_EXE_LEN;
+    FILE *fh;
+    int i, ii;
+    int ret;
+    char cmdl[DARSHAN_EXE_LEN];
+    char tmp_mnt[256];
+    char* env_exclusions;
+    char* string;
+    char* token;
+
     /* Check if user has set the env variable DARSHAN_EXCLUDE_DIRS */
     env_exclusions = getenv("DARSHAN_EXCLUDE_DIRS");
     if(env_exclusions)
     {
-        fs_exclusions[0]=NULL;
         /* if DARSHAN_EXCLUDE_DIRS=none, do not exclude any dir */
         if(strncmp(env_exclusions,"none",strlen(env_exclusions))>=0)
         {
@@ -1168,50 +2195,17 @@ static void darshan_get_exe_and_mounts(struct darshan_core_runtime *core,
             truncate_string);
     }
 
-    /* we make two passes through mounted file systems; in the first pass we
-     * grab any non-nfs mount points, then on the second pass we grab nfs
-     * mount points
-     */
-    mnt_data_count = 0;
-
-    tab = setmntent("/etc/mtab", "r");
-    if(!tab)
-        return;
-    /* loop through list of mounted file systems */
-    while(mnt_data_count<DARSHAN_MAX_MNTS && (entry = getmntent(tab)) != NULL)
+    /* store mount information with the job-level metadata in darshan log */
+    for(i = 0; i < mnt_data_count; i++)
     {
-        /* filter out excluded fs types */
-        tmp_index = 0;
-        skip = 0;
-        while((exclude = fs_exclusions[tmp_index]))
+        ret = snprintf(tmp_mnt, 256, "\n%s\t%s",
+            mnt_data_array[i].type, mnt_data_array[i].path);
+        if(ret < 256 && strlen(tmp_mnt) <= space_left)
         {
-            if(!(strcmp(exclude, entry->mnt_type)))
-            {
-                skip =1;
-                break;
-            }
-            tmp_index++;
+            strcat(core->log_exemnt_p, tmp_mnt);
+            space_left -= strlen(tmp_mnt);
         }
-
-        if(skip || (strcmp(entry->mnt_type, "nfs") == 0))
-            continue;
-
-        add_entry(core->log_exemnt_p, &space_left, entry);
-    }
-    endmntent(tab);
-
-    tab = setmntent("/etc/mtab", "r");
-    if(!tab)
-        return;
-    /* loop through list of mounted file systems */
-    while(mnt_data_count<DARSHAN_MAX_MNTS && (entry = getmntent(tab)) != NULL)
-    {
-        if(strcmp(entry->mnt_type, "nfs") != 0)
-            continue;
-
-        add_entry(core->log_exemnt_p, &space_left, entry);
     }
-    endmntent(tab);
 
     /* sort mount points in order of longest path to shortest path.  This is
      * necessary so that if we try to match file paths to mount points later
@@ -1221,44 +2215,285 @@ static void darshan_get_exe_and_mounts(struct darshan_core_runtime *core,
     return;
 }
 
-static void darshan_fs_info_from_path(const char *path, struct darshan_fs_info *fs_info)
+/* returns the index of the mount point 'path' is on, or -1 if unknown */
+static int darshan_mnt_index_from_path(const char *path)
 {
     int i;
-    fs_info->fs_type = -1;
-    fs_info->block_size = -1;
 
-    for(i=0; i<mnt_data_count; i++)
+    if(darshan_path_trie)
     {
-        if(!(strncmp(mnt_data_array[i].path, path, strlen(mnt_data_array[i].path))))
+        darshan_path_trie_match(path, &i);
+        return(i);
+    }
+
+    for(i=0; i<mnt_data_count; i++)
+    {
+        if(!(strncmp(mnt_data_array[i].path, path, strlen(mnt_data_array[i].path))))
+            return(i);
+    }
+
+    return(-1);
+}
+
+static void darshan_fs_info_from_path(const char *path, struct darshan_fs_info *fs_info)
+{
+    int i;
+    fs_info->fs_type = -1;
+    fs_info->block_size = -1;
+
+    i = darshan_mnt_index_from_path(path);
+    if(i >= 0)
+        *fs_info = mnt_data_array[i].fs_info;
+
+    return;
+}
+
+/* compile the path exclusions, inclusions, and mount points into the path
+ * trie. If this fails, the original lists are scanned linearly instead.
+ */
+static void darshan_build_path_trie()
+{
+    char *prefix;
+    int i;
+    int ret = 1;
+
+    free(darshan_path_trie);
+    darshan_path_trie = NULL;
+    darshan_path_trie_count = 0;
+    darshan_path_trie_size = 0;
+
+    /* root node, matching the empty prefix */
+    if(darshan_path_trie_new_node('\0') < 0)
+        return;
+
+    if(user_darshan_path_exclusions != NULL)
+    {
+        /* user exclusions override the default exclusions and inclusions */
+        for(i = 0; ret && (prefix = user_darshan_path_exclusions[i]); i++)
+            ret = darshan_path_trie_insert(prefix, DARSHAN_PATH_TRIE_EXCLUDE, -1);
+    }
+    else if(darshan_path_exclusions[0] != NULL)
+    {
+        for(i = 0; ret && (prefix = darshan_path_exclusions[i]); i++)
+            ret = darshan_path_trie_insert(prefix, DARSHAN_PATH_TRIE_EXCLUDE, -1);
+        for(i = 0; ret && (prefix = darshan_path_inclusions[i]); i++)
+            ret = darshan_path_trie_insert(prefix, DARSHAN_PATH_TRIE_INCLUDE, -1);
+    }
+
+    /* mount points are sorted longest first; for duplicate mount paths the
+     * first entry is kept, as in a linear scan
+     */
+    for(i = 0; ret && i < mnt_data_count; i++)
+        ret = darshan_path_trie_insert(mnt_data_array[i].path, 0, i);
+
+    if(!ret)
+    {
+        free(darshan_path_trie);
+        darshan_path_trie = NULL;
+        darshan_path_trie_count = 0;
+        darshan_path_trie_size = 0;
+    }
+
+    return;
+}
+
+/* append a new node for the given character to the path trie, returning its
+ * index, or -1 on failure to allocate it
+ */
+static int darshan_path_trie_new_node(char c)
+{
+    struct darshan_path_trie_node *tmp_trie;
+    int node;
+
+    if(darshan_path_trie_count == darshan_path_trie_size)
+    {
+        tmp_trie = realloc(darshan_path_trie,
+            (darshan_path_trie_size + 256) * sizeof(*darshan_path_trie));
+        if(!tmp_trie)
+            return(-1);
+        darshan_path_trie = tmp_trie;
+        darshan_path_trie_size += 256;
+    }
+
+    node = darshan_path_trie_count++;
+    darshan_path_trie[node].c = c;
+    darshan_path_trie[node].flags = 0;
+    darshan_path_trie[node].mnt_index = -1;
+    darshan_path_trie[node].first_child = -1;
+    darshan_path_trie[node].next_sibling = -1;
+
+    return(node);
+}
+
+/* add a prefix to the path trie, marking its final node with the given flags
+ * and mount index (if no mount index is set there yet). Returns 1 on success,
+ * 0 on failure to allocate nodes.
+ */
+static int darshan_path_trie_insert(const char *prefix, int flags, int mnt_index)
+{
+    int node = 0;
+    int child;
+
+    for(; *prefix != '\0'; prefix++)
+    {
+        for(child = darshan_path_trie[node].first_child; child >= 0;
+            child = darshan_path_trie[child].next_sibling)
         {
-            *fs_info = mnt_data_array[i].fs_info;
-            return;
+            if(darshan_path_trie[child].c == *prefix)
+                break;
+        }
+        if(child < 0)
+        {
+            child = darshan_path_trie_new_node(*prefix);
+            if(child < 0)
+                return(0);
+            darshan_path_trie[child].next_sibling = darshan_path_trie[node].first_child;
+            darshan_path_trie[node].first_child = child;
+        }
+        node = child;
+    }
+
+    darshan_path_trie[node].flags |= flags;
+    if(mnt_index >= 0 && darshan_path_trie[node].mnt_index < 0)
+        darshan_path_trie[node].mnt_index = mnt_index;
+
+    return(1);
+}
+
+/* walk the path trie along the given path, returning the flags of all
+ * matching prefixes. The index of the longest matching mount point (or -1)
+ * is returned in mnt_index, if given.
+ */
+static int darshan_path_trie_match(const char *path, int *mnt_index)
+{
+    int node = 0;
+    int child;
+    int flags = darshan_path_trie[0].flags;
+    int tmp_mnt_index = darshan_path_trie[0].mnt_index;
+
+    for(; *path != '\0'; path++)
+    {
+        for(child = darshan_path_trie[node].first_child; child >= 0;
+            child = darshan_path_trie[child].next_sibling)
+        {
+            if(darshan_path_trie[child].c == *path)
+                break;
         }
+        if(child < 0)
+            break;
+
+        node = child;
+        flags |= darshan_path_trie[node].flags;
+        if(darshan_path_trie[node].mnt_index >= 0)
+            tmp_mnt_index = darshan_path_trie[node].mnt_index;
     }
 
+    if(mnt_index)
+        *mnt_index = tmp_mnt_index;
+    return(flags);
+}
+
+/* allocate a chunk with room for at least 'size' bytes of name records.
+ * Name chunks are small, so they are never backed by huge pages.
+ */
+static struct darshan_core_name_chunk *darshan_alloc_name_chunk(size_t size)
+{
+    struct darshan_core_name_chunk *chunk;
+
+    chunk = malloc(sizeof(*chunk) + size);
+    if(!chunk)
+        return(NULL);
+    chunk->size = size;
+    return(chunk);
+}
+
+static void darshan_free_name_chunk(struct darshan_core_name_chunk *chunk)
+{
+    free(chunk);
     return;
 }
 
+#ifndef __DARSHAN_ENABLE_MMAP_LOGS
+/* returns whether the memory of a removed name record of 'record_size'
+ * bytes can be reused
+ */
+static int darshan_name_free_slot_peek(struct darshan_core_runtime *core,
+    size_t record_size)
+{
+    size_t name_len = record_size - sizeof(darshan_record_id) - 1;
+
+    return(core->name_free_slots && name_len <= DARSHAN_NAME_FREE_LEN_MAX &&
+        core->name_free_slots[name_len]);
+}
+
+/* takes the memory of a removed name record of 'record_size' bytes for
+ * reuse, returning NULL if there is none
+ */
+static struct darshan_name_record *darshan_name_free_slot_pop(
+    struct darshan_core_runtime *core, size_t record_size)
+{
+    size_t name_len = record_size - sizeof(darshan_record_id) - 1;
+    struct darshan_name_record *name_rec;
+
+    if(!darshan_name_free_slot_peek(core, record_size))
+        return(NULL);
+
+    name_rec = core->name_free_slots[name_len];
+    memcpy(&core->name_free_slots[name_len], &name_rec->id,
+        sizeof(name_rec));
+    core->name_dead_count--;
+
+    return(name_rec);
+}
+#endif
+
 static int darshan_add_name_record_ref(struct darshan_core_runtime *core,
-    darshan_record_id rec_id, const char *name, darshan_module_id mod_id)
+    darshan_record_id rec_id, const char *name, darshan_module_id mod_id,
+    int overflow)
 {
     struct darshan_core_name_record_ref *ref;
     struct darshan_core_name_record_ref *check_ref;
+    struct darshan_core_name_chunk *chunk = NULL;
     int record_size = sizeof(darshan_record_id) + strlen(name) + 1;
+    size_t chunk_size = 0;
+    size_t name_mem_quota = darshan_name_mem_quota;
+
+    /* names of overflow records may use some memory past the quota */
+    if(overflow)
+        name_mem_quota += DARSHAN_OVERFLOW_MEM_MAX;
 
-    if((record_size + core->name_mem_used) > DARSHAN_NAME_RECORD_BUF_SIZE)
+    if((record_size + core->name_mem_used) > name_mem_quota)
         return(0);
 
-    /* drop core lock while we allocate reference.  Note that
-     * this means we must check for existence again in hash table once we
-     * re-acquire the lock, but this code path will only happen once per
+#ifndef __DARSHAN_ENABLE_MMAP_LOGS
+    /* name records are stored in a list of chunks, so determine if we
+     * need to allocate a new chunk to store this record in (unless the
+     * memory of a removed name of the same length can be reused)
+     */
+    if(!darshan_name_free_slot_peek(core, record_size) &&
+       (!core->name_chunk_tail ||
+       (core->name_chunk_tail->size - core->name_chunk_tail->used) < record_size))
+    {
+        chunk_size = DARSHAN_NAME_MEM_CHUNK_SIZE;
+        if(chunk_size < record_size)
+            chunk_size = record_size;
+    }
+#endif
+
+    /* drop core lock while we allocate reference (and name chunk).  Note
+     * that this means we must check for existence again in hash table once
+     * we re-acquire the lock, but this code path will only happen once per
      * file.
      */
     __DARSHAN_CORE_UNLOCK();
     ref = malloc(sizeof(*ref));
+    if(chunk_size)
+        chunk = darshan_alloc_name_chunk(chunk_size);
     __DARSHAN_CORE_LOCK();
-    if(!ref)
+    if(!ref || (chunk_size && !chunk))
     {
+        free(ref);
+        darshan_free_name_chunk(chunk);
         return(0);
     }
     memset(ref, 0, sizeof(*ref));
@@ -1267,11 +2502,67 @@ static int darshan_add_name_record_ref(struct darshan_core_runtime *core,
     HASH_FIND(hlink, core->name_hash, &rec_id,
         sizeof(darshan_record_id), check_ref);
     if(check_ref)
+    {
+        free(ref);
+        darshan_free_name_chunk(chunk);
         return(1);
+    }
+
+    if((record_size + core->name_mem_used) > name_mem_quota)
+    {
+        free(ref);
+        darshan_free_name_chunk(chunk);
+        return(0);
+    }
 
     /* initialize the name record */
+#ifndef __DARSHAN_ENABLE_MMAP_LOGS
+    ref->name_record = darshan_name_free_slot_pop(core, record_size);
+    if(ref->name_record)
+    {
+        darshan_free_name_chunk(chunk);
+    }
+    else if(!core->name_chunk_tail ||
+       (core->name_chunk_tail->size - core->name_chunk_tail->used) < record_size)
+    {
+        if(!chunk)
+        {
+            /* someone else filled the last chunk while we dropped the
+             * lock; this is rare enough to just allocate under the lock
+             */
+            chunk_size = DARSHAN_NAME_MEM_CHUNK_SIZE;
+            if(chunk_size < record_size)
+                chunk_size = record_size;
+            chunk = darshan_alloc_name_chunk(chunk_size);
+            if(!chunk)
+            {
+                free(ref);
+                return(0);
+            }
+        }
+        chunk->next = NULL;
+        chunk->used = 0;
+        if(core->name_chunk_tail)
+            core->name_chunk_tail->next = chunk;
+        else
+            core->name_chunk_head = chunk;
+        core->name_chunk_tail = chunk;
+    }
+    else if(chunk)
+    {
+        /* someone else added a chunk while we dropped the lock */
+        darshan_free_name_chunk(chunk);
+    }
+    if(!ref->name_record)
+    {
+        ref->name_record = (struct darshan_name_record *)
+            (core->name_chunk_tail->buf + core->name_chunk_tail->used);
+        core->name_chunk_tail->used += record_size;
+    }
+#else
     ref->name_record = (struct darshan_name_record *)
         ((char *)core->log_name_p + core->name_mem_used);
+#endif
     memset(ref->name_record, 0, record_size);
     ref->name_record->id = rec_id;
     strcpy(ref->name_record->name, name);
@@ -1287,6 +2578,90 @@ static int darshan_add_name_record_ref(struct darshan_core_runtime *core,
     return(1);
 }
 
+#ifndef __DARSHAN_ENABLE_MMAP_LOGS
+/* removes a name record reference from the name hash, releasing its share
+ * of the name memory quota. The name record itself is left in its chunk
+ * (so chunks can still be walked record by record), and its memory is kept
+ * for reuse by a name of the same length; names that are not reused are
+ * dropped from the chunks before the name records are written out.
+ * Must be called holding the core lock.
+ */
+static void darshan_remove_name_record_ref(struct darshan_core_runtime *core,
+    struct darshan_core_name_record_ref *ref)
+{
+    struct darshan_name_record *name_rec = ref->name_record;
+    size_t name_len = strlen(name_rec->name);
+
+    HASH_DELETE(hlink, core->name_hash, ref);
+    core->name_mem_used -= sizeof(darshan_record_id) + name_len + 1;
+    core->name_dead_count++;
+    free(ref);
+
+    /* free slots are kept in per-length lists, linked through the record
+     * id field of the removed name records
+     */
+    if(!core->name_free_slots)
+        core->name_free_slots = calloc(DARSHAN_NAME_FREE_LEN_MAX + 1,
+            sizeof(*core->name_free_slots));
+    if(!core->name_free_slots || name_len > DARSHAN_NAME_FREE_LEN_MAX)
+        return;
+    memcpy(&name_rec->id, &core->name_free_slots[name_len],
+        sizeof(name_rec));
+    core->name_free_slots[name_len] = name_rec;
+
+    return;
+}
+
+/* drops name records that were removed from the name hash (and not reused)
+ * from the name record chunks, moving the remaining records forward
+ */
+static void darshan_compact_dead_name_records(struct darshan_core_runtime *core)
+{
+    struct darshan_core_name_chunk *chunk;
+    struct darshan_core_name_record_ref *ref;
+    struct darshan_name_record *name_rec;
+    size_t rec_len, off, used;
+
+    if(core->name_dead_count == 0)
+        return;
+
+    for(chunk = core->name_chunk_head; chunk; chunk = chunk->next)
+    {
+        for(off = 0, used = 0; off < chunk->used; off += rec_len)
+        {
+            name_rec = (struct darshan_name_record *)(chunk->buf + off);
+            rec_len = sizeof(darshan_record_id) + strlen(name_rec->name) + 1;
+
+            /* records removed from the name hash (whose id field may now
+             * link free slots) are not referenced by the hash entry
+             */
+            HASH_FIND(hlink, core->name_hash, &(name_rec->id),
+                sizeof(darshan_record_id), ref);
+            if(!ref || ref->name_record != name_rec)
+                continue;
+
+            if(used != off)
+            {
+                HASH_DELETE(hlink, core->name_hash, ref);
+                memmove(chunk->buf + used, name_rec, rec_len);
+                ref->name_record =
+                    (struct darshan_name_record *)(chunk->buf + used);
+                HASH_ADD(hlink, core->name_hash, name_record->id,
+                    sizeof(darshan_record_id), ref);
+            }
+            used += rec_len;
+        }
+        chunk->used = used;
+    }
+
+    free(core->name_free_slots);
+    core->name_free_slots = NULL;
+    core->name_dead_count = 0;
+
+    return;
+}
+#endif
+
 static void darshan_get_user_name(char *cuser)
 {
     char* logname_string;
@@ -1327,112 +2702,666 @@ static void darshan_get_user_name(char *cuser)
 }
 
 #ifdef HAVE_MPI
+static int darshan_shared_detect_ndx_cmp(const void *a_p, const void *b_p)
+{
+    const struct darshan_shared_detect_ndx *a = a_p;
+    const struct darshan_shared_detect_ndx *b = b_p;
+
+    if(a->id < b->id)
+        return(-1);
+    if(a->id > b->id)
+        return(1);
+    return((a->pos > b->pos) - (a->pos < b->pos));
+}
+
+/* find the process that owns the given id, and the round in which it is
+ * sent to its owner
+ */
+#define DARSHAN_SHARED_DETECT_OWNER(__id) ((int)((__id) % (uint64_t)nprocs))
+#define DARSHAN_SHARED_DETECT_ROUND(__id, __rounds) \
+    ((int)(((__id) / (uint64_t)nprocs) % (uint64_t)(__rounds)))
+
+/* determine which records were registered by multiple processes, as well
+ * as how many processes registered each record and which of them has the
+ * lowest rank. Each record id is sent to an owner process selected by
+ * hashing the id, which counts the processes that registered it and
+ * answers each of them, so no process needs to hold more than its own
+ * records and the ids it owns.
+ */
 static void darshan_get_shared_records(struct darshan_core_runtime *core,
     darshan_record_id **shared_recs, int *shared_rec_cnt)
 {
-    int i, j;
-    int tmp_cnt = HASH_CNT(hlink, core->name_hash);
+    int local_cnt = HASH_CNT(hlink, core->name_hash);
+    int max_cnt;
+    int partial = 0;
+    int rounds;
+    int round;
+    int owner;
+    int recv_cnt;
+    int i, j, k, r;
     struct darshan_core_name_record_ref *tmp, *ref;
-    darshan_record_id *id_array;
-    uint64_t *mod_flags;
-    uint64_t *global_mod_flags;
+    struct darshan_core_name_record_ref **send_refs;
+    struct darshan_shared_detect_req *send_reqs, *recv_reqs;
+    struct darshan_shared_detect_resp *send_resps, *recv_resps;
+    struct darshan_shared_detect_ndx *ndx;
+    struct darshan_shared_detect_resp resp;
+    int *send_counts, *send_displs, *recv_counts, *recv_displs;
+    MPI_Datatype req_type, resp_type;
+
+    *shared_rec_cnt = 0;
+    *shared_recs = malloc(local_cnt * sizeof(darshan_record_id));
+    send_counts = malloc(4 * nprocs * sizeof(int));
+    assert(*shared_recs && send_counts);
+    send_displs = send_counts + nprocs;
+    recv_counts = send_displs + nprocs;
+    recv_displs = recv_counts + nprocs;
+
+    /* size the rounds based on the largest number of records registered
+     * by any process
+     */
+    PMPI_Allreduce(&local_cnt, &max_cnt, 1, MPI_INT, MPI_MAX, core->mpi_comm);
+    rounds = (max_cnt + DARSHAN_SHARED_DETECT_BATCH - 1) /
+        DARSHAN_SHARED_DETECT_BATCH;
+    if(rounds < 1)
+        rounds = 1;
+
+    PMPI_Type_contiguous(sizeof(struct darshan_shared_detect_req), MPI_BYTE,
+        &req_type);
+    PMPI_Type_commit(&req_type);
+    PMPI_Type_contiguous(sizeof(struct darshan_shared_detect_resp), MPI_BYTE,
+        &resp_type);
+    PMPI_Type_commit(&resp_type);
+
+    for(round = 0; round < rounds; round++)
+    {
+        /* count and pack this round's ids by owner */
+        memset(send_counts, 0, nprocs * sizeof(int));
+        HASH_ITER(hlink, core->name_hash, ref, tmp)
+        {
+            if(DARSHAN_SHARED_DETECT_ROUND(ref->name_record->id, rounds) == round)
+                send_counts[DARSHAN_SHARED_DETECT_OWNER(ref->name_record->id)]++;
+        }
+        for(i = 0, j = 0; i < nprocs; i++)
+        {
+            send_displs[i] = j;
+            j += send_counts[i];
+        }
 
-    /* broadcast root's number of records to all other processes */
-    PMPI_Bcast(&tmp_cnt, 1, MPI_INT, 0, core->mpi_comm);
+        send_refs = malloc(j * sizeof(*send_refs));
+        send_reqs = malloc(j * sizeof(*send_reqs));
+        send_resps = malloc(j * sizeof(*send_resps));
+        assert((send_refs && send_reqs && send_resps) || j == 0);
 
-    /* use root record count to allocate data structures */
-    id_array = malloc(tmp_cnt * sizeof(darshan_record_id));
-    mod_flags = malloc(tmp_cnt * sizeof(uint64_t));
-    global_mod_flags = malloc(tmp_cnt * sizeof(uint64_t));
-    *shared_recs = malloc(tmp_cnt * sizeof(darshan_record_id));
-    assert(id_array && mod_flags && global_mod_flags && *shared_recs);
+        memset(send_counts, 0, nprocs * sizeof(int));
+        HASH_ITER(hlink, core->name_hash, ref, tmp)
+        {
+            if(DARSHAN_SHARED_DETECT_ROUND(ref->name_record->id, rounds) != round)
+                continue;
+            owner = DARSHAN_SHARED_DETECT_OWNER(ref->name_record->id);
+            k = send_displs[owner] + send_counts[owner]++;
+            send_refs[k] = ref;
+            send_reqs[k].id = ref->name_record->id;
+            send_reqs[k].mod_flags = ref->mod_flags;
+        }
 
-    memset(mod_flags, 0, tmp_cnt * sizeof(uint64_t));
-    memset(global_mod_flags, 0, tmp_cnt * sizeof(uint64_t));
-    memset(*shared_recs, 0, tmp_cnt * sizeof(darshan_record_id));
+        /* send each id to its owner */
+        PMPI_Alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT,
+            core->mpi_comm);
+        for(i = 0, recv_cnt = 0; i < nprocs; i++)
+        {
+            recv_displs[i] = recv_cnt;
+            recv_cnt += recv_counts[i];
+        }
 
-    /* first, determine list of records root process has opened */
-    if(my_rank == 0)
-    {
-        i = 0;
-        HASH_ITER(hlink, core->name_hash, ref, tmp)
+        recv_reqs = malloc(recv_cnt * sizeof(*recv_reqs));
+        recv_resps = malloc(recv_cnt * sizeof(*recv_resps));
+        ndx = malloc(recv_cnt * sizeof(*ndx));
+        assert((recv_reqs && recv_resps && ndx) || recv_cnt == 0);
+
+        PMPI_Alltoallv(send_reqs, send_counts, send_displs, req_type,
+            recv_reqs, recv_counts, recv_displs, req_type, core->mpi_comm);
+
+        /* group the received ids. Ids received from the same process are
+         * unique, and are stored in order of rank, so the first position
+         * of each id is from the lowest rank that registered it.
+         */
+        for(r = 0, i = 0; r < nprocs; r++)
         {
-            id_array[i++] = ref->name_record->id;
+            for(j = 0; j < recv_counts[r]; j++, i++)
+            {
+                ndx[i].id = recv_reqs[i].id;
+                ndx[i].pos = i;
+                ndx[i].rank = r;
+            }
         }
-    }
+        qsort(ndx, recv_cnt, sizeof(*ndx), darshan_shared_detect_ndx_cmp);
+
+        for(i = 0; i < recv_cnt; i = j)
+        {
+            resp.global_mod_flags = recv_reqs[ndx[i].pos].mod_flags;
+            for(j = i + 1; j < recv_cnt && ndx[j].id == ndx[i].id; j++)
+                resp.global_mod_flags &= recv_reqs[ndx[j].pos].mod_flags;
+            resp.rank_count = j - i;
+            resp.first_rank = ndx[i].rank;
+
+            /* the sharers of the id, in rank order, form a binomial tree
+             * rooted at the lowest rank: the sharer at index v sends to
+             * the one at v with its lowest set bit cleared, in the step
+             * given by the position of that bit
+             */
+            for(k = i; k < j; k++)
+            {
+                int v = k - i;
 
-    /* broadcast root's list of records to all other processes */
-    PMPI_Bcast(id_array, (tmp_cnt * sizeof(darshan_record_id)),
-        MPI_BYTE, 0, core->mpi_comm);
+                resp.redux_parent = -1;
+                resp.redux_step = -1;
+                if(v > 0)
+                {
+                    resp.redux_parent = ndx[i + (v & (v - 1))].rank;
+                    for(resp.redux_step = 0; !(v & (1 << resp.redux_step));
+                        resp.redux_step++);
+                }
+                recv_resps[ndx[k].pos] = resp;
+            }
+        }
 
-    /* everyone looks to see if they opened the same records as root */
-    for(i=0; i<tmp_cnt; i++)
-    {
-        HASH_FIND(hlink, core->name_hash, &id_array[i], sizeof(darshan_record_id), ref);
-        if(ref)
+        /* answer each process, in the order it sent its ids */
+        PMPI_Alltoallv(recv_resps, recv_counts, recv_displs, resp_type,
+            send_resps, send_counts, send_displs, resp_type, core->mpi_comm);
+
+        for(i = 0; i < send_displs[nprocs - 1] + send_counts[nprocs - 1]; i++)
         {
-            /* we opened that record too, save the mod_flags */
-            mod_flags[i] = ref->mod_flags;
+            ref = send_refs[i];
+            ref->global_rank_count = send_resps[i].rank_count;
+            ref->global_first_rank = send_resps[i].first_rank;
+            ref->global_redux_parent = send_resps[i].redux_parent;
+            ref->global_redux_step = send_resps[i].redux_step;
+
+            /* set global_mod_flags for records that multiple processes
+             * registered, so we know which modules collectively accessed
+             * them. we need this info to support shared record reductions
+             */
+            if(send_resps[i].rank_count > 1 &&
+               send_resps[i].global_mod_flags != 0)
+            {
+                ref->global_mod_flags = send_resps[i].global_mod_flags;
+                (*shared_recs)[(*shared_rec_cnt)++] = ref->name_record->id;
+                if(send_resps[i].rank_count < nprocs)
+                    partial = 1;
+            }
         }
+
+        free(send_refs);
+        free(send_reqs);
+        free(send_resps);
+        free(recv_reqs);
+        free(recv_resps);
+        free(ndx);
     }
 
-    /* now allreduce so everyone agrees which records are shared and
-     * which modules accessed them collectively
+    /* let all processes know whether records shared by a subset of
+     * processes need to be exchanged when reducing shared records
      */
-    PMPI_Allreduce(mod_flags, global_mod_flags, tmp_cnt,
-        MPI_UINT64_T, MPI_BAND, core->mpi_comm);
+    PMPI_Allreduce(&partial, &darshan_shared_redux_partial, 1, MPI_INT,
+        MPI_MAX, core->mpi_comm);
+
+    PMPI_Type_free(&req_type);
+    PMPI_Type_free(&resp_type);
+    free(send_counts);
+    return;
+}
+
+/* look up the name record reference of a queued shared record */
+static struct darshan_core_name_record_ref *darshan_shared_redux_ref(
+    void *rec)
+{
+    struct darshan_core_name_record_ref *ref;
+
+    assert(darshan_shared_redux_core);
+    HASH_FIND(hlink, darshan_shared_redux_core->name_hash,
+        &((struct darshan_base_record *)rec)->id, sizeof(darshan_record_id),
+        ref);
+    assert(ref);
+
+    return(ref);
+}
+
+/* returns whether this process keeps the given shared record once it is
+ * reduced: rank 0 keeps the records shared by all processes, and the lowest
+ * sharing rank keeps those shared by a subset of processes
+ */
+static int darshan_shared_redux_kept(struct darshan_core_name_record_ref *ref)
+{
+    if(ref->global_rank_count == nprocs)
+        return(my_rank == 0);
+    return(ref->global_first_rank == my_rank);
+}
+
+/* copy a queued record into a reduction element, along with the initial
+ * variance state
+ */
+static void darshan_shared_redux_pack(struct darshan_shared_redux *redux,
+    char *rec, char *elem)
+{
+    struct darshan_variance_dt *var;
+    int k;
 
-    j = 0;
-    for(i=0; i<tmp_cnt; i++)
+    memcpy(elem, rec, redux->rec_size);
+    if(redux->elem_size > redux->rec_size)
     {
-        if(global_mod_flags[i] != 0)
+        var = (struct darshan_variance_dt *)(elem + redux->rec_size);
+        for(k = 0; k < 2; k++)
         {
-            (*shared_recs)[j++] = id_array[i];
-
-            /* set global_mod_flags so we know which modules collectively
-             * accessed this module. we need this info to support shared
-             * record reductions
-             */
-            HASH_FIND(hlink, core->name_hash, &id_array[i], sizeof(darshan_record_id), ref);
-            assert(ref);
-            ref->global_mod_flags = global_mod_flags[i];
+            var[k].n = 1;
+            var[k].S = 0;
+            var[k].T = *(double *)(rec + redux->var_off[k]);
         }
     }
-    *shared_rec_cnt = j;
 
-    free(id_array);
-    free(mod_flags);
-    free(global_mod_flags);
     return;
 }
-#endif
 
-/* construct the darshan log file name */
-/* NOTE: logfile_name argument is assumed to have already been allocated
- * with size __DARSHAN_PATH_MAX; length will be safety checked in this
- * function.
- */
-static void darshan_get_logfile_name(
-    char* logfile_name, struct darshan_core_runtime* core)
+/* copy a reduced element back to its record, computing the variances */
+static void darshan_shared_redux_unpack(struct darshan_shared_redux *redux,
+    char *elem, char *rec)
 {
-    char* user_logfile_name;
-    char* logpath;
-    char* logpath_override = NULL;
-#ifdef __DARSHAN_LOG_ENV
-    char env_check[256];
-    char* env_tok;
-#endif
-    uint64_t hlevel;
-    char hname[HOST_NAME_MAX];
-    uint64_t logmod;
-    char cuser[L_cuserid] = {0};
-    struct tm *start_tm;
-    int jobid;
-    int pid;
-    time_t start_time;
-    int ret;
+    struct darshan_variance_dt *var;
+    int k;
 
-#ifdef HAVE_MPI
+    memcpy(rec, elem, redux->rec_size);
+    if(redux->elem_size > redux->rec_size)
+    {
+        var = (struct darshan_variance_dt *)(elem + redux->rec_size);
+        for(k = 0; k < 2; k++)
+            *(double *)(rec + redux->var_off[k]) = var[k].S / var[k].n;
+    }
+
+    return;
+}
+
+/* reduce one element into another with the module's record reduction
+ * operator, followed by the variance state
+ */
+static void darshan_shared_redux_apply(struct darshan_shared_redux *redux,
+    char *in, char *inout, MPI_Datatype *datatype)
+{
+    int one = 1, two = 2;
+
+    redux->rec_op(in, inout, &one, datatype);
+    if(redux->elem_size > redux->rec_size)
+        darshan_variance_reduce(in + redux->rec_size,
+            inout + redux->rec_size, &two, datatype);
+
+    return;
+}
+
+/* MPI reduction operator for the shared record slots, which applies each
+ * slot's module record reduction operator and reduces the variance state
+ * following the record
+ */
+static void darshan_shared_redux_op(void *inbuf_v, void *inoutbuf_v,
+    int *len, MPI_Datatype *datatype)
+{
+    struct darshan_shared_redux_slot *in_slot, *inout_slot;
+    MPI_Aint lb, extent;
+    char *inbuf = inbuf_v;
+    char *inoutbuf = inoutbuf_v;
+    int i;
+
+    PMPI_Type_get_extent(*datatype, &lb, &extent);
+    for(i = 0; i < *len; i++)
+    {
+        in_slot = (struct darshan_shared_redux_slot *)(inbuf + i * extent);
+        inout_slot = (struct darshan_shared_redux_slot *)
+            (inoutbuf + i * extent);
+        darshan_shared_redux_apply(
+            &darshan_shared_redux_list[inout_slot->redux_ndx],
+            (char *)(in_slot + 1), (char *)(inout_slot + 1), datatype);
+    }
+
+    return;
+}
+
+static int darshan_shared_redux_dest_cmp(const void *a_p, const void *b_p)
+{
+    const struct darshan_shared_redux_dest *a = a_p;
+    const struct darshan_shared_redux_dest *b = b_p;
+
+    if(a->mod_id != b->mod_id)
+        return((a->mod_id > b->mod_id) - (a->mod_id < b->mod_id));
+    return((a->id > b->id) - (a->id < b->id));
+}
+
+/* reduce the queued records shared by all processes to rank 0 in a single
+ * collective, writing the results back to the modules' record buffers
+ */
+static void darshan_reduce_global_shared_records(
+    struct darshan_core_runtime *core)
+{
+    struct darshan_shared_redux *redux;
+    struct darshan_shared_redux_slot *slot;
+    MPI_Datatype red_type;
+    MPI_Op red_op;
+    size_t slot_size = 0;
+    int64_t slot_count = 0;
+    char *buf, *rec;
+    char *p;
+    int i, j;
+
+    /* all processes queue the same records shared by all processes, in
+     * the same order, so the number of slots is the same everywhere
+     */
+    for(i = 0; i < darshan_shared_redux_count; i++)
+    {
+        redux = &darshan_shared_redux_list[i];
+        redux->global_count = 0;
+        for(j = 0; j < redux->rec_count; j++)
+        {
+            if(redux->rec_refs[j]->global_rank_count == nprocs)
+                redux->global_count++;
+        }
+        slot_count += redux->global_count;
+        if(redux->global_count > 0 && redux->elem_size > slot_size)
+            slot_size = redux->elem_size;
+    }
+    if(slot_count == 0)
+        return;
+    /* keep the records in each slot 8-byte aligned */
+    slot_size = (sizeof(*slot) + slot_size + 7) & ~(size_t)7;
+    assert(slot_count <= INT_MAX && slot_size <= INT_MAX);
+
+    buf = malloc(slot_count * slot_size);
+    assert(buf);
+
+    /* pack each record along with the initial variance state */
+    p = buf;
+    for(i = 0; i < darshan_shared_redux_count; i++)
+    {
+        redux = &darshan_shared_redux_list[i];
+        for(j = 0; j < redux->rec_count; j++)
+        {
+            if(redux->rec_refs[j]->global_rank_count != nprocs)
+                continue;
+            rec = (char *)redux->rec_buf + j * redux->rec_size;
+            slot = (struct darshan_shared_redux_slot *)p;
+            slot->redux_ndx = i;
+            slot->pad = 0;
+            darshan_shared_redux_pack(redux, rec, (char *)(slot + 1));
+            p += slot_size;
+        }
+    }
+
+    /* reduce one slot per element, so that MPI can split the reduction up
+     * as it sees fit
+     */
+    PMPI_Type_contiguous(slot_size, MPI_BYTE, &red_type);
+    PMPI_Type_commit(&red_type);
+    PMPI_Op_create(darshan_shared_redux_op, 1, &red_op);
+
+    if(my_rank == 0)
+        PMPI_Reduce(MPI_IN_PLACE, buf, slot_count, red_type, red_op, 0,
+            core->mpi_comm);
+    else
+        PMPI_Reduce(buf, NULL, slot_count, red_type, red_op, 0,
+            core->mpi_comm);
+
+    /* overwrite the modules' shared records with the reduced records */
+    if(my_rank == 0)
+    {
+        p = buf;
+        for(i = 0; i < darshan_shared_redux_count; i++)
+        {
+            redux = &darshan_shared_redux_list[i];
+            for(j = 0; j < redux->rec_count; j++)
+            {
+                if(redux->rec_refs[j]->global_rank_count != nprocs)
+                    continue;
+                rec = (char *)redux->rec_buf + j * redux->rec_size;
+                slot = (struct darshan_shared_redux_slot *)p;
+                darshan_shared_redux_unpack(redux, (char *)(slot + 1), rec);
+                p += slot_size;
+            }
+        }
+    }
+
+    PMPI_Type_free(&red_type);
+    PMPI_Op_free(&red_op);
+    free(buf);
+
+    return;
+}
+
+/* reduce the queued records shared by a subset of processes to the lowest
+ * sharing rank, over a binomial tree of the processes sharing each record
+ * (see darshan_get_shared_records()). The trees of all records are reduced
+ * together, one all-to-all exchange per step (and round) of the trees, so
+ * no sub-communicators are needed. In each step, a process receives at most
+ * one record for each record it holds, so no process receives more data
+ * in a step than the size of its own shared records.
+ */
+static void darshan_reduce_partial_shared_records(
+    struct darshan_core_runtime *core)
+{
+    struct darshan_shared_redux *redux;
+    struct darshan_core_name_record_ref *ref;
+    struct darshan_shared_redux_hdr *hdr;
+    struct darshan_shared_redux_dest *dests = NULL, *dest, key;
+    MPI_Datatype byte_type = MPI_BYTE;
+    int dest_cnt = 0;
+    size_t dest_buf_size = 0;
+    char *dest_buf = NULL;
+    char *send_buf, *recv_buf, *p;
+    int *send_counts, *send_displs, *recv_counts, *recv_displs;
+    size_t *send_sizes;
+    size_t send_size, recv_size;
+    int64_t local_max[2], global_max[2];
+    int steps, step;
+    int rounds, round;
+    int i, j;
+
+    send_counts = calloc(4 * nprocs, sizeof(int));
+    send_sizes = calloc(nprocs, sizeof(size_t));
+    assert(send_counts && send_sizes);
+    send_displs = send_counts + nprocs;
+    recv_counts = send_displs + nprocs;
+    recv_displs = recv_counts + nprocs;
+
+    /* pack each record shared by a subset of processes, along with its
+     * initial variance state
+     */
+    for(i = 0; i < darshan_shared_redux_count; i++)
+    {
+        redux = &darshan_shared_redux_list[i];
+        for(j = 0; j < redux->rec_count; j++)
+        {
+            if(redux->rec_refs[j]->global_rank_count != nprocs)
+            {
+                dest_cnt++;
+                dest_buf_size += redux->elem_size;
+            }
+        }
+    }
+    dests = malloc(dest_cnt * sizeof(*dests));
+    dest_buf = malloc(dest_buf_size);
+    assert((dests || dest_cnt == 0) && (dest_buf || dest_buf_size == 0));
+
+    local_max[0] = 0;
+    local_max[1] = dest_buf_size + dest_cnt * sizeof(*hdr);
+    dest_cnt = 0;
+    p = dest_buf;
+    for(i = 0; i < darshan_shared_redux_count; i++)
+    {
+        redux = &darshan_shared_redux_list[i];
+        for(j = 0; j < redux->rec_count; j++)
+        {
+            ref = redux->rec_refs[j];
+            if(ref->global_rank_count == nprocs)
+                continue;
+            dest = &dests[dest_cnt++];
+            dest->id = ref->name_record->id;
+            dest->mod_id = redux->mod_id;
+            dest->redux = redux;
+            dest->ref = ref;
+            dest->rec = (char *)redux->rec_buf + j * redux->rec_size;
+            dest->elem = p;
+            darshan_shared_redux_pack(redux, dest->rec, p);
+            p += redux->elem_size;
+            if(ref->global_rank_count > local_max[0])
+                local_max[0] = ref->global_rank_count;
+        }
+    }
+    qsort(dests, dest_cnt, sizeof(*dests), darshan_shared_redux_dest_cmp);
+
+    /* the number of steps is set by the largest number of sharers of any
+     * record, and the number of rounds by the largest amount of shared
+     * record data on any process
+     */
+    PMPI_Allreduce(local_max, global_max, 2, MPI_INT64_T, MPI_MAX,
+        core->mpi_comm);
+    for(steps = 0; ((int64_t)1 << steps) < global_max[0]; steps++);
+    rounds = (global_max[1] + DARSHAN_SHARED_REDUX_BATCH - 1) /
+        DARSHAN_SHARED_REDUX_BATCH;
+    if(rounds < 1)
+        rounds = 1;
+
+    for(step = 0; step < steps; step++)
+    {
+        for(round = 0; round < rounds; round++)
+        {
+            /* size and pack the records sent to parents in this step */
+            memset(send_sizes, 0, nprocs * sizeof(size_t));
+            for(i = 0; i < dest_cnt; i++)
+            {
+                ref = dests[i].ref;
+                if(ref->global_redux_step == step &&
+                   DARSHAN_SHARED_REDUX_ROUND(dests[i].id, rounds) == round)
+                    send_sizes[ref->global_redux_parent] +=
+                        sizeof(*hdr) + dests[i].redux->elem_size;
+            }
+            for(i = 0, send_size = 0; i < nprocs; i++)
+            {
+                assert(send_sizes[i] <= INT_MAX);
+                send_counts[i] = 0;
+                send_displs[i] = send_size;
+                send_size += send_sizes[i];
+            }
+            assert(send_size <= INT_MAX);
+
+            send_buf = malloc(send_size);
+            assert(send_buf || send_size == 0);
+            for(i = 0; i < dest_cnt; i++)
+            {
+                dest = &dests[i];
+                ref = dest->ref;
+                if(ref->global_redux_step != step ||
+                   DARSHAN_SHARED_REDUX_ROUND(dest->id, rounds) != round)
+                    continue;
+                hdr = (struct darshan_shared_redux_hdr *)(send_buf +
+                    send_displs[ref->global_redux_parent] +
+                    send_counts[ref->global_redux_parent]);
+                hdr->id = dest->id;
+                hdr->mod_id = dest->mod_id;
+                hdr->pad = 0;
+                memcpy(hdr + 1, dest->elem, dest->redux->elem_size);
+                send_counts[ref->global_redux_parent] +=
+                    sizeof(*hdr) + dest->redux->elem_size;
+            }
+
+            PMPI_Alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT,
+                core->mpi_comm);
+            for(i = 0, recv_size = 0; i < nprocs; i++)
+            {
+                recv_displs[i] = recv_size;
+                recv_size += recv_counts[i];
+            }
+            /* bounded by the size of this process's own records */
+            assert(recv_size <= INT_MAX);
+            recv_buf = malloc(recv_size);
+            assert(recv_buf || recv_size == 0);
+            PMPI_Alltoallv(send_buf, send_counts, send_displs, MPI_BYTE,
+                recv_buf, recv_counts, recv_displs, MPI_BYTE, core->mpi_comm);
+
+            /* reduce the children's records into the records held here */
+            p = recv_buf;
+            while(p < recv_buf + recv_size)
+            {
+                hdr = (struct darshan_shared_redux_hdr *)p;
+                key.id = hdr->id;
+                key.mod_id = hdr->mod_id;
+                dest = bsearch(&key, dests, dest_cnt, sizeof(*dests),
+                    darshan_shared_redux_dest_cmp);
+                assert(dest);
+                darshan_shared_redux_apply(dest->redux, (char *)(hdr + 1),
+                    dest->elem, &byte_type);
+                p += sizeof(*hdr) + dest->redux->elem_size;
+            }
+
+            free(send_buf);
+            free(recv_buf);
+        }
+    }
+
+    /* the roots of the trees keep the reduced records */
+    for(i = 0; i < dest_cnt; i++)
+    {
+        if(dests[i].ref->global_first_rank == my_rank)
+            darshan_shared_redux_unpack(dests[i].redux, dests[i].elem,
+                dests[i].rec);
+    }
+
+    free(dests);
+    free(dest_buf);
+    free(send_sizes);
+    free(send_counts);
+
+    return;
+}
+
+/* reduce the shared records queued by all modules, writing the results back
+ * to the modules' record buffers on the processes that keep them
+ */
+static void darshan_reduce_shared_records(struct darshan_core_runtime *core)
+{
+    int i;
+
+    darshan_reduce_global_shared_records(core);
+    if(darshan_shared_redux_partial)
+        darshan_reduce_partial_shared_records(core);
+
+    for(i = 0; i < darshan_shared_redux_count; i++)
+        free(darshan_shared_redux_list[i].rec_refs);
+    darshan_shared_redux_count = 0;
+
+    return;
+}
+#endif
+
+/* construct the darshan log file name */
+/* NOTE: logfile_name argument is assumed to have already been allocated
+ * with size __DARSHAN_PATH_MAX; length will be safety checked in this
+ * function.
+ */
+static void darshan_get_logfile_name(
+    char* logfile_name, struct darshan_core_runtime* core)
+{
+    char* user_logfile_name;
+    char* logpath;
+    char* logpath_override = NULL;
+#ifdef __DARSHAN_LOG_ENV
+    char env_check[256];
+    char* env_tok;
+#endif
+    uint64_t hlevel;
+    char hname[HOST_NAME_MAX];
+    uint64_t logmod;
+    char cuser[L_cuserid] = {0};
+    struct tm *start_tm;
+    int jobid;
+    int pid;
+    time_t start_time;
+    int ret;
+
+#ifdef HAVE_MPI
     if (using_mpi && my_rank > 0)
         goto bcast;
 #endif
@@ -1652,8 +3581,8 @@ static int darshan_log_write_job_record(darshan_core_log_fh log_fh,
 #endif
 
     /* compress the job info and the trailing mount/exe data */
-    ret = darshan_deflate_buffer(pointers, lengths, 2,
-        core->comp_buf, &comp_buf_sz);
+    ret = darshan_compress_buffer(pointers, lengths, 2,
+        core->comp_buf, core->comp_buf_size, &comp_buf_sz);
     if(ret)
     {
         DARSHAN_WARN("error compressing job record");
@@ -1700,101 +3629,165 @@ static int darshan_log_write_job_record(darshan_core_log_fh log_fh,
     return(ret);
 }
 
-static int darshan_log_write_name_record_hash(darshan_core_log_fh log_fh,
-    struct darshan_core_runtime *core, uint64_t *inout_off)
+#ifdef HAVE_MPI
+/* remove shared name records from a buffer of name records on non-zero
+ * ranks, unless this is the lowest rank that registered them, returning
+ * the length of the remaining records.  The
+ * shared records are moved to the end of the buffer so that they can still
+ * be referenced as modules shutdown.
+ */
+static int darshan_compact_name_records(struct darshan_core_runtime *core,
+    char *buf, int buf_len)
 {
+    struct darshan_core_name_record_ref *ref;
+    struct darshan_name_record *name_rec;
+    char *my_buf, *shared_buf;
+    char *tmp_p;
     int name_rec_buf_len;
-    int ret;
-
-    name_rec_buf_len = core->name_mem_used;
-#ifdef HAVE_MPI
-    if(using_mpi && (my_rank > 0))
+    int rec_len;
+    int shared_buf_len;
+
+    /* the compression buffer is used as scratch space for shared records */
+    if(darshan_core_reserve_comp_buf(core, buf_len) < 0)
+        return(buf_len);
+
+    name_rec = (struct darshan_name_record *)buf;
+    name_rec_buf_len = buf_len;
+    my_buf = buf;
+    shared_buf = core->comp_buf;
+    shared_buf_len = 0;
+    while(name_rec_buf_len > 0)
     {
-        struct darshan_core_name_record_ref *ref;
-        struct darshan_name_record *name_rec;
-        char *my_buf, *shared_buf;
-        char *tmp_p;
-        int rec_len;
-        int shared_buf_len;
-
-        /* remove globally shared name records from non-zero ranks */
+        HASH_FIND(hlink, core->name_hash, &(name_rec->id),
+            sizeof(darshan_record_id), ref);
+        assert(ref);
+        rec_len = sizeof(darshan_record_id) + strlen(name_rec->name) + 1;
 
-        name_rec = core->log_name_p;
-        my_buf = core->log_name_p;
-        shared_buf = core->comp_buf;
-        shared_buf_len = 0;
-        while(name_rec_buf_len > 0)
+        if(ref->global_rank_count > 1 && ref->global_first_rank != my_rank)
         {
-            HASH_FIND(hlink, core->name_hash, &(name_rec->id),
+            /* this record is shared, and its name is written by a lower
+             * rank. move to the temporary shared record buffer and update
+             * hash references
+             */
+            HASH_DELETE(hlink, core->name_hash, ref);
+            memcpy(shared_buf, name_rec, rec_len);
+            ref->name_record = (struct darshan_name_record *)shared_buf;
+            HASH_ADD(hlink, core->name_hash, name_record->id,
                 sizeof(darshan_record_id), ref);
-            assert(ref);
-            rec_len = sizeof(darshan_record_id) + strlen(name_rec->name) + 1;
 
-            if(ref->global_mod_flags)
+            shared_buf += rec_len;
+            shared_buf_len += rec_len;
+        }
+        else
+        {
+            /* this record is not shared, but we still may need to
+             * move it forward in our buffer and update hash references
+             */
+            if(my_buf != (char *)name_rec)
             {
-                /* this record is shared globally, move to the temporary
-                 * shared record buffer and update hash references
-                 */
                 HASH_DELETE(hlink, core->name_hash, ref);
-                memcpy(shared_buf, name_rec, rec_len);
-                ref->name_record = (struct darshan_name_record *)shared_buf;
+                memcpy(my_buf, name_rec, rec_len);
+                ref->name_record =(struct darshan_name_record *)my_buf;
                 HASH_ADD(hlink, core->name_hash, name_record->id,
                     sizeof(darshan_record_id), ref);
-
-                shared_buf += rec_len;
-                shared_buf_len += rec_len;
-            }
-            else
-            {
-                /* this record is not shared, but we still may need to
-                 * move it forward in our buffer and update hash references
-                 */
-                if(my_buf != (char *)name_rec)
-                {
-                    HASH_DELETE(hlink, core->name_hash, ref);
-                    memcpy(my_buf, name_rec, rec_len);
-                    ref->name_record =(struct darshan_name_record *)my_buf;
-                    HASH_ADD(hlink, core->name_hash, name_record->id,
-                        sizeof(darshan_record_id), ref);
-                }
-                my_buf += rec_len;
             }
-
-            tmp_p = (char *)name_rec + rec_len;
-            name_rec = (struct darshan_name_record *)tmp_p;
-            name_rec_buf_len -= rec_len;
+            my_buf += rec_len;
         }
-        name_rec_buf_len = core->name_mem_used - shared_buf_len;
 
-        /* append the shared records back to the end of the name record
-         * buffer and update hash table references so we can still
-         * reference these records as modules shutdown
-         */
-        name_rec = (struct darshan_name_record *)core->comp_buf;
-        while(shared_buf_len > 0)
-        {
-            HASH_FIND(hlink, core->name_hash, &(name_rec->id),
-                sizeof(darshan_record_id), ref);
-            assert(ref);
-            rec_len = sizeof(darshan_record_id) + strlen(name_rec->name) + 1;
+        tmp_p = (char *)name_rec + rec_len;
+        name_rec = (struct darshan_name_record *)tmp_p;
+        name_rec_buf_len -= rec_len;
+    }
+    name_rec_buf_len = buf_len - shared_buf_len;
 
-            HASH_DELETE(hlink, core->name_hash, ref);
-            memcpy(my_buf, name_rec, rec_len);
-            ref->name_record = (struct darshan_name_record *)my_buf;
-            HASH_ADD(hlink, core->name_hash, name_record->id,
-                sizeof(darshan_record_id), ref);
+    /* append the shared records back to the end of the name record
+     * buffer and update hash table references so we can still
+     * reference these records as modules shutdown
+     */
+    name_rec = (struct darshan_name_record *)core->comp_buf;
+    while(shared_buf_len > 0)
+    {
+        HASH_FIND(hlink, core->name_hash, &(name_rec->id),
+            sizeof(darshan_record_id), ref);
+        assert(ref);
+        rec_len = sizeof(darshan_record_id) + strlen(name_rec->name) + 1;
 
-            tmp_p = (char *)name_rec + rec_len;
-            name_rec = (struct darshan_name_record *)tmp_p;
-            my_buf += rec_len;
-            shared_buf_len -= rec_len;
-        }
+        HASH_DELETE(hlink, core->name_hash, ref);
+        memcpy(my_buf, name_rec, rec_len);
+        ref->name_record = (struct darshan_name_record *)my_buf;
+        HASH_ADD(hlink, core->name_hash, name_record->id,
+            sizeof(darshan_record_id), ref);
+
+        tmp_p = (char *)name_rec + rec_len;
+        name_rec = (struct darshan_name_record *)tmp_p;
+        my_buf += rec_len;
+        shared_buf_len -= rec_len;
+    }
+
+    return(name_rec_buf_len);
+}
+#endif
+
+static int darshan_log_write_name_record_hash(darshan_core_log_fh log_fh,
+    struct darshan_core_runtime *core, uint64_t *inout_off)
+{
+    void **name_bufs;
+    int *name_buf_lens;
+    int name_buf_count = 0;
+    int i;
+    int ret;
+#ifndef __DARSHAN_ENABLE_MMAP_LOGS
+    struct darshan_core_name_chunk *chunk;
+
+    /* don't write the names of evicted records */
+    darshan_compact_dead_name_records(core);
+
+    /* name records are spread over a list of chunks, which are gathered
+     * into a single compressed region of the log
+     */
+    for(chunk = core->name_chunk_head; chunk; chunk = chunk->next)
+        name_buf_count++;
+#else
+    name_buf_count = 1;
+#endif
+
+    name_bufs = malloc((name_buf_count + 1) * sizeof(*name_bufs));
+    name_buf_lens = malloc((name_buf_count + 1) * sizeof(*name_buf_lens));
+    if(!name_bufs || !name_buf_lens)
+    {
+        /* still participate in the collective write to avoid deadlock */
+        (void)darshan_log_append(log_fh, core, NULL, NULL, 0, inout_off);
+        free(name_bufs);
+        free(name_buf_lens);
+        return(-1);
+    }
+
+#ifndef __DARSHAN_ENABLE_MMAP_LOGS
+    for(chunk = core->name_chunk_head, i = 0; chunk; chunk = chunk->next, i++)
+    {
+        name_bufs[i] = chunk->buf;
+        name_buf_lens[i] = chunk->used;
+    }
+#else
+    name_bufs[0] = core->log_name_p;
+    name_buf_lens[0] = core->name_mem_used;
+#endif
+
+#ifdef HAVE_MPI
+    if(using_mpi && (my_rank > 0))
+    {
+        /* remove globally shared name records from non-zero ranks */
+        for(i = 0; i < name_buf_count; i++)
+            name_buf_lens[i] = darshan_compact_name_records(core,
+                name_bufs[i], name_buf_lens[i]);
     }
 #endif
 
     /* collectively write out the record hash to the darshan log */
-    ret = darshan_log_append(log_fh, core, core->log_name_p,
-        name_rec_buf_len, inout_off);
+    ret = darshan_log_append(log_fh, core, name_bufs, name_buf_lens,
+        name_buf_count, inout_off);
+    free(name_bufs);
+    free(name_buf_lens);
     return(ret);
 }
 
@@ -1803,7 +3796,7 @@ static int darshan_log_write_header(darshan_core_log_fh log_fh,
 {
     int ret;
 
-    core->log_hdr_p->comp_type = DARSHAN_ZLIB_COMP;
+    core->log_hdr_p->comp_type = darshan_log_comp_type;
 
 #ifdef HAVE_MPI
     MPI_Status status;
@@ -1866,30 +3859,139 @@ static int darshan_log_write_header(darshan_core_log_fh log_fh,
     return(ret);
 }
 
+/* grow a compression scratch buffer to at least 'size' bytes */
+static int darshan_core_reserve_scratch_buf(char **buf, size_t *buf_size,
+    int *huge_pages, size_t size)
+{
+    char *tmp_buf;
+
+    if(size <= *buf_size)
+        return(0);
+
+    /* compression buffers only hold scratch data between appends, so a
+     * huge page backed buffer is just replaced
+     */
+    tmp_buf = darshan_core_huge_page_alloc(size);
+    if(tmp_buf)
+    {
+        darshan_core_free_scratch_buf(buf, buf_size, huge_pages);
+        if(size % darshan_huge_page_size)
+            size += darshan_huge_page_size - (size % darshan_huge_page_size);
+        *buf = tmp_buf;
+        *buf_size = size;
+        *huge_pages = 1;
+        return(0);
+    }
+
+    if(*huge_pages)
+        darshan_core_free_scratch_buf(buf, buf_size, huge_pages);
+    tmp_buf = realloc(*buf, size);
+    if(!tmp_buf)
+        return(-1);
+    *buf = tmp_buf;
+    *buf_size = size;
+    return(0);
+}
+
+static void darshan_core_free_scratch_buf(char **buf, size_t *buf_size,
+    int *huge_pages)
+{
+    if(*huge_pages)
+        darshan_core_huge_page_free(*buf, *buf_size);
+    else
+        free(*buf);
+    *buf = NULL;
+    *buf_size = 0;
+    *huge_pages = 0;
+    return;
+}
+
+/* make sure the compression buffer can hold at least 'size' bytes */
+static int darshan_core_reserve_comp_buf(struct darshan_core_runtime *core,
+    size_t size)
+{
+    return(darshan_core_reserve_scratch_buf(&core->comp_buf,
+        &core->comp_buf_size, &core->comp_buf_huge_pages, size));
+}
+
+static void darshan_core_free_comp_buf(struct darshan_core_runtime *core)
+{
+    darshan_core_free_scratch_buf(&core->comp_buf, &core->comp_buf_size,
+        &core->comp_buf_huge_pages);
+    return;
+}
+
 /* NOTE: inout_off contains the starting offset of this append at the beginning
  *       of the call, and contains the ending offset at the end of the call.
  *       This variable is only valid on the root rank (rank 0).
  */
 static int darshan_log_append(darshan_core_log_fh log_fh, struct darshan_core_runtime *core,
-    void *buf, int count, uint64_t *inout_off)
+    void **bufs, int *counts, int buf_count, uint64_t *inout_off)
 {
     int comp_buf_sz = 0;
+    uLong total_count = 0;
+    int i;
     int ret;
 
-    /* compress the input buffer */
-    ret = darshan_deflate_buffer((void **)&buf, &count, 1,
-        core->comp_buf, &comp_buf_sz);
+    /* the input buffers (e.g., decoded DXT traces or name records) may be
+     * larger than the compression buffer was sized for, so make sure the
+     * compressed output is guaranteed to fit. If the buffer can't grow,
+     * fall back to the current one: compression fails (and this append
+     * with it) if the output doesn't fit.
+     */
+    for(i = 0; i < buf_count; i++)
+        total_count += counts[i];
+    ret = darshan_core_reserve_comp_buf(core, darshan_compress_bound(total_count));
+
+    /* compress the input buffers into a single compressed region */
+    if(ret == 0 || core->comp_buf_size > 0)
+        ret = darshan_compress_buffer(bufs, counts, buf_count,
+            core->comp_buf, core->comp_buf_size, &comp_buf_sz);
     if(ret < 0)
         comp_buf_sz = 0;
 
-#ifdef HAVE_MPI
-    MPI_Offset send_off, my_off;
-    MPI_Status status;
+    return(darshan_log_write_region(log_fh, core, core->comp_buf, comp_buf_sz,
+        ret, inout_off));
+}
 
-    if(using_mpi)
-    {
-        /* figure out where everyone is writing using scan */
-        send_off = comp_buf_sz;
+/* append an already compressed region to the log. If 'comp_ret' indicates
+ * a compression error, nothing is written on this process, but it still
+ * participates in the collective write and returns an error.
+ * NOTE: inout_off is handled as in darshan_log_append().
+ */
+static int darshan_log_write_region(darshan_core_log_fh log_fh,
+    struct darshan_core_runtime *core, char *buf, int len, int comp_ret,
+    uint64_t *inout_off)
+{
+    int ret = comp_ret;
+
+    if(ret < 0)
+        len = 0;
+
+#ifdef DARSHAN_LOG_NODE_AGG
+    if(using_mpi && darshan_node_agg)
+    {
+        /* write through the node leaders, as a batch of one region */
+        struct darshan_log_batch batch;
+
+        memset(&batch, 0, sizeof(batch));
+        darshan_log_batch_add(&batch, -1, buf, len, comp_ret);
+        ret = darshan_log_batch_issue(log_fh, core, &batch, inout_off);
+        if(darshan_log_batch_wait(&batch) < 0)
+            ret = -1;
+        darshan_log_batch_free(&batch);
+        return(ret);
+    }
+#endif
+
+#ifdef HAVE_MPI
+    MPI_Offset send_off, my_off;
+    MPI_Status status;
+
+    if(using_mpi)
+    {
+        /* figure out where everyone is writing using scan */
+        send_off = len;
         if(my_rank == 0)
         {
             send_off += *inout_off; /* rank 0 knows the beginning offset */
@@ -1897,13 +3999,13 @@ static int darshan_log_append(darshan_core_log_fh log_fh, struct darshan_core_ru
 
         PMPI_Scan(&send_off, &my_off, 1, MPI_OFFSET, MPI_SUM, core->mpi_comm);
         /* scan is inclusive; subtract local size back out */
-        my_off -= comp_buf_sz;
+        my_off -= len;
 
         if(ret == 0)
         {
             /* no compression errors, proceed with the collective write */
             ret = PMPI_File_write_at_all(log_fh.mpi_fh, my_off,
-                core->comp_buf, comp_buf_sz, MPI_BYTE, &status);
+                buf, len, MPI_BYTE, &status);
             if(ret != MPI_SUCCESS)
                 ret = -1;
         }
@@ -1913,7 +4015,7 @@ static int darshan_log_append(darshan_core_log_fh log_fh, struct darshan_core_ru
              * but participate in collective write to avoid deadlock.
              */
             (void)PMPI_File_write_at_all(log_fh.mpi_fh, my_off,
-                core->comp_buf, comp_buf_sz, MPI_BYTE, &status);
+                buf, len, MPI_BYTE, &status);
         }
 
         if(nprocs > 1)
@@ -1921,7 +4023,7 @@ static int darshan_log_append(darshan_core_log_fh log_fh, struct darshan_core_ru
             /* send the ending offset from rank (n-1) to rank 0 */
             if(my_rank == (nprocs-1))
             {
-                my_off += comp_buf_sz;
+                my_off += len;
                 PMPI_Send(&my_off, 1, MPI_OFFSET, 0, 0, core->mpi_comm);
             }
             if(my_rank == 0)
@@ -1933,20 +4035,660 @@ static int darshan_log_append(darshan_core_log_fh log_fh, struct darshan_core_ru
         }
         else
         {
-            *inout_off = my_off + comp_buf_sz;
+            *inout_off = my_off + len;
         }
 
         return(ret);
     }
 #endif
 
-    ret = pwrite(log_fh.nompi_fd, core->comp_buf, comp_buf_sz, *inout_off);
-    if(ret != comp_buf_sz)
+    ret = pwrite(log_fh.nompi_fd, buf, len, *inout_off);
+    if(ret != len)
         return(-1);
-    *inout_off += comp_buf_sz;
+    *inout_off += len;
+    return(0);
+}
+
+/* compress queued chunks until the pool is stopped */
+static void *darshan_comp_pool_thread(void *arg)
+{
+    struct darshan_comp_pool *pool = arg;
+    struct darshan_comp_chunk *chunk;
+    double tm1, tm2;
+
+    pthread_mutex_lock(&pool->mutex);
+    while(1)
+    {
+        while(!pool->head && !pool->stop)
+            pthread_cond_wait(&pool->work_cond, &pool->mutex);
+        if(!pool->head)
+            break;
+
+        chunk = pool->head;
+        pool->head = chunk->next;
+        if(!pool->head)
+            pool->tail = NULL;
+        pthread_mutex_unlock(&pool->mutex);
+
+        tm1 = darshan_core_wtime_absolute();
+        chunk->ret = darshan_compress_buffer((void **)&chunk->in,
+            &chunk->in_len, 1, chunk->out, chunk->out_size, &chunk->out_len);
+        tm2 = darshan_core_wtime_absolute();
+
+        pthread_mutex_lock(&pool->mutex);
+        pool->comp_time += tm2 - tm1;
+        if(--chunk->region->chunks_left == 0)
+            pthread_cond_broadcast(&pool->done_cond);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return(NULL);
+}
+
+/* start a pool of 'thread_count' compression threads, returning NULL if
+ * none could be started
+ */
+static struct darshan_comp_pool *darshan_comp_pool_start(int thread_count)
+{
+    struct darshan_comp_pool *pool;
+    int i;
+
+    pool = calloc(1, sizeof(*pool));
+    if(pool)
+        pool->threads = malloc(thread_count * sizeof(*pool->threads));
+    if(!pool || !pool->threads)
+    {
+        free(pool);
+        return(NULL);
+    }
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->work_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+
+    for(i = 0; i < thread_count; i++)
+    {
+        if(pthread_create(&pool->threads[i], NULL, darshan_comp_pool_thread,
+            pool) != 0)
+            break;
+        pool->thread_count++;
+    }
+    if(pool->thread_count == 0)
+    {
+        darshan_comp_pool_stop(pool);
+        return(NULL);
+    }
+
+    return(pool);
+}
+
+/* split the output buffer of module 'mod_id' into chunks, and queue them
+ * to be compressed
+ */
+static void darshan_comp_pool_queue(struct darshan_comp_pool *pool,
+    int mod_id, void *buf, int len)
+{
+    struct darshan_comp_region *region = &pool->regions[mod_id];
+    struct darshan_comp_chunk *chunk;
+    size_t buf_size = 0;
+    int i;
+
+    region->chunk_count = (len + DARSHAN_COMP_CHUNK_SIZE - 1) /
+        DARSHAN_COMP_CHUNK_SIZE;
+    if(region->chunk_count == 0)
+        return;
+
+    region->chunks = calloc(region->chunk_count, sizeof(*region->chunks));
+    if(!region->chunks)
+    {
+        region->chunk_count = 0;
+        region->ret = -1;
+        return;
+    }
+    for(i = 0; i < region->chunk_count; i++)
+    {
+        chunk = &region->chunks[i];
+        chunk->in = (char *)buf + (size_t)i * DARSHAN_COMP_CHUNK_SIZE;
+        chunk->in_len = len - i * DARSHAN_COMP_CHUNK_SIZE;
+        if(chunk->in_len > DARSHAN_COMP_CHUNK_SIZE)
+            chunk->in_len = DARSHAN_COMP_CHUNK_SIZE;
+        chunk->out_size = darshan_compress_bound(chunk->in_len);
+        chunk->region = region;
+        buf_size += chunk->out_size;
+    }
+    region->buf = malloc(buf_size);
+    if(!region->buf)
+    {
+        free(region->chunks);
+        region->chunks = NULL;
+        region->chunk_count = 0;
+        region->ret = -1;
+        return;
+    }
+    for(i = 0, buf_size = 0; i < region->chunk_count; i++)
+    {
+        region->chunks[i].out = region->buf + buf_size;
+        buf_size += region->chunks[i].out_size;
+        if(i + 1 < region->chunk_count)
+            region->chunks[i].next = &region->chunks[i + 1];
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    region->chunks_left = region->chunk_count;
+    if(pool->tail)
+        pool->tail->next = &region->chunks[0];
+    else
+        pool->head = &region->chunks[0];
+    pool->tail = &region->chunks[region->chunk_count - 1];
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->mutex);
+
+    return;
+}
+
+/* wait for the region of module 'mod_id' to be compressed, compressing
+ * queued chunks on the calling thread in the meantime, and return it with
+ * its chunks' output contiguous in its buffer
+ */
+static struct darshan_comp_region *darshan_comp_pool_wait(
+    struct darshan_comp_pool *pool, int mod_id)
+{
+    struct darshan_comp_region *region = &pool->regions[mod_id];
+    struct darshan_comp_chunk *chunk;
+    double wait1, tm1, tm2;
+    int i;
+
+    wait1 = darshan_core_wtime_absolute();
+    pthread_mutex_lock(&pool->mutex);
+    while(region->chunks_left > 0)
+    {
+        if(!pool->head)
+        {
+            pthread_cond_wait(&pool->done_cond, &pool->mutex);
+            continue;
+        }
+
+        chunk = pool->head;
+        pool->head = chunk->next;
+        if(!pool->head)
+            pool->tail = NULL;
+        pthread_mutex_unlock(&pool->mutex);
+
+        tm1 = darshan_core_wtime_absolute();
+        chunk->ret = darshan_compress_buffer((void **)&chunk->in,
+            &chunk->in_len, 1, chunk->out, chunk->out_size, &chunk->out_len);
+        tm2 = darshan_core_wtime_absolute();
+
+        pthread_mutex_lock(&pool->mutex);
+        pool->comp_time += tm2 - tm1;
+        if(--chunk->region->chunks_left == 0)
+            pthread_cond_broadcast(&pool->done_cond);
+    }
+    pool->wait_time += darshan_core_wtime_absolute() - wait1;
+    pthread_mutex_unlock(&pool->mutex);
+
+    for(i = 0, region->len = 0; i < region->chunk_count; i++)
+    {
+        chunk = &region->chunks[i];
+        if(chunk->ret < 0)
+            region->ret = -1;
+        memmove(region->buf + region->len, chunk->out, chunk->out_len);
+        region->len += chunk->out_len;
+    }
+
+    return(region);
+}
+
+/* stop the compression threads and free the pool */
+static void darshan_comp_pool_stop(struct darshan_comp_pool *pool)
+{
+    int i;
+
+    if(!pool)
+        return;
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->mutex);
+    for(i = 0; i < pool->thread_count; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    for(i = 0; i < DARSHAN_MAX_MODS; i++)
+    {
+        free(pool->regions[i].buf);
+        free(pool->regions[i].chunks);
+    }
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->done_cond);
+    pthread_cond_destroy(&pool->work_cond);
+    free(pool->threads);
+    free(pool);
+
+    return;
+}
+
+/* compress a module output buffer into the next region of the batch */
+static int darshan_log_batch_compress(struct darshan_log_batch *batch,
+    int mod_id, void *buf, int len)
+{
+    int j = batch->count;
+    int comp_len = 0;
+    int ret;
+
+    assert(j < DARSHAN_LOG_BATCH_SIZE);
+    ret = darshan_core_reserve_scratch_buf(&batch->scratch[j],
+        &batch->scratch_sizes[j], &batch->scratch_huge_pages[j],
+        darshan_compress_bound(len));
+    if(ret == 0)
+        ret = darshan_compress_buffer(&buf, &len, 1, batch->scratch[j],
+            batch->scratch_sizes[j], &comp_len);
+
+    darshan_log_batch_add(batch, mod_id, batch->scratch[j], comp_len, ret);
+    return(ret);
+}
+
+/* add an already compressed region to the batch. If 'comp_ret' indicates
+ * a compression error, the region is written as empty on this process,
+ * and issuing the batch returns an error.
+ */
+static void darshan_log_batch_add(struct darshan_log_batch *batch,
+    int mod_id, char *buf, int len, int comp_ret)
+{
+    int j;
+
+    assert(batch->count < DARSHAN_LOG_BATCH_SIZE);
+    j = batch->count++;
+    batch->mod_ids[j] = mod_id;
+    batch->bufs[j] = buf;
+    batch->lens[j] = (comp_ret < 0) ? 0 : len;
+    batch->rets[j] = comp_ret;
+    return;
+}
+
+/* write the regions of a batch, for when writes can't be left in flight */
+static void *darshan_log_batch_write_thread(void *arg)
+{
+    struct darshan_log_batch *batch = arg;
+    int j;
+
+    for(j = 0; j < batch->count; j++)
+    {
+        if(pwrite(batch->write_fd, batch->bufs[j], batch->lens[j],
+            batch->write_offs[j]) != batch->lens[j])
+            batch->err = -1;
+    }
+
+    return(NULL);
+}
+
+/* start appending the regions of the batch to the log, each region being
+ * the concatenation of all processes' data for it. The writes must be
+ * completed with darshan_log_batch_wait() before the batch is reused.
+ * NOTE: inout_off contains the starting offset of the batch at the
+ *       beginning of the call on rank 0, and contains the ending offset
+ *       on all processes at the end of the call.
+ */
+static int darshan_log_batch_issue(darshan_core_log_fh log_fh,
+    struct darshan_core_runtime *core, struct darshan_log_batch *batch,
+    uint64_t *inout_off)
+{
+    int ret = 0;
+    int j;
+
+    batch->issued = 1;
+    for(j = 0; j < batch->count; j++)
+        if(batch->rets[j] < 0)
+            ret = -1;
+
+#ifdef DARSHAN_LOG_NODE_AGG
+    if(using_mpi && darshan_node_agg)
+    {
+        if(darshan_log_batch_issue_node_agg(log_fh, batch, inout_off) < 0)
+            batch->err = -1;
+        return(ret);
+    }
+#endif
+
+#ifdef HAVE_MPI
+    MPI_Offset lens[DARSHAN_LOG_BATCH_SIZE];
+    MPI_Offset my_offs[DARSHAN_LOG_BATCH_SIZE];
+
+    if(using_mpi)
+    {
+        for(j = 0; j < batch->count; j++)
+            lens[j] = batch->lens[j];
+        darshan_log_scan_offsets(core->mpi_comm, lens, batch->count, my_offs,
+            batch, inout_off);
+
+        /* participate in the collective writes even after a compression
+         * error to avoid deadlock
+         */
+        batch->req_count = 0;
+        for(j = 0; j < batch->count; j++)
+        {
+#ifdef DARSHAN_LOG_IWRITE_ALL
+            if(PMPI_File_iwrite_at_all(log_fh.mpi_fh, my_offs[j],
+                batch->bufs[j], batch->lens[j], MPI_BYTE,
+                &batch->reqs[batch->req_count]) == MPI_SUCCESS)
+                batch->req_count++;
+            else
+                batch->err = -1;
+#else
+            MPI_Status status;
+
+            if(PMPI_File_write_at_all(log_fh.mpi_fh, my_offs[j],
+                batch->bufs[j], batch->lens[j], MPI_BYTE, &status)
+                != MPI_SUCCESS)
+                batch->err = -1;
+#endif
+        }
+
+        return(ret);
+    }
+#endif
+
+    for(j = 0; j < batch->count; j++)
+    {
+        batch->offs[j] = *inout_off;
+        batch->global_lens[j] = batch->lens[j];
+        batch->write_offs[j] = *inout_off;
+        *inout_off += batch->lens[j];
+    }
+    if(ret < 0)
+        return(ret);
+
+    /* leave the writes to a helper thread, or write them now if one can't
+     * be started
+     */
+    batch->write_fd = log_fh.nompi_fd;
+    if(pthread_create(&batch->write_thread, NULL,
+        darshan_log_batch_write_thread, batch) == 0)
+        batch->write_thread_started = 1;
+    else
+        darshan_log_batch_write_thread(batch);
+
     return(0);
 }
 
+#ifdef HAVE_MPI
+/* figure out where each process writes its part of each of the batch's
+ * regions, given the lengths of its parts, using a single scan over
+ * 'comm'. Only rank 0 knows the beginning offset, so the scan gives the
+ * absolute end of the first region, and the lengths of the others, on the
+ * last rank, which broadcasts them. Sets the global offset and length of
+ * each region in the batch.
+ * NOTE: inout_off is handled as in darshan_log_batch_issue(), for the
+ *       processes in 'comm'.
+ */
+static void darshan_log_scan_offsets(MPI_Comm comm, MPI_Offset *lens,
+    int count, MPI_Offset *my_offs, struct darshan_log_batch *batch,
+    uint64_t *inout_off)
+{
+    MPI_Offset send_offs[DARSHAN_LOG_BATCH_SIZE];
+    MPI_Offset end_offs[DARSHAN_LOG_BATCH_SIZE];
+    MPI_Offset region_off = 0;
+    int comm_rank, comm_size;
+    int j;
+
+    PMPI_Comm_rank(comm, &comm_rank);
+    PMPI_Comm_size(comm, &comm_size);
+
+    memcpy(send_offs, lens, count * sizeof(MPI_Offset));
+    if(comm_rank == 0)
+        send_offs[0] += *inout_off;
+
+    PMPI_Scan(send_offs, my_offs, count, MPI_OFFSET, MPI_SUM, comm);
+    if(comm_rank == (comm_size-1))
+        memcpy(end_offs, my_offs, count * sizeof(MPI_Offset));
+    PMPI_Bcast(end_offs, count, MPI_OFFSET, comm_size-1, comm);
+
+    /* the scan is inclusive; subtract local sizes back out */
+    for(j = 0; j < count; j++)
+    {
+        if(j == 0)
+        {
+            region_off = *inout_off;
+            my_offs[0] -= lens[0];
+        }
+        else
+        {
+            end_offs[j] += end_offs[j-1];
+            my_offs[j] += end_offs[j-1] - lens[j];
+        }
+        batch->offs[j] = region_off;
+        batch->global_lens[j] = end_offs[j] - region_off;
+        region_off = end_offs[j];
+    }
+    *inout_off = end_offs[count-1];
+
+    return;
+}
+#endif
+
+#ifdef DARSHAN_LOG_NODE_AGG
+/* set up the node and node leader communicators for writing the log
+ * through node leaders. The lowest rank on each node is its leader, so
+ * rank 0 is the first leader. Returns NULL on all processes if any of
+ * them fails.
+ */
+static struct darshan_log_node_agg *darshan_log_node_agg_start(
+    struct darshan_core_runtime *core)
+{
+    struct darshan_log_node_agg *agg;
+    int failed = 0;
+
+    agg = calloc(1, sizeof(*agg));
+    if(!agg)
+        return(NULL);
+
+    PMPI_Comm_split_type(core->mpi_comm, MPI_COMM_TYPE_SHARED, my_rank,
+        MPI_INFO_NULL, &agg->node_comm);
+    PMPI_Comm_rank(agg->node_comm, &agg->node_rank);
+    PMPI_Comm_size(agg->node_comm, &agg->node_size);
+    PMPI_Comm_split(core->mpi_comm, (agg->node_rank == 0) ? 0 : MPI_UNDEFINED,
+        my_rank, &agg->leader_comm);
+
+    if(agg->node_rank == 0)
+    {
+        agg->lens = malloc(agg->node_size * DARSHAN_LOG_BATCH_SIZE *
+            sizeof(*agg->lens));
+        agg->counts = malloc(agg->node_size * sizeof(*agg->counts));
+        agg->displs = malloc(agg->node_size * sizeof(*agg->displs));
+        agg->offs = malloc(agg->node_size * DARSHAN_LOG_BATCH_SIZE *
+            sizeof(*agg->offs));
+        if(!agg->lens || !agg->counts || !agg->displs || !agg->offs)
+            failed = 1;
+    }
+
+    PMPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_LOR,
+        core->mpi_comm);
+    if(failed)
+    {
+        darshan_log_node_agg_stop(agg);
+        return(NULL);
+    }
+
+    return(agg);
+}
+
+static void darshan_log_node_agg_stop(struct darshan_log_node_agg *agg)
+{
+    if(!agg)
+        return;
+
+    PMPI_Comm_free(&agg->node_comm);
+    if(agg->leader_comm != MPI_COMM_NULL)
+        PMPI_Comm_free(&agg->leader_comm);
+    free(agg->lens);
+    free(agg->counts);
+    free(agg->displs);
+    free(agg->offs);
+    free(agg);
+    return;
+}
+
+/* issue the batch through the node leaders: each region's data is
+ * gathered from the processes of a node to the node's leader, which then
+ * writes the node's data for the region as one contiguous chunk with
+ * nonblocking independent I/O. Offsets are computed with a scan over the
+ * leaders only. If the leader can't gather the node's data (it can't
+ * allocate the buffer, or the node's data for the batch exceeds the
+ * INT_MAX bytes that gather displacements can address), it hands each
+ * process of the node its offsets instead, and every process writes its
+ * own data at the same place in the log.
+ */
+static int darshan_log_batch_issue_node_agg(darshan_core_log_fh log_fh,
+    struct darshan_log_batch *batch, uint64_t *inout_off)
+{
+    struct darshan_log_node_agg *agg = darshan_node_agg;
+    MPI_Offset node_lens[DARSHAN_LOG_BATCH_SIZE];
+    MPI_Offset node_offs[DARSHAN_LOG_BATCH_SIZE];
+    MPI_Offset my_offs[DARSHAN_LOG_BATCH_SIZE];
+    size_t region_start[DARSHAN_LOG_BATCH_SIZE];
+    size_t agg_len = 0;
+    int gather = 1;
+    int ret = 0;
+    int r, j;
+
+    PMPI_Gather(batch->lens, batch->count, MPI_INT, agg->lens, batch->count,
+        MPI_INT, 0, agg->node_comm);
+
+    if(agg->node_rank == 0)
+    {
+        /* the node's data is laid out region by region, in rank order */
+        for(j = 0; j < batch->count; j++)
+        {
+            region_start[j] = agg_len;
+            node_lens[j] = 0;
+            for(r = 0; r < agg->node_size; r++)
+                node_lens[j] += agg->lens[r * batch->count + j];
+            agg_len += node_lens[j];
+        }
+
+        if(agg_len > INT_MAX || darshan_core_reserve_scratch_buf(
+            &batch->agg_buf, &batch->agg_buf_size, &batch->agg_buf_huge_pages,
+            agg_len ? agg_len : 1) < 0)
+        {
+            DARSHAN_WARN("unable to aggregate log data on node leader, "
+                "writing it from each process");
+            gather = 0;
+        }
+    }
+    PMPI_Bcast(&gather, 1, MPI_INT, 0, agg->node_comm);
+
+    for(j = 0; gather && j < batch->count; j++)
+    {
+        if(agg->node_rank == 0)
+        {
+            for(r = 0; r < agg->node_size; r++)
+            {
+                agg->counts[r] = agg->lens[r * batch->count + j];
+                agg->displs[r] = (r == 0) ? 0 :
+                    agg->displs[r-1] + agg->counts[r-1];
+            }
+        }
+        PMPI_Gatherv(batch->bufs[j], batch->lens[j], MPI_BYTE,
+            batch->agg_buf + region_start[j], agg->counts, agg->displs,
+            MPI_BYTE, 0, agg->node_comm);
+    }
+
+    if(agg->node_rank == 0)
+        darshan_log_scan_offsets(agg->leader_comm, node_lens, batch->count,
+            node_offs, batch, inout_off);
+
+    batch->req_count = 0;
+    if(!gather)
+    {
+        /* each process writes its regions where the leader would have */
+        if(agg->node_rank == 0)
+        {
+            for(j = 0; j < batch->count; j++)
+            {
+                for(r = 0; r < agg->node_size; r++)
+                    agg->offs[r * batch->count + j] = (r == 0) ? node_offs[j] :
+                        agg->offs[(r-1) * batch->count + j] +
+                        agg->lens[(r-1) * batch->count + j];
+            }
+        }
+        PMPI_Scatter(agg->offs, batch->count, MPI_OFFSET, my_offs,
+            batch->count, MPI_OFFSET, 0, agg->node_comm);
+
+        for(j = 0; j < batch->count; j++)
+        {
+            if(batch->lens[j] == 0)
+                continue;
+            if(PMPI_File_iwrite_at(log_fh.mpi_fh, my_offs[j], batch->bufs[j],
+                batch->lens[j], MPI_BYTE, &batch->reqs[batch->req_count])
+                == MPI_SUCCESS)
+                batch->req_count++;
+            else
+                ret = -1;
+        }
+        return(ret);
+    }
+
+    if(agg->node_rank != 0)
+        return(0);
+
+    for(j = 0; j < batch->count; j++)
+    {
+        if(node_lens[j] == 0)
+            continue;
+        if(PMPI_File_iwrite_at(log_fh.mpi_fh, node_offs[j],
+            batch->agg_buf + region_start[j], node_lens[j], MPI_BYTE,
+            &batch->reqs[batch->req_count]) == MPI_SUCCESS)
+            batch->req_count++;
+        else
+            ret = -1;
+    }
+
+    return(ret);
+}
+#endif
+
+/* wait for the writes of an issued batch to complete, and empty it */
+static int darshan_log_batch_wait(struct darshan_log_batch *batch)
+{
+    int ret;
+
+#ifdef HAVE_MPI
+    if(batch->req_count > 0)
+    {
+        if(PMPI_Waitall(batch->req_count, batch->reqs, MPI_STATUSES_IGNORE)
+            != MPI_SUCCESS)
+            batch->err = -1;
+        batch->req_count = 0;
+    }
+#endif
+    if(batch->write_thread_started)
+    {
+        pthread_join(batch->write_thread, NULL);
+        batch->write_thread_started = 0;
+    }
+
+    ret = batch->err;
+    batch->err = 0;
+    batch->count = 0;
+    batch->issued = 0;
+    return(ret);
+}
+
+/* complete any writes in flight and free the batch's scratch buffers */
+static void darshan_log_batch_free(struct darshan_log_batch *batch)
+{
+    int j;
+
+    (void)darshan_log_batch_wait(batch);
+    for(j = 0; j < DARSHAN_LOG_BATCH_SIZE; j++)
+        darshan_core_free_scratch_buf(&batch->scratch[j],
+            &batch->scratch_sizes[j], &batch->scratch_huge_pages[j]);
+#ifdef DARSHAN_LOG_NODE_AGG
+    darshan_core_free_scratch_buf(&batch->agg_buf, &batch->agg_buf_size,
+        &batch->agg_buf_huge_pages);
+#endif
+    return;
+}
+
 void darshan_log_close(darshan_core_log_fh log_fh)
 {
 #ifdef HAVE_MPI
@@ -2016,11 +4758,62 @@ void darshan_log_finalize(char *logfile_name, double start_log_time)
     return;
 }
 
-static int darshan_deflate_buffer(void **pointers, int *lengths, int count,
-    char *comp_buf, int *comp_buf_length)
+/* upper bound on the compressed size of 'len' bytes of input, with the
+ * log compression method
+ */
+static size_t darshan_compress_bound(size_t len)
 {
-    int ret = 0;
-    int i;
+    switch(darshan_log_comp_type)
+    {
+#ifdef HAVE_LIBZSTD
+        case DARSHAN_ZSTD_COMP:
+            return(ZSTD_compressBound(len));
+#endif
+#ifdef HAVE_LIBLZ4
+        case DARSHAN_LZ4_COMP:
+        {
+            LZ4F_preferences_t prefs;
+
+            memset(&prefs, 0, sizeof(prefs));
+            prefs.frameInfo.blockSizeID = LZ4F_max64KB;
+            prefs.compressionLevel = darshan_log_comp_level;
+            return(LZ4F_HEADER_SIZE_MAX + LZ4F_compressBound(len, &prefs));
+        }
+#endif
+        default:
+            return(compressBound(len));
+    }
+}
+
+/* compress the input buffers into a single stream, with the log
+ * compression method
+ */
+static int darshan_compress_buffer(void **pointers, int *lengths, int count,
+    char *comp_buf, size_t comp_buf_size, int *comp_buf_length)
+{
+    switch(darshan_log_comp_type)
+    {
+#ifdef HAVE_LIBZSTD
+        case DARSHAN_ZSTD_COMP:
+            return(darshan_zstd_buffer(pointers, lengths, count, comp_buf,
+                comp_buf_size, comp_buf_length));
+#endif
+#ifdef HAVE_LIBLZ4
+        case DARSHAN_LZ4_COMP:
+            return(darshan_lz4_buffer(pointers, lengths, count, comp_buf,
+                comp_buf_size, comp_buf_length));
+#endif
+        default:
+            return(darshan_deflate_buffer(pointers, lengths, count, comp_buf,
+                comp_buf_size, comp_buf_length));
+    }
+}
+
+static int darshan_deflate_buffer(void **pointers, int *lengths, int count,
+    char *comp_buf, size_t comp_buf_size, int *comp_buf_length)
+{
+    int ret = 0;
+    int i;
     int total_target = 0;
     z_stream tmp_stream;
 
@@ -2039,67 +4832,589 @@ static int darshan_deflate_buffer(void **pointers, int *lengths, int count,
         return(0);
     }
 
-    memset(&tmp_stream, 0, sizeof(tmp_stream));
-    tmp_stream.zalloc = Z_NULL;
-    tmp_stream.zfree = Z_NULL;
-    tmp_stream.opaque = Z_NULL;
+    memset(&tmp_stream, 0, sizeof(tmp_stream));
+    tmp_stream.zalloc = Z_NULL;
+    tmp_stream.zfree = Z_NULL;
+    tmp_stream.opaque = Z_NULL;
+
+    /* initialize the zlib compression parameters */
+    /* TODO: check these parameters? */
+//    ret = deflateInit2(&tmp_stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+//        15 + 16, 8, Z_DEFAULT_STRATEGY);
+    ret = deflateInit(&tmp_stream, (darshan_log_comp_level > 0 &&
+        darshan_log_comp_level <= 9) ? darshan_log_comp_level :
+        Z_DEFAULT_COMPRESSION);
+    if(ret != Z_OK)
+    {
+        return(-1);
+    }
+
+    tmp_stream.next_out = (unsigned char *)comp_buf;
+    tmp_stream.avail_out = comp_buf_size;
+
+    /* loop over the input pointers */
+    for(i = 0; i < count; i++)
+    {
+        total_target += lengths[i];
+        tmp_stream.next_in = pointers[i];
+        tmp_stream.avail_in = lengths[i];
+        /* while we have not finished consuming all of the data available to
+         * this point in the loop
+         */
+        while(tmp_stream.total_in < total_target)
+        {
+            if(tmp_stream.avail_out == 0)
+            {
+                /* We ran out of buffer space for compression.  In theory,
+                 * we could start using some of the file_array buffer space
+                 * without having to malloc again.  In practice, this case 
+                 * is going to be practically impossible to hit.
+                 */
+                deflateEnd(&tmp_stream);
+                return(-1);
+            }
+
+            /* compress data */
+            ret = deflate(&tmp_stream, Z_NO_FLUSH);
+            if(ret != Z_OK)
+            {
+                deflateEnd(&tmp_stream);
+                return(-1);
+            }
+        }
+    }
+
+    /* flush compression and end */
+    ret = deflate(&tmp_stream, Z_FINISH);
+    if(ret != Z_STREAM_END)
+    {
+        deflateEnd(&tmp_stream);
+        return(-1);
+    }
+    deflateEnd(&tmp_stream);
+
+    *comp_buf_length = tmp_stream.total_out;
+    return(0);
+}
+
+#ifdef HAVE_LIBZSTD
+static int darshan_zstd_buffer(void **pointers, int *lengths, int count,
+    char *comp_buf, size_t comp_buf_size, int *comp_buf_length)
+{
+    ZSTD_CCtx *cctx;
+    ZSTD_inBuffer in;
+    ZSTD_outBuffer out = {comp_buf, comp_buf_size, 0};
+    size_t ret;
+    int total_target = 0;
+    int i;
+
+    /* just return if there is no data */
+    for(i = 0; i < count; i++)
+        total_target += lengths[i];
+    if(!total_target)
+    {
+        *comp_buf_length = 0;
+        return(0);
+    }
+
+    cctx = ZSTD_createCCtx();
+    if(!cctx)
+        return(-1);
+    ret = ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel,
+        darshan_log_comp_level);
+    if(ZSTD_isError(ret))
+    {
+        ZSTD_freeCCtx(cctx);
+        return(-1);
+    }
+
+    /* loop over the input pointers */
+    for(i = 0; i < count; i++)
+    {
+        in.src = pointers[i];
+        in.size = lengths[i];
+        in.pos = 0;
+        while(in.pos < in.size)
+        {
+            /* we ran out of buffer space for compression */
+            if(out.pos == out.size)
+            {
+                ZSTD_freeCCtx(cctx);
+                return(-1);
+            }
+
+            ret = ZSTD_compressStream2(cctx, &out, &in, ZSTD_e_continue);
+            if(ZSTD_isError(ret))
+            {
+                ZSTD_freeCCtx(cctx);
+                return(-1);
+            }
+        }
+    }
+
+    /* flush compression and end the frame */
+    in.src = NULL;
+    in.size = in.pos = 0;
+    do
+    {
+        ret = ZSTD_compressStream2(cctx, &out, &in, ZSTD_e_end);
+        if(ZSTD_isError(ret) || (ret && out.pos == out.size))
+        {
+            ZSTD_freeCCtx(cctx);
+            return(-1);
+        }
+    } while(ret);
+    ZSTD_freeCCtx(cctx);
+
+    *comp_buf_length = out.pos;
+    return(0);
+}
+#endif
+
+#ifdef HAVE_LIBLZ4
+static int darshan_lz4_buffer(void **pointers, int *lengths, int count,
+    char *comp_buf, size_t comp_buf_size, int *comp_buf_length)
+{
+    LZ4F_cctx *cctx;
+    LZ4F_preferences_t prefs;
+    size_t ret;
+    size_t out_len = 0;
+    int total_target = 0;
+    int i;
+
+    /* just return if there is no data */
+    for(i = 0; i < count; i++)
+        total_target += lengths[i];
+    if(!total_target)
+    {
+        *comp_buf_length = 0;
+        return(0);
+    }
+
+    if(LZ4F_isError(LZ4F_createCompressionContext(&cctx, LZ4F_VERSION)))
+        return(-1);
+
+    /* NOTE: darshan_compress_bound() sizes buffers with the same
+     * preferences
+     */
+    memset(&prefs, 0, sizeof(prefs));
+    prefs.frameInfo.blockSizeID = LZ4F_max64KB;
+    prefs.compressionLevel = darshan_log_comp_level;
+
+    ret = LZ4F_compressBegin(cctx, comp_buf, comp_buf_size, &prefs);
+    if(LZ4F_isError(ret))
+    {
+        LZ4F_freeCompressionContext(cctx);
+        return(-1);
+    }
+    out_len += ret;
+
+    /* loop over the input pointers; lz4 fails rather than overrunning the
+     * output buffer if it is too small
+     */
+    for(i = 0; i < count; i++)
+    {
+        ret = LZ4F_compressUpdate(cctx, comp_buf + out_len,
+            comp_buf_size - out_len, pointers[i], lengths[i], NULL);
+        if(LZ4F_isError(ret))
+        {
+            LZ4F_freeCompressionContext(cctx);
+            return(-1);
+        }
+        out_len += ret;
+    }
+
+    /* flush compression and end the frame */
+    ret = LZ4F_compressEnd(cctx, comp_buf + out_len, comp_buf_size - out_len,
+        NULL);
+    LZ4F_freeCompressionContext(cctx);
+    if(LZ4F_isError(ret))
+        return(-1);
+    out_len += ret;
+
+    *comp_buf_length = out_len;
+    return(0);
+}
+#endif
+
+/* set the log compression method and level from the DARSHAN_LOGCOMP
+ * environment variable ("zlib", "zstd" or "lz4", optionally followed by
+ * ":<level>")
+ */
+static void darshan_init_log_comp(void)
+{
+    char *envstr;
+    char *level_str;
+    size_t len;
+
+    envstr = getenv(DARSHAN_LOG_COMP_OVERRIDE);
+    if(!envstr)
+        return;
+
+    level_str = strchr(envstr, ':');
+    len = level_str ? (size_t)(level_str - envstr) : strlen(envstr);
+    if(len == 4 && strncmp(envstr, "zlib", len) == 0)
+        darshan_log_comp_type = DARSHAN_ZLIB_COMP;
+#ifdef HAVE_LIBZSTD
+    else if(len == 4 && strncmp(envstr, "zstd", len) == 0)
+        darshan_log_comp_type = DARSHAN_ZSTD_COMP;
+#endif
+#ifdef HAVE_LIBLZ4
+    else if(len == 3 && strncmp(envstr, "lz4", len) == 0)
+        darshan_log_comp_type = DARSHAN_LZ4_COMP;
+#endif
+    else
+    {
+        DARSHAN_WARN("unsupported log compression method %s, using zlib",
+            envstr);
+        return;
+    }
+
+    if(level_str)
+        darshan_log_comp_level = atoi(level_str + 1);
+
+    return;
+}
+
+/* set each module's soft memory budget from a list of "<module>:<MiB>"
+ * pairs in the DARSHAN_MODMEM_BUDGETS environment variable, splitting the
+ * remaining module memory quota evenly over the modules not listed. If no
+ * budgets are given, modules share the whole quota on a first come, first
+ * served basis instead.
+ */
+static void darshan_init_mod_mem_budgets(void)
+{
+    int *explicit = darshan_mod_mem_budget_explicit;
+    int explicit_count = 0;
+    size_t explicit_total = 0;
+    size_t default_budget = 0;
+    char *envstr, *budget_str, *tok, *saveptr, *sep;
+    double tmpfloat;
+    int i;
+
+    memset(darshan_mod_mem_budget, 0, sizeof(darshan_mod_mem_budget));
+    memset(darshan_mod_mem_budget_explicit, 0,
+        sizeof(darshan_mod_mem_budget_explicit));
+
+    envstr = getenv(DARSHAN_MOD_MEM_BUDGETS_OVERRIDE);
+    if(envstr && (budget_str = strdup(envstr)))
+    {
+        for(tok = strtok_r(budget_str, ",", &saveptr); tok;
+            tok = strtok_r(NULL, ",", &saveptr))
+        {
+            sep = strrchr(tok, ':');
+            if(!sep)
+                continue;
+            *sep = '\0';
+            /* silently ignore entries that are set poorly */
+            if(sscanf(sep + 1, "%lf", &tmpfloat) != 1 || tmpfloat < 0)
+                continue;
+            for(i = 0; i < DARSHAN_KNOWN_MODULE_COUNT; i++)
+            {
+                if(strcmp(tok, darshan_module_names[i]) == 0)
+                {
+                    if(!explicit[i])
+                        explicit_count++;
+                    else
+                        explicit_total -= darshan_mod_mem_budget[i];
+                    explicit[i] = 1;
+                    darshan_mod_mem_budget[i] = tmpfloat * 1024 * 1024;
+                    explicit_total += darshan_mod_mem_budget[i];
+                    break;
+                }
+            }
+        }
+        free(budget_str);
+    }
+
+    darshan_mod_mem_budgets_set = (explicit_count > 0);
+    if(!darshan_mod_mem_budgets_set)
+        return;
+
+    if(explicit_total < darshan_mod_mem_quota &&
+       explicit_count < DARSHAN_KNOWN_MODULE_COUNT)
+        default_budget = (darshan_mod_mem_quota - explicit_total) /
+            (DARSHAN_KNOWN_MODULE_COUNT - explicit_count);
+    for(i = 0; i < DARSHAN_MAX_MODS; i++)
+    {
+        if(!explicit[i])
+            darshan_mod_mem_budget[i] = (i < DARSHAN_KNOWN_MODULE_COUNT) ?
+                default_budget : 0;
+    }
+
+    return;
+}
+
+/* set the huge page mode from the DARSHAN_HUGEPAGES environment variable
+ * ("thp" or "hugetlb"), and look up the huge page size
+ */
+static void darshan_init_huge_pages(void)
+{
+    char *envstr;
+    char line[128];
+    unsigned long tmpval = 0;
+    FILE *fh;
+
+    envstr = getenv(DARSHAN_HUGE_PAGES_OVERRIDE);
+    if(!envstr)
+        return;
+
+    /* silently ignore if the env variable is set poorly */
+    if(strcmp(envstr, "thp") == 0)
+        darshan_huge_page_mode = DARSHAN_HUGE_PAGES_THP;
+    else if(strcmp(envstr, "hugetlb") == 0)
+        darshan_huge_page_mode = DARSHAN_HUGE_PAGES_HUGETLB;
+    else
+        return;
+
+    /* explicit huge pages come in the default hugetlb page size, while
+     * transparent huge pages are PMD sized
+     */
+    if(darshan_huge_page_mode == DARSHAN_HUGE_PAGES_HUGETLB)
+    {
+        fh = fopen("/proc/meminfo", "r");
+        if(fh)
+        {
+            while(fgets(line, sizeof(line), fh))
+            {
+                if(sscanf(line, "Hugepagesize: %lu kB", &tmpval) == 1)
+                {
+                    tmpval *= 1024;
+                    break;
+                }
+            }
+            fclose(fh);
+        }
+    }
+    else
+    {
+        fh = fopen("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", "r");
+        if(fh)
+        {
+            if(fscanf(fh, "%lu", &tmpval) != 1)
+                tmpval = 0;
+            fclose(fh);
+        }
+    }
+    if(fh && tmpval >= darshan_sys_page_size &&
+       (tmpval % darshan_sys_page_size) == 0)
+        darshan_huge_page_size = tmpval;
+
+    return;
+}
+
+/* map 'size' bytes (a multiple of the huge page size) of anonymous memory
+ * aligned to the huge page size, and ask for it to be backed by
+ * transparent huge pages. Returns NULL on failure.
+ */
+static void *darshan_huge_page_reserve(size_t size, int prot, int flags)
+{
+    char *buf;
+    size_t lead;
+
+    /* over-map by one huge page, and trim the mapping to the alignment */
+    buf = mmap(NULL, size + darshan_huge_page_size, prot,
+        MAP_PRIVATE|MAP_ANONYMOUS|flags, -1, 0);
+    if(buf == MAP_FAILED)
+        return(NULL);
+    lead = (uintptr_t)buf % darshan_huge_page_size;
+    if(lead)
+    {
+        lead = darshan_huge_page_size - lead;
+        munmap(buf, lead);
+    }
+    if(lead < darshan_huge_page_size)
+        munmap(buf + lead + size, darshan_huge_page_size - lead);
+    buf += lead;
+
+#ifdef MADV_HUGEPAGE
+    (void)madvise(buf, size, MADV_HUGEPAGE);
+#endif
+
+    return(buf);
+}
+
+/* amount of memory committed to a module's records */
+static size_t darshan_module_mem_committed(struct darshan_core_module *mod)
+{
+    return(((char *)mod->rec_buf_p - (char *)mod->rec_buf_start) +
+        mod->rec_mem_avail);
+}
+
+/* commit more of a module's reserved address space so that it can store a
+ * record of size 'rec_len', without exceeding the module memory quota
+ */
+static int darshan_module_mem_grow(struct darshan_core_runtime *core,
+    struct darshan_core_module *mod, size_t rec_len, int overflow)
+{
+#ifndef __DARSHAN_ENABLE_MMAP_LOGS
+    size_t committed = darshan_module_mem_committed(mod);
+    size_t needed = rec_len - mod->rec_mem_avail;
+    size_t grow_len = DARSHAN_MOD_MEM_CHUNK_SIZE;
+    size_t mod_mem_free, own_budget, lent_reserve, limit, huge_len;
+    int i;
+
+    /* overflow records are committed a page at a time */
+    if(overflow || grow_len < needed)
+        grow_len = needed;
+    if(grow_len % darshan_sys_page_size)
+        grow_len += darshan_sys_page_size - (grow_len % darshan_sys_page_size);
+
+    if(overflow)
+    {
+        /* overflow records ignore module budgets, and may use some
+         * memory past the quota
+         */
+        if((grow_len > (mod->rec_mem_reserved - committed)) ||
+           ((core->mod_mem_used + grow_len) >
+            (darshan_mod_mem_quota + DARSHAN_OVERFLOW_MEM_MAX)))
+            return(-1);
+    }
+    else
+    {
+        /* don't grow past the module's reservation or the memory quota */
+        if(grow_len > (mod->rec_mem_reserved - committed))
+            grow_len = mod->rec_mem_reserved - committed;
+        if(core->mod_mem_used >= darshan_mod_mem_quota)
+            return(-1);
+        mod_mem_free = darshan_mod_mem_quota - core->mod_mem_used;
+
+        /* a module can always use what is left of its own budget, but may
+         * only borrow free memory that other modules are not holding in
+         * reserve: modules given an explicit budget reserve all of it,
+         * while other modules lend their entire budget until they are in
+         * use, and then keep half of their unused budget. Without budgets,
+         * all of the free memory is available to any module.
+         */
+        own_budget = mod_mem_free;
+        if(darshan_mod_mem_budgets_set)
+        {
+            own_budget = 0;
+            if(darshan_mod_mem_budget[mod->mod_id] > committed)
+                own_budget = darshan_mod_mem_budget[mod->mod_id] - committed;
+            if(own_budget > mod_mem_free)
+                own_budget = mod_mem_free;
+        }
+
+        /* with huge pages, commit up to the next huge page boundary if the
+         * module's own budget allows it, so that the kernel can back the
+         * whole huge page when it is first touched. As for
+         * darshan_core_huge_page_alloc(), this is only done once the extra
+         * memory is at most an eighth of the module's committed memory, so
+         * that small modules don't hold on to whole huge pages.
+         */
+        if(darshan_huge_page_mode != DARSHAN_HUGE_PAGES_NONE)
+        {
+            huge_len = committed + grow_len;
+            if(huge_len % darshan_huge_page_size)
+                huge_len += darshan_huge_page_size -
+                    (huge_len % darshan_huge_page_size);
+            huge_len -= committed;
+            if(huge_len <= own_budget &&
+               huge_len <= (mod->rec_mem_reserved - committed) &&
+               (huge_len - grow_len) <= ((committed + grow_len) / 8))
+                grow_len = huge_len;
+        }
+
+        lent_reserve = 0;
+        if(darshan_mod_mem_budgets_set)
+        {
+            for(i = 0; i < DARSHAN_MAX_MODS; i++)
+            {
+                size_t other_committed = 0;
+                size_t other_unused = 0;
+
+                if(i == mod->mod_id)
+                    continue;
+                if(core->mod_array[i])
+                    other_committed =
+                        darshan_module_mem_committed(core->mod_array[i]);
+                if(darshan_mod_mem_budget[i] > other_committed)
+                    other_unused = darshan_mod_mem_budget[i] - other_committed;
+
+                if(darshan_mod_mem_budget_explicit[i])
+                    lent_reserve += other_unused;
+                else if(core->mod_array[i] && core->mod_array[i]->rec_mem_reserved)
+                    lent_reserve += other_unused / 2;
+            }
+        }
+        limit = own_budget;
+        if(mod_mem_free > (own_budget + lent_reserve))
+            limit = mod_mem_free - lent_reserve;
+        if(grow_len > limit)
+        {
+            grow_len = limit;
+            grow_len -= grow_len % darshan_sys_page_size;
+        }
+        if(grow_len < needed)
+            return(-1);
+    }
+
+    if(mprotect((char *)mod->rec_buf_start + committed, grow_len,
+        PROT_READ|PROT_WRITE) < 0)
+        return(-1);
 
-    /* initialize the zlib compression parameters */
-    /* TODO: check these parameters? */
-//    ret = deflateInit2(&tmp_stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
-//        15 + 16, 8, Z_DEFAULT_STRATEGY);
-    ret = deflateInit(&tmp_stream, Z_DEFAULT_COMPRESSION);
-    if(ret != Z_OK)
+    mod->rec_mem_avail += grow_len;
+    core->mod_mem_used += grow_len;
+    return(0);
+#else
+    /* module memory is a fixed region of the mmap log */
+    return(-1);
+#endif
+}
+
+/* release a module's reserved record memory */
+static void darshan_module_mem_release(struct darshan_core_module *mod)
+{
+    struct darshan_core_missed_record *missed, *tmp;
+
+#ifndef __DARSHAN_ENABLE_MMAP_LOGS
+    if(mod->rec_mem_reserved)
+        munmap(mod->rec_buf_start, mod->rec_mem_reserved);
+#endif
+    HASH_ITER(hlink, mod->missed_hash, missed, tmp)
     {
-        return(-1);
+        HASH_DELETE(hlink, mod->missed_hash, missed);
+        free(missed);
     }
+    return;
+}
 
-    tmp_stream.next_out = (unsigned char *)comp_buf;
-    tmp_stream.avail_out = darshan_mod_mem_quota;
+/* account for record 'rec_id' failing to register with module 'mod',
+ * counting each distinct record once. Must be called holding the core lock.
+ */
+static void darshan_core_drop_record(
+    struct darshan_core_module *mod, darshan_record_id rec_id)
+{
+    struct darshan_core_missed_record *missed;
 
-    /* loop over the input pointers */
-    for(i = 0; i < count; i++)
+    HASH_FIND(hlink, mod->missed_hash, &rec_id, sizeof(darshan_record_id),
+        missed);
+    if(missed)
     {
-        total_target += lengths[i];
-        tmp_stream.next_in = pointers[i];
-        tmp_stream.avail_in = lengths[i];
-        /* while we have not finished consuming all of the data available to
-         * this point in the loop
+        /* records already folded into an overflow record will be folded
+         * into it again by the module
          */
-        while(tmp_stream.total_in < total_target)
-        {
-            if(tmp_stream.avail_out == 0)
-            {
-                /* We ran out of buffer space for compression.  In theory,
-                 * we could start using some of the file_array buffer space
-                 * without having to malloc again.  In practice, this case 
-                 * is going to be practically impossible to hit.
-                 */
-                deflateEnd(&tmp_stream);
-                return(-1);
-            }
-
-            /* compress data */
-            ret = deflate(&tmp_stream, Z_NO_FLUSH);
-            if(ret != Z_OK)
-            {
-                deflateEnd(&tmp_stream);
-                return(-1);
-            }
-        }
+        if(!missed->folded)
+            DARSHAN_MOD_FLAG_SET(__darshan_core->log_hdr_p->partial_flag,
+                mod->mod_id);
+        return;
     }
 
-    /* flush compression and end */
-    ret = deflate(&tmp_stream, Z_FINISH);
-    if(ret != Z_STREAM_END)
+    DARSHAN_MOD_FLAG_SET(__darshan_core->log_hdr_p->partial_flag, mod->mod_id);
+
+    /* NOTE: if we can't remember the record, it may be counted again */
+    missed = malloc(sizeof(*missed));
+    if(missed)
     {
-        deflateEnd(&tmp_stream);
-        return(-1);
+        missed->id = rec_id;
+        missed->folded = 0;
+        HASH_ADD(hlink, mod->missed_hash, id, sizeof(darshan_record_id),
+            missed);
     }
-    deflateEnd(&tmp_stream);
+    mod->rec_dropped++;
 
-    *comp_buf_length = tmp_stream.total_out;
-    return(0);
+    return;
 }
 
 /* free darshan core data structures to shutdown */
@@ -2118,6 +5433,7 @@ static void darshan_core_cleanup(struct darshan_core_runtime* core)
     {
         if(core->mod_array[i])
         {
+            darshan_module_mem_release(core->mod_array[i]);
             free(core->mod_array[i]);
             core->mod_array[i] = NULL;
         }
@@ -2127,8 +5443,13 @@ static void darshan_core_cleanup(struct darshan_core_runtime* core)
     free(core->log_hdr_p);
     free(core->log_job_p);
     free(core->log_exemnt_p);
-    free(core->log_name_p);
-    free(core->log_mod_p);
+    while(core->name_chunk_head)
+    {
+        struct darshan_core_name_chunk *chunk = core->name_chunk_head;
+        core->name_chunk_head = chunk->next;
+        darshan_free_name_chunk(chunk);
+    }
+    free(core->name_free_slots);
 #endif
 
 #ifdef HAVE_MPI
@@ -2136,8 +5457,12 @@ static void darshan_core_cleanup(struct darshan_core_runtime* core)
         PMPI_Comm_free(&core->mpi_comm);
 #endif
 
-    if(core->comp_buf)
-        free(core->comp_buf);
+    free(darshan_path_trie);
+    darshan_path_trie = NULL;
+    darshan_path_trie_count = 0;
+    darshan_path_trie_size = 0;
+
+    darshan_core_free_comp_buf(core);
     free(core);
 
     return;
@@ -2170,6 +5495,7 @@ void darshan_shutdown_bench(int argc, char **argv)
     /* clear out existing core runtime structure */
     if(__darshan_core)
     {
+        __DARSHAN_CORE_SET_ENABLED(0);
         darshan_core_cleanup(__darshan_core);
         __darshan_core = NULL;
     }
@@ -2282,24 +5608,65 @@ void darshan_core_register_module(
 
     /* set module's record buffer and max memory usage */
     mod_mem_avail = darshan_mod_mem_quota - __darshan_core->mod_mem_used;
+    if(mod_mem_avail > darshan_mod_mem_quota)
+        mod_mem_avail = 0;
+#ifndef __DARSHAN_ENABLE_MMAP_LOGS
+    if(mod_mem_req > 0)
+    {
+        /* reserve enough address space for this module to hold the entire
+         * module memory quota, so its records stay contiguous as it grows,
+         * but only commit memory to it as records are registered
+         */
+        mod->rec_mem_reserved = darshan_mod_mem_quota + DARSHAN_OVERFLOW_MEM_MAX;
+        if(mod->rec_mem_reserved % darshan_sys_page_size)
+            mod->rec_mem_reserved += darshan_sys_page_size -
+                (mod->rec_mem_reserved % darshan_sys_page_size);
+        mod->rec_buf_start = NULL;
+        if(darshan_huge_page_mode != DARSHAN_HUGE_PAGES_NONE)
+        {
+            /* records are committed incrementally, so they are backed by
+             * transparent huge pages even if explicit ones were requested
+             */
+            if(mod->rec_mem_reserved % darshan_huge_page_size)
+                mod->rec_mem_reserved += darshan_huge_page_size -
+                    (mod->rec_mem_reserved % darshan_huge_page_size);
+            mod->rec_buf_start = darshan_huge_page_reserve(
+                mod->rec_mem_reserved, PROT_NONE, MAP_NORESERVE);
+        }
+        if(!mod->rec_buf_start)
+            mod->rec_buf_start = mmap(NULL, mod->rec_mem_reserved, PROT_NONE,
+                MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+        if(mod->rec_buf_start == MAP_FAILED)
+        {
+            __DARSHAN_CORE_UNLOCK();
+            free(mod);
+            return;
+        }
+    }
+    mod->rec_buf_p = mod->rec_buf_start;
+    *inout_mod_buf_size = (mod_mem_avail >= mod_mem_req) ?
+        mod_mem_req : mod_mem_avail;
+#else
     if(mod_mem_avail >= mod_mem_req)
         mod->rec_mem_avail = mod_mem_req;
     else
         mod->rec_mem_avail = mod_mem_avail;
     mod->rec_buf_start = __darshan_core->log_mod_p + __darshan_core->mod_mem_used;
     mod->rec_buf_p = mod->rec_buf_start;
+    __darshan_core->mod_mem_used += mod->rec_mem_avail;
+    *inout_mod_buf_size = mod->rec_mem_avail;
+#endif
+    mod->mod_id = mod_id;
     mod->mod_funcs = mod_funcs;
 
     /* register module with darshan */
     __darshan_core->mod_array[mod_id] = mod;
-    __darshan_core->mod_mem_used += mod->rec_mem_avail;
     __darshan_core->log_hdr_p->mod_ver[mod_id] = darshan_module_versions[mod_id];
 #ifdef __DARSHAN_ENABLE_MMAP_LOGS
     __darshan_core->log_hdr_p->mod_map[mod_id].off =
         ((char *)mod->rec_buf_start - (char *)__darshan_core->log_hdr_p);
 #endif
 
-    *inout_mod_buf_size = mod->rec_mem_avail;
     __DARSHAN_CORE_UNLOCK();
 
     /* set the memory alignment and calling process's rank, if desired */
@@ -2311,8 +5678,8 @@ void darshan_core_register_module(
     return;
 }
 
-/* NOTE: we currently don't really have a simple way of returning the
- * memory allocated to this module back to darshan to hand out to
+/* NOTE: with mmap logs enabled, we don't have a simple way of returning
+ * the memory allocated to this module back to darshan to hand out to
  * other modules, so all we do is disable the module so darshan does
  * not attempt to call into it at shutdown time
  */
@@ -2336,9 +5703,16 @@ void darshan_core_unregister_module(
 #ifdef __DARSHAN_ENABLE_MMAP_LOGS
     __darshan_core->log_hdr_p->mod_map[mod_id].off =
         __darshan_core->log_hdr_p->mod_map[mod_id].len = 0;
+#else
+    if(mod)
+        __darshan_core->mod_mem_used -= darshan_module_mem_committed(mod);
 #endif
     __DARSHAN_CORE_UNLOCK();
-    free(mod);
+    if(mod)
+    {
+        darshan_module_mem_release(mod);
+        free(mod);
+    }
 
     return;
 }
@@ -2369,9 +5743,11 @@ void *darshan_core_register_record(
     }
 
     /* check to see if this module has enough space to store a new record */
-    if(__darshan_core->mod_array[mod_id]->rec_mem_avail < rec_len)
+    if((__darshan_core->mod_array[mod_id]->rec_mem_avail < rec_len) &&
+       (darshan_module_mem_grow(__darshan_core,
+            __darshan_core->mod_array[mod_id], rec_len, 0) < 0))
     {
-        DARSHAN_MOD_FLAG_SET(__darshan_core->log_hdr_p->partial_flag, mod_id);
+        darshan_core_drop_record(__darshan_core->mod_array[mod_id], rec_id);
         __DARSHAN_CORE_UNLOCK();
         return(NULL);
     }
@@ -2386,10 +5762,12 @@ void *darshan_core_register_record(
             sizeof(darshan_record_id), ref);
         if(!ref)
         {
-            ret = darshan_add_name_record_ref(__darshan_core, rec_id, name, mod_id);
+            ret = darshan_add_name_record_ref(__darshan_core, rec_id, name,
+                mod_id, 0);
             if(ret == 0)
             {
-                DARSHAN_MOD_FLAG_SET(__darshan_core->log_hdr_p->partial_flag, mod_id);
+                darshan_core_drop_record(__darshan_core->mod_array[mod_id],
+                    rec_id);
                 __DARSHAN_CORE_UNLOCK();
                 return(NULL);
             }
@@ -2414,16 +5792,357 @@ void *darshan_core_register_record(
     return(rec_buf);;
 }
 
-char *darshan_core_lookup_record_name(darshan_record_id rec_id)
+int darshan_core_record_overflow_policy()
+{
+    return(darshan_record_overflow_policy);
+}
+
+void *darshan_core_huge_page_alloc(size_t size)
+{
+    void *buf;
+    size_t huge_size = size;
+
+    if(darshan_huge_page_mode == DARSHAN_HUGE_PAGES_NONE || size == 0)
+        return(NULL);
+
+    /* huge pages may be as large as 1 GiB, so leave buffers that would
+     * waste more than an eighth of their size to malloc
+     */
+    if(huge_size % darshan_huge_page_size)
+        huge_size += darshan_huge_page_size - (huge_size % darshan_huge_page_size);
+    if((huge_size - size) > (size / 8))
+        return(NULL);
+    size = huge_size;
+
+#ifdef MAP_HUGETLB
+    if(darshan_huge_page_mode == DARSHAN_HUGE_PAGES_HUGETLB)
+    {
+        /* explicit huge pages are reserved when mapped (as MAP_NORESERVE
+         * is not given), so running out of them fails here rather than
+         * at a later page fault
+         */
+        buf = mmap(NULL, size, PROT_READ|PROT_WRITE,
+            MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+        if(buf != MAP_FAILED)
+            return(buf);
+    }
+#endif
+
+    buf = darshan_huge_page_reserve(size, PROT_READ|PROT_WRITE, 0);
+    return(buf);
+}
+
+void darshan_core_huge_page_free(void *buf, size_t size)
+{
+    if(!buf)
+        return;
+
+    if(size % darshan_huge_page_size)
+        size += darshan_huge_page_size - (size % darshan_huge_page_size);
+    munmap(buf, size);
+
+    return;
+}
+
+#ifdef HAVE_MPI
+int darshan_core_reduce_shared_records(
+    void *rec_buf,
+    int rec_count,
+    int rec_size,
+    MPI_User_function *rec_op,
+    int var_time_off,
+    int var_bytes_off)
+{
+    struct darshan_shared_redux *redux;
+    struct darshan_core_name_record_ref **refs;
+    char *tmp_buf;
+    int kept = 0;
+    int i, j, k, n;
+
+    /* each module queues at most one set of shared records */
+    assert(darshan_shared_redux_count < DARSHAN_MAX_MODS);
+    if(rec_count <= 0)
+        return(0);
+
+    redux = &darshan_shared_redux_list[darshan_shared_redux_count++];
+    redux->mod_id = -1;
+    redux->rec_buf = rec_buf;
+    redux->rec_count = rec_count;
+    redux->rec_size = rec_size;
+    redux->rec_op = rec_op;
+    redux->var_off[0] = var_time_off;
+    redux->var_off[1] = var_bytes_off;
+    redux->elem_size = rec_size;
+    if(var_time_off >= 0 && var_bytes_off >= 0)
+        redux->elem_size += 2 * sizeof(struct darshan_variance_dt);
+
+    /* look up the name of each record, and move the records kept by this
+     * process to the start of the buffer, preserving the order of the
+     * records on either side
+     */
+    redux->rec_refs = malloc(rec_count * sizeof(*redux->rec_refs));
+    assert(redux->rec_refs);
+    for(i = 0; i < rec_count; i++)
+    {
+        redux->rec_refs[i] =
+            darshan_shared_redux_ref((char *)rec_buf + i * rec_size);
+        if(darshan_shared_redux_kept(redux->rec_refs[i]))
+            kept++;
+    }
+    if(kept == 0 || kept == rec_count)
+        return(kept);
+
+    tmp_buf = malloc(rec_count * rec_size);
+    refs = malloc(rec_count * sizeof(*refs));
+    assert(tmp_buf && refs);
+    memcpy(refs, redux->rec_refs, rec_count * sizeof(*refs));
+    for(i = 0, j = 0, k = kept; i < rec_count; i++)
+    {
+        n = darshan_shared_redux_kept(refs[i]) ? j++ : k++;
+        memcpy(tmp_buf + n * rec_size, (char *)rec_buf + i * rec_size,
+            rec_size);
+        redux->rec_refs[n] = refs[i];
+    }
+    memcpy(rec_buf, tmp_buf, rec_count * rec_size);
+    free(tmp_buf);
+    free(refs);
+
+    return(kept);
+}
+#endif
+
+/* account for record 'rec_id' of module 'mod' as folded into an overflow
+ * record (rather than dropped, if it failed to register), counting each
+ * distinct record once. Must be called holding the core lock.
+ */
+static void darshan_core_fold_record(
+    struct darshan_core_module *mod, darshan_record_id rec_id)
+{
+    struct darshan_core_missed_record *missed;
+
+    HASH_FIND(hlink, mod->missed_hash, &rec_id, sizeof(darshan_record_id),
+        missed);
+    if(missed && missed->folded)
+        return;
+
+    if(missed)
+    {
+        missed->folded = 1;
+        mod->rec_dropped--;
+        if(mod->rec_dropped == 0)
+            DARSHAN_MOD_FLAG_UNSET(__darshan_core->log_hdr_p->partial_flag,
+                mod->mod_id);
+    }
+    else
+    {
+        /* an evicted record, which registered successfully */
+        missed = malloc(sizeof(*missed));
+        if(missed)
+        {
+            missed->id = rec_id;
+            missed->folded = 1;
+            HASH_ADD(hlink, mod->missed_hash, id, sizeof(darshan_record_id),
+                missed);
+        }
+    }
+    mod->rec_folded++;
+
+    return;
+}
+
+void *darshan_core_register_overflow_record(
+    darshan_record_id rec_id,
+    const char *name,
+    darshan_module_id mod_id,
+    int rec_len,
+    darshan_record_id *overflow_rec_id,
+    struct darshan_fs_info *fs_info)
 {
+#ifndef __DARSHAN_ENABLE_MMAP_LOGS
+    struct darshan_core_module *mod;
     struct darshan_core_name_record_ref *ref;
-    char *name = NULL;
+    char overflow_name[DARSHAN_MAX_MNT_PATH + sizeof(DARSHAN_OVERFLOW_RECORD_NAME) + 1];
+    void *rec_buf;
+    int mnt_index;
+    int len = -1;
+    int ret;
+
+    if(darshan_record_overflow_policy == DARSHAN_RECORD_OVERFLOW_DROP)
+        return(NULL);
+
+    /* name the overflow record after the mount point the record is on,
+     * falling back to the record for no known mount point if the name
+     * doesn't fit
+     */
+    mnt_index = darshan_mnt_index_from_path(name);
+    if(mnt_index >= 0)
+    {
+        len = snprintf(overflow_name, sizeof(overflow_name), "%s%s%s",
+            mnt_data_array[mnt_index].path,
+            (mnt_data_array[mnt_index].path[
+             strlen(mnt_data_array[mnt_index].path) - 1] == '/') ? "" : "/",
+            DARSHAN_OVERFLOW_RECORD_NAME);
+    }
+    if(len < 0 || len >= sizeof(overflow_name))
+    {
+        strcpy(overflow_name, DARSHAN_OVERFLOW_RECORD_NAME);
+        mnt_index = DARSHAN_MAX_MNTS;
+    }
+    *overflow_rec_id = darshan_core_gen_record_id(overflow_name);
+
+    __DARSHAN_CORE_LOCK();
+    if(!__darshan_core)
+    {
+        __DARSHAN_CORE_UNLOCK();
+        return(NULL);
+    }
+    mod = __darshan_core->mod_array[mod_id];
+
+    if(!mod->overflow_recs[mnt_index])
+    {
+        HASH_FIND(hlink, __darshan_core->name_hash, overflow_rec_id,
+            sizeof(darshan_record_id), ref);
+        if(!ref)
+        {
+            /* NOTE: this may drop the core lock */
+            ret = darshan_add_name_record_ref(__darshan_core, *overflow_rec_id,
+                overflow_name, mod_id, 1);
+            if(ret == 0)
+            {
+                __DARSHAN_CORE_UNLOCK();
+                return(NULL);
+            }
+        }
+        else
+        {
+            DARSHAN_MOD_FLAG_SET(ref->mod_flags, mod_id);
+        }
+    }
+
+    /* check again, in case someone else registered the overflow record
+     * while the core lock was dropped
+     */
+    rec_buf = mod->overflow_recs[mnt_index];
+    if(!rec_buf)
+    {
+        if((mod->rec_mem_avail < rec_len) &&
+           (darshan_module_mem_grow(__darshan_core, mod, rec_len, 1) < 0))
+        {
+            __DARSHAN_CORE_UNLOCK();
+            return(NULL);
+        }
+
+        rec_buf = mod->rec_buf_p;
+        memset(rec_buf, 0, rec_len);
+        mod->rec_buf_p += rec_len;
+        mod->rec_mem_avail -= rec_len;
+        mod->overflow_recs[mnt_index] = rec_buf;
+    }
+    darshan_core_fold_record(mod, rec_id);
+    __DARSHAN_CORE_UNLOCK();
+
+    if(fs_info)
+        darshan_fs_info_from_path(name, fs_info);
+
+    return(rec_buf);
+#else
+    /* module memory is a fixed region of the mmap log */
+    return(NULL);
+#endif
+}
+
+int darshan_core_replace_record(
+    darshan_record_id old_rec_id,
+    darshan_record_id new_rec_id,
+    const char *name,
+    darshan_module_id mod_id,
+    struct darshan_fs_info *fs_info)
+{
+    struct darshan_core_name_record_ref *ref;
+    struct darshan_core_missed_record *missed;
+    struct darshan_core_module *mod;
+    int ret;
 
     __DARSHAN_CORE_LOCK();
-    HASH_FIND(hlink, __darshan_core->name_hash, &rec_id,
+    if(!__darshan_core)
+    {
+        __DARSHAN_CORE_UNLOCK();
+        return(0);
+    }
+    mod = __darshan_core->mod_array[mod_id];
+
+    HASH_FIND(hlink, __darshan_core->name_hash, &new_rec_id,
+        sizeof(darshan_record_id), ref);
+    if(!ref)
+    {
+        ret = darshan_add_name_record_ref(__darshan_core, new_rec_id, name,
+            mod_id, 0);
+        if(ret == 0)
+        {
+            __DARSHAN_CORE_UNLOCK();
+            return(0);
+        }
+    }
+    else
+    {
+        DARSHAN_MOD_FLAG_SET(ref->mod_flags, mod_id);
+    }
+
+    /* the evicted record no longer belongs to this module, so it must not
+     * be considered when looking for records shared across processes. Its
+     * name is removed unless another module has a record with the same id,
+     * or DXT may have traced it.
+     */
+    HASH_FIND(hlink, __darshan_core->name_hash, &old_rec_id,
         sizeof(darshan_record_id), ref);
     if(ref)
-        name = ref->name_record->name;
+    {
+        DARSHAN_MOD_FLAG_UNSET(ref->mod_flags, mod_id);
+#ifndef __DARSHAN_ENABLE_MMAP_LOGS
+        if(ref->mod_flags == 0 &&
+           !__darshan_core->mod_array[DXT_POSIX_MOD] &&
+           !__darshan_core->mod_array[DXT_MPIIO_MOD])
+            darshan_remove_name_record_ref(__darshan_core, ref);
+#endif
+    }
+
+    darshan_core_fold_record(mod, old_rec_id);
+
+    /* the new record failed to register, but is tracked after all (unless
+     * it was evicted before, in which case it stays counted as folded)
+     */
+    HASH_FIND(hlink, mod->missed_hash, &new_rec_id,
+        sizeof(darshan_record_id), missed);
+    if(missed && !missed->folded)
+    {
+        HASH_DELETE(hlink, mod->missed_hash, missed);
+        free(missed);
+        mod->rec_dropped--;
+        if(mod->rec_dropped == 0)
+            DARSHAN_MOD_FLAG_UNSET(__darshan_core->log_hdr_p->partial_flag,
+                mod_id);
+    }
+    __DARSHAN_CORE_UNLOCK();
+
+    if(fs_info)
+        darshan_fs_info_from_path(name, fs_info);
+
+    return(1);
+}
+
+char *darshan_core_lookup_record_name(darshan_record_id rec_id)
+{
+    struct darshan_core_name_record_ref *ref;
+    char *name = NULL;
+
+    __DARSHAN_CORE_LOCK();
+    if(__darshan_core)
+    {
+        HASH_FIND(hlink, __darshan_core->name_hash, &rec_id,
+            sizeof(darshan_record_id), ref);
+        if(ref)
+            name = ref->name_record->name;
+    }
     __DARSHAN_CORE_UNLOCK();
 
     return(name);
@@ -2475,6 +6194,15 @@ int darshan_core_excluded_path(const char *path)
     char *exclude, *include;
     int tmp_index = 0;
     int tmp_jndex;
+    int flags;
+
+    if(darshan_path_trie)
+    {
+        /* inclusions always take precedence over exclusions */
+        flags = darshan_path_trie_match(path, NULL);
+        return((flags & DARSHAN_PATH_TRIE_EXCLUDE) &&
+            !(flags & DARSHAN_PATH_TRIE_INCLUDE));
+    }
 
     /* if user has set DARSHAN_EXCLUDE_DIRS, override the default ones */
     if (user_darshan_path_exclusions != NULL) {
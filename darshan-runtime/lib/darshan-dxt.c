@@ -28,6 +28,11 @@
 #include <libgen.h>
 #include <pthread.h>
 #include <regex.h>
+#include <math.h>
+#include <limits.h>
+#ifdef HAVE_STDATOMIC_H
+#include <stdatomic.h>
+#endif
 
 #include "utlist.h"
 #include "uthash.h"
@@ -46,9 +51,15 @@ typedef int64_t off64_t;
 #define DXT_IO_TRACE_MEM_MAX (4 * 1024 * 1024) /* 4 MiB default */
 #endif
 
-/* initial size of read/write trace buffer (in number of segments) */
-/* NOTE: when this size is exceeded, the buffer size is doubled */
-#define IO_TRACE_BUF_SIZE       64
+/* size of each read/write trace block (in bytes of encoded segments) */
+/* NOTE: when a block fills up, another block is linked after it */
+#define IO_TRACE_BUF_SIZE       2048
+
+/* maximum size of a single encoded segment (4 varints) */
+#define DXT_MAX_ENCODED_SEGMENT 40
+
+/* number of trace blocks allocated at a time for each thread */
+#define DXT_ARENA_CHUNK_BLOCKS  16
 
 /* XXX: dirty hack -- If DXT runs out of memory to store trace data in,
  * we should set a flag so that log parsers know that the log has
@@ -79,13 +90,111 @@ struct dxt_file_record_ref
 {
     struct dxt_file_record *file_rec;
 
-    int64_t write_available_buf;
-    int64_t read_available_buf;
-
-    segment_info *write_traces;
-    segment_info *read_traces;
+    /* list of per-thread traces of this record, in creation order */
+    struct dxt_thread_trace *thread_traces;
 
     char trace_enabled;
+    char dropped; /* set if the traces were filtered out at shutdown */
+};
+
+/* Trace segments are stored in fixed-size blocks that are linked together
+ * as they fill up, so traces never need to be copied while tracing.  Blocks
+ * are carved out of larger per-thread arena chunks to limit the number of
+ * allocations.
+ *
+ * To fit more segments in the DXT memory limit, segments are encoded
+ * compactly in the blocks, as zigzag varints of the difference from the
+ * previous segment in the same chain:
+ *      - offset, relative to the end of the previous segment
+ *      - length, relative to the previous length
+ *      - start time, in nanoseconds after the previous end time
+ *      - duration, in nanoseconds
+ * Segments never span blocks, and are decoded back into segment_info
+ * structures (with nanosecond timestamp resolution) at shutdown time.
+ */
+struct dxt_segment_block
+{
+    struct dxt_segment_block *next;
+    int used;     /* bytes of encoded segments */
+    int capacity; /* usable bytes in data[] */
+    unsigned char data[IO_TRACE_BUF_SIZE];
+};
+
+struct dxt_arena_chunk
+{
+    struct dxt_arena_chunk *next;
+    int used;
+    struct dxt_segment_block blocks[DXT_ARENA_CHUNK_BLOCKS];
+};
+
+/* when huge pages are enabled, arena chunks are carved out of one huge
+ * page backed region per module, sized for the DXT memory limit, and
+ * allocated individually once it is used up
+ */
+struct dxt_arena_region
+{
+    char *base;
+    size_t size;
+    size_t used;
+    int failed; /* set if the region couldn't be mapped */
+};
+
+/* encoding state carried from one segment to the next in a chain */
+struct dxt_segment_delta
+{
+    int64_t end_offset;
+    int64_t length;
+    int64_t end_ns;
+};
+
+struct dxt_segment_chain
+{
+    struct dxt_segment_block *head;
+    struct dxt_segment_block *tail;
+    int64_t count;
+    struct dxt_segment_delta last;
+    int full; /* set once trace memory has been exhausted */
+};
+
+/* cursor for decoding the segments of a chain in order */
+struct dxt_segment_cursor
+{
+    struct dxt_segment_block *block;
+    int pos;
+    struct dxt_segment_delta last;
+    segment_info seg; /* most recently decoded segment */
+};
+
+#define DXT_WRITE_CHAIN 0
+#define DXT_READ_CHAIN  1
+
+/* The dxt_thread_trace structure holds the segments a single thread has
+ * traced for a record.  Only the owning thread appends to it, so no lock
+ * is needed while tracing; the per-thread traces of each record are
+ * stitched together when the record is serialized at shutdown.  A trace
+ * with a NULL 'rec_ref' caches the decision not to trace a record.
+ */
+struct dxt_thread_trace
+{
+    darshan_record_id rec_id;
+    struct dxt_file_record_ref *rec_ref;
+    struct dxt_segment_chain chains[2];
+    struct dxt_thread_trace *next;
+};
+
+/* The dxt_thread_state structure is each thread's private view of a DXT
+ * module: a table of the thread's traces, indexed by record id, and the
+ * arena chunk that it is currently allocating trace blocks from.  It is
+ * reset whenever a new runtime instance (epoch) is seen.
+ */
+struct dxt_thread_state
+{
+    int epoch;
+    struct dxt_thread_trace *last; /* most recently used trace */
+    struct dxt_thread_trace **table; /* open addressing, power of 2 size */
+    int table_size;
+    int table_count;
+    struct dxt_arena_chunk *chunk;
 };
 
 /* The dxt_runtime structure maintains necessary state for storing
@@ -98,6 +207,10 @@ struct dxt_posix_runtime
     int file_rec_count;
     char *record_buf;
     int record_buf_size;
+    int epoch; /* identifies this runtime instance to thread state */
+    struct dxt_arena_chunk *chunk_list;
+    struct dxt_arena_region arena_region;
+    struct dxt_thread_trace *untraced_list;
     int frozen; /* flag to indicate that the counters should no longer be modified */
 };
 
@@ -107,6 +220,10 @@ struct dxt_mpiio_runtime
     int file_rec_count;
     char *record_buf;
     int record_buf_size;
+    int epoch; /* identifies this runtime instance to thread state */
+    struct dxt_arena_chunk *chunk_list;
+    struct dxt_arena_region arena_region;
+    struct dxt_thread_trace *untraced_list;
     int frozen; /* flag to indicate that the counters should no longer be modified */
 };
 
@@ -146,10 +263,17 @@ static int dxt_should_trace_rank(
     int rank);
 static int dxt_should_trace_file(
     darshan_record_id rec_id);
-static void check_wr_trace_buf(
-    struct dxt_file_record_ref *rec_ref);
-static void check_rd_trace_buf(
-    struct dxt_file_record_ref *rec_ref);
+static struct dxt_thread_trace *dxt_thread_trace(
+    struct dxt_thread_state *state, int epoch, darshan_record_id rec_id,
+    int mod_id);
+static struct dxt_thread_trace *dxt_new_thread_trace(
+    struct dxt_thread_state *state, darshan_record_id rec_id, int mod_id);
+static void dxt_append_segment(
+    struct dxt_thread_state *state, struct dxt_segment_chain *chain,
+    int mod_id, int64_t offset, int64_t length, double start_time,
+    double end_time);
+static char *dxt_stitch_segments(
+    char *buf, struct dxt_file_record_ref *rec_ref, int chain_index);
 static struct dxt_file_record_ref *dxt_posix_track_new_file_record(
     darshan_record_id rec_id);
 static struct dxt_file_record_ref *dxt_mpiio_track_new_file_record(
@@ -174,6 +298,22 @@ static int dxt_my_rank = -1;
 static size_t dxt_total_mem = DXT_IO_TRACE_MEM_MAX;
 static size_t dxt_mem_remaining = 0;
 
+/* epoch of the runtime instance that is currently accepting traces for
+ * each module, or 0 if there is none
+ */
+#ifdef HAVE_STDATOMIC_H
+static atomic_int dxt_posix_epoch = 0;
+static atomic_int dxt_mpiio_epoch = 0;
+#else
+static volatile int dxt_posix_epoch = 0;
+static volatile int dxt_mpiio_epoch = 0;
+#endif
+static int dxt_epoch_counter = 0;
+static __thread struct dxt_thread_state dxt_posix_thread_state;
+static __thread struct dxt_thread_state dxt_mpiio_thread_state;
+static pthread_once_t dxt_thread_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t dxt_thread_key;
+
 #define MAX_DXT_TRIGGERS 20
 static int num_dxt_triggers = 0;
 static struct dxt_trigger_info dxt_triggers[MAX_DXT_TRIGGERS];
@@ -333,6 +473,8 @@ void dxt_posix_runtime_initialize()
     }
     memset(dxt_posix_runtime, 0, sizeof(*dxt_posix_runtime));
     dxt_mem_remaining = dxt_total_mem;
+    dxt_posix_runtime->epoch = ++dxt_epoch_counter;
+    dxt_posix_epoch = dxt_posix_runtime->epoch;
     DXT_UNLOCK();
 
     return;
@@ -399,6 +541,8 @@ void dxt_mpiio_runtime_initialize()
     }
     memset(dxt_mpiio_runtime, 0, sizeof(*dxt_mpiio_runtime));
     dxt_mem_remaining = dxt_total_mem; /* XXX is this right? better with memory */
+    dxt_mpiio_runtime->epoch = ++dxt_epoch_counter;
+    dxt_mpiio_epoch = dxt_mpiio_runtime->epoch;
     DXT_UNLOCK();
 
     return;
@@ -407,229 +551,61 @@ void dxt_mpiio_runtime_initialize()
 void dxt_posix_write(darshan_record_id rec_id, int64_t offset,
         int64_t length, double start_time, double end_time)
 {
-    struct dxt_file_record_ref* rec_ref = NULL;
-    struct dxt_file_record *file_rec;
-    int should_trace_file;
-
-    DXT_LOCK();
+    struct dxt_thread_trace *trace;
 
-    if(!dxt_posix_runtime || dxt_posix_runtime->frozen)
-    {
-        DXT_UNLOCK();
+    trace = dxt_thread_trace(&dxt_posix_thread_state, dxt_posix_epoch,
+        rec_id, DXT_POSIX_MOD);
+    if(!trace)
         return;
-    }
 
-    rec_ref = darshan_lookup_record_ref(dxt_posix_runtime->rec_id_hash,
-        &rec_id, sizeof(darshan_record_id));
-    if(!rec_ref)
-    {
-        /* check whether we should actually trace */
-        should_trace_file = dxt_should_trace_file(rec_id);
-        if(!should_trace_file && !dxt_trace_all && !dxt_use_dynamic_triggers)
-        {
-            DXT_UNLOCK();
-            return;
-        }
-
-        /* track new dxt file record */
-        rec_ref = dxt_posix_track_new_file_record(rec_id);
-        if(!rec_ref)
-        {
-            DXT_UNLOCK();
-            return;
-        }
-        if(should_trace_file)
-            rec_ref->trace_enabled = 1;
-    }
-
-    file_rec = rec_ref->file_rec;
-    check_wr_trace_buf(rec_ref);
-    if(file_rec->write_count == rec_ref->write_available_buf)
-    {
-        /* no more memory for i/o segments ... back out */
-        SET_DXT_MOD_PARTIAL_FLAG(DXT_POSIX_MOD);
-        DXT_UNLOCK();
-        return;
-    }
-
-    rec_ref->write_traces[file_rec->write_count].offset = offset;
-    rec_ref->write_traces[file_rec->write_count].length = length;
-    rec_ref->write_traces[file_rec->write_count].start_time = start_time;
-    rec_ref->write_traces[file_rec->write_count].end_time = end_time;
-    file_rec->write_count += 1;
-
-    DXT_UNLOCK();
+    dxt_append_segment(&dxt_posix_thread_state,
+        &trace->chains[DXT_WRITE_CHAIN], DXT_POSIX_MOD,
+        offset, length, start_time, end_time);
 }
 
 void dxt_posix_read(darshan_record_id rec_id, int64_t offset,
         int64_t length, double start_time, double end_time)
 {
-    struct dxt_file_record_ref* rec_ref = NULL;
-    struct dxt_file_record *file_rec;
-    int should_trace_file;
-
-    DXT_LOCK();
-
-    if(!dxt_posix_runtime || dxt_posix_runtime->frozen)
-    {
-        DXT_UNLOCK();
-        return;
-    }
-
-    rec_ref = darshan_lookup_record_ref(dxt_posix_runtime->rec_id_hash,
-                &rec_id, sizeof(darshan_record_id));
-    if (!rec_ref)
-    {
-        /* check whether we should actually trace */
-        should_trace_file = dxt_should_trace_file(rec_id);
-        if(!should_trace_file && !dxt_trace_all && !dxt_use_dynamic_triggers)
-        {
-            DXT_UNLOCK();
-            return;
-        }
-
-        /* track new dxt file record */
-        rec_ref = dxt_posix_track_new_file_record(rec_id);
-        if(!rec_ref)
-        {
-            DXT_UNLOCK();
-            return;
-        }
-        if(should_trace_file)
-            rec_ref->trace_enabled = 1;
-    }
+    struct dxt_thread_trace *trace;
 
-    file_rec = rec_ref->file_rec;
-    check_rd_trace_buf(rec_ref);
-    if(file_rec->read_count == rec_ref->read_available_buf)
-    {
-        /* no more memory for i/o segments ... back out */
-        SET_DXT_MOD_PARTIAL_FLAG(DXT_POSIX_MOD);
-        DXT_UNLOCK();
+    trace = dxt_thread_trace(&dxt_posix_thread_state, dxt_posix_epoch,
+        rec_id, DXT_POSIX_MOD);
+    if(!trace)
         return;
-    }
-
-    rec_ref->read_traces[file_rec->read_count].offset = offset;
-    rec_ref->read_traces[file_rec->read_count].length = length;
-    rec_ref->read_traces[file_rec->read_count].start_time = start_time;
-    rec_ref->read_traces[file_rec->read_count].end_time = end_time;
-    file_rec->read_count += 1;
 
-    DXT_UNLOCK();
+    dxt_append_segment(&dxt_posix_thread_state,
+        &trace->chains[DXT_READ_CHAIN], DXT_POSIX_MOD,
+        offset, length, start_time, end_time);
 }
 
 void dxt_mpiio_write(darshan_record_id rec_id, int64_t offset,
         int64_t length, double start_time, double end_time)
 {
-    struct dxt_file_record_ref* rec_ref = NULL;
-    struct dxt_file_record *file_rec;
-    int should_trace_file;
-
-    DXT_LOCK();
+    struct dxt_thread_trace *trace;
 
-    if(!dxt_mpiio_runtime || dxt_mpiio_runtime->frozen)
-    {
-        DXT_UNLOCK();
+    trace = dxt_thread_trace(&dxt_mpiio_thread_state, dxt_mpiio_epoch,
+        rec_id, DXT_MPIIO_MOD);
+    if(!trace)
         return;
-    }
-
-    rec_ref = darshan_lookup_record_ref(dxt_mpiio_runtime->rec_id_hash,
-                &rec_id, sizeof(darshan_record_id));
-    if(!rec_ref)
-    {
-        /* check whether we should actually trace */
-        should_trace_file = dxt_should_trace_file(rec_id);
-        if(!should_trace_file && !dxt_trace_all && !dxt_use_dynamic_triggers)
-        {
-            DXT_UNLOCK();
-            return;
-        }
-
-        /* track new dxt file record */
-        rec_ref = dxt_mpiio_track_new_file_record(rec_id);
-        if(!rec_ref)
-        {
-            DXT_UNLOCK();
-            return;
-        }
-        if(should_trace_file)
-            rec_ref->trace_enabled = 1;
-    }
-
-    file_rec = rec_ref->file_rec;
-    check_wr_trace_buf(rec_ref);
-    if(file_rec->write_count == rec_ref->write_available_buf)
-    {
-        /* no more memory for i/o segments ... back out */
-        SET_DXT_MOD_PARTIAL_FLAG(DXT_MPIIO_MOD);
-        DXT_UNLOCK();
-        return;
-    }
 
-    rec_ref->write_traces[file_rec->write_count].length = length;
-    rec_ref->write_traces[file_rec->write_count].offset = offset;
-    rec_ref->write_traces[file_rec->write_count].start_time = start_time;
-    rec_ref->write_traces[file_rec->write_count].end_time = end_time;
-    file_rec->write_count += 1;
-
-    DXT_UNLOCK();
+    dxt_append_segment(&dxt_mpiio_thread_state,
+        &trace->chains[DXT_WRITE_CHAIN], DXT_MPIIO_MOD,
+        offset, length, start_time, end_time);
 }
 
 void dxt_mpiio_read(darshan_record_id rec_id, int64_t offset,
         int64_t length, double start_time, double end_time)
 {
-    struct dxt_file_record_ref* rec_ref = NULL;
-    struct dxt_file_record *file_rec;
-    int should_trace_file;
+    struct dxt_thread_trace *trace;
 
-    DXT_LOCK();
-
-    if(!dxt_mpiio_runtime || dxt_mpiio_runtime->frozen)
-    {
-        DXT_UNLOCK();
+    trace = dxt_thread_trace(&dxt_mpiio_thread_state, dxt_mpiio_epoch,
+        rec_id, DXT_MPIIO_MOD);
+    if(!trace)
         return;
-    }
-
-    rec_ref = darshan_lookup_record_ref(dxt_mpiio_runtime->rec_id_hash,
-                &rec_id, sizeof(darshan_record_id));
-    if(!rec_ref)
-    {
-        /* check whether we should actually trace */
-        should_trace_file = dxt_should_trace_file(rec_id);
-        if(!should_trace_file && !dxt_trace_all && !dxt_use_dynamic_triggers)
-        {
-            DXT_UNLOCK();
-            return;
-        }
 
-        /* track new dxt file record */
-        rec_ref = dxt_mpiio_track_new_file_record(rec_id);
-        if(!rec_ref)
-        {
-            DXT_UNLOCK();
-            return;
-        }
-        if(should_trace_file)
-            rec_ref->trace_enabled = 1;
-    }
-
-    file_rec = rec_ref->file_rec;
-    check_rd_trace_buf(rec_ref);
-    if(file_rec->read_count == rec_ref->read_available_buf)
-    {
-        /* no more memory for i/o segments ... back out */
-        SET_DXT_MOD_PARTIAL_FLAG(DXT_MPIIO_MOD);
-        DXT_UNLOCK();
-        return;
-    }
-
-    rec_ref->read_traces[file_rec->read_count].length = length;
-    rec_ref->read_traces[file_rec->read_count].offset = offset;
-    rec_ref->read_traces[file_rec->read_count].start_time = start_time;
-    rec_ref->read_traces[file_rec->read_count].end_time = end_time;
-    file_rec->read_count += 1;
-
-    DXT_UNLOCK();
+    dxt_append_segment(&dxt_mpiio_thread_state,
+        &trace->chains[DXT_READ_CHAIN], DXT_MPIIO_MOD,
+        offset, length, start_time, end_time);
 }
 
 static void dxt_posix_filter_dynamic_traces_iterator(void *rec_ref_p, void *user_ptr)
@@ -685,35 +661,23 @@ static void dxt_posix_filter_dynamic_traces_iterator(void *rec_ref_p, void *user
     }
 
     /* drop the record if no dynamic trace triggers occurred */
+    /* NOTE: other threads may still be appending to the per-thread traces
+     * of these records, so they are only marked as dropped here (so they
+     * are not serialized) and freed at cleanup time
+     */
     if(!should_keep)
     {
         if(dxt_mpiio_runtime && dxt_mpiio_runtime->rec_id_hash)
         {
             /* first check the MPI-IO traces to see if we should drop there */
-            mpiio_rec_ref = darshan_delete_record_ref(&dxt_mpiio_runtime->rec_id_hash,
+            mpiio_rec_ref = darshan_lookup_record_ref(dxt_mpiio_runtime->rec_id_hash,
                 &psx_file->base_rec.id, sizeof(darshan_record_id));
             if(mpiio_rec_ref)
-            {
-                free(mpiio_rec_ref->write_traces);
-                free(mpiio_rec_ref->read_traces);
-                free(mpiio_rec_ref->file_rec);
-                free(mpiio_rec_ref);
-            }
+                mpiio_rec_ref->dropped = 1;
         }
 
-        if(dxt_posix_runtime && dxt_posix_runtime->rec_id_hash)
-        {
-            /* then delete the POSIX trace records */
-            psx_rec_ref = darshan_delete_record_ref(&dxt_posix_runtime->rec_id_hash,
-                &psx_file->base_rec.id, sizeof(darshan_record_id));
-            if(psx_rec_ref)
-            {
-                free(psx_rec_ref->write_traces);
-                free(psx_rec_ref->read_traces);
-                free(psx_rec_ref->file_rec);
-                free(psx_rec_ref);
-            }
-        }
+        /* then drop the POSIX trace records */
+        psx_rec_ref->dropped = 1;
     }
 
     return;
@@ -785,70 +749,509 @@ static int dxt_should_trace_file(darshan_record_id rec_id)
     return(0);
 }
 
-static void check_wr_trace_buf(struct dxt_file_record_ref *rec_ref)
+static void dxt_thread_key_destroy(void *arg)
 {
-    struct dxt_file_record *file_rec = rec_ref->file_rec;
+    /* free the calling thread's trace tables when it exits */
+    free(dxt_posix_thread_state.table);
+    dxt_posix_thread_state.table = NULL;
+    free(dxt_mpiio_thread_state.table);
+    dxt_mpiio_thread_state.table = NULL;
+}
 
-    int write_count = file_rec->write_count;
-    int write_available_buf = rec_ref->write_available_buf;
+static void dxt_thread_key_create(void)
+{
+    pthread_key_create(&dxt_thread_key, dxt_thread_key_destroy);
+}
 
-    if (write_count >= write_available_buf) {
-        int write_count_inc;
-        if(write_available_buf == 0)
-            write_count_inc = IO_TRACE_BUF_SIZE;
-        else
-            write_count_inc = write_available_buf;
+/* inserts a trace into a thread's trace table, growing it if needed */
+static void dxt_thread_trace_insert(struct dxt_thread_state *state,
+    struct dxt_thread_trace *trace)
+{
+    struct dxt_thread_trace **old_table = state->table;
+    int old_size = state->table_size;
+    struct dxt_thread_trace **new_table;
+    int new_size;
+    int i, j;
+
+    /* keep the table at most half full */
+    if(2 * (state->table_count + 1) > state->table_size)
+    {
+        new_size = old_size ? 2 * old_size : 64;
+        new_table = calloc(new_size, sizeof(*new_table));
+        if(!new_table)
+            return;
+        for(i = 0; i < old_size; i++)
+        {
+            if(!old_table[i])
+                continue;
+            j = old_table[i]->rec_id & (new_size - 1);
+            while(new_table[j])
+                j = (j + 1) & (new_size - 1);
+            new_table[j] = old_table[i];
+        }
+        free(old_table);
+        state->table = new_table;
+        state->table_size = new_size;
 
-        DXT_LOCK();
-        if((write_count_inc * sizeof(segment_info)) > dxt_mem_remaining)
-            write_count_inc = dxt_mem_remaining / sizeof(segment_info);
+        if(!old_table)
+        {
+            /* first table for this thread; make sure it's freed at exit */
+            pthread_once(&dxt_thread_key_once, dxt_thread_key_create);
+            pthread_setspecific(dxt_thread_key, state);
+        }
+    }
+
+    j = trace->rec_id & (state->table_size - 1);
+    while(state->table[j])
+        j = (j + 1) & (state->table_size - 1);
+    state->table[j] = trace;
+    state->table_count++;
+
+    return;
+}
+
+/* returns the calling thread's trace of the given record, or NULL if the
+ * record should not be traced (or DXT is not currently tracing).  This
+ * only takes the DXT lock the first time a thread traces a record.
+ */
+static struct dxt_thread_trace *dxt_thread_trace(
+    struct dxt_thread_state *state, int epoch, darshan_record_id rec_id,
+    int mod_id)
+{
+    struct dxt_thread_trace *trace;
+    int i;
+
+    if(!epoch)
+        return(NULL);
 
-        dxt_mem_remaining -= (write_count_inc * sizeof(segment_info));
+    if(state->epoch != epoch)
+    {
+        /* the runtime was (re)created since this thread last traced; any
+         * traces and chunks it knew about are gone
+         */
+        if(state->table)
+            memset(state->table, 0, state->table_size * sizeof(*state->table));
+        state->table_count = 0;
+        state->last = NULL;
+        state->chunk = NULL;
+        state->epoch = epoch;
+    }
+
+    trace = state->last;
+    if(!trace || trace->rec_id != rec_id)
+    {
+        trace = NULL;
+        if(state->table)
+        {
+            i = rec_id & (state->table_size - 1);
+            while(state->table[i])
+            {
+                if(state->table[i]->rec_id == rec_id)
+                {
+                    trace = state->table[i];
+                    break;
+                }
+                i = (i + 1) & (state->table_size - 1);
+            }
+        }
+        if(!trace)
+        {
+            trace = dxt_new_thread_trace(state, rec_id, mod_id);
+            if(!trace)
+                return(NULL);
+        }
+        state->last = trace;
+    }
+
+    if(!trace->rec_ref)
+        return(NULL);
+
+    return(trace);
+}
+
+/* creates the calling thread's trace of the given record, creating the
+ * DXT record itself if this is the first thread to trace it
+ */
+static struct dxt_thread_trace *dxt_new_thread_trace(
+    struct dxt_thread_state *state, darshan_record_id rec_id, int mod_id)
+{
+    struct dxt_file_record_ref *rec_ref;
+    struct dxt_thread_trace *trace;
+    struct dxt_thread_trace **tail;
+    struct dxt_thread_trace **untraced_list;
+    void *rec_id_hash;
+    int should_trace_file;
+
+    DXT_LOCK();
+
+    if(mod_id == DXT_POSIX_MOD)
+    {
+        if(!dxt_posix_runtime || dxt_posix_runtime->frozen ||
+           dxt_posix_runtime->epoch != state->epoch)
+        {
+            DXT_UNLOCK();
+            return(NULL);
+        }
+        rec_id_hash = dxt_posix_runtime->rec_id_hash;
+        untraced_list = &dxt_posix_runtime->untraced_list;
+    }
+    else
+    {
+        if(!dxt_mpiio_runtime || dxt_mpiio_runtime->frozen ||
+           dxt_mpiio_runtime->epoch != state->epoch)
+        {
+            DXT_UNLOCK();
+            return(NULL);
+        }
+        rec_id_hash = dxt_mpiio_runtime->rec_id_hash;
+        untraced_list = &dxt_mpiio_runtime->untraced_list;
+    }
+
+    rec_ref = darshan_lookup_record_ref(rec_id_hash, &rec_id,
+        sizeof(darshan_record_id));
+    if(!rec_ref)
+    {
+        /* check whether we should actually trace */
+        should_trace_file = dxt_should_trace_file(rec_id);
+        if(should_trace_file || dxt_trace_all || dxt_use_dynamic_triggers)
+        {
+            /* track new dxt file record */
+            if(mod_id == DXT_POSIX_MOD)
+                rec_ref = dxt_posix_track_new_file_record(rec_id);
+            else
+                rec_ref = dxt_mpiio_track_new_file_record(rec_id);
+            if(!rec_ref)
+            {
+                DXT_UNLOCK();
+                return(NULL);
+            }
+            if(should_trace_file)
+                rec_ref->trace_enabled = 1;
+        }
+    }
+
+    trace = malloc(sizeof(*trace));
+    if(!trace)
+    {
         DXT_UNLOCK();
+        return(NULL);
+    }
+    memset(trace, 0, sizeof(*trace));
+    trace->rec_id = rec_id;
+    trace->rec_ref = rec_ref;
+
+    if(rec_ref)
+    {
+        /* append, so that traces are stitched in creation order */
+        for(tail = &rec_ref->thread_traces; *tail; tail = &(*tail)->next);
+        *tail = trace;
+    }
+    else
+    {
+        /* remember that this record isn't traced; freed at cleanup */
+        trace->next = *untraced_list;
+        *untraced_list = trace;
+    }
+
+    DXT_UNLOCK();
+
+    dxt_thread_trace_insert(state, trace);
+
+    return(trace);
+}
+
+/* allocates an arena chunk, from the huge page backed arena region if
+ * huge pages are enabled. Must be called holding the DXT lock.
+ */
+static struct dxt_arena_chunk *dxt_alloc_arena_chunk(
+    struct dxt_arena_region *region)
+{
+    struct dxt_arena_chunk *chunk;
+    size_t size;
+
+    if(!region->base && !region->failed)
+    {
+        size = (dxt_total_mem / (DXT_ARENA_CHUNK_BLOCKS * IO_TRACE_BUF_SIZE)
+            + 1) * sizeof(*chunk);
+        region->base = darshan_core_huge_page_alloc(size);
+        if(region->base)
+            region->size = size;
+        else
+            region->failed = 1;
+    }
 
-        if(write_count_inc > 0)
+    if(region->base && (region->size - region->used) >= sizeof(*chunk))
+    {
+        chunk = (struct dxt_arena_chunk *)(region->base + region->used);
+        region->used += sizeof(*chunk);
+        return(chunk);
+    }
+
+    chunk = malloc(sizeof(*chunk));
+    return(chunk);
+}
+
+/* allocates a new trace block for the calling thread, charging it against
+ * the DXT memory limit
+ */
+static struct dxt_segment_block *dxt_alloc_segment_block(
+    struct dxt_thread_state *state, int mod_id)
+{
+    struct dxt_arena_chunk **chunk_list;
+    struct dxt_arena_region *region;
+    struct dxt_arena_chunk *chunk;
+    struct dxt_segment_block *block;
+    size_t block_mem;
+
+    DXT_LOCK();
+
+    if(mod_id == DXT_POSIX_MOD)
+    {
+        if(!dxt_posix_runtime || dxt_posix_runtime->epoch != state->epoch)
+        {
+            DXT_UNLOCK();
+            return(NULL);
+        }
+        chunk_list = &dxt_posix_runtime->chunk_list;
+        region = &dxt_posix_runtime->arena_region;
+    }
+    else
+    {
+        if(!dxt_mpiio_runtime || dxt_mpiio_runtime->epoch != state->epoch)
         {
-            write_available_buf += write_count_inc;
-            rec_ref->write_traces =
-                (segment_info *)realloc(rec_ref->write_traces,
-                        write_available_buf * sizeof(segment_info));
+            DXT_UNLOCK();
+            return(NULL);
+        }
+        chunk_list = &dxt_mpiio_runtime->chunk_list;
+        region = &dxt_mpiio_runtime->arena_region;
+    }
+
+    block_mem = IO_TRACE_BUF_SIZE;
+    if(block_mem > dxt_mem_remaining)
+        block_mem = dxt_mem_remaining;
+    if(block_mem < DXT_MAX_ENCODED_SEGMENT)
+    {
+        /* no more memory for i/o segments ... back out */
+        SET_DXT_MOD_PARTIAL_FLAG(mod_id);
+        DXT_UNLOCK();
+        return(NULL);
+    }
 
-            rec_ref->write_available_buf = write_available_buf;
+    chunk = state->chunk;
+    if(!chunk || chunk->used == DXT_ARENA_CHUNK_BLOCKS)
+    {
+        chunk = dxt_alloc_arena_chunk(region);
+        if(!chunk)
+        {
+            DXT_UNLOCK();
+            return(NULL);
         }
+        chunk->used = 0;
+        chunk->next = *chunk_list;
+        *chunk_list = chunk;
+        state->chunk = chunk;
+    }
+
+    block = &chunk->blocks[chunk->used++];
+    block->next = NULL;
+    block->used = 0;
+    block->capacity = block_mem;
+    dxt_mem_remaining -= block_mem;
+
+    DXT_UNLOCK();
+
+    return(block);
+}
+
+static inline unsigned char *dxt_encode_varint(unsigned char *p, int64_t val)
+{
+    /* zigzag encoding, so that small negative values stay small */
+    uint64_t v = ((uint64_t)val << 1) ^ (uint64_t)(val >> 63);
+
+    while(v >= 0x80)
+    {
+        *p++ = (unsigned char)(v | 0x80);
+        v >>= 7;
     }
+    *p++ = (unsigned char)v;
+    return(p);
 }
 
-static void check_rd_trace_buf(struct dxt_file_record_ref *rec_ref)
+static inline const unsigned char *dxt_decode_varint(const unsigned char *p,
+    int64_t *val)
 {
-    struct dxt_file_record *file_rec = rec_ref->file_rec;
+    uint64_t v = 0;
+    int shift = 0;
 
-    int read_count = file_rec->read_count;
-    int read_available_buf = rec_ref->read_available_buf;
+    while(*p & 0x80)
+    {
+        v |= (uint64_t)(*p++ & 0x7f) << shift;
+        shift += 7;
+    }
+    v |= (uint64_t)(*p++) << shift;
+    *val = (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+    return(p);
+}
+
+/* appends a segment to one of the calling thread's trace chains */
+static void dxt_append_segment(
+    struct dxt_thread_state *state, struct dxt_segment_chain *chain,
+    int mod_id, int64_t offset, int64_t length, double start_time,
+    double end_time)
+{
+    struct dxt_segment_block *block = chain->tail;
+    unsigned char enc[DXT_MAX_ENCODED_SEGMENT];
+    unsigned char *p = enc;
+    int64_t start_ns, end_ns;
+    int enc_len;
+
+    start_ns = llround(start_time * 1e9);
+    end_ns = llround(end_time * 1e9);
+    p = dxt_encode_varint(p, offset - chain->last.end_offset);
+    p = dxt_encode_varint(p, length - chain->last.length);
+    p = dxt_encode_varint(p, start_ns - chain->last.end_ns);
+    p = dxt_encode_varint(p, end_ns - start_ns);
+    enc_len = p - enc;
+
+    if(!block || block->used + enc_len > block->capacity)
+    {
+        /* DXT memory is never given back while tracing, so once a chain
+         * fails to get a block there is no point in trying again
+         */
+        if(chain->full)
+            return;
 
-    if (read_count >= read_available_buf) {
-        int read_count_inc;
-        if(read_available_buf == 0)
-            read_count_inc = IO_TRACE_BUF_SIZE;
+        block = dxt_alloc_segment_block(state, mod_id);
+        if(!block)
+        {
+            chain->full = 1;
+            return;
+        }
+        if(chain->tail)
+            chain->tail->next = block;
         else
-            read_count_inc = read_available_buf;
+            chain->head = block;
+        chain->tail = block;
+    }
 
-        DXT_LOCK();
-        if((read_count_inc * sizeof(segment_info)) > dxt_mem_remaining)
-            read_count_inc = dxt_mem_remaining / sizeof(segment_info);
+    memcpy(&block->data[block->used], enc, enc_len);
+    block->used += enc_len;
+    chain->last.end_offset = offset + length;
+    chain->last.length = length;
+    chain->last.end_ns = end_ns;
+    chain->count++;
 
-        dxt_mem_remaining -= (read_count_inc * sizeof(segment_info));
-        DXT_UNLOCK();
+    return;
+}
+
+/* decodes the next segment of a chain into the cursor; returns 0 once
+ * there are no more segments
+ */
+static int dxt_cursor_next(struct dxt_segment_cursor *cursor)
+{
+    const unsigned char *p;
+    int64_t offset_delta, length_delta, gap_ns, duration_ns;
+    int64_t start_ns;
+
+    if(cursor->block && cursor->pos == cursor->block->used)
+    {
+        cursor->block = cursor->block->next;
+        cursor->pos = 0;
+    }
+    if(!cursor->block)
+        return(0);
+
+    p = &cursor->block->data[cursor->pos];
+    p = dxt_decode_varint(p, &offset_delta);
+    p = dxt_decode_varint(p, &length_delta);
+    p = dxt_decode_varint(p, &gap_ns);
+    p = dxt_decode_varint(p, &duration_ns);
+    cursor->pos = p - cursor->block->data;
+
+    cursor->seg.offset = cursor->last.end_offset + offset_delta;
+    cursor->seg.length = cursor->last.length + length_delta;
+    start_ns = cursor->last.end_ns + gap_ns;
+    cursor->seg.start_time = start_ns / 1e9;
+    cursor->seg.end_time = (start_ns + duration_ns) / 1e9;
+
+    cursor->last.end_offset = cursor->seg.offset + cursor->seg.length;
+    cursor->last.length = cursor->seg.length;
+    cursor->last.end_ns = start_ns + duration_ns;
+
+    return(1);
+}
+
+/* decodes the segments of one chain (read or write) of each of a record's
+ * thread traces into 'buf', merging them in order of start time if more
+ * than one thread traced the record.  Returns the end of the decoded data.
+ */
+static char *dxt_stitch_segments(
+    char *buf, struct dxt_file_record_ref *rec_ref, int chain_index)
+{
+    struct dxt_thread_trace *trace;
+    struct dxt_segment_cursor *cursors;
+    struct dxt_segment_cursor cursor;
+    int ntraces = 0;
+    int i, min;
+
+    for(trace = rec_ref->thread_traces; trace; trace = trace->next)
+        if(trace->chains[chain_index].count > 0)
+            ntraces++;
+
+    cursors = NULL;
+    if(ntraces > 1)
+        cursors = calloc(ntraces, sizeof(*cursors));
+
+    if(!cursors)
+    {
+        /* single thread (or out of memory): just concatenate the chains */
+        for(trace = rec_ref->thread_traces; trace; trace = trace->next)
+        {
+            memset(&cursor, 0, sizeof(cursor));
+            cursor.block = trace->chains[chain_index].head;
+            while(dxt_cursor_next(&cursor))
+            {
+                memcpy(buf, &cursor.seg, sizeof(segment_info));
+                buf += sizeof(segment_info);
+            }
+        }
+        return(buf);
+    }
+
+    i = 0;
+    for(trace = rec_ref->thread_traces; trace; trace = trace->next)
+    {
+        if(trace->chains[chain_index].count > 0)
+        {
+            cursors[i].block = trace->chains[chain_index].head;
+            dxt_cursor_next(&cursors[i]);
+            i++;
+        }
+    }
 
-        if(read_count_inc > 0)
+    /* repeatedly take the earliest remaining segment across threads */
+    while(1)
+    {
+        min = -1;
+        for(i = 0; i < ntraces; i++)
         {
-            read_available_buf += read_count_inc;
-            rec_ref->read_traces =
-                (segment_info *)realloc(rec_ref->read_traces,
-                        read_available_buf * sizeof(segment_info));
-            
-            rec_ref->read_available_buf = read_available_buf;
+            if(!cursors[i].block)
+                continue;
+            if(min < 0 || cursors[i].seg.start_time <
+                cursors[min].seg.start_time)
+                min = i;
         }
+        if(min < 0)
+            break;
+
+        memcpy(buf, &cursors[min].seg, sizeof(segment_info));
+        buf += sizeof(segment_info);
+        if(!dxt_cursor_next(&cursors[min]))
+            cursors[min].block = NULL;
     }
+
+    free(cursors);
+    return(buf);
 }
 
 static struct dxt_file_record_ref *dxt_posix_track_new_file_record(
@@ -971,12 +1374,47 @@ static struct dxt_file_record_ref *dxt_mpiio_track_new_file_record(
 static void dxt_free_record_data(void *rec_ref_p, void *user_ptr)
 {
     struct dxt_file_record_ref *dxt_rec_ref = (struct dxt_file_record_ref *)rec_ref_p;
+    struct dxt_thread_trace *trace, *tmp;
 
-    free(dxt_rec_ref->write_traces);
-    free(dxt_rec_ref->read_traces);
+    /* NOTE: trace blocks belong to arena chunks, which are freed separately */
+    LL_FOREACH_SAFE(dxt_rec_ref->thread_traces, trace, tmp)
+        free(trace);
     free(dxt_rec_ref->file_rec);
 }
 
+/* adds the size a record will take up once its segments are decoded */
+static void dxt_sum_record_size(void *rec_ref_p, void *user_ptr)
+{
+    struct dxt_file_record_ref *rec_ref = (struct dxt_file_record_ref *)rec_ref_p;
+    struct dxt_thread_trace *trace;
+    size_t *total_size = (size_t *)user_ptr;
+
+    if(rec_ref->dropped)
+        return;
+
+    *total_size += sizeof(struct dxt_file_record);
+    for(trace = rec_ref->thread_traces; trace; trace = trace->next)
+        *total_size += (trace->chains[DXT_WRITE_CHAIN].count +
+            trace->chains[DXT_READ_CHAIN].count) * sizeof(segment_info);
+}
+
+static void dxt_free_runtime_data(struct dxt_arena_chunk *chunk_list,
+    struct dxt_arena_region *region, struct dxt_thread_trace *untraced_list)
+{
+    struct dxt_arena_chunk *chunk, *tmp_chunk;
+    struct dxt_thread_trace *trace, *tmp_trace;
+
+    LL_FOREACH_SAFE(chunk_list, chunk, tmp_chunk)
+    {
+        if((char *)chunk < region->base ||
+           (char *)chunk >= (region->base + region->size))
+            free(chunk);
+    }
+    darshan_core_huge_page_free(region->base, region->size);
+    LL_FOREACH_SAFE(untraced_list, trace, tmp_trace)
+        free(trace);
+}
+
 /********************************************************************************
  *     functions exported by this module for coordinating with darshan-core     *
  ********************************************************************************/
@@ -984,20 +1422,30 @@ static void dxt_free_record_data(void *rec_ref_p, void *user_ptr)
 static void dxt_serialize_posix_records(void *rec_ref_p, void *user_ptr)
 {
     struct dxt_file_record_ref *rec_ref = (struct dxt_file_record_ref *)rec_ref_p;
+    size_t *buf_limit = (size_t *)user_ptr;
     struct dxt_file_record *file_rec;
+    struct dxt_thread_trace *trace;
     int64_t record_size = 0;
     int64_t record_write_count = 0;
     int64_t record_read_count = 0;
-    void *tmp_buf_ptr;
+    char *tmp_buf_ptr;
 
     assert(rec_ref);
     file_rec = rec_ref->file_rec;
     assert(file_rec);
 
-    record_write_count = file_rec->write_count;
-    record_read_count = file_rec->read_count;
+    if(rec_ref->dropped)
+        return;
+
+    for(trace = rec_ref->thread_traces; trace; trace = trace->next)
+    {
+        record_write_count += trace->chains[DXT_WRITE_CHAIN].count;
+        record_read_count += trace->chains[DXT_READ_CHAIN].count;
+    }
     if (record_write_count == 0 && record_read_count == 0)
         return;
+    file_rec->write_count = record_write_count;
+    file_rec->read_count = record_read_count;
 
     /*
      * Buffer format:
@@ -1006,81 +1454,64 @@ static void dxt_serialize_posix_records(void *rec_ref_p, void *user_ptr)
     record_size = sizeof(struct dxt_file_record) +
             (record_write_count + record_read_count) * sizeof(segment_info);
 
-    tmp_buf_ptr = (void *)(dxt_posix_runtime->record_buf +
-        dxt_posix_runtime->record_buf_size);
+    /* leave out records that don't fit in the output buffer */
+    if((size_t)(dxt_posix_runtime->record_buf_size + record_size) > *buf_limit)
+        return;
+
+    tmp_buf_ptr = dxt_posix_runtime->record_buf +
+        dxt_posix_runtime->record_buf_size;
 
     /*Copy struct dxt_file_record */
     memcpy(tmp_buf_ptr, (void *)file_rec, sizeof(struct dxt_file_record));
-    tmp_buf_ptr = (void *)(tmp_buf_ptr + sizeof(struct dxt_file_record));
+    tmp_buf_ptr += sizeof(struct dxt_file_record);
 
-    /*Copy write record */
-    memcpy(tmp_buf_ptr, (void *)(rec_ref->write_traces),
-            record_write_count * sizeof(segment_info));
-    tmp_buf_ptr = (void *)(tmp_buf_ptr +
-                record_write_count * sizeof(segment_info));
-
-    /*Copy read record */
-    memcpy(tmp_buf_ptr, (void *)(rec_ref->read_traces),
-            record_read_count * sizeof(segment_info));
-    tmp_buf_ptr = (void *)(tmp_buf_ptr +
-                record_read_count * sizeof(segment_info));
+    /*Copy write record, then read record */
+    tmp_buf_ptr = dxt_stitch_segments(tmp_buf_ptr, rec_ref, DXT_WRITE_CHAIN);
+    tmp_buf_ptr = dxt_stitch_segments(tmp_buf_ptr, rec_ref, DXT_READ_CHAIN);
 
     dxt_posix_runtime->record_buf_size += record_size;
-
-#if 0
-    int i;
-    int64_t rank;
-    char *hostname;
-    int64_t offset;
-    int64_t length;
-    double start_time;
-    double end_time;
-
-    rank = file_rec->base_rec.rank;
-    hostname = file_rec->hostname;
-
-    printf("X_POSIX, record_id: %" PRIu64 "\n", rec_ref->file_rec->base_rec.id);
-    printf("X_POSIX, write_count is: %d read_count is: %d\n",
-                file_rec->write_count, file_rec->read_count);
-    printf("X_POSIX, rank: %d hostname: %s\n", rank, hostname);
-
-    for (i = 0; i < file_rec->write_count; i++) {
-        offset = rec_ref->write_traces[i].offset;
-        length = rec_ref->write_traces[i].length;
-        start_time = rec_ref->write_traces[i].start_time;
-        end_time = rec_ref->write_traces[i].end_time;
-
-        printf("X_POSIX, rank %d writes segment %lld [offset: %lld length: %lld start_time: %fs end_time: %fs]\n", rank, i, offset, length, start_time, end_time);
-    }
-
-    for (i = 0; i < file_rec->read_count; i++) {
-        offset = rec_ref->read_traces[i].offset;
-        length = rec_ref->read_traces[i].length;
-        start_time = rec_ref->read_traces[i].start_time;
-        end_time = rec_ref->read_traces[i].end_time;
-
-        printf("X_POSIX, rank %d reads segment %lld [offset: %lld length: %lld start_time: %fs end_time: %fs]\n", rank, i, offset, length, start_time, end_time);
-    }
-#endif
 }
 
 static void dxt_posix_output(
     void **dxt_posix_buf,
     int *dxt_posix_buf_sz)
 {
+    size_t record_buf_size;
+
     assert(dxt_posix_runtime);
 
     *dxt_posix_buf_sz = 0;
 
-    dxt_posix_runtime->record_buf = malloc(dxt_total_mem);
+    /* stop tracing; the calling module has already stopped instrumenting,
+     * so no thread is still appending segments
+     */
+    dxt_posix_epoch = 0;
+
+    /* segments are stored encoded, so the decoded records may be larger
+     * than the DXT memory limit
+     */
+    record_buf_size = 0;
+    darshan_iter_record_refs(dxt_posix_runtime->rec_id_hash,
+        dxt_sum_record_size, &record_buf_size);
+    if(record_buf_size > INT_MAX)
+    {
+        /* module data is limited to INT_MAX bytes per process, so only
+         * the traces of the files that fit are written
+         */
+        darshan_core_fprintf(stderr, "darshan library warning: "\
+            "DXT_POSIX traces exceed %d bytes, leaving out the traces of "\
+            "some files\n", INT_MAX);
+        record_buf_size = INT_MAX;
+    }
+
+    dxt_posix_runtime->record_buf = malloc(record_buf_size ? record_buf_size : 1);
     if(!(dxt_posix_runtime->record_buf))
         return;
-    memset(dxt_posix_runtime->record_buf, 0, dxt_total_mem);
     dxt_posix_runtime->record_buf_size = 0;
 
     /* iterate all dxt posix records and serialize them to the output buffer */
     darshan_iter_record_refs(dxt_posix_runtime->rec_id_hash,
-        dxt_serialize_posix_records, NULL);
+        dxt_serialize_posix_records, &record_buf_size);
 
     /* set output */
     *dxt_posix_buf = dxt_posix_runtime->record_buf;
@@ -1098,9 +1529,12 @@ static void dxt_posix_cleanup()
     free(dxt_posix_runtime->record_buf);
 
     /* cleanup internal structures used for instrumenting */
+    dxt_posix_epoch = 0;
     darshan_iter_record_refs(dxt_posix_runtime->rec_id_hash,
         dxt_free_record_data, NULL);
     darshan_clear_record_refs(&(dxt_posix_runtime->rec_id_hash), 1);
+    dxt_free_runtime_data(dxt_posix_runtime->chunk_list,
+        &dxt_posix_runtime->arena_region, dxt_posix_runtime->untraced_list);
 
     free(dxt_posix_runtime);
     dxt_posix_runtime = NULL;
@@ -1111,20 +1545,30 @@ static void dxt_posix_cleanup()
 static void dxt_serialize_mpiio_records(void *rec_ref_p, void *user_ptr)
 {
     struct dxt_file_record_ref *rec_ref = (struct dxt_file_record_ref *)rec_ref_p;
+    size_t *buf_limit = (size_t *)user_ptr;
     struct dxt_file_record *file_rec;
+    struct dxt_thread_trace *trace;
     int64_t record_size = 0;
     int64_t record_write_count = 0;
     int64_t record_read_count = 0;
-    void *tmp_buf_ptr;
+    char *tmp_buf_ptr;
 
     assert(rec_ref);
     file_rec = rec_ref->file_rec;
     assert(file_rec);
 
-    record_write_count = file_rec->write_count;
-    record_read_count = file_rec->read_count;
+    if(rec_ref->dropped)
+        return;
+
+    for(trace = rec_ref->thread_traces; trace; trace = trace->next)
+    {
+        record_write_count += trace->chains[DXT_WRITE_CHAIN].count;
+        record_read_count += trace->chains[DXT_READ_CHAIN].count;
+    }
     if (record_write_count == 0 && record_read_count == 0)
         return;
+    file_rec->write_count = record_write_count;
+    file_rec->read_count = record_read_count;
 
     /*
      * Buffer format:
@@ -1133,78 +1577,64 @@ static void dxt_serialize_mpiio_records(void *rec_ref_p, void *user_ptr)
     record_size = sizeof(struct dxt_file_record) +
             (record_write_count + record_read_count) * sizeof(segment_info);
 
-    tmp_buf_ptr = (void *)(dxt_mpiio_runtime->record_buf +
-        dxt_mpiio_runtime->record_buf_size);
+    /* leave out records that don't fit in the output buffer */
+    if((size_t)(dxt_mpiio_runtime->record_buf_size + record_size) > *buf_limit)
+        return;
+
+    tmp_buf_ptr = dxt_mpiio_runtime->record_buf +
+        dxt_mpiio_runtime->record_buf_size;
 
     /*Copy struct dxt_file_record */
     memcpy(tmp_buf_ptr, (void *)file_rec, sizeof(struct dxt_file_record));
-    tmp_buf_ptr = (void *)(tmp_buf_ptr + sizeof(struct dxt_file_record));
+    tmp_buf_ptr += sizeof(struct dxt_file_record);
 
-    /*Copy write record */
-    memcpy(tmp_buf_ptr, (void *)(rec_ref->write_traces),
-            record_write_count * sizeof(segment_info));
-    tmp_buf_ptr = (void *)(tmp_buf_ptr +
-                record_write_count * sizeof(segment_info));
-
-    /*Copy read record */
-    memcpy(tmp_buf_ptr, (void *)(rec_ref->read_traces),
-            record_read_count * sizeof(segment_info));
-    tmp_buf_ptr = (void *)(tmp_buf_ptr +
-                record_read_count * sizeof(segment_info));
+    /*Copy write record, then read record */
+    tmp_buf_ptr = dxt_stitch_segments(tmp_buf_ptr, rec_ref, DXT_WRITE_CHAIN);
+    tmp_buf_ptr = dxt_stitch_segments(tmp_buf_ptr, rec_ref, DXT_READ_CHAIN);
 
     dxt_mpiio_runtime->record_buf_size += record_size;
-
-#if 0
-    int i;
-    int64_t rank;
-    char *hostname;
-    int64_t length;
-    double start_time;
-    double end_time;
-
-    rank = file_rec->base_rec.rank;
-    hostname = file_rec->hostname;
-
-    printf("X_MPIIO, record_id: %" PRIu64 "\n", rec_ref->file_rec->base_rec.id);
-    printf("X_MPIIO, write_count is: %d read_count is: %d\n",
-                file_rec->write_count, file_rec->read_count);
-    printf("X_MPIIO, rank: %d hostname: %s\n", rank, hostname);
-
-    for (i = 0; i < file_rec->write_count; i++) {
-        length = rec_ref->write_traces[i].length;
-        start_time = rec_ref->write_traces[i].start_time;
-        end_time = rec_ref->write_traces[i].end_time;
-
-        printf("X_MPIIO, rank %d writes segment %lld [length: %lld start_time: %fs end_time: %fs]\n", rank, i, length, start_time, end_time);
-    }
-
-    for (i = 0; i < file_rec->read_count; i++) {
-        length = rec_ref->read_traces[i].length;
-        start_time = rec_ref->read_traces[i].start_time;
-        end_time = rec_ref->read_traces[i].end_time;
-
-        printf("X_MPIIO, rank %d reads segment %lld [length: %lld start_time: %fs end_time: %fs]\n", rank, i, length, start_time, end_time);
-    }
-#endif
 }
 
 static void dxt_mpiio_output(
     void **dxt_mpiio_buf,
     int *dxt_mpiio_buf_sz)
 {
+    size_t record_buf_size;
+
     assert(dxt_mpiio_runtime);
 
     *dxt_mpiio_buf_sz = 0;
 
-    dxt_mpiio_runtime->record_buf = malloc(dxt_total_mem);
+    /* stop tracing; the calling module has already stopped instrumenting,
+     * so no thread is still appending segments
+     */
+    dxt_mpiio_epoch = 0;
+
+    /* segments are stored encoded, so the decoded records may be larger
+     * than the DXT memory limit
+     */
+    record_buf_size = 0;
+    darshan_iter_record_refs(dxt_mpiio_runtime->rec_id_hash,
+        dxt_sum_record_size, &record_buf_size);
+    if(record_buf_size > INT_MAX)
+    {
+        /* module data is limited to INT_MAX bytes per process, so only
+         * the traces of the files that fit are written
+         */
+        darshan_core_fprintf(stderr, "darshan library warning: "\
+            "DXT_MPIIO traces exceed %d bytes, leaving out the traces of "\
+            "some files\n", INT_MAX);
+        record_buf_size = INT_MAX;
+    }
+
+    dxt_mpiio_runtime->record_buf = malloc(record_buf_size ? record_buf_size : 1);
     if(!(dxt_mpiio_runtime->record_buf))
         return;
-    memset(dxt_mpiio_runtime->record_buf, 0, dxt_total_mem);
     dxt_mpiio_runtime->record_buf_size = 0;
 
     /* iterate all dxt posix records and serialize them to the output buffer */
     darshan_iter_record_refs(dxt_mpiio_runtime->rec_id_hash,
-        dxt_serialize_mpiio_records, NULL);
+        dxt_serialize_mpiio_records, &record_buf_size);
 
     /* set output */ 
     *dxt_mpiio_buf = dxt_mpiio_runtime->record_buf;
@@ -1222,9 +1652,12 @@ static void dxt_mpiio_cleanup()
     free(dxt_mpiio_runtime->record_buf);
 
     /* cleanup internal structures used for instrumenting */
+    dxt_mpiio_epoch = 0;
     darshan_iter_record_refs(dxt_mpiio_runtime->rec_id_hash,
         dxt_free_record_data, NULL);
     darshan_clear_record_refs(&(dxt_mpiio_runtime->rec_id_hash), 1);
+    dxt_free_runtime_data(dxt_mpiio_runtime->chunk_list,
+        &dxt_mpiio_runtime->arena_region, dxt_mpiio_runtime->untraced_list);
 
     free(dxt_mpiio_runtime);
     dxt_mpiio_runtime = NULL;
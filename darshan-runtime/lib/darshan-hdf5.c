@@ -17,6 +17,7 @@
 #include <sys/stat.h>
 #include <stdarg.h>
 #include <string.h>
+#include <stddef.h>
 #include <time.h>
 #include <stdlib.h>
 #include <errno.h>
@@ -90,9 +91,6 @@ static void hdf5_file_record_reduction_op(
     void* inrec_v, void* inoutrec_v, int *len, MPI_Datatype *datatype);
 static void hdf5_dataset_record_reduction_op(
     void* inrec_v, void* inoutrec_v, int *len, MPI_Datatype *datatype);
-static void hdf5_shared_dataset_record_variance(
-    MPI_Comm mod_comm, struct darshan_hdf5_dataset *inrec_array,
-    struct darshan_hdf5_dataset *outrec_array, int shared_rec_count);
 static void hdf5_file_mpi_redux(
     void *hdf5_buf, MPI_Comm mod_comm,
     darshan_record_id *shared_recs, int shared_rec_count);
@@ -937,6 +935,7 @@ static void hdf5_file_runtime_initialize()
     darshan_module_funcs mod_funcs = {
 #ifdef HAVE_MPI
     .mod_redux_func = &hdf5_file_mpi_redux,
+    .mod_redux_partial = 1,
 #endif
     .mod_output_func = &hdf5_file_output,
     .mod_cleanup_func = &hdf5_file_cleanup
@@ -970,6 +969,7 @@ static void hdf5_dataset_runtime_initialize()
     darshan_module_funcs mod_funcs = {
 #ifdef HAVE_MPI
     .mod_redux_func = &hdf5_dataset_mpi_redux,
+    .mod_redux_partial = 1,
 #endif
     .mod_output_func = &hdf5_dataset_output,
     .mod_cleanup_func = &hdf5_dataset_cleanup
@@ -1163,6 +1163,19 @@ static void hdf5_file_record_reduction_op(void* inrec_v, void* inoutrec_v,
     return;
 }
 
+/* counters of shared HDF5 dataset records that are reduced with a single
+ * operation; the remaining counters are special cases in
+ * hdf5_dataset_record_reduction_op()
+ */
+#define H5D_COUNTER_SPANS(X) \
+    X(sum, H5D_OPENS, H5D_POINT_SELECTS) \
+    X(sum, H5D_SIZE_READ_AGG_0_100, H5D_SIZE_WRITE_AGG_1G_PLUS) \
+    X(in, H5D_DATASPACE_NDIMS, H5D_CHUNK_SIZE_D5)
+#define H5D_FCOUNTER_SPANS(X) \
+    X(min_nonzero, H5D_F_OPEN_START_TIMESTAMP, H5D_F_CLOSE_START_TIMESTAMP) \
+    X(max, H5D_F_OPEN_END_TIMESTAMP, H5D_F_CLOSE_END_TIMESTAMP) \
+    X(sum, H5D_F_READ_TIME, H5D_F_META_TIME)
+
 static void hdf5_dataset_record_reduction_op(void* inrec_v, void* inoutrec_v,
     int *len, MPI_Datatype *datatype)
 {
@@ -1178,19 +1191,13 @@ static void hdf5_dataset_record_reduction_op(void* inrec_v, void* inoutrec_v,
         tmp_dataset.base_rec.rank = -1;
         tmp_dataset.file_rec_id = inrec->file_rec_id;
 
-        /* sum */
-        for(j=H5D_OPENS; j<=H5D_POINT_SELECTS; j++)
-        {
-            tmp_dataset.counters[j] = inrec->counters[j] + inoutrec->counters[j];
-        }
+        DARSHAN_REDUCE_COUNTER_SPANS(H5D_COUNTER_SPANS,
+            inrec->counters, inoutrec->counters, tmp_dataset.counters);
+        DARSHAN_REDUCE_FCOUNTER_SPANS(H5D_FCOUNTER_SPANS,
+            inrec->fcounters, inoutrec->fcounters, tmp_dataset.fcounters);
 
         /* skip H5D_MAX_*_TIME_SIZE; handled in floating point section */
 
-        for(j=H5D_SIZE_READ_AGG_0_100; j<=H5D_SIZE_WRITE_AGG_1G_PLUS; j++)
-        {
-            tmp_dataset.counters[j] = inrec->counters[j] + inoutrec->counters[j];
-        }
-
         /* first collapse any duplicates */
         for(j=H5D_ACCESS1_ACCESS, j2=H5D_ACCESS1_COUNT; j<=H5D_ACCESS4_ACCESS;
             j+=(H5D_MAX_NDIMS+H5D_MAX_NDIMS+1), j2++)
@@ -1231,13 +1238,6 @@ static void hdf5_dataset_record_reduction_op(void* inrec_v, void* inoutrec_v,
                 inoutrec->counters[j2], 0);
         }
 
-        tmp_dataset.counters[H5D_DATASPACE_NDIMS] = inrec->counters[H5D_DATASPACE_NDIMS];
-        tmp_dataset.counters[H5D_DATASPACE_NPOINTS] = inrec->counters[H5D_DATASPACE_NPOINTS];
-        tmp_dataset.counters[H5D_DATATYPE_SIZE] = inrec->counters[H5D_DATATYPE_SIZE];
-
-        for(j=H5D_CHUNK_SIZE_D1; j<=H5D_CHUNK_SIZE_D5; j++)
-            tmp_dataset.counters[j] = inrec->counters[j];
-
         if(inoutrec->counters[H5D_USE_MPIIO_COLLECTIVE] == 1 ||
                 inrec->counters[H5D_USE_MPIIO_COLLECTIVE] == 1)
             tmp_dataset.counters[H5D_USE_MPIIO_COLLECTIVE] = 1;
@@ -1246,31 +1246,6 @@ static void hdf5_dataset_record_reduction_op(void* inrec_v, void* inoutrec_v,
                 inrec->counters[H5D_USE_DEPRECATED] == 1)
             tmp_dataset.counters[H5D_USE_DEPRECATED] = 1;
 
-        /* min non-zero (if available) value */
-        for(j=H5D_F_OPEN_START_TIMESTAMP; j<=H5D_F_CLOSE_START_TIMESTAMP; j++)
-        {
-            if((inrec->fcounters[j] < inoutrec->fcounters[j] &&
-               inrec->fcounters[j] > 0) || inoutrec->fcounters[j] == 0) 
-                tmp_dataset.fcounters[j] = inrec->fcounters[j];
-            else
-                tmp_dataset.fcounters[j] = inoutrec->fcounters[j];
-        }
-
-        /* max */
-        for(j=H5D_F_OPEN_END_TIMESTAMP; j<=H5D_F_CLOSE_END_TIMESTAMP; j++)
-        {
-            if(inrec->fcounters[j] > inoutrec->fcounters[j])
-                tmp_dataset.fcounters[j] = inrec->fcounters[j];
-            else
-                tmp_dataset.fcounters[j] = inoutrec->fcounters[j];
-        }
-
-        /* sum */
-        for(j=H5D_F_READ_TIME; j<=H5D_F_META_TIME; j++)
-        {
-            tmp_dataset.fcounters[j] = inrec->fcounters[j] + inoutrec->fcounters[j];
-        }
-
         /* max (special case) */
         if(inrec->fcounters[H5D_F_MAX_READ_TIME] >
             inoutrec->fcounters[H5D_F_MAX_READ_TIME])
@@ -1355,90 +1330,6 @@ static void hdf5_dataset_record_reduction_op(void* inrec_v, void* inoutrec_v,
 
     return;
 }
-
-static void hdf5_shared_dataset_record_variance(
-    MPI_Comm mod_comm, struct darshan_hdf5_dataset *inrec_array,
-    struct darshan_hdf5_dataset *outrec_array, int shared_rec_count)
-{
-    MPI_Datatype var_dt;
-    MPI_Op var_op;
-    int i;
-    struct darshan_variance_dt *var_send_buf = NULL;
-    struct darshan_variance_dt *var_recv_buf = NULL;
-
-    PMPI_Type_contiguous(sizeof(struct darshan_variance_dt),
-        MPI_BYTE, &var_dt);
-    PMPI_Type_commit(&var_dt);
-
-    PMPI_Op_create(darshan_variance_reduce, 1, &var_op);
-
-    var_send_buf = malloc(shared_rec_count * sizeof(struct darshan_variance_dt));
-    if(!var_send_buf)
-        return;
-
-    if(my_rank == 0)
-    {
-        var_recv_buf = malloc(shared_rec_count * sizeof(struct darshan_variance_dt));
-
-        if(!var_recv_buf)
-            return;
-    }
-
-    /* get total i/o time variances for shared records */
-
-    /* get total i/o time variances for shared records */
-
-    for(i=0; i<shared_rec_count; i++)
-    {
-        var_send_buf[i].n = 1;
-        var_send_buf[i].S = 0;
-        var_send_buf[i].T = inrec_array[i].fcounters[H5D_F_READ_TIME] +
-                            inrec_array[i].fcounters[H5D_F_WRITE_TIME] +
-                            inrec_array[i].fcounters[H5D_F_META_TIME];
-    }
-
-    PMPI_Reduce(var_send_buf, var_recv_buf, shared_rec_count,
-        var_dt, var_op, 0, mod_comm);
-
-    if(my_rank == 0)
-    {
-        for(i=0; i<shared_rec_count; i++)
-        {
-            outrec_array[i].fcounters[H5D_F_VARIANCE_RANK_TIME] =
-                (var_recv_buf[i].S / var_recv_buf[i].n);
-        }
-    }
-
-    /* get total bytes moved variances for shared records */
-
-    for(i=0; i<shared_rec_count; i++)
-    {
-        var_send_buf[i].n = 1;
-        var_send_buf[i].S = 0;
-        var_send_buf[i].T = (double)
-                            inrec_array[i].counters[H5D_BYTES_READ] +
-                            inrec_array[i].counters[H5D_BYTES_WRITTEN];
-    }
-
-    PMPI_Reduce(var_send_buf, var_recv_buf, shared_rec_count,
-        var_dt, var_op, 0, mod_comm);
-
-    if(my_rank == 0)
-    {
-        for(i=0; i<shared_rec_count; i++)
-        {
-            outrec_array[i].fcounters[H5D_F_VARIANCE_RANK_BYTES] =
-                (var_recv_buf[i].S / var_recv_buf[i].n);
-        }
-    }
-
-    PMPI_Type_free(&var_dt);
-    PMPI_Op_free(&var_op);
-    free(var_send_buf);
-    free(var_recv_buf);
-
-    return;
-}
 #endif
 
 /************************************************************************
@@ -1456,9 +1347,7 @@ static void hdf5_file_mpi_redux(
     struct hdf5_file_record_ref *rec_ref;
     struct darshan_hdf5_file *hdf5_rec_buf = (struct darshan_hdf5_file *)hdf5_buf;
     struct darshan_hdf5_file *red_send_buf = NULL;
-    struct darshan_hdf5_file *red_recv_buf = NULL;
-    MPI_Datatype red_type;
-    MPI_Op red_op;
+    int kept_rec_count;
     int i;
 
     HDF5_LOCK();
@@ -1485,47 +1374,17 @@ static void hdf5_file_mpi_redux(
     /* make *send_buf point to the shared records at the end of sorted array */
     red_send_buf = &(hdf5_rec_buf[rec_count-shared_rec_count]);
 
-    /* allocate memory for the reduction output on rank 0 */
-    if(my_rank == 0)
-    {
-        red_recv_buf = malloc(shared_rec_count * sizeof(struct darshan_hdf5_file));
-        if(!red_recv_buf)
-        {
-            HDF5_UNLOCK();
-            return;
-        }
-    }
-
-    /* construct a datatype for a HDF5 dataset record.  This is serving no purpose
-     * except to make sure we can do a reduction on proper boundaries
+    /* queue the shared records to be reduced along with those of other
+     * modules
      */
-    PMPI_Type_contiguous(sizeof(struct darshan_hdf5_file), MPI_BYTE, &red_type);
-    PMPI_Type_commit(&red_type);
+    kept_rec_count = darshan_core_reduce_shared_records(red_send_buf, shared_rec_count,
+        sizeof(struct darshan_hdf5_file), hdf5_file_record_reduction_op, -1, -1);
 
-    /* register a HDF5 dataset record reduction operator */
-    PMPI_Op_create(hdf5_file_record_reduction_op, 1, &red_op);
-
-    /* reduce shared HDF5 dataset records */
-    PMPI_Reduce(red_send_buf, red_recv_buf,
-        shared_rec_count, red_type, red_op, 0, mod_comm);
-
-    /* update module state to account for shared file reduction */
-    if(my_rank == 0)
-    {
-        /* overwrite local shared records with globally reduced records */
-        int tmp_ndx = rec_count - shared_rec_count;
-        memcpy(&(hdf5_rec_buf[tmp_ndx]), red_recv_buf,
-            shared_rec_count * sizeof(struct darshan_hdf5_file));
-        free(red_recv_buf);
-    }
-    else
-    {
-        /* drop shared records on non-zero ranks */
-        hdf5_file_runtime->rec_count -= shared_rec_count;
-    }
-
-    PMPI_Type_free(&red_type);
-    PMPI_Op_free(&red_op);
+    /* drop the shared records this rank doesn't keep. darshan-core
+     * overwrites the kept records (moved to the start of the shared
+     * records) with the reduced records.
+     */
+    hdf5_file_runtime->rec_count -= shared_rec_count - kept_rec_count;
 
     HDF5_UNLOCK();
     return;
@@ -1542,9 +1401,7 @@ static void hdf5_dataset_mpi_redux(
     struct darshan_hdf5_dataset *hdf5_rec_buf = (struct darshan_hdf5_dataset *)hdf5_buf;
     double hdf5_time;
     struct darshan_hdf5_dataset *red_send_buf = NULL;
-    struct darshan_hdf5_dataset *red_recv_buf = NULL;
-    MPI_Datatype red_type;
-    MPI_Op red_op;
+    int kept_rec_count;
     int i;
 
     HDF5_LOCK();
@@ -1595,52 +1452,30 @@ static void hdf5_dataset_mpi_redux(
     /* make *send_buf point to the shared records at the end of sorted array */
     red_send_buf = &(hdf5_rec_buf[rec_count-shared_rec_count]);
 
-    /* allocate memory for the reduction output on rank 0 */
-    if(my_rank == 0)
-    {
-        red_recv_buf = malloc(shared_rec_count * sizeof(struct darshan_hdf5_dataset));
-        if(!red_recv_buf)
-        {
-            HDF5_UNLOCK();
-            return;
-        }
-    }
-
-    /* construct a datatype for a HDF5 dataset record.  This is serving no purpose
-     * except to make sure we can do a reduction on proper boundaries
+    /* queue the shared records to be reduced along with those of other
+     * modules, storing the time and bytes this rank contributes to the
+     * variance counters
      */
-    PMPI_Type_contiguous(sizeof(struct darshan_hdf5_dataset),
-        MPI_BYTE, &red_type);
-    PMPI_Type_commit(&red_type);
-
-    /* register a HDF5 dataset record reduction operator */
-    PMPI_Op_create(hdf5_dataset_record_reduction_op, 1, &red_op);
-
-    /* reduce shared HDF5 dataset records */
-    PMPI_Reduce(red_send_buf, red_recv_buf,
-        shared_rec_count, red_type, red_op, 0, mod_comm);
-
-    /* get the time and byte variances for shared files */
-    hdf5_shared_dataset_record_variance(mod_comm, red_send_buf, red_recv_buf,
-        shared_rec_count);
-
-    /* update module state to account for shared file reduction */
-    if(my_rank == 0)
-    {
-        /* overwrite local shared records with globally reduced records */
-        int tmp_ndx = rec_count - shared_rec_count;
-        memcpy(&(hdf5_rec_buf[tmp_ndx]), red_recv_buf,
-            shared_rec_count * sizeof(struct darshan_hdf5_dataset));
-        free(red_recv_buf);
-    }
-    else
+    for(i = 0; i < shared_rec_count; i++)
     {
-        /* drop shared records on non-zero ranks */
-        hdf5_dataset_runtime->rec_count -= shared_rec_count;
+        red_send_buf[i].fcounters[H5D_F_VARIANCE_RANK_TIME] =
+            red_send_buf[i].fcounters[H5D_F_READ_TIME] +
+            red_send_buf[i].fcounters[H5D_F_WRITE_TIME] +
+            red_send_buf[i].fcounters[H5D_F_META_TIME];
+        red_send_buf[i].fcounters[H5D_F_VARIANCE_RANK_BYTES] = (double)
+            red_send_buf[i].counters[H5D_BYTES_READ] +
+            red_send_buf[i].counters[H5D_BYTES_WRITTEN];
     }
-
-    PMPI_Type_free(&red_type);
-    PMPI_Op_free(&red_op);
+    kept_rec_count = darshan_core_reduce_shared_records(red_send_buf, shared_rec_count,
+        sizeof(struct darshan_hdf5_dataset), hdf5_dataset_record_reduction_op,
+        offsetof(struct darshan_hdf5_dataset, fcounters[H5D_F_VARIANCE_RANK_TIME]),
+        offsetof(struct darshan_hdf5_dataset, fcounters[H5D_F_VARIANCE_RANK_BYTES]));
+
+    /* drop the shared records this rank doesn't keep. darshan-core
+     * overwrites the kept records (moved to the start of the shared
+     * records) with the reduced records.
+     */
+    hdf5_dataset_runtime->rec_count -= shared_rec_count - kept_rec_count;
 
     HDF5_UNLOCK();
     return;
@@ -62,16 +62,66 @@ struct heatmap_record_ref
 struct heatmap_runtime
 {
     void *rec_id_hash;
+    struct darshan_heatmap_record *recs[DARSHAN_MAX_HEATMAPS];
     int rec_count;
+    int epoch; /* identifies this runtime instance to thread shards */
     int frozen; /* flag to indicate that the counters should no longer be modified */
 };
 
+/* Per-thread bins for a single heatmap.  Each thread accumulates traffic
+ * into its own bins (collapsing them independently as needed), and the
+ * bins are folded into the heatmap record registered with darshan-core at
+ * output time.
+ */
+struct heatmap_shard_bins
+{
+    darshan_record_id id; /* 0 if this slot is unused */
+    double bin_width_seconds;
+    int64_t write_bins[DARSHAN_MAX_HEATMAP_BINS];
+    int64_t read_bins[DARSHAN_MAX_HEATMAP_BINS];
+};
+
+/* The heatmap_thread_shard structure holds one thread's heatmap bins.  A
+ * thread only ever takes its own shard's lock when updating, so threads do
+ * not contend with each other; the lock is only contended when the shard
+ * is folded at output time.
+ * NOTE: shards are never freed, only reset when a new runtime instance
+ * (epoch) is seen, so a thread that races with module cleanup never
+ * touches freed memory.
+ */
+struct heatmap_thread_shard
+{
+#ifdef HAVE_STDATOMIC_H
+    atomic_flag lock;
+#endif
+    int epoch;
+    struct heatmap_shard_bins *bins[DARSHAN_MAX_HEATMAPS];
+    struct heatmap_thread_shard *next;
+};
+
 static struct heatmap_runtime *heatmap_runtime = NULL;
 static int my_rank = -1;
 
+/* epoch of the runtime instance that is currently accepting updates, or 0
+ * if there is none (not yet initialized, frozen, or cleaned up)
+ */
+#ifdef HAVE_STDATOMIC_H
+static atomic_int heatmap_epoch = 0;
+#else
+static int heatmap_epoch = 0;
+#endif
+static int heatmap_epoch_counter = 0;
+static struct heatmap_thread_shard *heatmap_shard_list = NULL;
+static __thread struct heatmap_thread_shard *heatmap_my_shard = NULL;
+
 static struct heatmap_record_ref *heatmap_track_new_record(
     darshan_record_id rec_id, const char *name);
-static void collapse_heatmap(struct darshan_heatmap_record *rec);
+static void collapse_heatmap(int64_t *write_bins, int64_t *read_bins,
+    double *bin_width_seconds);
+static struct heatmap_thread_shard *heatmap_new_thread_shard(void);
+static struct heatmap_shard_bins *heatmap_shard_lookup_bins(
+    struct heatmap_thread_shard *shard, darshan_record_id heatmap_id);
+static void heatmap_fold_thread_shards(void);
 #ifdef HAVE_MPI
 static void heatmap_mpi_redux(
     void *stdio_buf, MPI_Comm mod_comm,
@@ -90,35 +140,21 @@ static pthread_mutex_t heatmap_runtime_mutex = PTHREAD_MUTEX_INITIALIZER;
 #define HEATMAP_UNLOCK() pthread_mutex_unlock(&heatmap_runtime_mutex)
 #endif
 
-/* note that if the break condition is triggered in this macro, then it
- * will exit the do/while loop holding a lock that will be released in
- * POST_RECORD().  Otherwise it will release the lock here (if held) and
- * return immediately without reaching the POST_RECORD() macro.
+/* Updates only take the calling thread's shard lock.  Without atomics, all
+ * shard updates are instead serialized on the module lock.
+ * NOTE: unlike other modules, heatmap updates do not attempt to initialize
+ * this module if it isn't already.  That should have been done in the
+ * _register() call before reaching this point.
  */
-/* NOTE: unlike other modules, the PRE_RECORD here does not attempt to
- * initialize this module if it isn't already.  That should have been done
- * in the _register() call before reaching this point.  Skipping the
- * initialization attempt here makes it safe to use atomics or spinlocks
- * in the critical wrapper path.
- */
-#define HEATMAP_PRE_RECORD() do { \
-    HEATMAP_LOCK(); \
-    if(heatmap_runtime && !heatmap_runtime->frozen) break; \
-    HEATMAP_UNLOCK(); \
-    return(ret); \
-} while(0)
-
-/* same as above but for void fns */
-#define HEATMAP_PRE_RECORD_VOID() do { \
-    HEATMAP_LOCK(); \
-    if(heatmap_runtime && !heatmap_runtime->frozen) break; \
-    HEATMAP_UNLOCK(); \
-    return; \
-} while(0)
-
-#define HEATMAP_POST_RECORD() do { \
-    HEATMAP_UNLOCK(); \
-} while(0)
+#ifdef HAVE_STDATOMIC_H
+#define HEATMAP_SHARD_LOCK(__shard) \
+    while (atomic_flag_test_and_set(&(__shard)->lock))
+#define HEATMAP_SHARD_UNLOCK(__shard) \
+    atomic_flag_clear(&(__shard)->lock)
+#else
+#define HEATMAP_SHARD_LOCK(__shard) HEATMAP_LOCK()
+#define HEATMAP_SHARD_UNLOCK(__shard) HEATMAP_UNLOCK()
+#endif
 
 static void heatmap_output(
     void **heatmap_buf,
@@ -135,11 +171,17 @@ static void heatmap_output(
 
     HEATMAP_LOCK();
     assert(heatmap_runtime);
-
-    *heatmap_buf_sz = 0;
-
     /* freeze instrumentation if it's not already */
     heatmap_runtime->frozen = 1;
+    heatmap_epoch = 0;
+    HEATMAP_UNLOCK();
+
+    /* fold per-thread bins into the heatmap records */
+    heatmap_fold_thread_shards();
+
+    HEATMAP_LOCK();
+
+    *heatmap_buf_sz = 0;
 
     /* use coordinated end timestamp if available, otherwise local time */
     if(g_end_timestamp)
@@ -204,7 +246,8 @@ static void heatmap_output(
          * the heatmap records have a consistent size
          */
         while(end_timestamp > rec->bin_width_seconds * DARSHAN_MAX_HEATMAP_BINS)
-            collapse_heatmap(rec);
+            collapse_heatmap(rec->write_bins, rec->read_bins,
+                &rec->bin_width_seconds);
 
         tmp_nbins= ceil(end_timestamp/rec->bin_width_seconds);
 
@@ -243,6 +286,10 @@ static void heatmap_cleanup()
     assert(heatmap_runtime);
 
     /* cleanup internal structures used for instrumenting */
+    /* NOTE: thread shards are retained and reset when the next runtime
+     * instance (if any) is created
+     */
+    heatmap_epoch = 0;
     darshan_clear_record_refs(&(heatmap_runtime->rec_id_hash), 1);
 
     free(heatmap_runtime);
@@ -308,8 +355,12 @@ darshan_record_id heatmap_register(const char* name)
         /* see if someone beat us to it */
         if(heatmap_runtime && tmp_runtime)
             free(tmp_runtime);
-        else
+        else if(tmp_runtime)
+        {
             heatmap_runtime = tmp_runtime;
+            heatmap_runtime->epoch = ++heatmap_epoch_counter;
+            heatmap_epoch = heatmap_runtime->epoch;
+        }
     }
 
     /* if we exit the above logic without anyone initializing, then we
@@ -334,30 +385,154 @@ darshan_record_id heatmap_register(const char* name)
     return(ret);
 }
 
-static void collapse_heatmap(struct darshan_heatmap_record *rec)
+/* collapses a heatmap's read and write bins (either those of a record or of
+ * a thread shard) into half as many bins of twice the width
+ */
+static void collapse_heatmap(int64_t *write_bins, int64_t *read_bins,
+    double *bin_width_seconds)
 {
     int i;
 
     /* collapse write bins */
     for(i=0; i<DARSHAN_MAX_HEATMAP_BINS; i+=2)
     {
-        rec->write_bins[i] += rec->write_bins[i+1]; /* accumulate adjacent bins */
-        rec->write_bins[i/2] = rec->write_bins[i];  /* shift down */
+        write_bins[i] += write_bins[i+1]; /* accumulate adjacent bins */
+        write_bins[i/2] = write_bins[i];  /* shift down */
     }
     /* zero out second half of heatmap */
-    memset(&rec->write_bins[DARSHAN_MAX_HEATMAP_BINS/2], 0, (DARSHAN_MAX_HEATMAP_BINS/2)*sizeof(int64_t));
+    memset(&write_bins[DARSHAN_MAX_HEATMAP_BINS/2], 0, (DARSHAN_MAX_HEATMAP_BINS/2)*sizeof(int64_t));
 
     /* collapse read bins */
     for(i=0; i<DARSHAN_MAX_HEATMAP_BINS; i+=2)
     {
-        rec->read_bins[i] += rec->read_bins[i+1]; /* accumulate adjacent bins */
-        rec->read_bins[i/2] = rec->read_bins[i];  /* shift down */
+        read_bins[i] += read_bins[i+1]; /* accumulate adjacent bins */
+        read_bins[i/2] = read_bins[i];  /* shift down */
     }
     /* zero out second half of heatmap */
-    memset(&rec->read_bins[DARSHAN_MAX_HEATMAP_BINS/2], 0, (DARSHAN_MAX_HEATMAP_BINS/2)*sizeof(int64_t));
+    memset(&read_bins[DARSHAN_MAX_HEATMAP_BINS/2], 0, (DARSHAN_MAX_HEATMAP_BINS/2)*sizeof(int64_t));
 
     /* double bin width */
-    rec->bin_width_seconds *= 2.0;
+    *bin_width_seconds *= 2.0;
+
+    return;
+}
+
+/* allocates the calling thread's shard and adds it to the shard list */
+static struct heatmap_thread_shard *heatmap_new_thread_shard(void)
+{
+    struct heatmap_thread_shard *shard;
+
+    shard = malloc(sizeof(*shard));
+    if(!shard)
+        return(NULL);
+    memset(shard, 0, sizeof(*shard));
+
+    HEATMAP_LOCK();
+    shard->next = heatmap_shard_list;
+    heatmap_shard_list = shard;
+    HEATMAP_UNLOCK();
+
+    heatmap_my_shard = shard;
+    return(shard);
+}
+
+/* returns the bins for the given heatmap in a thread's shard, claiming or
+ * allocating a slot if needed. Must be called holding the shard lock.
+ */
+static struct heatmap_shard_bins *heatmap_shard_lookup_bins(
+    struct heatmap_thread_shard *shard, darshan_record_id heatmap_id)
+{
+    struct heatmap_shard_bins *bins;
+    int i;
+
+    for(i=0; i<DARSHAN_MAX_HEATMAPS; i++)
+    {
+        bins = shard->bins[i];
+        if(!bins)
+        {
+            bins = malloc(sizeof(*bins));
+            if(!bins)
+                return(NULL);
+            shard->bins[i] = bins;
+            bins->id = 0;
+        }
+        if(bins->id == heatmap_id)
+            return(bins);
+        if(bins->id == 0)
+        {
+            memset(bins, 0, sizeof(*bins));
+            bins->id = heatmap_id;
+            bins->bin_width_seconds = DARSHAN_INITIAL_BIN_WIDTH_SECONDS;
+            return(bins);
+        }
+    }
+
+    return(NULL);
+}
+
+/* folds the bins of every thread shard into the corresponding heatmap
+ * records.  Must be called after updates have been stopped by clearing
+ * heatmap_epoch, and without holding the module lock.
+ */
+static void heatmap_fold_thread_shards(void)
+{
+    struct darshan_heatmap_record *recs[DARSHAN_MAX_HEATMAPS];
+    struct darshan_heatmap_record *rec;
+    struct heatmap_thread_shard *shard;
+    struct heatmap_shard_bins *bins;
+    int rec_count;
+    int epoch;
+    int i, j, k;
+
+    HEATMAP_LOCK();
+    rec_count = heatmap_runtime->rec_count;
+    if(rec_count > DARSHAN_MAX_HEATMAPS)
+        rec_count = DARSHAN_MAX_HEATMAPS;
+    memcpy(recs, heatmap_runtime->recs, rec_count * sizeof(*recs));
+    epoch = heatmap_runtime->epoch;
+    shard = heatmap_shard_list;
+    HEATMAP_UNLOCK();
+
+    for(; shard; shard = shard->next)
+    {
+        /* waits out any update still in progress on this shard */
+        HEATMAP_SHARD_LOCK(shard);
+        if(shard->epoch != epoch)
+        {
+            HEATMAP_SHARD_UNLOCK(shard);
+            continue;
+        }
+        for(i=0; i<DARSHAN_MAX_HEATMAPS && shard->bins[i]; i++)
+        {
+            bins = shard->bins[i];
+            if(bins->id == 0)
+                break;
+            for(j=0; j<rec_count; j++)
+            {
+                rec = recs[j];
+                if(rec->base_rec.id != bins->id)
+                    continue;
+
+                /* bring both histograms to the same (coarser) bin width */
+                while(bins->bin_width_seconds < rec->bin_width_seconds)
+                    collapse_heatmap(bins->write_bins, bins->read_bins,
+                        &bins->bin_width_seconds);
+                while(rec->bin_width_seconds < bins->bin_width_seconds)
+                    collapse_heatmap(rec->write_bins, rec->read_bins,
+                        &rec->bin_width_seconds);
+
+                for(k=0; k<DARSHAN_MAX_HEATMAP_BINS; k++)
+                {
+                    rec->write_bins[k] += bins->write_bins[k];
+                    rec->read_bins[k] += bins->read_bins[k];
+                }
+                break;
+            }
+            /* each shard is only folded once */
+            bins->id = 0;
+        }
+        HEATMAP_SHARD_UNLOCK(shard);
+    }
 
     return;
 }
@@ -365,21 +540,57 @@ static void collapse_heatmap(struct darshan_heatmap_record *rec)
 void heatmap_update(darshan_record_id heatmap_id, int rw_flag,
     int64_t size, double start_time, double end_time)
 {
-    struct heatmap_record_ref *rec_ref;
+    struct heatmap_thread_shard *shard;
+    struct heatmap_shard_bins *bins;
     int bin_index = 0;
+    int epoch;
+    int i;
     double top_boundary, bottom_boundary, seconds_in_bin;
 
-    HEATMAP_PRE_RECORD_VOID();
-
-    rec_ref = darshan_lookup_record_ref(heatmap_runtime->rec_id_hash, &heatmap_id, sizeof(darshan_record_id));
     /* the heatmap should have already been instantiated in the register
-     * function; something is wrong if we can't find it now
+     * function; something is wrong if we don't have an id for it
      */
-    if(!rec_ref) { HEATMAP_POST_RECORD(); return; }
+    if(!heatmap_id)
+        return;
+
+    shard = heatmap_my_shard;
+    if(!shard)
+    {
+        shard = heatmap_new_thread_shard();
+        if(!shard)
+            return;
+    }
+
+    HEATMAP_SHARD_LOCK(shard);
+
+    epoch = heatmap_epoch;
+    if(!epoch)
+    {
+        /* not initialized or frozen */
+        HEATMAP_SHARD_UNLOCK(shard);
+        return;
+    }
+    if(shard->epoch != epoch)
+    {
+        /* first update to this shard since the runtime was (re)created;
+         * drop anything left over from a previous instance
+         */
+        for(i=0; i<DARSHAN_MAX_HEATMAPS && shard->bins[i]; i++)
+            shard->bins[i]->id = 0;
+        shard->epoch = epoch;
+    }
+
+    bins = heatmap_shard_lookup_bins(shard, heatmap_id);
+    if(!bins)
+    {
+        HEATMAP_SHARD_UNLOCK(shard);
+        return;
+    }
 
     /* is current update out of bounds with histogram size?  if so, collapse */
-    while(end_time > rec_ref->heatmap_rec->bin_width_seconds * DARSHAN_MAX_HEATMAP_BINS)
-        collapse_heatmap(rec_ref->heatmap_rec);
+    while(end_time > bins->bin_width_seconds * DARSHAN_MAX_HEATMAP_BINS)
+        collapse_heatmap(bins->write_bins, bins->read_bins,
+            &bins->bin_width_seconds);
 
     /* once we fall through to this point, we know that the current heatmap
      * granularity is sufficiently large to hold this update
@@ -389,15 +600,15 @@ void heatmap_update(darshan_record_id heatmap_id, int rw_flag,
      * boundaries) */
     /* note: counting on the below type conversion to round down to lower
      * integer */
-    for(bin_index = start_time/rec_ref->heatmap_rec->bin_width_seconds; bin_index < (int)(end_time/rec_ref->heatmap_rec->bin_width_seconds + 1); bin_index++)
+    for(bin_index = start_time/bins->bin_width_seconds; bin_index < (int)(end_time/bins->bin_width_seconds + 1); bin_index++)
     {
         /* starting assumption about how much time this update spent in
          * current bin
          */
-        seconds_in_bin = rec_ref->heatmap_rec->bin_width_seconds;
+        seconds_in_bin = bins->bin_width_seconds;
         /* calculate where bin starts and stops */
-        bottom_boundary = bin_index * rec_ref->heatmap_rec->bin_width_seconds;
-        top_boundary = bottom_boundary + rec_ref->heatmap_rec->bin_width_seconds;
+        bottom_boundary = bin_index * bins->bin_width_seconds;
+        top_boundary = bottom_boundary + bins->bin_width_seconds;
         /* truncate if update started after bottom boundary */
         if(start_time > bottom_boundary)
             seconds_in_bin -= start_time-bottom_boundary;
@@ -410,20 +621,20 @@ void heatmap_update(darshan_record_id heatmap_id, int rw_flag,
              * condition but here we just bail out to avoid disrupting the
              * application.
              */
-            HEATMAP_POST_RECORD();
+            HEATMAP_SHARD_UNLOCK(shard);
             return;
         }
 
         /* proportionally assign bytes to this bin */
         if(rw_flag == HEATMAP_WRITE)
-            rec_ref->heatmap_rec->write_bins[bin_index] +=
+            bins->write_bins[bin_index] +=
                 round(size * (seconds_in_bin/(end_time-start_time)));
         else
-            rec_ref->heatmap_rec->read_bins[bin_index] +=
+            bins->read_bins[bin_index] +=
                 round(size * (seconds_in_bin/(end_time-start_time)));
     }
 
-    HEATMAP_POST_RECORD();
+    HEATMAP_SHARD_UNLOCK(shard);
 
     return;
 }
@@ -474,6 +685,8 @@ static struct heatmap_record_ref *heatmap_track_new_record(
     heatmap_rec->write_bins = (int64_t*)((uintptr_t)heatmap_rec + sizeof(*heatmap_rec));
     heatmap_rec->read_bins = (int64_t*)((uintptr_t)heatmap_rec + sizeof(*heatmap_rec) + heatmap_rec->nbins*sizeof(int64_t));
     rec_ref->heatmap_rec = heatmap_rec;
+    if(heatmap_runtime->rec_count < DARSHAN_MAX_HEATMAPS)
+        heatmap_runtime->recs[heatmap_runtime->rec_count] = heatmap_rec;
     heatmap_runtime->rec_count++;
 
     return(rec_ref);
@@ -493,6 +706,7 @@ static void heatmap_mpi_redux(
     HEATMAP_LOCK();
     assert(heatmap_runtime);
     heatmap_runtime->frozen = 1;
+    heatmap_epoch = 0;
     HEATMAP_UNLOCK();
 
     /* check time locally */
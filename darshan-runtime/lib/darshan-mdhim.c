@@ -480,9 +480,6 @@ static void mdhim_mpi_redux(
     int i, nr_servers=0;
     struct mdhim_record_ref *rec_ref;
     struct darshan_mdhim_record *red_send_buf = NULL;
-    struct darshan_mdhim_record *red_recv_buf = NULL;
-    MPI_Datatype red_type;
-    MPI_Op red_op;
     /* walking through these arrays will be awkward if there is more than one
      * record: the 'server_histogram' field is variable */
     struct darshan_mdhim_record *mdhim_rec_buf =
@@ -529,40 +526,19 @@ static void mdhim_mpi_redux(
         /* make send_buf point to shared files at end */
         red_send_buf = &(mdhim_rec_buf[mdhim_rec_count-shared_rec_count]);
 
-        if (my_rank == 0)
-        {
-            red_recv_buf = malloc(shared_rec_count *
-                    MDHIM_RECORD_SIZE(nr_servers));
-            if (!red_recv_buf)
-            {
-                MDHIM_UNLOCK();
-                return;
-            }
-        }
-
-        PMPI_Type_contiguous(MDHIM_RECORD_SIZE(nr_servers),
-                MPI_BYTE, &red_type);
-        PMPI_Type_commit(&red_type);
-        PMPI_Op_create(mdhim_record_reduction_op, 1, &red_op);
-        PMPI_Reduce(red_send_buf, red_recv_buf,
-                shared_rec_count, red_type, red_op, 0, mod_comm);
+        /* queue the shared records to be reduced along with those of
+         * other modules. On rank 0, darshan-core overwrites them with the
+         * globally reduced records. */
+        darshan_core_reduce_shared_records(red_send_buf, shared_rec_count,
+                MDHIM_RECORD_SIZE(nr_servers), mdhim_record_reduction_op,
+                -1, -1);
 
-        if (my_rank == 0)
-        {
-            memcpy(&(mdhim_rec_buf[0]), red_recv_buf,
-                    shared_rec_count *
-                    MDHIM_RECORD_SIZE(nr_servers));
-            free(red_recv_buf);
-        }
-        else
+        if (my_rank != 0)
         {
             /* drop shared records from non-root ranks or we'll end up writing too
              * much */
             mdhim_runtime->rec_count -= shared_rec_count;
         }
-
-        PMPI_Type_free(&red_type);
-        PMPI_Op_free(&red_op);
     }
 
     MDHIM_UNLOCK();
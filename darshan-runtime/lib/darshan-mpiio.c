@@ -18,6 +18,7 @@
 #include <fcntl.h>
 #include <stdarg.h>
 #include <string.h>
+#include <stddef.h>
 #include <time.h>
 #include <stdlib.h>
 #include <errno.h>
@@ -144,8 +145,7 @@ struct mpiio_file_record_ref
     double last_meta_end;
     double last_read_end;
     double last_write_end;
-    void *access_root;
-    int access_count;
+    struct darshan_common_val_table access_table;
 };
 
 /* The mpiio_runtime structure maintains necessary state for storing
@@ -170,9 +170,6 @@ static void mpiio_finalize_file_records(
 #ifdef HAVE_MPI
 static void mpiio_record_reduction_op(
     void* infile_v, void* inoutfile_v, int *len, MPI_Datatype *datatype);
-static void mpiio_shared_record_variance(
-    MPI_Comm mod_comm, struct darshan_mpiio_file *inrec_array,
-    struct darshan_mpiio_file *outrec_array, int shared_rec_count);
 static void mpiio_mpi_redux(
     void *mpiio_buf, MPI_Comm mod_comm,
     darshan_record_id *shared_recs, int shared_rec_count);
@@ -262,8 +259,6 @@ static int get_byte_offset = 0;
     struct mpiio_file_record_ref *rec_ref; \
     int size = 0; \
     MPI_Offset displacement=-1;\
-    int64_t size_ll; \
-    struct darshan_common_val_counter *cvc; \
     double __elapsed = __tm2-__tm1; \
     if(__ret != MPI_SUCCESS) break; \
     rec_ref = darshan_lookup_record_ref(mpiio_runtime->fh_hash, &(__fh), sizeof(MPI_File)); \
@@ -276,13 +271,7 @@ static int get_byte_offset = 0;
     /* heatmap to record traffic summary */ \
     heatmap_update(mpiio_runtime->heatmap_id, HEATMAP_READ, size, __tm1, __tm2); \
     DARSHAN_BUCKET_INC(&(rec_ref->file_rec->counters[MPIIO_SIZE_READ_AGG_0_100]), size); \
-    size_ll = size; \
-    cvc = darshan_track_common_val_counters(&rec_ref->access_root, &size_ll, 1, \
-        &rec_ref->access_count); \
-    if(cvc) DARSHAN_UPDATE_COMMON_VAL_COUNTERS( \
-        &(rec_ref->file_rec->counters[MPIIO_ACCESS1_ACCESS]), \
-        &(rec_ref->file_rec->counters[MPIIO_ACCESS1_COUNT]), \
-        cvc->vals, 1, cvc->freq, 0); \
+    darshan_common_val_table_add(&rec_ref->access_table, size, 1); \
     rec_ref->file_rec->counters[MPIIO_BYTES_READ] += size; \
     rec_ref->file_rec->counters[__counter] += 1; \
     if(rec_ref->last_io_type == DARSHAN_IO_WRITE) \
@@ -303,8 +292,6 @@ static int get_byte_offset = 0;
     struct mpiio_file_record_ref *rec_ref; \
     int size = 0; \
     MPI_Offset displacement=-1; \
-    int64_t size_ll; \
-    struct darshan_common_val_counter *cvc; \
     double __elapsed = __tm2-__tm1; \
     if(__ret != MPI_SUCCESS) break; \
     rec_ref = darshan_lookup_record_ref(mpiio_runtime->fh_hash, &(__fh), sizeof(MPI_File)); \
@@ -317,13 +304,7 @@ static int get_byte_offset = 0;
     /* heatmap to record traffic summary */ \
     heatmap_update(mpiio_runtime->heatmap_id, HEATMAP_WRITE, size, __tm1, __tm2); \
     DARSHAN_BUCKET_INC(&(rec_ref->file_rec->counters[MPIIO_SIZE_WRITE_AGG_0_100]), size); \
-    size_ll = size; \
-    cvc = darshan_track_common_val_counters(&rec_ref->access_root, &size_ll, 1, \
-        &rec_ref->access_count); \
-    if(cvc) DARSHAN_UPDATE_COMMON_VAL_COUNTERS( \
-        &(rec_ref->file_rec->counters[MPIIO_ACCESS1_ACCESS]), \
-        &(rec_ref->file_rec->counters[MPIIO_ACCESS1_COUNT]), \
-        cvc->vals, 1, cvc->freq, 0); \
+    darshan_common_val_table_add(&rec_ref->access_table, size, 1); \
     rec_ref->file_rec->counters[MPIIO_BYTES_WRITTEN] += size; \
     rec_ref->file_rec->counters[__counter] += 1; \
     if(rec_ref->last_io_type == DARSHAN_IO_READ) \
@@ -1185,6 +1166,7 @@ static void mpiio_runtime_initialize()
     darshan_module_funcs mod_funcs = {
 #ifdef HAVE_MPI
     .mod_redux_func = &mpiio_mpi_redux,
+    .mod_redux_partial = 1,
 #endif
     .mod_output_func = &mpiio_output,
     .mod_cleanup_func = &mpiio_cleanup
@@ -1266,16 +1248,35 @@ static struct mpiio_file_record_ref *mpiio_track_new_file_record(
     return(rec_ref);
 }
 
+/* store the most common access sizes tracked for a record in its common
+ * value counters
+ */
 static void mpiio_finalize_file_records(void *rec_ref_p, void *user_ptr)
 {
     struct mpiio_file_record_ref *rec_ref =
         (struct mpiio_file_record_ref *)rec_ref_p;
 
-    tdestroy(rec_ref->access_root, free);
+    darshan_common_val_table_finalize(&rec_ref->access_table,
+        &(rec_ref->file_rec->counters[MPIIO_ACCESS1_ACCESS]),
+        &(rec_ref->file_rec->counters[MPIIO_ACCESS1_COUNT]));
     return;
 }
 
 #ifdef HAVE_MPI
+/* counters of shared MPI-IO file records that are reduced with a single
+ * operation; the remaining counters are special cases in
+ * mpiio_record_reduction_op()
+ */
+#define MPIIO_COUNTER_SPANS(X) \
+    X(sum, MPIIO_INDEP_OPENS, MPIIO_VIEWS) \
+    X(in, MPIIO_MODE, MPIIO_MODE) \
+    X(sum, MPIIO_BYTES_READ, MPIIO_RW_SWITCHES) \
+    X(sum, MPIIO_SIZE_READ_AGG_0_100, MPIIO_SIZE_WRITE_AGG_1G_PLUS)
+#define MPIIO_FCOUNTER_SPANS(X) \
+    X(min_nonzero, MPIIO_F_OPEN_START_TIMESTAMP, MPIIO_F_CLOSE_START_TIMESTAMP) \
+    X(max, MPIIO_F_OPEN_END_TIMESTAMP, MPIIO_F_CLOSE_END_TIMESTAMP) \
+    X(sum, MPIIO_F_READ_TIME, MPIIO_F_META_TIME)
+
 static void mpiio_record_reduction_op(void* infile_v, void* inoutfile_v,
     int *len, MPI_Datatype *datatype)
 {
@@ -1290,27 +1291,13 @@ static void mpiio_record_reduction_op(void* infile_v, void* inoutfile_v,
         tmp_file.base_rec.id = infile->base_rec.id;
         tmp_file.base_rec.rank = -1;
 
-        /* sum */
-        for(j=MPIIO_INDEP_OPENS; j<=MPIIO_VIEWS; j++)
-        {
-            tmp_file.counters[j] = infile->counters[j] + inoutfile->counters[j];
-        }
-
-        tmp_file.counters[MPIIO_MODE] = infile->counters[MPIIO_MODE];
-
-        /* sum */
-        for(j=MPIIO_BYTES_READ; j<=MPIIO_RW_SWITCHES; j++)
-        {
-            tmp_file.counters[j] = infile->counters[j] + inoutfile->counters[j];
-        }
+        DARSHAN_REDUCE_COUNTER_SPANS(MPIIO_COUNTER_SPANS,
+            infile->counters, inoutfile->counters, tmp_file.counters);
+        DARSHAN_REDUCE_FCOUNTER_SPANS(MPIIO_FCOUNTER_SPANS,
+            infile->fcounters, inoutfile->fcounters, tmp_file.fcounters);
 
         /* skip MPIIO_MAX_*_TIME_SIZE; handled in floating point section */
 
-        for(j=MPIIO_SIZE_READ_AGG_0_100; j<=MPIIO_SIZE_WRITE_AGG_1G_PLUS; j++)
-        {
-            tmp_file.counters[j] = infile->counters[j] + inoutfile->counters[j];
-        }
-
         /* first collapse any duplicates */
         for(j=MPIIO_ACCESS1_ACCESS; j<=MPIIO_ACCESS4_ACCESS; j++)
         {
@@ -1343,31 +1330,6 @@ static void mpiio_record_reduction_op(void* infile_v, void* inoutfile_v,
                 &inoutfile->counters[j], 1, inoutfile->counters[j+4], 1);
         }
 
-        /* min non-zero (if available) value */
-        for(j=MPIIO_F_OPEN_START_TIMESTAMP; j<=MPIIO_F_CLOSE_START_TIMESTAMP; j++)
-        {
-            if((infile->fcounters[j] < inoutfile->fcounters[j] &&
-               infile->fcounters[j] > 0) || inoutfile->fcounters[j] == 0)
-                tmp_file.fcounters[j] = infile->fcounters[j];
-            else
-                tmp_file.fcounters[j] = inoutfile->fcounters[j];
-        }
-
-        /* max */
-        for(j=MPIIO_F_OPEN_END_TIMESTAMP; j<= MPIIO_F_CLOSE_END_TIMESTAMP; j++)
-        {
-            if(infile->fcounters[j] > inoutfile->fcounters[j])
-                tmp_file.fcounters[j] = infile->fcounters[j];
-            else
-                tmp_file.fcounters[j] = inoutfile->fcounters[j];
-        }
-
-        /* sum */
-        for(j=MPIIO_F_READ_TIME; j<=MPIIO_F_META_TIME; j++)
-        {
-            tmp_file.fcounters[j] = infile->fcounters[j] + inoutfile->fcounters[j];
-        }
-
         /* max (special case) */
         if(infile->fcounters[MPIIO_F_MAX_READ_TIME] >
             inoutfile->fcounters[MPIIO_F_MAX_READ_TIME])
@@ -1451,88 +1413,6 @@ static void mpiio_record_reduction_op(void* infile_v, void* inoutfile_v,
 
     return;
 }
-
-static void mpiio_shared_record_variance(MPI_Comm mod_comm,
-    struct darshan_mpiio_file *inrec_array, struct darshan_mpiio_file *outrec_array,
-    int shared_rec_count)
-{
-    MPI_Datatype var_dt;
-    MPI_Op var_op;
-    int i;
-    struct darshan_variance_dt *var_send_buf = NULL;
-    struct darshan_variance_dt *var_recv_buf = NULL;
-
-    PMPI_Type_contiguous(sizeof(struct darshan_variance_dt),
-        MPI_BYTE, &var_dt);
-    PMPI_Type_commit(&var_dt);
-
-    PMPI_Op_create(darshan_variance_reduce, 1, &var_op);
-
-    var_send_buf = malloc(shared_rec_count * sizeof(struct darshan_variance_dt));
-    if(!var_send_buf)
-        return;
-
-    if(my_rank == 0)
-    {
-        var_recv_buf = malloc(shared_rec_count * sizeof(struct darshan_variance_dt));
-
-        if(!var_recv_buf)
-            return;
-    }
-
-    /* get total i/o time variances for shared records */
-
-    for(i=0; i<shared_rec_count; i++)
-    {
-        var_send_buf[i].n = 1;
-        var_send_buf[i].S = 0;
-        var_send_buf[i].T = inrec_array[i].fcounters[MPIIO_F_READ_TIME] +
-                            inrec_array[i].fcounters[MPIIO_F_WRITE_TIME] +
-                            inrec_array[i].fcounters[MPIIO_F_META_TIME];
-    }
-
-    PMPI_Reduce(var_send_buf, var_recv_buf, shared_rec_count,
-        var_dt, var_op, 0, mod_comm);
-
-    if(my_rank == 0)
-    {
-        for(i=0; i<shared_rec_count; i++)
-        {
-            outrec_array[i].fcounters[MPIIO_F_VARIANCE_RANK_TIME] =
-                (var_recv_buf[i].S / var_recv_buf[i].n);
-        }
-    }
-
-    /* get total bytes moved variances for shared records */
-
-    for(i=0; i<shared_rec_count; i++)
-    {
-        var_send_buf[i].n = 1;
-        var_send_buf[i].S = 0;
-        var_send_buf[i].T = (double)
-                            inrec_array[i].counters[MPIIO_BYTES_READ] +
-                            inrec_array[i].counters[MPIIO_BYTES_WRITTEN];
-    }
-
-    PMPI_Reduce(var_send_buf, var_recv_buf, shared_rec_count,
-        var_dt, var_op, 0, mod_comm);
-
-    if(my_rank == 0)
-    {
-        for(i=0; i<shared_rec_count; i++)
-        {
-            outrec_array[i].fcounters[MPIIO_F_VARIANCE_RANK_BYTES] =
-                (var_recv_buf[i].S / var_recv_buf[i].n);
-        }
-    }
-
-    PMPI_Type_free(&var_dt);
-    PMPI_Op_free(&var_op);
-    free(var_send_buf);
-    free(var_recv_buf);
-
-    return;
-}
 #endif
 
 /* mpiio module shutdown benchmark routine */
@@ -1639,14 +1519,15 @@ static void mpiio_mpi_redux(
     struct darshan_mpiio_file *mpiio_rec_buf = (struct darshan_mpiio_file *)mpiio_buf;
     double mpiio_time;
     struct darshan_mpiio_file *red_send_buf = NULL;
-    struct darshan_mpiio_file *red_recv_buf = NULL;
-    MPI_Datatype red_type;
-    MPI_Op red_op;
+    int kept_rec_count;
     int i;
 
     MPIIO_LOCK();
     assert(mpiio_runtime);
 
+    darshan_iter_record_refs(mpiio_runtime->rec_id_hash,
+        &mpiio_finalize_file_records, NULL);
+
     mpiio_rec_count = mpiio_runtime->file_rec_count;
 
     /* necessary initialization of shared records */
@@ -1693,52 +1574,30 @@ static void mpiio_mpi_redux(
     /* make send_buf point to the shared files at the end of sorted array */
     red_send_buf = &(mpiio_rec_buf[mpiio_rec_count-shared_rec_count]);
 
-    /* allocate memory for the reduction output on rank 0 */
-    if(my_rank == 0)
-    {
-        red_recv_buf = malloc(shared_rec_count * sizeof(struct darshan_mpiio_file));
-        if(!red_recv_buf)
-        {
-            MPIIO_UNLOCK();
-            return;
-        }
-    }
-
-    /* construct a datatype for a MPIIO file record.  This is serving no purpose
-     * except to make sure we can do a reduction on proper boundaries
+    /* queue the shared records to be reduced along with those of other
+     * modules, storing the time and bytes this rank contributes to the
+     * variance counters
      */
-    PMPI_Type_contiguous(sizeof(struct darshan_mpiio_file),
-        MPI_BYTE, &red_type);
-    PMPI_Type_commit(&red_type);
-
-    /* register a MPIIO file record reduction operator */
-    PMPI_Op_create(mpiio_record_reduction_op, 1, &red_op);
-
-    /* reduce shared MPIIO file records */
-    PMPI_Reduce(red_send_buf, red_recv_buf,
-        shared_rec_count, red_type, red_op, 0, mod_comm);
-
-    /* get the time and byte variances for shared files */
-    mpiio_shared_record_variance(mod_comm, red_send_buf, red_recv_buf,
-        shared_rec_count);
-
-    /* update module state to account for shared file reduction */
-    if(my_rank == 0)
-    {
-        /* overwrite local shared records with globally reduced records */
-        int tmp_ndx = mpiio_rec_count - shared_rec_count;
-        memcpy(&(mpiio_rec_buf[tmp_ndx]), red_recv_buf,
-            shared_rec_count * sizeof(struct darshan_mpiio_file));
-        free(red_recv_buf);
-    }
-    else
+    for(i = 0; i < shared_rec_count; i++)
     {
-        /* drop shared records on non-zero ranks */
-        mpiio_runtime->file_rec_count -= shared_rec_count;
+        red_send_buf[i].fcounters[MPIIO_F_VARIANCE_RANK_TIME] =
+            red_send_buf[i].fcounters[MPIIO_F_READ_TIME] +
+            red_send_buf[i].fcounters[MPIIO_F_WRITE_TIME] +
+            red_send_buf[i].fcounters[MPIIO_F_META_TIME];
+        red_send_buf[i].fcounters[MPIIO_F_VARIANCE_RANK_BYTES] = (double)
+            red_send_buf[i].counters[MPIIO_BYTES_READ] +
+            red_send_buf[i].counters[MPIIO_BYTES_WRITTEN];
     }
-
-    PMPI_Type_free(&red_type);
-    PMPI_Op_free(&red_op);
+    kept_rec_count = darshan_core_reduce_shared_records(red_send_buf, shared_rec_count,
+        sizeof(struct darshan_mpiio_file), mpiio_record_reduction_op,
+        offsetof(struct darshan_mpiio_file, fcounters[MPIIO_F_VARIANCE_RANK_TIME]),
+        offsetof(struct darshan_mpiio_file, fcounters[MPIIO_F_VARIANCE_RANK_BYTES]));
+
+    /* drop the shared records this rank doesn't keep. darshan-core
+     * overwrites the kept records (moved to the start of the shared
+     * records) with the reduced records.
+     */
+    mpiio_runtime->file_rec_count -= shared_rec_count - kept_rec_count;
 
     MPIIO_UNLOCK();
     return;
@@ -1754,6 +1613,9 @@ static void mpiio_output(
     MPIIO_LOCK();
     assert(mpiio_runtime);
 
+    darshan_iter_record_refs(mpiio_runtime->rec_id_hash,
+        &mpiio_finalize_file_records, NULL);
+
     /* just pass back our updated total buffer size -- no need to update buffer */
     mpiio_rec_count = mpiio_runtime->file_rec_count;
     *mpiio_buf_sz = mpiio_rec_count * sizeof(struct darshan_mpiio_file);
@@ -228,6 +228,7 @@ static void pnetcdf_runtime_initialize()
     darshan_module_funcs mod_funcs = {
 #ifdef HAVE_MPI
     .mod_redux_func = &pnetcdf_mpi_redux,
+    .mod_redux_partial = 1,
 #endif
     .mod_output_func = &pnetcdf_output,
     .mod_cleanup_func = &pnetcdf_cleanup
@@ -370,9 +371,7 @@ static void pnetcdf_mpi_redux(
     struct pnetcdf_file_record_ref *rec_ref;
     struct darshan_pnetcdf_file *pnetcdf_rec_buf = (struct darshan_pnetcdf_file *)pnetcdf_buf;
     struct darshan_pnetcdf_file *red_send_buf = NULL;
-    struct darshan_pnetcdf_file *red_recv_buf = NULL;
-    MPI_Datatype red_type;
-    MPI_Op red_op;
+    int kept_rec_count;
     int i;
 
     PNETCDF_LOCK();
@@ -399,48 +398,17 @@ static void pnetcdf_mpi_redux(
     /* make *send_buf point to the shared files at the end of sorted array */
     red_send_buf = &(pnetcdf_rec_buf[pnetcdf_rec_count-shared_rec_count]);
 
-    /* allocate memory for the reduction output on rank 0 */
-    if(my_rank == 0)
-    {
-        red_recv_buf = malloc(shared_rec_count * sizeof(struct darshan_pnetcdf_file));
-        if(!red_recv_buf)
-        {
-            PNETCDF_UNLOCK();
-            return;
-        }
-    }
-
-    /* construct a datatype for a PNETCDF file record.  This is serving no purpose
-     * except to make sure we can do a reduction on proper boundaries
+    /* queue the shared records to be reduced along with those of other
+     * modules
      */
-    PMPI_Type_contiguous(sizeof(struct darshan_pnetcdf_file),
-        MPI_BYTE, &red_type);
-    PMPI_Type_commit(&red_type);
-
-    /* register a PNETCDF file record reduction operator */
-    PMPI_Op_create(pnetcdf_record_reduction_op, 1, &red_op);
-
-    /* reduce shared PNETCDF file records */
-    PMPI_Reduce(red_send_buf, red_recv_buf,
-        shared_rec_count, red_type, red_op, 0, mod_comm);
+    kept_rec_count = darshan_core_reduce_shared_records(red_send_buf, shared_rec_count,
+        sizeof(struct darshan_pnetcdf_file), pnetcdf_record_reduction_op, -1, -1);
 
-    /* update module state to account for shared file reduction */
-    if(my_rank == 0)
-    {
-        /* overwrite local shared records with globally reduced records */
-        int tmp_ndx = pnetcdf_rec_count - shared_rec_count;
-        memcpy(&(pnetcdf_rec_buf[tmp_ndx]), red_recv_buf,
-            shared_rec_count * sizeof(struct darshan_pnetcdf_file));
-        free(red_recv_buf);
-    }
-    else
-    {
-        /* drop shared records on non-zero ranks */
-        pnetcdf_runtime->file_rec_count -= shared_rec_count;
-    }
-
-    PMPI_Type_free(&red_type);
-    PMPI_Op_free(&red_op);
+    /* drop the shared records this rank doesn't keep. darshan-core
+     * overwrites the kept records (moved to the start of the shared
+     * records) with the reduced records.
+     */
+    pnetcdf_runtime->file_rec_count -= shared_rec_count - kept_rec_count;
 
     PNETCDF_UNLOCK();
     return;
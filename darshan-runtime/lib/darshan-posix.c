@@ -18,6 +18,7 @@
 #include <fcntl.h>
 #include <stdarg.h>
 #include <string.h>
+#include <stddef.h>
 #include <time.h>
 #include <stdlib.h>
 #include <errno.h>
@@ -29,6 +30,10 @@
 #include <aio.h>
 #include <pthread.h>
 #include <limits.h>
+#include <signal.h>
+#ifdef HAVE_STDATOMIC_H
+#include <stdatomic.h>
+#endif
 
 #include "utlist.h"
 #include "darshan.h"
@@ -107,6 +112,59 @@ DARSHAN_FORWARD_DECL(aio_return64, ssize_t, (struct aiocb64 *aiocbp));
 DARSHAN_FORWARD_DECL(lio_listio, int, (int mode, struct aiocb *const aiocb_list[], int nitems, struct sigevent *sevp));
 DARSHAN_FORWARD_DECL(lio_listio64, int, (int mode, struct aiocb64 *const aiocb_list[], int nitems, struct sigevent *sevp));
 DARSHAN_FORWARD_DECL(rename, int, (const char *oldpath, const char *newpath));
+DARSHAN_FORWARD_DECL(chdir, int, (const char *path));
+DARSHAN_FORWARD_DECL(fchdir, int, (int fd));
+
+/* The posix_rw_counters structure holds the counters that each read (or
+ * write) operation updates, packed into two cache lines.
+ */
+struct posix_rw_counters
+{
+    /* first cache line: updated by every operation */
+    int64_t ops; /* POSIX_READS or POSIX_WRITES */
+    int64_t bytes; /* POSIX_BYTES_READ or POSIX_BYTES_WRITTEN */
+    int64_t max_byte; /* POSIX_MAX_BYTE_READ or POSIX_MAX_BYTE_WRITTEN */
+    int64_t last_byte; /* last byte accessed, reset on open and close */
+    double start_time; /* POSIX_F_{READ,WRITE}_START_TIMESTAMP */
+    double end_time; /* POSIX_F_{READ,WRITE}_END_TIMESTAMP */
+    double time; /* POSIX_F_READ_TIME or POSIX_F_WRITE_TIME */
+    double last_end; /* end of the latest operation, to avoid overlaps */
+    /* second cache line: updated depending on the access pattern */
+    int64_t seq; /* POSIX_SEQ_{READS,WRITES} */
+    int64_t consec; /* POSIX_CONSEC_{READS,WRITES} */
+    int64_t rw_switches; /* switches to this type of operation */
+    int64_t mem_not_aligned;
+    int64_t file_not_aligned;
+    int64_t max_time_size; /* POSIX_MAX_{READ,WRITE}_TIME_SIZE */
+    double max_time; /* POSIX_F_MAX_{READ,WRITE}_TIME */
+} __attribute__((aligned(DARSHAN_CACHE_LINE_SIZE)));
+
+/* in sharded mode, concurrent read/write wrappers (which only hold the shard
+ * lock in shared mode) and lseek wrappers update the same file offset, so it
+ * is updated atomically
+ */
+#ifdef HAVE_STDATOMIC_H
+typedef atomic_int_least64_t posix_offset_t;
+#define POSIX_OFFSET_SET(__ref, __off) \
+    atomic_store_explicit(&(__ref)->offset, __off, memory_order_relaxed)
+#define POSIX_OFFSET_ADVANCE(__ref, __len, __old) \
+    (__old) = atomic_fetch_add_explicit(&(__ref)->offset, __len, \
+        memory_order_relaxed)
+#else
+typedef int64_t posix_offset_t;
+static pthread_mutex_t posix_offset_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define POSIX_OFFSET_SET(__ref, __off) do { \
+    pthread_mutex_lock(&posix_offset_mutex); \
+    (__ref)->offset = (__off); \
+    pthread_mutex_unlock(&posix_offset_mutex); \
+} while(0)
+#define POSIX_OFFSET_ADVANCE(__ref, __len, __old) do { \
+    pthread_mutex_lock(&posix_offset_mutex); \
+    (__old) = (__ref)->offset; \
+    (__ref)->offset += (__len); \
+    pthread_mutex_unlock(&posix_offset_mutex); \
+} while(0)
+#endif
 
 /* The posix_file_record_ref structure maintains necessary runtime metadata
  * for the POSIX file record (darshan_posix_file structure, defined in
@@ -129,38 +187,150 @@ DARSHAN_FORWARD_DECL(rename, int, (const char *oldpath, const char *newpath));
  * or by a generated file descriptor, for instance. Note that, while there should
  * only be a single Darshan record identifier that indexes a posix_file_record_ref,
  * there could be multiple open file descriptors that index it.
+ *
+ * NOTE: when per-thread sharding is enabled, each thread also keeps private
+ * posix_file_record_ref structs (with private darshan_posix_file records)
+ * for the files it reads or writes. These shard references are stored in the
+ * thread's posix_thread_shard and are folded into the file record that
+ * darshan-core persists at shutdown time.
+ *
+ * NOTE: the counters that every read or write updates are kept in
+ * posix_rw_counters structs in the posix_file_record_ref rather than in the
+ * file record, so that each operation touches a few adjacent cache lines.
+ * They are added to the file record in posix_finalize_file_records().
+ *
+ * NOTE: when darshan-core's record overflow policy allows it, files that
+ * don't fit in memory are accounted to an overflow record (one per mount
+ * point), which is indexed by its own record identifier. Evicted files keep
+ * their posix_file_record_ref, which then points to the overflow record the
+ * file was evicted to, so more than one reference may share a file record.
+ * Sequential, consecutive and stride counters only make sense within a
+ * file, so they are not tracked through an overflow record's own reference,
+ * and the most common access sizes and strides are not tracked for
+ * overflow records at all.
  */
 struct posix_file_record_ref
 {
     struct darshan_posix_file *file_rec;
-    int64_t offset;
-    int64_t last_byte_read;
-    int64_t last_byte_written;
+    posix_offset_t offset; /* see POSIX_OFFSET_ADVANCE() */
+    int64_t file_alignment; /* same as the POSIX_FILE_ALIGNMENT counter */
     enum darshan_io_type last_io_type;
+    int reset_count; /* incremented when reads/writes.last_byte are reset */
+    /* the latest run of accesses of the same size (in the direction of
+     * last_io_type) and of the same stride, which are only added to the
+     * size histogram and common value tables once the run ends, see
+     * posix_flush_access_runs()
+     */
+    int64_t size_run;
+    int64_t size_run_count;
+    int64_t stride_run;
+    int64_t stride_run_count;
+    struct posix_rw_counters reads;
+    struct posix_rw_counters writes;
     double last_meta_end;
-    double last_read_end;
-    double last_write_end;
-    void *access_root;
-    int access_count;
-    void *stride_root;
-    int stride_count;
+    struct darshan_common_val_table access_table;
+    struct darshan_common_val_table stride_table;
     struct posix_aio_tracker* aio_list;
     int fs_type; /* same as darshan_fs_info->fs_type */
+    int overflow; /* file_rec is an overflow record */
+    int evicted; /* file_rec is the overflow record this file was evicted to */
+};
+
+/* The posix_thread_shard structure holds one thread's private read/write
+ * state when per-thread sharding is enabled. Read and write wrappers update
+ * their thread's shard without holding the POSIX module lock.
+ */
+struct posix_thread_shard
+{
+    void *rec_id_hash;
+    struct posix_thread_shard *next;
+};
+
+/* The posix_event structure describes a single read or write operation
+ * that has been queued by a wrapper in event queue mode, but whose counters
+ * (and DXT and heatmap data) have not been updated yet.
+ */
+struct posix_event
+{
+    struct posix_file_record_ref *rec_ref;
+    int64_t offset;
+    int64_t size;
+    double tm1;
+    double tm2;
+    enum darshan_io_type io_type;
+    int aligned;
+};
+
+/* The posix_event_queue structure is a single-producer, single-consumer
+ * ring of events. Each thread queues events in its own ring without holding
+ * the POSIX module lock, and the rings are drained (i.e., the events are
+ * recorded) by whichever thread holds the POSIX module lock.
+ */
+#define POSIX_EVENT_QUEUE_SIZE 1024 /* must be a power of 2 */
+
+#ifdef HAVE_STDATOMIC_H
+struct posix_event_queue
+{
+    /* the producer and consumer indexes are kept on separate cache lines */
+    atomic_ulong tail __attribute__((aligned(DARSHAN_CACHE_LINE_SIZE)));
+    atomic_ulong head __attribute__((aligned(DARSHAN_CACHE_LINE_SIZE)));
+    struct posix_event_queue *next;
+    struct posix_event events[POSIX_EVENT_QUEUE_SIZE];
 };
+#else
+struct posix_event_queue;
+#endif
 
 /* The posix_runtime structure maintains necessary state for storing
  * POSIX file records and for coordinating with darshan-core at 
  * shutdown time.
  */
+#define POSIX_FD_PAGE_SIZE 1024 /* number of fds per fd table page */
+#define POSIX_FD_MAX_PAGES 1024 /* larger fds are tracked in fd_hash */
+#define POSIX_FD_TABLE_MAX (POSIX_FD_PAGE_SIZE * POSIX_FD_MAX_PAGES)
+
 struct posix_runtime
 {
     void *rec_id_hash;
+    /* file descriptors are small, dense integers, so they index directly
+     * into pages of record reference pointers that are allocated on demand.
+     * fd_hash is only used for descriptors beyond POSIX_FD_TABLE_MAX.
+     */
+    struct posix_file_record_ref **fd_pages[POSIX_FD_MAX_PAGES];
     void *fd_hash;
+    void *path_cache_hash;
+    int path_cache_count;
     int file_rec_count;
     darshan_record_id heatmap_id;
     int frozen; /* flag to indicate that the counters should no longer be modified */
+    struct posix_thread_shard *shard_list;
+    int shard_epoch; /* incremented each time shards are folded and dropped */
+    size_t shard_mem_limit; /* memory thread shards may use */
+    size_t shard_mem_avail; /* memory left for shards until they are folded */
+    struct posix_event_queue *queue_list;
+    int queue_epoch; /* identifies the event queues of this runtime instance */
+    struct darshan_posix_file *first_rec; /* start of the record buffer */
+    int evict_ndx; /* next record to sample for eviction */
+};
+
+/* The posix_path_cache_entry structure caches the result of resolving a path
+ * passed to an open or stat wrapper, so that repeated opens and stats of the
+ * same path skip path cleaning, exclusion checks, and record id hashing.
+ * Entries are keyed on the raw path string given by the application.
+ */
+struct posix_path_cache_entry
+{
+    struct posix_file_record_ref *rec_ref; /* NULL if the path is excluded */
+    int cwd_generation; /* cwd generation for relative paths, -1 otherwise */
+    char *newpath; /* cleaned path, stored after this structure */
 };
 
+/* maximum number of paths cached before the cache is flushed */
+#define POSIX_PATH_CACHE_MAX 4096
+
+/* number of file records sampled when looking for a record to evict */
+#define POSIX_EVICT_SAMPLE_COUNT 8
+
 /* struct to track information about aio operations in flight */
 struct posix_aio_tracker
 {
@@ -173,18 +343,59 @@ static void posix_runtime_initialize(
     void);
 static struct posix_file_record_ref *posix_track_new_file_record(
     darshan_record_id rec_id, const char *path);
+static struct posix_file_record_ref *posix_track_overflow_record(
+    darshan_record_id file_rec_id, const char *path);
+static struct darshan_posix_file *posix_evict_file_record(
+    darshan_record_id rec_id, const char *path,
+    struct darshan_fs_info *fs_info);
+static struct posix_file_record_ref *posix_path_record_ref(
+    const char *path, char **newpath_p);
 static void posix_aio_tracker_add(
     int fd, void *aiocbp);
 static struct posix_aio_tracker* posix_aio_tracker_del(
     int fd, void *aiocbp);
+static void posix_fd_add(
+    int fd, struct posix_file_record_ref *rec_ref);
+static void posix_fd_delete(
+    int fd);
+static void posix_fd_clear(
+    void);
+static void posix_clear_evicted_file_records(
+    void *rec_ref_p, void *user_ptr);
 static void posix_finalize_file_records(
     void *rec_ref_p, void *user_ptr);
+static void posix_merge_rw_counters(
+    struct posix_rw_counters *dst, struct posix_rw_counters *src);
+static void posix_fold_rw_counters(
+    struct darshan_posix_file *file_rec, struct posix_rw_counters *rw, int w);
+static inline void posix_flush_size_run(
+    struct posix_file_record_ref *rec_ref, int64_t size);
+static inline void posix_flush_stride_run(
+    struct posix_file_record_ref *rec_ref, int64_t stride);
+static void posix_flush_access_runs(
+    struct posix_file_record_ref *rec_ref);
+static void posix_record_merge(
+    struct darshan_posix_file *infile, struct darshan_posix_file *inoutfile);
+static struct posix_file_record_ref *posix_shard_record_ref(
+    struct posix_file_record_ref *rec_ref, int *shared);
+static void posix_fold_thread_shards(
+    void);
+static void posix_fold_shard_record(
+    void *shard_ref_p, void *user_ptr);
+static int posix_reserve_event(
+    void);
+static void posix_enqueue_event(
+    struct posix_file_record_ref *rec_ref, enum darshan_io_type io_type,
+    int64_t offset, int64_t size, int aligned, double tm1, double tm2);
+static void posix_drain_events(
+    void);
+static void posix_free_event_queues(
+    void);
+static void posix_start_event_drain_thread(
+    long interval_ms);
 #ifdef HAVE_MPI
 static void posix_record_reduction_op(
     void* infile_v, void* inoutfile_v, int *len, MPI_Datatype *datatype);
-static void posix_shared_record_variance(
-    MPI_Comm mod_comm, struct darshan_posix_file *inrec_array,
-    struct darshan_posix_file *outrec_array, int shared_rec_count);
 static void posix_mpi_redux(
     void *posix_buf, MPI_Comm mod_comm,
     darshan_record_id *shared_recs, int shared_rec_count);
@@ -201,10 +412,60 @@ static struct posix_runtime *posix_runtime = NULL;
 static pthread_mutex_t posix_runtime_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
 static int my_rank = -1;
 static int darshan_mem_alignment = 1;
+/* incremented on each chdir, to invalidate cached relative paths */
+static int posix_cwd_generation = 0;
+
+/* per-thread sharding state; see posix_runtime_initialize() */
+static int posix_sharded = 0;
+static int posix_shard_epoch_counter = 0;
+static pthread_rwlock_t posix_shard_rwlock =
+    PTHREAD_RWLOCK_WRITER_NONRECURSIVE_INITIALIZER_NP;
+static pthread_mutex_t posix_shard_list_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* serializes updates to shared file record references by threads that
+ * can't have shard references (see posix_shard_record_ref())
+ */
+static pthread_mutex_t posix_shard_shared_mutex = PTHREAD_MUTEX_INITIALIZER;
+static __thread struct posix_thread_shard *posix_my_shard = NULL;
+static __thread int posix_my_shard_epoch = 0;
+
+/* event queue state; see posix_runtime_initialize() */
+static int posix_event_queue = 0;
+static long posix_event_drain_interval = 0;
+static __thread struct posix_event_queue *posix_my_queue = NULL;
+static __thread int posix_my_queue_epoch = 0;
 
 #define POSIX_LOCK() pthread_mutex_lock(&posix_runtime_mutex)
 #define POSIX_UNLOCK() pthread_mutex_unlock(&posix_runtime_mutex)
 
+/* in sharded mode, the shard lock is held shared by read/write wrappers
+ * and exclusively (while also holding the POSIX lock) by anything that
+ * modifies the fd table, runtime pointer, or thread shards
+ */
+#define POSIX_SHARD_RDLOCK() pthread_rwlock_rdlock(&posix_shard_rwlock)
+#define POSIX_SHARD_WRLOCK() do { \
+    if(posix_sharded) pthread_rwlock_wrlock(&posix_shard_rwlock); \
+} while(0)
+#define POSIX_SHARD_UNLOCK() pthread_rwlock_unlock(&posix_shard_rwlock)
+#define POSIX_SHARD_WRUNLOCK() do { \
+    if(posix_sharded) pthread_rwlock_unlock(&posix_shard_rwlock); \
+} while(0)
+
+/* look up the file record reference associated with an open fd */
+static inline struct posix_file_record_ref *posix_fd_lookup(int fd)
+{
+    struct posix_file_record_ref **fd_page;
+
+    if(fd < 0)
+        return(NULL);
+    if(fd >= POSIX_FD_TABLE_MAX)
+        return(darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int)));
+
+    fd_page = posix_runtime->fd_pages[fd / POSIX_FD_PAGE_SIZE];
+    if(!fd_page)
+        return(NULL);
+    return(fd_page[fd % POSIX_FD_PAGE_SIZE]);
+}
+
 #define POSIX_WTIME() \
     __darshan_disabled ? 0 : darshan_core_wtime();
 
@@ -227,27 +488,59 @@ static int darshan_mem_alignment = 1;
     POSIX_UNLOCK(); \
 } while(0)
 
+/* variant of POSIX_PRE_RECORD() for read/write wrappers. In sharded mode,
+ * these wrappers only hold the shard lock in shared mode, since they just
+ * consult the fd table and update the calling thread's shard (or queue an
+ * event, in event queue mode, which is only entered after making sure there
+ * is room for it in the calling thread's queue).
+ * NOTE: posix_sharded is only ever set (never cleared) while holding the
+ * POSIX lock, so POST_RECORD_RW() always releases the lock taken here.
+ */
+#define POSIX_PRE_RECORD_RW() do { \
+    if(!__darshan_disabled) { \
+        if(!posix_sharded) { \
+            POSIX_LOCK(); \
+            if(!posix_runtime) posix_runtime_initialize(); \
+            if(!posix_sharded) { \
+                if(posix_runtime && !posix_runtime->frozen) break; \
+                POSIX_UNLOCK(); \
+                return(ret); \
+            } \
+            POSIX_UNLOCK(); \
+        } \
+        POSIX_SHARD_RDLOCK(); \
+        if(posix_runtime && !posix_runtime->frozen && \
+           (!posix_event_queue || posix_reserve_event())) break; \
+        POSIX_SHARD_UNLOCK(); \
+    } \
+    return(ret); \
+} while(0)
+
+#define POSIX_POST_RECORD_RW() do { \
+    if(posix_sharded) POSIX_SHARD_UNLOCK(); \
+    else POSIX_UNLOCK(); \
+} while(0)
+
+/* map a file record reference to the reference read/write counters should
+ * be recorded in (the calling thread's shard reference if sharding is on).
+ * '__shared' is set if the (shared) file record reference is returned in
+ * sharded mode, in which case POSIX_RW_RECORD_UNREF() must be called after
+ * recording the counters.
+ */
+#define POSIX_RW_RECORD_REF(__rec_ref, __shared) \
+    (posix_sharded ? posix_shard_record_ref(__rec_ref, &(__shared)) : (__rec_ref))
+#define POSIX_RW_RECORD_UNREF(__shared) do { \
+    if(__shared) pthread_mutex_unlock(&posix_shard_shared_mutex); \
+} while(0)
+
 #define POSIX_RECORD_OPEN(__ret, __path, __mode, __tm1, __tm2) do { \
-    darshan_record_id __rec_id; \
     struct posix_file_record_ref *__rec_ref; \
     char *__newpath; \
     if(__ret < 0) break; \
-    __newpath = darshan_clean_file_path(__path); \
-    if(!__newpath) __newpath = (char *)__path; \
-    if(darshan_core_excluded_path(__newpath)) { \
-        if(__newpath != __path) free(__newpath); \
-        break; \
-    } \
-    __rec_id = darshan_core_gen_record_id(__newpath); \
-    __rec_ref = darshan_lookup_record_ref(posix_runtime->rec_id_hash, &__rec_id, sizeof(darshan_record_id)); \
-    if(!__rec_ref) __rec_ref = posix_track_new_file_record(__rec_id, __newpath); \
-    if(!__rec_ref) { \
-        if(__newpath != __path) free(__newpath); \
-        break; \
-    } \
+    __rec_ref = posix_path_record_ref(__path, &__newpath); \
+    if(!__rec_ref) break; \
     _POSIX_RECORD_OPEN(__ret, __rec_ref, __mode, __tm1, __tm2, 1, -1); \
     darshan_instrument_fs_data(__rec_ref->fs_type, __newpath, __ret); \
-    if(__newpath != __path) free(__newpath); \
 } while(0)
 
 #define POSIX_RECORD_REFOPEN(__ret, __rec_ref, __tm1, __tm2, __ref_counter) do { \
@@ -258,9 +551,11 @@ static int darshan_mem_alignment = 1;
 #define _POSIX_RECORD_OPEN(__ret, __rec_ref, __mode, __tm1, __tm2, __reset_flag, __ref_counter) do { \
     if(__mode) __rec_ref->file_rec->counters[POSIX_MODE] = __mode; \
     if(__reset_flag) { \
-        __rec_ref->offset = 0; \
-        __rec_ref->last_byte_written = 0; \
-        __rec_ref->last_byte_read = 0; \
+        if(posix_event_queue) posix_drain_events(); \
+        POSIX_OFFSET_SET(__rec_ref, 0); \
+        __rec_ref->writes.last_byte = 0; \
+        __rec_ref->reads.last_byte = 0; \
+        __rec_ref->reset_count++; \
     } \
     __rec_ref->file_rec->counters[POSIX_OPENS] += 1; \
     if(__ref_counter >= 0) __rec_ref->file_rec->counters[__ref_counter] += 1; \
@@ -270,152 +565,163 @@ static int darshan_mem_alignment = 1;
     __rec_ref->file_rec->fcounters[POSIX_F_OPEN_END_TIMESTAMP] = __tm2; \
     DARSHAN_TIMER_INC_NO_OVERLAP(__rec_ref->file_rec->fcounters[POSIX_F_META_TIME], \
         __tm1, __tm2, __rec_ref->last_meta_end); \
-    darshan_add_record_ref(&(posix_runtime->fd_hash), &__ret, sizeof(int), __rec_ref); \
+    POSIX_SHARD_WRLOCK(); \
+    posix_fd_add(__ret, __rec_ref); \
+    POSIX_SHARD_WRUNLOCK(); \
 } while(0)
 
 #define POSIX_RECORD_READ(__ret, __fd, __pread_flag, __pread_offset, __aligned, __tm1, __tm2) do { \
+    struct posix_file_record_ref* fd_ref; \
     struct posix_file_record_ref* rec_ref; \
-    int64_t stride; \
     int64_t this_offset; \
-    int64_t file_alignment; \
-    struct darshan_common_val_counter *cvc; \
-    double __elapsed = __tm2-__tm1; \
+    int shared = 0; \
     if(__ret < 0) break; \
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &(__fd), sizeof(int)); \
-    if(!rec_ref) break; \
-    if(__pread_flag) \
+    fd_ref = posix_fd_lookup(__fd); \
+    if(!fd_ref) break; \
+    if(__pread_flag) { \
         this_offset = __pread_offset; \
+        POSIX_OFFSET_SET(fd_ref, this_offset + __ret); \
+    } \
     else \
-        this_offset = rec_ref->offset; \
+        POSIX_OFFSET_ADVANCE(fd_ref, __ret, this_offset); \
+    if(posix_event_queue) { \
+        posix_enqueue_event(fd_ref, DARSHAN_IO_READ, this_offset, __ret, \
+            __aligned, __tm1, __tm2); \
+        break; \
+    } \
+    rec_ref = POSIX_RW_RECORD_REF(fd_ref, shared); \
+    _POSIX_RECORD_READ(rec_ref, this_offset, __ret, __aligned, __tm1, __tm2); \
+    POSIX_RW_RECORD_UNREF(shared); \
+} while(0)
+
+#define _POSIX_RECORD_READ(__rec_ref, __offset, __ret, __aligned, __tm1, __tm2) do { \
+    int64_t stride; \
+    int64_t file_alignment; \
+    double __elapsed = __tm2-__tm1; \
     /* DXT to record detailed read tracing information */ \
-    dxt_posix_read(rec_ref->file_rec->base_rec.id, this_offset, __ret, __tm1, __tm2); \
+    dxt_posix_read(__rec_ref->file_rec->base_rec.id, __offset, __ret, __tm1, __tm2); \
     /* heatmap to record traffic summary */ \
     heatmap_update(posix_runtime->heatmap_id, HEATMAP_READ, __ret, __tm1, __tm2); \
-    if(this_offset > rec_ref->last_byte_read) \
-        rec_ref->file_rec->counters[POSIX_SEQ_READS] += 1;  \
-    if(this_offset == (rec_ref->last_byte_read + 1)) \
-        rec_ref->file_rec->counters[POSIX_CONSEC_READS] += 1;  \
-    if(this_offset > 0 && this_offset > rec_ref->last_byte_read \
-        && rec_ref->last_byte_read != 0) \
-        stride = this_offset - rec_ref->last_byte_read - 1; \
-    else \
-        stride = 0; \
-    rec_ref->last_byte_read = this_offset + __ret - 1; \
-    rec_ref->offset = this_offset + __ret; \
-    if(rec_ref->file_rec->counters[POSIX_MAX_BYTE_READ] < (this_offset + __ret - 1)) \
-        rec_ref->file_rec->counters[POSIX_MAX_BYTE_READ] = (this_offset + __ret - 1); \
-    rec_ref->file_rec->counters[POSIX_BYTES_READ] += __ret; \
-    rec_ref->file_rec->counters[POSIX_READS] += 1; \
-    DARSHAN_BUCKET_INC(&(rec_ref->file_rec->counters[POSIX_SIZE_READ_0_100]), __ret); \
-    cvc = darshan_track_common_val_counters(&rec_ref->access_root, &__ret, 1, \
-        &rec_ref->access_count); \
-    if(cvc) DARSHAN_UPDATE_COMMON_VAL_COUNTERS( \
-        &(rec_ref->file_rec->counters[POSIX_ACCESS1_ACCESS]), \
-        &(rec_ref->file_rec->counters[POSIX_ACCESS1_COUNT]), \
-        cvc->vals, 1, cvc->freq, 0); \
-    cvc = darshan_track_common_val_counters(&rec_ref->stride_root, &stride, 1, \
-        &rec_ref->stride_count); \
-    if(cvc) DARSHAN_UPDATE_COMMON_VAL_COUNTERS( \
-        &(rec_ref->file_rec->counters[POSIX_STRIDE1_STRIDE]), \
-        &(rec_ref->file_rec->counters[POSIX_STRIDE1_COUNT]), \
-        cvc->vals, 1, cvc->freq, 0); \
+    /* access patterns are only tracked per file, see posix_file_record_ref */ \
+    if(!__rec_ref->overflow) { \
+        if(__offset > __rec_ref->reads.last_byte) \
+            __rec_ref->reads.seq += 1; \
+        if(__offset == (__rec_ref->reads.last_byte + 1)) \
+            __rec_ref->reads.consec += 1; \
+        if(__offset > 0 && __offset > __rec_ref->reads.last_byte \
+            && __rec_ref->reads.last_byte != 0) \
+            stride = __offset - __rec_ref->reads.last_byte - 1; \
+        else \
+            stride = 0; \
+        __rec_ref->reads.last_byte = __offset + __ret - 1; \
+        if(!__rec_ref->evicted) { \
+            if(stride != __rec_ref->stride_run) \
+                posix_flush_stride_run(__rec_ref, stride); \
+            __rec_ref->stride_run_count += 1; } \
+    } \
+    if(__ret != __rec_ref->size_run || __rec_ref->last_io_type != DARSHAN_IO_READ) \
+        posix_flush_size_run(__rec_ref, __ret); \
+    __rec_ref->size_run_count += 1; \
+    if(__rec_ref->reads.max_byte < (__offset + __ret - 1)) \
+        __rec_ref->reads.max_byte = (__offset + __ret - 1); \
+    __rec_ref->reads.bytes += __ret; \
+    __rec_ref->reads.ops += 1; \
     if(!__aligned) \
-        rec_ref->file_rec->counters[POSIX_MEM_NOT_ALIGNED] += 1; \
-    file_alignment = rec_ref->file_rec->counters[POSIX_FILE_ALIGNMENT]; \
-    if(file_alignment > 0 && (this_offset % file_alignment) != 0) \
-        rec_ref->file_rec->counters[POSIX_FILE_NOT_ALIGNED] += 1; \
-    if(rec_ref->last_io_type == DARSHAN_IO_WRITE) \
-        rec_ref->file_rec->counters[POSIX_RW_SWITCHES] += 1; \
-    rec_ref->last_io_type = DARSHAN_IO_READ; \
-    if(rec_ref->file_rec->fcounters[POSIX_F_READ_START_TIMESTAMP] == 0 || \
-     rec_ref->file_rec->fcounters[POSIX_F_READ_START_TIMESTAMP] > __tm1) \
-        rec_ref->file_rec->fcounters[POSIX_F_READ_START_TIMESTAMP] = __tm1; \
-    rec_ref->file_rec->fcounters[POSIX_F_READ_END_TIMESTAMP] = __tm2; \
-    if(rec_ref->file_rec->fcounters[POSIX_F_MAX_READ_TIME] < __elapsed) { \
-        rec_ref->file_rec->fcounters[POSIX_F_MAX_READ_TIME] = __elapsed; \
-        rec_ref->file_rec->counters[POSIX_MAX_READ_TIME_SIZE] = __ret; } \
-    DARSHAN_TIMER_INC_NO_OVERLAP(rec_ref->file_rec->fcounters[POSIX_F_READ_TIME], \
-        __tm1, __tm2, rec_ref->last_read_end); \
+        __rec_ref->reads.mem_not_aligned += 1; \
+    file_alignment = __rec_ref->file_alignment; \
+    if(file_alignment > 0 && (__offset % file_alignment) != 0) \
+        __rec_ref->reads.file_not_aligned += 1; \
+    if(__rec_ref->last_io_type == DARSHAN_IO_WRITE) \
+        __rec_ref->reads.rw_switches += 1; \
+    __rec_ref->last_io_type = DARSHAN_IO_READ; \
+    if(__rec_ref->reads.start_time == 0 || __rec_ref->reads.start_time > __tm1) \
+        __rec_ref->reads.start_time = __tm1; \
+    __rec_ref->reads.end_time = __tm2; \
+    if(__rec_ref->reads.max_time < __elapsed) { \
+        __rec_ref->reads.max_time = __elapsed; \
+        __rec_ref->reads.max_time_size = __ret; } \
+    DARSHAN_TIMER_INC_NO_OVERLAP(__rec_ref->reads.time, \
+        __tm1, __tm2, __rec_ref->reads.last_end); \
 } while(0)
 
 #define POSIX_RECORD_WRITE(__ret, __fd, __pwrite_flag, __pwrite_offset, __aligned, __tm1, __tm2) do { \
+    struct posix_file_record_ref* fd_ref; \
     struct posix_file_record_ref* rec_ref; \
-    int64_t stride; \
     int64_t this_offset; \
-    int64_t file_alignment; \
-    struct darshan_common_val_counter *cvc; \
-    double __elapsed = __tm2-__tm1; \
+    int shared = 0; \
     if(__ret < 0) break; \
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &__fd, sizeof(int)); \
-    if(!rec_ref) break; \
-    if(__pwrite_flag) \
+    fd_ref = posix_fd_lookup(__fd); \
+    if(!fd_ref) break; \
+    if(__pwrite_flag) { \
         this_offset = __pwrite_offset; \
+        POSIX_OFFSET_SET(fd_ref, this_offset + __ret); \
+    } \
     else \
-        this_offset = rec_ref->offset; \
+        POSIX_OFFSET_ADVANCE(fd_ref, __ret, this_offset); \
+    if(posix_event_queue) { \
+        posix_enqueue_event(fd_ref, DARSHAN_IO_WRITE, this_offset, __ret, \
+            __aligned, __tm1, __tm2); \
+        break; \
+    } \
+    rec_ref = POSIX_RW_RECORD_REF(fd_ref, shared); \
+    _POSIX_RECORD_WRITE(rec_ref, this_offset, __ret, __aligned, __tm1, __tm2); \
+    POSIX_RW_RECORD_UNREF(shared); \
+} while(0)
+
+#define _POSIX_RECORD_WRITE(__rec_ref, __offset, __ret, __aligned, __tm1, __tm2) do { \
+    int64_t stride; \
+    int64_t file_alignment; \
+    double __elapsed = __tm2-__tm1; \
     /* DXT to record detailed write tracing information */ \
-    dxt_posix_write(rec_ref->file_rec->base_rec.id, this_offset, __ret, __tm1, __tm2); \
+    dxt_posix_write(__rec_ref->file_rec->base_rec.id, __offset, __ret, __tm1, __tm2); \
     /* heatmap to record traffic summary */ \
     heatmap_update(posix_runtime->heatmap_id, HEATMAP_WRITE, __ret, __tm1, __tm2); \
-    if(this_offset > rec_ref->last_byte_written) \
-        rec_ref->file_rec->counters[POSIX_SEQ_WRITES] += 1; \
-    if(this_offset == (rec_ref->last_byte_written + 1)) \
-        rec_ref->file_rec->counters[POSIX_CONSEC_WRITES] += 1; \
-    if(this_offset > 0 && this_offset > rec_ref->last_byte_written \
-        && rec_ref->last_byte_written != 0) \
-        stride = this_offset - rec_ref->last_byte_written - 1; \
-    else \
-        stride = 0; \
-    rec_ref->last_byte_written = this_offset + __ret - 1; \
-    rec_ref->offset = this_offset + __ret; \
-    if(rec_ref->file_rec->counters[POSIX_MAX_BYTE_WRITTEN] < (this_offset + __ret - 1)) \
-        rec_ref->file_rec->counters[POSIX_MAX_BYTE_WRITTEN] = (this_offset + __ret - 1); \
-    rec_ref->file_rec->counters[POSIX_BYTES_WRITTEN] += __ret; \
-    rec_ref->file_rec->counters[POSIX_WRITES] += 1; \
-    DARSHAN_BUCKET_INC(&(rec_ref->file_rec->counters[POSIX_SIZE_WRITE_0_100]), __ret); \
-    cvc = darshan_track_common_val_counters(&rec_ref->access_root, &__ret, 1, \
-        &rec_ref->access_count); \
-    if(cvc) DARSHAN_UPDATE_COMMON_VAL_COUNTERS( \
-        &(rec_ref->file_rec->counters[POSIX_ACCESS1_ACCESS]), \
-        &(rec_ref->file_rec->counters[POSIX_ACCESS1_COUNT]), \
-        cvc->vals, 1, cvc->freq, 0); \
-    cvc = darshan_track_common_val_counters(&rec_ref->stride_root, &stride, 1, \
-        &rec_ref->stride_count); \
-    if(cvc) DARSHAN_UPDATE_COMMON_VAL_COUNTERS( \
-        &(rec_ref->file_rec->counters[POSIX_STRIDE1_STRIDE]), \
-        &(rec_ref->file_rec->counters[POSIX_STRIDE1_COUNT]), \
-        cvc->vals, 1, cvc->freq, 0); \
+    /* access patterns are only tracked per file, see posix_file_record_ref */ \
+    if(!__rec_ref->overflow) { \
+        if(__offset > __rec_ref->writes.last_byte) \
+            __rec_ref->writes.seq += 1; \
+        if(__offset == (__rec_ref->writes.last_byte + 1)) \
+            __rec_ref->writes.consec += 1; \
+        if(__offset > 0 && __offset > __rec_ref->writes.last_byte \
+            && __rec_ref->writes.last_byte != 0) \
+            stride = __offset - __rec_ref->writes.last_byte - 1; \
+        else \
+            stride = 0; \
+        __rec_ref->writes.last_byte = __offset + __ret - 1; \
+        if(!__rec_ref->evicted) { \
+            if(stride != __rec_ref->stride_run) \
+                posix_flush_stride_run(__rec_ref, stride); \
+            __rec_ref->stride_run_count += 1; } \
+    } \
+    if(__ret != __rec_ref->size_run || __rec_ref->last_io_type != DARSHAN_IO_WRITE) \
+        posix_flush_size_run(__rec_ref, __ret); \
+    __rec_ref->size_run_count += 1; \
+    if(__rec_ref->writes.max_byte < (__offset + __ret - 1)) \
+        __rec_ref->writes.max_byte = (__offset + __ret - 1); \
+    __rec_ref->writes.bytes += __ret; \
+    __rec_ref->writes.ops += 1; \
     if(!__aligned) \
-        rec_ref->file_rec->counters[POSIX_MEM_NOT_ALIGNED] += 1; \
-    file_alignment = rec_ref->file_rec->counters[POSIX_FILE_ALIGNMENT]; \
-    if(file_alignment > 0 && (this_offset % file_alignment) != 0) \
-        rec_ref->file_rec->counters[POSIX_FILE_NOT_ALIGNED] += 1; \
-    if(rec_ref->last_io_type == DARSHAN_IO_READ) \
-        rec_ref->file_rec->counters[POSIX_RW_SWITCHES] += 1; \
-    rec_ref->last_io_type = DARSHAN_IO_WRITE; \
-    if(rec_ref->file_rec->fcounters[POSIX_F_WRITE_START_TIMESTAMP] == 0 || \
-     rec_ref->file_rec->fcounters[POSIX_F_WRITE_START_TIMESTAMP] > __tm1) \
-        rec_ref->file_rec->fcounters[POSIX_F_WRITE_START_TIMESTAMP] = __tm1; \
-    rec_ref->file_rec->fcounters[POSIX_F_WRITE_END_TIMESTAMP] = __tm2; \
-    if(rec_ref->file_rec->fcounters[POSIX_F_MAX_WRITE_TIME] < __elapsed) { \
-        rec_ref->file_rec->fcounters[POSIX_F_MAX_WRITE_TIME] = __elapsed; \
-        rec_ref->file_rec->counters[POSIX_MAX_WRITE_TIME_SIZE] = __ret; } \
-    DARSHAN_TIMER_INC_NO_OVERLAP(rec_ref->file_rec->fcounters[POSIX_F_WRITE_TIME], \
-        __tm1, __tm2, rec_ref->last_write_end); \
+        __rec_ref->writes.mem_not_aligned += 1; \
+    file_alignment = __rec_ref->file_alignment; \
+    if(file_alignment > 0 && (__offset % file_alignment) != 0) \
+        __rec_ref->writes.file_not_aligned += 1; \
+    if(__rec_ref->last_io_type == DARSHAN_IO_READ) \
+        __rec_ref->writes.rw_switches += 1; \
+    __rec_ref->last_io_type = DARSHAN_IO_WRITE; \
+    if(__rec_ref->writes.start_time == 0 || __rec_ref->writes.start_time > __tm1) \
+        __rec_ref->writes.start_time = __tm1; \
+    __rec_ref->writes.end_time = __tm2; \
+    if(__rec_ref->writes.max_time < __elapsed) { \
+        __rec_ref->writes.max_time = __elapsed; \
+        __rec_ref->writes.max_time_size = __ret; } \
+    DARSHAN_TIMER_INC_NO_OVERLAP(__rec_ref->writes.time, \
+        __tm1, __tm2, __rec_ref->writes.last_end); \
 } while(0)
 
 #define POSIX_LOOKUP_RECORD_STAT(__path, __statbuf, __tm1, __tm2) do { \
-    darshan_record_id rec_id; \
     struct posix_file_record_ref* rec_ref; \
-    char *newpath = darshan_clean_file_path(__path); \
-    if(!newpath) newpath = (char *)__path; \
-    if(darshan_core_excluded_path(newpath)) { \
-        if(newpath != __path) free(newpath); \
-        break; \
-    } \
-    rec_id = darshan_core_gen_record_id(newpath); \
-    rec_ref = darshan_lookup_record_ref(posix_runtime->rec_id_hash, &rec_id, sizeof(darshan_record_id)); \
-    if(!rec_ref) rec_ref = posix_track_new_file_record(rec_id, newpath); \
-    if(newpath != __path) free(newpath); \
+    char *newpath; \
+    rec_ref = posix_path_record_ref(__path, &newpath); \
     if(rec_ref) { \
         POSIX_RECORD_STAT(rec_ref, __statbuf, __tm1, __tm2); \
     } \
@@ -557,8 +863,7 @@ int DARSHAN_DECL(openat)(int dirfd, const char *pathname, int flags, ...)
     else
     {
         /* construct path relative to dirfd */
-        rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash,
-            &dirfd, sizeof(dirfd));
+        rec_ref = posix_fd_lookup(dirfd);
         if(rec_ref)
         {
             dirpath = darshan_core_lookup_record_name(rec_ref->file_rec->base_rec.id);
@@ -634,8 +939,7 @@ int DARSHAN_DECL(openat64)(int dirfd, const char *pathname, int flags, ...)
     else
     {
         /* construct path relative to dirfd */
-        rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash,
-            &dirfd, sizeof(dirfd));
+        rec_ref = posix_fd_lookup(dirfd);
         if(rec_ref)
         {
             dirpath = darshan_core_lookup_record_name(rec_ref->file_rec->base_rec.id);
@@ -721,8 +1025,7 @@ int DARSHAN_DECL(dup)(int oldfd)
     if(ret >= 0)
     {
         POSIX_PRE_RECORD();
-        rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash,
-            &oldfd, sizeof(oldfd));
+        rec_ref = posix_fd_lookup(oldfd);
         POSIX_RECORD_REFOPEN(ret, rec_ref, tm1, tm2, POSIX_DUPS);
         POSIX_POST_RECORD();
     }
@@ -745,8 +1048,7 @@ int DARSHAN_DECL(dup2)(int oldfd, int newfd)
     if(ret >=0)
     {
         POSIX_PRE_RECORD();
-        rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash,
-            &oldfd, sizeof(oldfd));
+        rec_ref = posix_fd_lookup(oldfd);
         POSIX_RECORD_REFOPEN(ret, rec_ref, tm1, tm2, POSIX_DUPS);
         POSIX_POST_RECORD();
     }
@@ -769,8 +1071,7 @@ int DARSHAN_DECL(dup3)(int oldfd, int newfd, int flags)
     if(ret >=0)
     {
         POSIX_PRE_RECORD();
-        rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash,
-            &oldfd, sizeof(oldfd));
+        rec_ref = posix_fd_lookup(oldfd);
         POSIX_RECORD_REFOPEN(ret, rec_ref, tm1, tm2, POSIX_DUPS);
         POSIX_POST_RECORD();
     }
@@ -897,9 +1198,9 @@ ssize_t DARSHAN_DECL(read)(int fd, void *buf, size_t count)
     ret = __real_read(fd, buf, count);
     tm2 = POSIX_WTIME();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_READ(ret, fd, 0, 0, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -918,9 +1219,9 @@ ssize_t DARSHAN_DECL(write)(int fd, const void *buf, size_t count)
     ret = __real_write(fd, buf, count);
     tm2 = POSIX_WTIME();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_WRITE(ret, fd, 0, 0, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -939,9 +1240,9 @@ ssize_t DARSHAN_DECL(pread)(int fd, void *buf, size_t count, off_t offset)
     ret = __real_pread(fd, buf, count, offset);
     tm2 = POSIX_WTIME();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_READ(ret, fd, 1, offset, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -960,9 +1261,9 @@ ssize_t DARSHAN_DECL(pwrite)(int fd, const void *buf, size_t count, off_t offset
     ret = __real_pwrite(fd, buf, count, offset);
     tm2 = POSIX_WTIME();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_WRITE(ret, fd, 1, offset, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -981,9 +1282,9 @@ ssize_t DARSHAN_DECL(pread64)(int fd, void *buf, size_t count, off64_t offset)
     ret = __real_pread64(fd, buf, count, offset);
     tm2 = POSIX_WTIME();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_READ(ret, fd, 1, offset, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -1002,9 +1303,9 @@ ssize_t DARSHAN_DECL(pwrite64)(int fd, const void *buf, size_t count, off64_t of
     ret = __real_pwrite64(fd, buf, count, offset);
     tm2 = POSIX_WTIME();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_WRITE(ret, fd, 1, offset, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -1028,9 +1329,9 @@ ssize_t DARSHAN_DECL(readv)(int fd, const struct iovec *iov, int iovcnt)
     ret = __real_readv(fd, iov, iovcnt);
     tm2 = POSIX_WTIME();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_READ(ret, fd, 0, 0, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -1055,9 +1356,9 @@ ssize_t DARSHAN_DECL(preadv)(int fd, const struct iovec *iov, int iovcnt, off_t
     ret = __real_preadv(fd, iov, iovcnt, offset);
     tm2 = POSIX_WTIME();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_READ(ret, fd, 1, offset, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -1081,9 +1382,9 @@ ssize_t DARSHAN_DECL(preadv64)(int fd, const struct iovec *iov, int iovcnt, off6
     ret = __real_preadv64(fd, iov, iovcnt, offset);
     tm2 = POSIX_WTIME();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_READ(ret, fd, 1, offset, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -1110,9 +1411,9 @@ ssize_t DARSHAN_DECL(preadv2)(int fd, const struct iovec *iov, int iovcnt, off_t
     ret = __real_preadv2(fd, iov, iovcnt, offset, flags);
     tm2 = POSIX_WTIME();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_READ(ret, fd, 1, offset, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -1136,9 +1437,9 @@ ssize_t DARSHAN_DECL(preadv64v2)(int fd, const struct iovec *iov, int iovcnt, of
     ret = __real_preadv64v2(fd, iov, iovcnt, offset, flags);
     tm2 = POSIX_WTIME();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_READ(ret, fd, 1, offset, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -1163,9 +1464,9 @@ ssize_t DARSHAN_DECL(writev)(int fd, const struct iovec *iov, int iovcnt)
     ret = __real_writev(fd, iov, iovcnt);
     tm2 = POSIX_WTIME();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_WRITE(ret, fd, 0, 0, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -1190,9 +1491,9 @@ ssize_t DARSHAN_DECL(pwritev)(int fd, const struct iovec *iov, int iovcnt, off_t
     ret = __real_pwritev(fd, iov, iovcnt, offset);
     tm2 = POSIX_WTIME();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_WRITE(ret, fd, 1, offset, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -1216,9 +1517,9 @@ ssize_t DARSHAN_DECL(pwritev64)(int fd, const struct iovec *iov, int iovcnt, off
     ret = __real_pwritev64(fd, iov, iovcnt, offset);
     tm2 = POSIX_WTIME();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_WRITE(ret, fd, 1, offset, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -1244,9 +1545,9 @@ ssize_t DARSHAN_DECL(pwritev2)(int fd, const struct iovec *iov, int iovcnt, off_
     ret = __real_pwritev2(fd, iov, iovcnt, offset, flags);
     tm2 = POSIX_WTIME();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_WRITE(ret, fd, 1, offset, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -1270,9 +1571,9 @@ ssize_t DARSHAN_DECL(pwritev64v2)(int fd, const struct iovec *iov, int iovcnt, o
     ret = __real_pwritev64v2(fd, iov, iovcnt, offset, flags);
     tm2 = POSIX_WTIME();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_WRITE(ret, fd, 1, offset, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -1294,10 +1595,10 @@ off_t DARSHAN_DECL(lseek)(int fd, off_t offset, int whence)
     if(ret >= 0)
     {
         POSIX_PRE_RECORD();
-        rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+        rec_ref = posix_fd_lookup(fd);
         if(rec_ref)
         {
-            rec_ref->offset = ret;
+            POSIX_OFFSET_SET(rec_ref, ret);
             DARSHAN_TIMER_INC_NO_OVERLAP(
                 rec_ref->file_rec->fcounters[POSIX_F_META_TIME],
                 tm1, tm2, rec_ref->last_meta_end);
@@ -1324,10 +1625,10 @@ off64_t DARSHAN_DECL(lseek64)(int fd, off64_t offset, int whence)
     if(ret >= 0)
     {
         POSIX_PRE_RECORD();
-        rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+        rec_ref = posix_fd_lookup(fd);
         if(rec_ref)
         {
-            rec_ref->offset = ret;
+            POSIX_OFFSET_SET(rec_ref, ret);
             DARSHAN_TIMER_INC_NO_OVERLAP(
                 rec_ref->file_rec->fcounters[POSIX_F_META_TIME],
                 tm1, tm2, rec_ref->last_meta_end);
@@ -1439,7 +1740,7 @@ int DARSHAN_DECL(__fxstat)(int vers, int fd, struct stat *buf)
         return(ret);
 
     POSIX_PRE_RECORD();
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+    rec_ref = posix_fd_lookup(fd);
     if(rec_ref)
     {
         POSIX_RECORD_STAT(rec_ref, buf, tm1, tm2);
@@ -1465,7 +1766,7 @@ int DARSHAN_DECL(__fxstat64)(int vers, int fd, struct stat64 *buf)
         return(ret);
 
     POSIX_PRE_RECORD();
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+    rec_ref = posix_fd_lookup(fd);
     if(rec_ref)
     {
         POSIX_RECORD_STAT(rec_ref, buf, tm1, tm2);
@@ -1498,7 +1799,7 @@ void* DARSHAN_DECL(mmap)(void *addr, size_t length, int prot, int flags,
         return(ret);
 
     POSIX_PRE_RECORD();
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+    rec_ref = posix_fd_lookup(fd);
     if(rec_ref)
     {
         rec_ref->file_rec->counters[POSIX_MMAPS] += 1;
@@ -1531,7 +1832,7 @@ void* DARSHAN_DECL(mmap64)(void *addr, size_t length, int prot, int flags,
         return(ret);
 
     POSIX_PRE_RECORD();
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+    rec_ref = posix_fd_lookup(fd);
     if(rec_ref)
     {
         rec_ref->file_rec->counters[POSIX_MMAPS] += 1;
@@ -1558,12 +1859,13 @@ int DARSHAN_DECL(fsync)(int fd)
         return(ret);
 
     POSIX_PRE_RECORD();
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+    rec_ref = posix_fd_lookup(fd);
     if(rec_ref)
     {
-        DARSHAN_TIMER_INC_NO_OVERLAP(
-            rec_ref->file_rec->fcounters[POSIX_F_WRITE_TIME],
-            tm1, tm2, rec_ref->last_write_end);
+        if(posix_event_queue)
+            posix_drain_events();
+        DARSHAN_TIMER_INC_NO_OVERLAP(rec_ref->writes.time,
+            tm1, tm2, rec_ref->writes.last_end);
         rec_ref->file_rec->counters[POSIX_FSYNCS] += 1;
     }
     POSIX_POST_RECORD();
@@ -1587,12 +1889,13 @@ int DARSHAN_DECL(fdatasync)(int fd)
         return(ret);
 
     POSIX_PRE_RECORD();
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+    rec_ref = posix_fd_lookup(fd);
     if(rec_ref)
     {
-        DARSHAN_TIMER_INC_NO_OVERLAP(
-            rec_ref->file_rec->fcounters[POSIX_F_WRITE_TIME],
-            tm1, tm2, rec_ref->last_write_end);
+        if(posix_event_queue)
+            posix_drain_events();
+        DARSHAN_TIMER_INC_NO_OVERLAP(rec_ref->writes.time,
+            tm1, tm2, rec_ref->writes.last_end);
         rec_ref->file_rec->counters[POSIX_FDSYNCS] += 1;
     }
     POSIX_POST_RECORD();
@@ -1613,11 +1916,17 @@ int DARSHAN_DECL(close)(int fd)
     tm2 = POSIX_WTIME();
 
     POSIX_PRE_RECORD();
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+    rec_ref = posix_fd_lookup(fd);
     if(rec_ref)
     {
-        rec_ref->last_byte_written = 0;
-        rec_ref->last_byte_read = 0;
+        /* record any operations still queued before resetting the access
+         * pattern state
+         */
+        if(posix_event_queue)
+            posix_drain_events();
+        rec_ref->writes.last_byte = 0;
+        rec_ref->reads.last_byte = 0;
+        rec_ref->reset_count++;
         if(rec_ref->file_rec->fcounters[POSIX_F_CLOSE_START_TIMESTAMP] == 0 ||
          rec_ref->file_rec->fcounters[POSIX_F_CLOSE_START_TIMESTAMP] > tm1)
            rec_ref->file_rec->fcounters[POSIX_F_CLOSE_START_TIMESTAMP] = tm1;
@@ -1625,7 +1934,9 @@ int DARSHAN_DECL(close)(int fd)
         DARSHAN_TIMER_INC_NO_OVERLAP(
             rec_ref->file_rec->fcounters[POSIX_F_META_TIME],
             tm1, tm2, rec_ref->last_meta_end);
-        darshan_delete_record_ref(&(posix_runtime->fd_hash), &fd, sizeof(int));
+        POSIX_SHARD_WRLOCK();
+        posix_fd_delete(fd);
+        POSIX_SHARD_WRUNLOCK();
     }
     POSIX_POST_RECORD();
 
@@ -1897,6 +2208,40 @@ int DARSHAN_DECL(rename)(const char *oldpath, const char *newpath)
     return(ret);
 }
 
+int DARSHAN_DECL(chdir)(const char *path)
+{
+    int ret;
+
+    MAP_OR_FAIL(chdir);
+
+    ret = __real_chdir(path);
+    if(ret == 0 && !__darshan_disabled)
+    {
+        POSIX_LOCK();
+        posix_cwd_generation++;
+        POSIX_UNLOCK();
+    }
+
+    return(ret);
+}
+
+int DARSHAN_DECL(fchdir)(int fd)
+{
+    int ret;
+
+    MAP_OR_FAIL(fchdir);
+
+    ret = __real_fchdir(fd);
+    if(ret == 0 && !__darshan_disabled)
+    {
+        POSIX_LOCK();
+        posix_cwd_generation++;
+        POSIX_UNLOCK();
+    }
+
+    return(ret);
+}
+
 /**********************************************************
  * Internal functions for manipulating POSIX module state *
  **********************************************************/
@@ -1905,9 +2250,15 @@ int DARSHAN_DECL(rename)(const char *oldpath, const char *newpath)
 static void posix_runtime_initialize()
 {
     size_t psx_buf_size;
+    struct posix_runtime *tmp_runtime;
+#ifdef HAVE_STDATOMIC_H
+    char *envstr;
+#endif
+    long drain_interval = 0;
     darshan_module_funcs mod_funcs = {
 #ifdef HAVE_MPI
         .mod_redux_func = &posix_mpi_redux,
+        .mod_redux_partial = 1,
 #endif
         .mod_output_func = &posix_output,
         .mod_cleanup_func = &posix_cleanup
@@ -1924,19 +2275,57 @@ static void posix_runtime_initialize()
         &my_rank,
         &darshan_mem_alignment);
 
-    posix_runtime = malloc(sizeof(*posix_runtime));
-    if(!posix_runtime)
+    tmp_runtime = malloc(sizeof(*tmp_runtime));
+    if(!tmp_runtime)
     {
         darshan_core_unregister_module(DARSHAN_POSIX_MOD);
         return;
     }
-    memset(posix_runtime, 0, sizeof(*posix_runtime));
+    memset(tmp_runtime, 0, sizeof(*tmp_runtime));
 
     /* allow DXT module to initialize if needed */
     dxt_posix_runtime_initialize();
 
     /* register a heatmap */
-    posix_runtime->heatmap_id = heatmap_register("heatmap:POSIX");
+    tmp_runtime->heatmap_id = heatmap_register("heatmap:POSIX");
+
+    /* check whether read/write counters should be kept in per-thread shards
+     * rather than being serialized on the POSIX module lock
+     */
+    if(getenv("DARSHAN_POSIX_SHARDED"))
+        posix_sharded = 1;
+    tmp_runtime->shard_epoch = ++posix_shard_epoch_counter;
+
+    /* thread shards may use as much memory as darshan-core initially
+     * granted to the module's records; threads record in the shared file
+     * records once it is used up
+     */
+    tmp_runtime->shard_mem_limit = psx_buf_size;
+    tmp_runtime->shard_mem_avail = psx_buf_size;
+
+    /* check whether read/write wrappers should just queue events to be
+     * recorded later. The value optionally gives the interval (in
+     * milliseconds) at which a helper thread records queued events.
+     * Wrappers queue events holding only the shard lock, so this mode
+     * implies sharded mode.
+     */
+#ifdef HAVE_STDATOMIC_H
+    envstr = getenv("DARSHAN_POSIX_EVENT_QUEUE");
+    if(envstr)
+    {
+        posix_event_queue = 1;
+        posix_sharded = 1;
+        drain_interval = strtol(envstr, NULL, 10);
+    }
+#endif
+    tmp_runtime->queue_epoch = ++posix_shard_epoch_counter;
+
+    POSIX_SHARD_WRLOCK();
+    posix_runtime = tmp_runtime;
+    POSIX_SHARD_WRUNLOCK();
+
+    if(posix_event_queue && drain_interval > 0)
+        posix_start_event_drain_thread(drain_interval);
 
     return;
 }
@@ -1947,10 +2336,11 @@ static struct posix_file_record_ref *posix_track_new_file_record(
     struct darshan_posix_file *file_rec = NULL;
     struct posix_file_record_ref *rec_ref = NULL;
     struct darshan_fs_info fs_info;
+    int evicted = 0;
     int ret;
 
-    rec_ref = malloc(sizeof(*rec_ref));
-    if(!rec_ref)
+    if(posix_memalign((void **)&rec_ref, DARSHAN_CACHE_LINE_SIZE,
+        sizeof(*rec_ref)) != 0)
         return(NULL);
     memset(rec_ref, 0, sizeof(*rec_ref));
 
@@ -1973,12 +2363,24 @@ static struct posix_file_record_ref *posix_track_new_file_record(
         sizeof(struct darshan_posix_file),
         &fs_info);
 
+    /* if there is no memory left for this record, make room for it by
+     * evicting another record if darshan-core allows it
+     */
+    if(!file_rec && darshan_core_record_overflow_policy() ==
+        DARSHAN_RECORD_OVERFLOW_EVICT)
+    {
+        file_rec = posix_evict_file_record(rec_id, path, &fs_info);
+        evicted = (file_rec != NULL);
+    }
+
     if(!file_rec)
     {
         darshan_delete_record_ref(&(posix_runtime->rec_id_hash),
             &rec_id, sizeof(darshan_record_id));
         free(rec_ref);
-        return(NULL);
+
+        /* fall back to accounting this file to its overflow record */
+        return(posix_track_overflow_record(rec_id, path));
     }
 
     /* registering this file record was successful, so initialize some fields */
@@ -1986,390 +2388,1154 @@ static struct posix_file_record_ref *posix_track_new_file_record(
     file_rec->base_rec.rank = my_rank;
     file_rec->counters[POSIX_MEM_ALIGNMENT] = darshan_mem_alignment;
     file_rec->counters[POSIX_FILE_ALIGNMENT] = fs_info.block_size;
+    rec_ref->file_alignment = fs_info.block_size;
 #ifndef DARSHAN_WRAP_MMAP
     /* set invalid value here if MMAP instrumentation is disabled */
     file_rec->counters[POSIX_MMAPS] = -1;
 #endif /* undefined DARSHAN_WRAP_MMAP */
     rec_ref->fs_type = fs_info.fs_type;
     rec_ref->file_rec = file_rec;
-    posix_runtime->file_rec_count++;
+    if(!posix_runtime->first_rec)
+        posix_runtime->first_rec = file_rec;
+    if(!evicted)
+        posix_runtime->file_rec_count++;
 
     return(rec_ref);
 }
 
-/* finds the tracker structure for a given aio operation, removes it from
- * the associated linked list for this file record, and returns a pointer.  
- *
- * returns NULL if aio operation not found
+/* returns the reference to the overflow record that the file 'file_rec_id'
+ * at 'path' is accounted to when it can't be tracked individually,
+ * registering the overflow record if needed
  */
-static struct posix_aio_tracker* posix_aio_tracker_del(int fd, void *aiocbp)
+static struct posix_file_record_ref *posix_track_overflow_record(
+    darshan_record_id file_rec_id, const char *path)
 {
-    struct posix_aio_tracker *tracker = NULL, *iter, *tmp;
+    struct darshan_posix_file *file_rec;
     struct posix_file_record_ref *rec_ref;
+    struct darshan_fs_info fs_info;
+    darshan_record_id rec_id;
+    int ret;
+
+    file_rec = darshan_core_register_overflow_record(
+        file_rec_id,
+        path,
+        DARSHAN_POSIX_MOD,
+        sizeof(struct darshan_posix_file),
+        &rec_id,
+        &fs_info);
+    if(!file_rec)
+        return(NULL);
 
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+    rec_ref = darshan_lookup_record_ref(posix_runtime->rec_id_hash,
+        &rec_id, sizeof(darshan_record_id));
     if(rec_ref)
+        return(rec_ref);
+
+    if(posix_memalign((void **)&rec_ref, DARSHAN_CACHE_LINE_SIZE,
+        sizeof(*rec_ref)) != 0)
+        return(NULL);
+    memset(rec_ref, 0, sizeof(*rec_ref));
+
+    ret = darshan_add_record_ref(&(posix_runtime->rec_id_hash), &rec_id,
+        sizeof(darshan_record_id), rec_ref);
+    if(ret == 0)
     {
-        LL_FOREACH_SAFE(rec_ref->aio_list, iter, tmp)
-        {
-            if(iter->aiocbp == aiocbp)
-            {
-                LL_DELETE(rec_ref->aio_list, iter);
-                tracker = iter;
-                break;
-            }
-        }
+        free(rec_ref);
+        return(NULL);
     }
 
-    return(tracker);
+    file_rec->base_rec.id = rec_id;
+    file_rec->base_rec.rank = my_rank;
+    file_rec->counters[POSIX_MEM_ALIGNMENT] = darshan_mem_alignment;
+    file_rec->counters[POSIX_FILE_ALIGNMENT] = fs_info.block_size;
+    rec_ref->file_alignment = fs_info.block_size;
+#ifndef DARSHAN_WRAP_MMAP
+    file_rec->counters[POSIX_MMAPS] = -1;
+#endif /* undefined DARSHAN_WRAP_MMAP */
+    rec_ref->fs_type = fs_info.fs_type;
+    rec_ref->file_rec = file_rec;
+    rec_ref->overflow = 1;
+    if(!posix_runtime->first_rec)
+        posix_runtime->first_rec = file_rec;
+    posix_runtime->file_rec_count++;
+
+    return(rec_ref);
 }
 
-/* adds a tracker for the given aio operation */
-static void posix_aio_tracker_add(int fd, void *aiocbp)
+/* evicts a file record with little traffic into the overflow record for
+ * its mount point, and hands its memory over to the new record 'rec_id'
+ * for the file at 'path'. Candidates are sampled from a few consecutive
+ * records, continuing where the previous eviction left off. Returns the
+ * (zeroed) memory for the new record, or NULL if no record was evicted.
+ * 'fs_info' is set as for darshan_core_register_record().
+ */
+static struct darshan_posix_file *posix_evict_file_record(
+    darshan_record_id rec_id, const char *path,
+    struct darshan_fs_info *fs_info)
 {
-    struct posix_aio_tracker* tracker;
-    struct posix_file_record_ref *rec_ref;
+    struct posix_file_record_ref *rec_ref, *victim_ref = NULL;
+    struct posix_file_record_ref *overflow_ref;
+    struct darshan_posix_file *file_rec;
+    char *victim_name;
+    int64_t traffic, victim_traffic = 0;
+    int i;
 
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
-    if(rec_ref)
+    if(!posix_runtime->first_rec)
+        return(NULL);
+
+    if(posix_event_queue)
+        posix_drain_events();
+
+    /* NOTE: in sharded mode, read/write counters that haven't been folded
+     * from thread shards yet are not considered
+     */
+    for(i = 0; i < POSIX_EVICT_SAMPLE_COUNT &&
+        i < posix_runtime->file_rec_count; i++)
     {
-        tracker = malloc(sizeof(*tracker));
-        if(tracker)
+        if(posix_runtime->evict_ndx >= posix_runtime->file_rec_count)
+            posix_runtime->evict_ndx = 0;
+        file_rec = &posix_runtime->first_rec[posix_runtime->evict_ndx++];
+
+        rec_ref = darshan_lookup_record_ref(posix_runtime->rec_id_hash,
+            &file_rec->base_rec.id, sizeof(darshan_record_id));
+        if(!rec_ref || rec_ref->overflow || rec_ref->file_rec != file_rec)
+            continue;
+
+        traffic = file_rec->counters[POSIX_OPENS] +
+            file_rec->counters[POSIX_READS] + file_rec->counters[POSIX_WRITES] +
+            rec_ref->reads.ops + rec_ref->writes.ops +
+            file_rec->counters[POSIX_SEEKS] + file_rec->counters[POSIX_STATS];
+        if(!victim_ref || traffic < victim_traffic)
         {
-            tracker->tm1 = darshan_core_wtime();
-            tracker->aiocbp = aiocbp;
-            LL_PREPEND(rec_ref->aio_list, tracker);
+            victim_ref = rec_ref;
+            victim_traffic = traffic;
         }
     }
+    if(!victim_ref)
+        return(NULL);
 
-    return;
-}
+    victim_name = darshan_core_lookup_record_name(
+        victim_ref->file_rec->base_rec.id);
+    if(!victim_name)
+        return(NULL);
+    overflow_ref = posix_track_overflow_record(
+        victim_ref->file_rec->base_rec.id, victim_name);
+    if(!overflow_ref)
+        return(NULL);
+    if(!darshan_core_replace_record(victim_ref->file_rec->base_rec.id,
+        rec_id, path, DARSHAN_POSIX_MOD, fs_info))
+        return(NULL);
 
-static void posix_finalize_file_records(void *rec_ref_p, void *user_ptr)
+    /* readers in sharded mode may be consulting the victim's record */
+    POSIX_SHARD_WRLOCK();
+    file_rec = victim_ref->file_rec;
+    posix_flush_access_runs(victim_ref);
+    posix_fold_rw_counters(file_rec, &victim_ref->reads, 0);
+    posix_fold_rw_counters(file_rec, &victim_ref->writes, 1);
+    posix_record_merge(file_rec, overflow_ref->file_rec);
+    victim_ref->file_rec = overflow_ref->file_rec;
+    victim_ref->evicted = 1;
+    memset(&victim_ref->access_table, 0, sizeof(victim_ref->access_table));
+    memset(&victim_ref->stride_table, 0, sizeof(victim_ref->stride_table));
+    memset(file_rec, 0, sizeof(*file_rec));
+    POSIX_SHARD_WRUNLOCK();
+
+    return(file_rec);
+}
+
+/* returns the file record reference for the given path, or NULL if the path
+ * is excluded from instrumentation or can't be tracked. Must be called
+ * holding the POSIX lock. The cleaned version
+ * of the path is returned in newpath_p, and remains valid until the next
+ * call. Paths are resolved through a cache keyed on the raw path string;
+ * relative path entries are only valid for the cwd generation they were
+ * resolved in.
+ */
+static struct posix_file_record_ref *posix_path_record_ref(
+    const char *path, char **newpath_p)
 {
-    struct posix_file_record_ref *rec_ref =
-        (struct posix_file_record_ref *)rec_ref_p;
-
-    tdestroy(rec_ref->access_root, free);
-    tdestroy(rec_ref->stride_root, free);
-    return;
-}
+    struct posix_path_cache_entry *entry;
+    struct posix_file_record_ref *rec_ref = NULL;
+    darshan_record_id rec_id;
+    char *newpath;
+    size_t path_len;
+    int cwd_generation = -1;
+    int excluded;
+    int ret;
 
-#ifdef HAVE_MPI
-static void posix_record_reduction_op(void* infile_v, void* inoutfile_v,
-    int *len, MPI_Datatype *datatype)
-{
-    struct darshan_posix_file tmp_file;
-    struct darshan_posix_file *infile = infile_v;
-    struct darshan_posix_file *inoutfile = inoutfile_v;
-    int i, j, k;
+    if(!path)
+        return(NULL);
+    path_len = strlen(path);
+    if(path[0] != '/')
+        cwd_generation = posix_cwd_generation;
 
-    for(i=0; i<*len; i++)
+    entry = darshan_lookup_record_ref(posix_runtime->path_cache_hash,
+        (void *)path, path_len);
+    if(entry)
     {
-        memset(&tmp_file, 0, sizeof(struct darshan_posix_file));
-        tmp_file.base_rec.id = infile->base_rec.id;
-        tmp_file.base_rec.rank = -1;
-
-        /* sum */
-        for(j=POSIX_OPENS; j<=POSIX_RENAME_TARGETS; j++)
+        if(entry->cwd_generation == cwd_generation)
         {
-            tmp_file.counters[j] = infile->counters[j] + inoutfile->counters[j];
-            if(tmp_file.counters[j] < 0) /* make sure invalid counters are -1 exactly */
-                tmp_file.counters[j] = -1;
+            *newpath_p = entry->newpath;
+            return(entry->rec_ref);
         }
 
-        tmp_file.counters[POSIX_RENAMED_FROM] = infile->counters[POSIX_RENAMED_FROM];
-        tmp_file.counters[POSIX_MODE] = infile->counters[POSIX_MODE];
+        /* stale relative path, resolve it again */
+        darshan_delete_record_ref(&(posix_runtime->path_cache_hash),
+            (void *)path, path_len);
+        free(entry);
+        posix_runtime->path_cache_count--;
+    }
 
-        /* sum */
-        for(j=POSIX_BYTES_READ; j<=POSIX_BYTES_WRITTEN; j++)
+    newpath = darshan_clean_file_path(path);
+    if(!newpath) newpath = (char *)path;
+    excluded = darshan_core_excluded_path(newpath);
+    if(!excluded)
+    {
+        rec_id = darshan_core_gen_record_id(newpath);
+        rec_ref = darshan_lookup_record_ref(posix_runtime->rec_id_hash,
+            &rec_id, sizeof(darshan_record_id));
+        if(!rec_ref) rec_ref = posix_track_new_file_record(rec_id, newpath);
+        if(!rec_ref)
         {
-            tmp_file.counters[j] = infile->counters[j] + inoutfile->counters[j];
+            /* don't cache failures to track the record */
+            if(newpath != path) free(newpath);
+            return(NULL);
         }
+    }
 
-        /* max */
-        for(j=POSIX_MAX_BYTE_READ; j<=POSIX_MAX_BYTE_WRITTEN; j++)
-        {
-            tmp_file.counters[j] = (
-                (infile->counters[j] > inoutfile->counters[j]) ?
-                infile->counters[j] :
-                inoutfile->counters[j]);
-        }
+    if(posix_runtime->path_cache_count >= POSIX_PATH_CACHE_MAX)
+    {
+        darshan_clear_record_refs(&(posix_runtime->path_cache_hash), 1);
+        posix_runtime->path_cache_count = 0;
+    }
 
-        /* sum */
-        for(j=POSIX_CONSEC_READS; j<=POSIX_MEM_NOT_ALIGNED; j++)
+    /* allocate the cache entry and the cleaned path together */
+    entry = malloc(sizeof(*entry) + strlen(newpath) + 1);
+    if(entry)
+    {
+        entry->rec_ref = rec_ref;
+        entry->cwd_generation = cwd_generation;
+        entry->newpath = (char *)entry + sizeof(*entry);
+        strcpy(entry->newpath, newpath);
+        ret = darshan_add_record_ref(&(posix_runtime->path_cache_hash),
+            (void *)path, path_len, entry);
+        if(ret == 0)
         {
-            tmp_file.counters[j] = infile->counters[j] + inoutfile->counters[j];
+            free(entry);
+            entry = NULL;
         }
+        else
+            posix_runtime->path_cache_count++;
+    }
+    if(newpath != path) free(newpath);
+    if(!entry)
+        return(NULL);
 
-        tmp_file.counters[POSIX_MEM_ALIGNMENT] = infile->counters[POSIX_MEM_ALIGNMENT];
+    *newpath_p = entry->newpath;
+    return(rec_ref);
+}
 
-        /* sum */
-        for(j=POSIX_FILE_NOT_ALIGNED; j<=POSIX_FILE_NOT_ALIGNED; j++)
-        {
-            tmp_file.counters[j] = infile->counters[j] + inoutfile->counters[j];
-        }
+/* associates the given fd with a file record reference, replacing any
+ * existing association for the fd (e.g., if it was reused via dup2 or
+ * if its close was not intercepted)
+ */
+static void posix_fd_add(int fd, struct posix_file_record_ref *rec_ref)
+{
+    struct posix_file_record_ref ***fd_page_p;
 
-        tmp_file.counters[POSIX_FILE_ALIGNMENT] = infile->counters[POSIX_FILE_ALIGNMENT];
+    if(fd < 0)
+        return;
+    if(fd >= POSIX_FD_TABLE_MAX)
+    {
+        darshan_delete_record_ref(&(posix_runtime->fd_hash), &fd, sizeof(int));
+        darshan_add_record_ref(&(posix_runtime->fd_hash), &fd, sizeof(int), rec_ref);
+        return;
+    }
 
-        /* skip POSIX_MAX_*_TIME_SIZE; handled in floating point section */
+    fd_page_p = &(posix_runtime->fd_pages[fd / POSIX_FD_PAGE_SIZE]);
+    if(!(*fd_page_p))
+    {
+        *fd_page_p = calloc(POSIX_FD_PAGE_SIZE, sizeof(**fd_page_p));
+        if(!(*fd_page_p))
+            return;
+    }
+    (*fd_page_p)[fd % POSIX_FD_PAGE_SIZE] = rec_ref;
 
-        for(j=POSIX_SIZE_READ_0_100; j<=POSIX_SIZE_WRITE_1G_PLUS; j++)
-        {
-            tmp_file.counters[j] = infile->counters[j] + inoutfile->counters[j];
-        }
+    return;
+}
 
-        /* first collapse any duplicates */
-        for(j=POSIX_STRIDE1_STRIDE; j<=POSIX_STRIDE4_STRIDE; j++)
-        {
-            for(k=POSIX_STRIDE1_STRIDE; k<=POSIX_STRIDE4_STRIDE; k++)
-            {
-                if(infile->counters[j] == inoutfile->counters[k])
-                {
-                    infile->counters[j+4] += inoutfile->counters[k+4];
-                    inoutfile->counters[k] = 0;
-                    inoutfile->counters[k+4] = 0;
-                }
-            }
-        }
+/* removes any file record reference associated with the given fd */
+static void posix_fd_delete(int fd)
+{
+    struct posix_file_record_ref **fd_page;
 
-        /* first set */
-        for(j=POSIX_STRIDE1_STRIDE; j<=POSIX_STRIDE4_STRIDE; j++)
-        {
-            DARSHAN_UPDATE_COMMON_VAL_COUNTERS(
-                &(tmp_file.counters[POSIX_STRIDE1_STRIDE]),
-                &(tmp_file.counters[POSIX_STRIDE1_COUNT]),
-                &infile->counters[j], 1, infile->counters[j+4], 1);
-        }
-        /* second set */
-        for(j=POSIX_STRIDE1_STRIDE; j<=POSIX_STRIDE4_STRIDE; j++)
-        {
-            DARSHAN_UPDATE_COMMON_VAL_COUNTERS(
-                &(tmp_file.counters[POSIX_STRIDE1_STRIDE]),
-                &(tmp_file.counters[POSIX_STRIDE1_COUNT]),
-                &inoutfile->counters[j], 1, inoutfile->counters[j+4], 1);
-        }
+    if(fd < 0)
+        return;
+    if(fd >= POSIX_FD_TABLE_MAX)
+    {
+        darshan_delete_record_ref(&(posix_runtime->fd_hash), &fd, sizeof(int));
+        return;
+    }
+
+    fd_page = posix_runtime->fd_pages[fd / POSIX_FD_PAGE_SIZE];
+    if(fd_page)
+        fd_page[fd % POSIX_FD_PAGE_SIZE] = NULL;
+
+    return;
+}
+
+/* removes all fd associations and frees the fd table */
+static void posix_fd_clear()
+{
+    int i;
+
+    for(i = 0; i < POSIX_FD_MAX_PAGES; i++)
+    {
+        free(posix_runtime->fd_pages[i]);
+        posix_runtime->fd_pages[i] = NULL;
+    }
+    darshan_clear_record_refs(&(posix_runtime->fd_hash), 0);
+
+    return;
+}
 
-        /* same for access counts */
+/* finds the tracker structure for a given aio operation, removes it from
+ * the associated linked list for this file record, and returns a pointer.  
+ *
+ * returns NULL if aio operation not found
+ */
+static struct posix_aio_tracker* posix_aio_tracker_del(int fd, void *aiocbp)
+{
+    struct posix_aio_tracker *tracker = NULL, *iter, *tmp;
+    struct posix_file_record_ref *rec_ref;
 
-        /* first collapse any duplicates */
-        for(j=POSIX_ACCESS1_ACCESS; j<=POSIX_ACCESS4_ACCESS; j++)
+    rec_ref = posix_fd_lookup(fd);
+    if(rec_ref)
+    {
+        LL_FOREACH_SAFE(rec_ref->aio_list, iter, tmp)
         {
-            for(k=POSIX_ACCESS1_ACCESS; k<=POSIX_ACCESS4_ACCESS; k++)
+            if(iter->aiocbp == aiocbp)
             {
-                if(infile->counters[j] == inoutfile->counters[k])
-                {
-                    infile->counters[j+4] += inoutfile->counters[k+4];
-                    inoutfile->counters[k] = 0;
-                    inoutfile->counters[k+4] = 0;
-                }
+                LL_DELETE(rec_ref->aio_list, iter);
+                tracker = iter;
+                break;
             }
         }
+    }
 
-        /* first set */
-        for(j=POSIX_ACCESS1_ACCESS; j<=POSIX_ACCESS4_ACCESS; j++)
-        {
-            DARSHAN_UPDATE_COMMON_VAL_COUNTERS(
-                &(tmp_file.counters[POSIX_ACCESS1_ACCESS]),
-                &(tmp_file.counters[POSIX_ACCESS1_COUNT]),
-                &infile->counters[j], 1, infile->counters[j+4], 1);
-        }
-        /* second set */
-        for(j=POSIX_ACCESS1_ACCESS; j<=POSIX_ACCESS4_ACCESS; j++)
-        {
-            DARSHAN_UPDATE_COMMON_VAL_COUNTERS(
-                &(tmp_file.counters[POSIX_ACCESS1_ACCESS]),
-                &(tmp_file.counters[POSIX_ACCESS1_COUNT]),
-                &inoutfile->counters[j], 1, inoutfile->counters[j+4], 1);
-        }
+    return(tracker);
+}
 
-        /* min non-zero (if available) value */
-        for(j=POSIX_F_OPEN_START_TIMESTAMP; j<=POSIX_F_CLOSE_START_TIMESTAMP; j++)
-        {
-            if((infile->fcounters[j] < inoutfile->fcounters[j] &&
-               infile->fcounters[j] > 0) || inoutfile->fcounters[j] == 0)
-                tmp_file.fcounters[j] = infile->fcounters[j];
-            else
-                tmp_file.fcounters[j] = inoutfile->fcounters[j];
-        }
+/* adds a tracker for the given aio operation */
+static void posix_aio_tracker_add(int fd, void *aiocbp)
+{
+    struct posix_aio_tracker* tracker;
+    struct posix_file_record_ref *rec_ref;
 
-        /* max */
-        for(j=POSIX_F_OPEN_END_TIMESTAMP; j<=POSIX_F_CLOSE_END_TIMESTAMP; j++)
+    rec_ref = posix_fd_lookup(fd);
+    if(rec_ref)
+    {
+        tracker = malloc(sizeof(*tracker));
+        if(tracker)
         {
-            if(infile->fcounters[j] > inoutfile->fcounters[j])
-                tmp_file.fcounters[j] = infile->fcounters[j];
-            else
-                tmp_file.fcounters[j] = inoutfile->fcounters[j];
+            tracker->tm1 = darshan_core_wtime();
+            tracker->aiocbp = aiocbp;
+            LL_PREPEND(rec_ref->aio_list, tracker);
         }
+    }
 
-        /* sum */
-        for(j=POSIX_F_READ_TIME; j<=POSIX_F_META_TIME; j++)
-        {
-            tmp_file.fcounters[j] = infile->fcounters[j] + inoutfile->fcounters[j];
-        }
+    return;
+}
 
-        /* max (special case) */
-        if(infile->fcounters[POSIX_F_MAX_READ_TIME] >
-            inoutfile->fcounters[POSIX_F_MAX_READ_TIME])
-        {
-            tmp_file.fcounters[POSIX_F_MAX_READ_TIME] =
-                infile->fcounters[POSIX_F_MAX_READ_TIME];
-            tmp_file.counters[POSIX_MAX_READ_TIME_SIZE] =
-                infile->counters[POSIX_MAX_READ_TIME_SIZE];
-        }
+/* discard the common access and stride values that thread shards created
+ * before a file was evicted have folded into its reference, so that they
+ * are not counted in the overflow record it was evicted to
+ */
+static void posix_clear_evicted_file_records(void *rec_ref_p, void *user_ptr)
+{
+    struct posix_file_record_ref *rec_ref =
+        (struct posix_file_record_ref *)rec_ref_p;
+
+    if(!rec_ref->evicted)
+        return;
+
+    memset(&rec_ref->access_table, 0, sizeof(rec_ref->access_table));
+    memset(&rec_ref->stride_table, 0, sizeof(rec_ref->stride_table));
+
+    return;
+}
+
+/* adds the read (w = 0) or write (w = 1) counters in 'rw' to the
+ * corresponding counters of 'file_rec', and resets the accumulated values
+ * (including maxima and timestamps) in 'rw' so that they are only counted
+ * once. Folding again is then a no-op, which matters at shutdown, as
+ * record refs may point at other records once shared records are sorted.
+ */
+static void posix_fold_rw_counters(struct darshan_posix_file *file_rec,
+    struct posix_rw_counters *rw, int w)
+{
+    file_rec->counters[POSIX_READS+w] += rw->ops;
+    file_rec->counters[POSIX_BYTES_READ+w] += rw->bytes;
+    file_rec->counters[POSIX_CONSEC_READS+w] += rw->consec;
+    file_rec->counters[POSIX_SEQ_READS+w] += rw->seq;
+    file_rec->counters[POSIX_RW_SWITCHES] += rw->rw_switches;
+    file_rec->counters[POSIX_MEM_NOT_ALIGNED] += rw->mem_not_aligned;
+    file_rec->counters[POSIX_FILE_NOT_ALIGNED] += rw->file_not_aligned;
+    file_rec->fcounters[POSIX_F_READ_TIME+w] += rw->time;
+    if(rw->max_byte > file_rec->counters[POSIX_MAX_BYTE_READ+w])
+        file_rec->counters[POSIX_MAX_BYTE_READ+w] = rw->max_byte;
+    if(rw->start_time > 0 &&
+        (file_rec->fcounters[POSIX_F_READ_START_TIMESTAMP+w] == 0 ||
+         rw->start_time < file_rec->fcounters[POSIX_F_READ_START_TIMESTAMP+w]))
+        file_rec->fcounters[POSIX_F_READ_START_TIMESTAMP+w] = rw->start_time;
+    if(rw->end_time > file_rec->fcounters[POSIX_F_READ_END_TIMESTAMP+w])
+        file_rec->fcounters[POSIX_F_READ_END_TIMESTAMP+w] = rw->end_time;
+    if(rw->max_time > file_rec->fcounters[POSIX_F_MAX_READ_TIME+w])
+    {
+        file_rec->fcounters[POSIX_F_MAX_READ_TIME+w] = rw->max_time;
+        file_rec->counters[POSIX_MAX_READ_TIME_SIZE+w] = rw->max_time_size;
+    }
+
+    rw->ops = 0;
+    rw->bytes = 0;
+    rw->consec = 0;
+    rw->seq = 0;
+    rw->rw_switches = 0;
+    rw->mem_not_aligned = 0;
+    rw->file_not_aligned = 0;
+    rw->time = 0;
+    rw->max_byte = 0;
+    rw->start_time = 0;
+    rw->end_time = 0;
+    rw->max_time = 0;
+    rw->max_time_size = 0;
+
+    return;
+}
+
+/* ends the current run of accesses of the same size, adding it to the
+ * size histogram of the run's direction and to the common access sizes, and
+ * starts a new run of accesses of 'size'
+ */
+static inline void posix_flush_size_run(struct posix_file_record_ref *rec_ref,
+    int64_t size)
+{
+    if(rec_ref->size_run_count)
+    {
+        if(rec_ref->last_io_type == DARSHAN_IO_WRITE)
+            DARSHAN_BUCKET_ADD(
+                &(rec_ref->file_rec->counters[POSIX_SIZE_WRITE_0_100]),
+                rec_ref->size_run, rec_ref->size_run_count);
         else
-        {
-            tmp_file.fcounters[POSIX_F_MAX_READ_TIME] =
-                inoutfile->fcounters[POSIX_F_MAX_READ_TIME];
-            tmp_file.counters[POSIX_MAX_READ_TIME_SIZE] =
-                inoutfile->counters[POSIX_MAX_READ_TIME_SIZE];
-        }
+            DARSHAN_BUCKET_ADD(
+                &(rec_ref->file_rec->counters[POSIX_SIZE_READ_0_100]),
+                rec_ref->size_run, rec_ref->size_run_count);
+        if(!rec_ref->overflow && !rec_ref->evicted)
+            darshan_common_val_table_add(&rec_ref->access_table,
+                rec_ref->size_run, rec_ref->size_run_count);
+    }
+    rec_ref->size_run = size;
+    rec_ref->size_run_count = 0;
+}
 
-        if(infile->fcounters[POSIX_F_MAX_WRITE_TIME] >
-            inoutfile->fcounters[POSIX_F_MAX_WRITE_TIME])
+/* ends the current run of accesses of the same stride, adding it to the
+ * common strides, and starts a new run of accesses of 'stride'
+ */
+static inline void posix_flush_stride_run(
+    struct posix_file_record_ref *rec_ref, int64_t stride)
+{
+    if(rec_ref->stride_run_count)
+        darshan_common_val_table_add(&rec_ref->stride_table,
+            rec_ref->stride_run, rec_ref->stride_run_count);
+    rec_ref->stride_run = stride;
+    rec_ref->stride_run_count = 0;
+}
+
+/* adds the pending runs of accesses of the same size and stride to the
+ * size histograms and common value tables, before they are consulted or
+ * before last_io_type is changed other than by a read or write
+ */
+static void posix_flush_access_runs(struct posix_file_record_ref *rec_ref)
+{
+    posix_flush_size_run(rec_ref, 0);
+    posix_flush_stride_run(rec_ref, 0);
+    return;
+}
+
+/* merges the read or write counters of a thread shard into 'dst' */
+static void posix_merge_rw_counters(struct posix_rw_counters *dst,
+    struct posix_rw_counters *src)
+{
+    /* sum */
+    dst->ops += src->ops;
+    dst->bytes += src->bytes;
+    dst->consec += src->consec;
+    dst->seq += src->seq;
+    dst->rw_switches += src->rw_switches;
+    dst->mem_not_aligned += src->mem_not_aligned;
+    dst->file_not_aligned += src->file_not_aligned;
+    dst->time += src->time;
+
+    /* max */
+    if(src->max_byte > dst->max_byte)
+        dst->max_byte = src->max_byte;
+    if(src->end_time > dst->end_time)
+        dst->end_time = src->end_time;
+    if(src->last_end > dst->last_end)
+        dst->last_end = src->last_end;
+
+    /* min non-zero */
+    if(src->start_time > 0 &&
+        (dst->start_time == 0 || src->start_time < dst->start_time))
+        dst->start_time = src->start_time;
+
+    /* max (special case) */
+    if(src->max_time > dst->max_time)
+    {
+        dst->max_time = src->max_time;
+        dst->max_time_size = src->max_time_size;
+    }
+
+    return;
+}
+
+/* store the most common access sizes and strides tracked for a record in
+ * its common value counters
+ */
+static void posix_finalize_file_records(void *rec_ref_p, void *user_ptr)
+{
+    struct posix_file_record_ref *rec_ref =
+        (struct posix_file_record_ref *)rec_ref_p;
+
+    posix_flush_access_runs(rec_ref);
+    posix_fold_rw_counters(rec_ref->file_rec, &rec_ref->reads, 0);
+    posix_fold_rw_counters(rec_ref->file_rec, &rec_ref->writes, 1);
+
+    darshan_common_val_table_finalize(&rec_ref->access_table,
+        &(rec_ref->file_rec->counters[POSIX_ACCESS1_ACCESS]),
+        &(rec_ref->file_rec->counters[POSIX_ACCESS1_COUNT]));
+    darshan_common_val_table_finalize(&rec_ref->stride_table,
+        &(rec_ref->file_rec->counters[POSIX_STRIDE1_STRIDE]),
+        &(rec_ref->file_rec->counters[POSIX_STRIDE1_COUNT]));
+    return;
+}
+
+/* takes 'size' bytes from the memory available to thread shards, returning
+ * 0 if there isn't enough left
+ */
+static int posix_shard_mem_take(size_t size)
+{
+    int ret = 0;
+
+    pthread_mutex_lock(&posix_shard_list_mutex);
+    if(posix_runtime->shard_mem_avail >= size)
+    {
+        posix_runtime->shard_mem_avail -= size;
+        ret = 1;
+    }
+    pthread_mutex_unlock(&posix_shard_list_mutex);
+
+    return(ret);
+}
+
+/* returns the calling thread's shard reference for the given file record
+ * reference, creating the thread's shard and/or the shard reference if
+ * needed. Must be called holding the shard lock (shared) or the POSIX lock.
+ * If the shard memory limit is reached (or allocation fails), 'rec_ref'
+ * itself is returned instead, with 'shared' set and
+ * posix_shard_shared_mutex held.
+ */
+static struct posix_file_record_ref *posix_shard_record_ref(
+    struct posix_file_record_ref *rec_ref, int *shared)
+{
+    struct posix_thread_shard *shard;
+    struct posix_file_record_ref *shard_ref;
+    darshan_record_id rec_id = rec_ref->file_rec->base_rec.id;
+    int ret;
+
+    /* shards are dropped when folded, so make sure this thread's shard
+     * pointer is from the current epoch before using it
+     */
+    if(!posix_my_shard || posix_my_shard_epoch != posix_runtime->shard_epoch)
+    {
+        if(!posix_shard_mem_take(sizeof(*shard)))
+            goto use_shared;
+        shard = malloc(sizeof(*shard));
+        if(!shard)
+            goto use_shared;
+        memset(shard, 0, sizeof(*shard));
+
+        pthread_mutex_lock(&posix_shard_list_mutex);
+        shard->next = posix_runtime->shard_list;
+        posix_runtime->shard_list = shard;
+        pthread_mutex_unlock(&posix_shard_list_mutex);
+
+        posix_my_shard = shard;
+        posix_my_shard_epoch = posix_runtime->shard_epoch;
+    }
+    shard = posix_my_shard;
+
+    shard_ref = darshan_lookup_record_ref(shard->rec_id_hash, &rec_id,
+        sizeof(darshan_record_id));
+    if(!shard_ref)
+    {
+        /* allocate the shard reference and its private file record together */
+        if(!posix_shard_mem_take(sizeof(*shard_ref) +
+            sizeof(struct darshan_posix_file)))
+            goto use_shared;
+        if(posix_memalign((void **)&shard_ref, DARSHAN_CACHE_LINE_SIZE,
+            sizeof(*shard_ref) + sizeof(struct darshan_posix_file)) != 0)
+            goto use_shared;
+        memset(shard_ref, 0, sizeof(*shard_ref) + sizeof(struct darshan_posix_file));
+        shard_ref->file_rec = (struct darshan_posix_file *)
+            ((char *)shard_ref + sizeof(*shard_ref));
+
+        ret = darshan_add_record_ref(&(shard->rec_id_hash), &rec_id,
+            sizeof(darshan_record_id), shard_ref);
+        if(ret == 0)
         {
-            tmp_file.fcounters[POSIX_F_MAX_WRITE_TIME] =
-                infile->fcounters[POSIX_F_MAX_WRITE_TIME];
-            tmp_file.counters[POSIX_MAX_WRITE_TIME_SIZE] =
-                infile->counters[POSIX_MAX_WRITE_TIME_SIZE];
+            free(shard_ref);
+            goto use_shared;
         }
-        else
+
+        /* seed the shard with the state read/write counters depend on */
+        shard_ref->file_rec->base_rec = rec_ref->file_rec->base_rec;
+        shard_ref->file_alignment = rec_ref->file_alignment;
+        shard_ref->reads.last_byte = rec_ref->reads.last_byte;
+        shard_ref->writes.last_byte = rec_ref->writes.last_byte;
+        shard_ref->reset_count = rec_ref->reset_count;
+        shard_ref->last_io_type = rec_ref->last_io_type;
+        shard_ref->reads.last_end = rec_ref->reads.last_end;
+        shard_ref->writes.last_end = rec_ref->writes.last_end;
+        shard_ref->fs_type = rec_ref->fs_type;
+        shard_ref->overflow = rec_ref->overflow;
+        shard_ref->evicted = rec_ref->evicted;
+    }
+
+    /* pick up any open/close resets of the access pattern state */
+    if(shard_ref->reset_count != rec_ref->reset_count)
+    {
+        shard_ref->reads.last_byte = rec_ref->reads.last_byte;
+        shard_ref->writes.last_byte = rec_ref->writes.last_byte;
+        shard_ref->reset_count = rec_ref->reset_count;
+    }
+
+    return(shard_ref);
+
+use_shared:
+    /* NOTE: the shard lock keeps the shared reference from being changed
+     * by anything but other threads recording in it
+     */
+    pthread_mutex_lock(&posix_shard_shared_mutex);
+    *shared = 1;
+    return(rec_ref);
+}
+
+/* fold the read/write counters of a single shard reference into the
+ * corresponding file record registered with darshan-core
+ */
+static void posix_fold_shard_record(void *shard_ref_p, void *user_ptr)
+{
+    struct posix_file_record_ref *shard_ref =
+        (struct posix_file_record_ref *)shard_ref_p;
+    struct posix_file_record_ref *rec_ref;
+    struct darshan_posix_file *shard_rec = shard_ref->file_rec;
+    struct darshan_posix_file *file_rec;
+    int j;
+
+    rec_ref = darshan_lookup_record_ref(posix_runtime->rec_id_hash,
+        &(shard_rec->base_rec.id), sizeof(darshan_record_id));
+    if(rec_ref)
+    {
+        file_rec = rec_ref->file_rec;
+
+        posix_flush_access_runs(shard_ref);
+        posix_flush_access_runs(rec_ref);
+        posix_merge_rw_counters(&rec_ref->reads, &shard_ref->reads);
+        posix_merge_rw_counters(&rec_ref->writes, &shard_ref->writes);
+
+        /* sum */
+        for(j=POSIX_SIZE_READ_0_100; j<=POSIX_SIZE_WRITE_1G_PLUS; j++)
+            file_rec->counters[j] += shard_rec->counters[j];
+
+        /* common values */
+        darshan_common_val_table_merge(&rec_ref->access_table,
+            &shard_ref->access_table);
+        darshan_common_val_table_merge(&rec_ref->stride_table,
+            &shard_ref->stride_table);
+
+        /* carry access pattern state over so that shards created after
+         * this fold continue where this one left off
+         */
+        if(shard_ref->reset_count == rec_ref->reset_count)
         {
-            tmp_file.fcounters[POSIX_F_MAX_WRITE_TIME] =
-                inoutfile->fcounters[POSIX_F_MAX_WRITE_TIME];
-            tmp_file.counters[POSIX_MAX_WRITE_TIME_SIZE] =
-                inoutfile->counters[POSIX_MAX_WRITE_TIME_SIZE];
+            rec_ref->reads.last_byte = shard_ref->reads.last_byte;
+            rec_ref->writes.last_byte = shard_ref->writes.last_byte;
         }
+        if(shard_ref->last_io_type)
+            rec_ref->last_io_type = shard_ref->last_io_type;
+    }
+
+    return;
+}
+
+/* fold all thread shards into the file records registered with darshan-core
+ * and drop them. Must be called holding both the POSIX lock and the shard
+ * lock (exclusive).
+ */
+static void posix_fold_thread_shards()
+{
+    struct posix_thread_shard *shard, *tmp;
+
+    shard = posix_runtime->shard_list;
+    while(shard)
+    {
+        tmp = shard->next;
+        darshan_iter_record_refs(shard->rec_id_hash,
+            &posix_fold_shard_record, NULL);
+        /* shard references were allocated along with their file records */
+        darshan_clear_record_refs(&(shard->rec_id_hash), 1);
+        free(shard);
+        shard = tmp;
+    }
+    posix_runtime->shard_list = NULL;
+    posix_runtime->shard_mem_avail = posix_runtime->shard_mem_limit;
+
+    /* invalidate thread-local shard pointers */
+    posix_runtime->shard_epoch = ++posix_shard_epoch_counter;
+
+    return;
+}
+
+#ifdef HAVE_STDATOMIC_H
+
+/* makes sure the calling thread's event queue has room for another event,
+ * recording the queued events if it is full. Must be called holding the
+ * shard lock (shared), which may be dropped and reacquired. Returns 0 if
+ * the POSIX module stopped instrumenting in the meantime.
+ */
+static int posix_reserve_event()
+{
+    struct posix_event_queue *queue = posix_my_queue;
+
+    /* a queue from an earlier epoch may have been freed */
+    if(!queue || posix_my_queue_epoch != posix_runtime->queue_epoch)
+        return(1);
+    if(atomic_load_explicit(&queue->tail, memory_order_relaxed) -
+       atomic_load_explicit(&queue->head, memory_order_acquire) <
+       POSIX_EVENT_QUEUE_SIZE)
+        return(1);
+
+    /* the POSIX lock must be taken before the shard lock */
+    POSIX_SHARD_UNLOCK();
+    POSIX_LOCK();
+    if(posix_runtime)
+        posix_drain_events();
+    POSIX_UNLOCK();
+    POSIX_SHARD_RDLOCK();
+
+    return(posix_runtime && !posix_runtime->frozen);
+}
+
+/* queues a read or write event in the calling thread's event queue,
+ * creating the queue if needed. Must be called holding the shard lock
+ * (shared) or the POSIX lock.
+ */
+static void posix_enqueue_event(struct posix_file_record_ref *rec_ref,
+    enum darshan_io_type io_type, int64_t offset, int64_t size, int aligned,
+    double tm1, double tm2)
+{
+    struct posix_event_queue *queue;
+    struct posix_event *ev;
+    unsigned long tail;
+    int epoch;
+
+    /* queues are dropped at cleanup, so make sure this thread's queue
+     * pointer is from the current epoch before using it
+     */
+    if(!posix_my_queue || posix_my_queue_epoch != posix_runtime->queue_epoch)
+    {
+        if(posix_memalign((void **)&queue, DARSHAN_CACHE_LINE_SIZE,
+            sizeof(*queue)) != 0)
+            return;
+        memset(queue, 0, sizeof(*queue));
+        atomic_init(&queue->tail, 0);
+        atomic_init(&queue->head, 0);
 
-        /* min (zeroes are ok here; some procs don't do I/O) */
-        if(infile->fcounters[POSIX_F_FASTEST_RANK_TIME] <
-           inoutfile->fcounters[POSIX_F_FASTEST_RANK_TIME])
+        pthread_mutex_lock(&posix_shard_list_mutex);
+        queue->next = posix_runtime->queue_list;
+        posix_runtime->queue_list = queue;
+        pthread_mutex_unlock(&posix_shard_list_mutex);
+
+        posix_my_queue = queue;
+        posix_my_queue_epoch = posix_runtime->queue_epoch;
+    }
+    queue = posix_my_queue;
+
+    tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    if(tail - atomic_load_explicit(&queue->head, memory_order_acquire) >=
+        POSIX_EVENT_QUEUE_SIZE)
+    {
+        /* read/write wrappers reserve room before queueing, so this
+         * normally only happens for callers already holding the POSIX lock
+         * (e.g., aio_return()), which can record the queued events right
+         * away. Any other caller waits for the POSIX lock as in
+         * posix_reserve_event(), and only gives up on the event if the
+         * POSIX module stopped instrumenting (and 'rec_ref' may be gone).
+         */
+        if(pthread_mutex_trylock(&posix_runtime_mutex) == 0)
         {
-            tmp_file.counters[POSIX_FASTEST_RANK] =
-                infile->counters[POSIX_FASTEST_RANK];
-            tmp_file.counters[POSIX_FASTEST_RANK_BYTES] =
-                infile->counters[POSIX_FASTEST_RANK_BYTES];
-            tmp_file.fcounters[POSIX_F_FASTEST_RANK_TIME] =
-                infile->fcounters[POSIX_F_FASTEST_RANK_TIME];
+            posix_drain_events();
+            POSIX_UNLOCK();
         }
         else
         {
-            tmp_file.counters[POSIX_FASTEST_RANK] =
-                inoutfile->counters[POSIX_FASTEST_RANK];
-            tmp_file.counters[POSIX_FASTEST_RANK_BYTES] =
-                inoutfile->counters[POSIX_FASTEST_RANK_BYTES];
-            tmp_file.fcounters[POSIX_F_FASTEST_RANK_TIME] =
-                inoutfile->fcounters[POSIX_F_FASTEST_RANK_TIME];
+            epoch = posix_runtime->queue_epoch;
+            if(!posix_reserve_event() || posix_runtime->queue_epoch != epoch)
+                return;
         }
+    }
 
-        /* max */
-        if(infile->fcounters[POSIX_F_SLOWEST_RANK_TIME] >
-           inoutfile->fcounters[POSIX_F_SLOWEST_RANK_TIME])
-        {
-            tmp_file.counters[POSIX_SLOWEST_RANK] =
-                infile->counters[POSIX_SLOWEST_RANK];
-            tmp_file.counters[POSIX_SLOWEST_RANK_BYTES] =
-                infile->counters[POSIX_SLOWEST_RANK_BYTES];
-            tmp_file.fcounters[POSIX_F_SLOWEST_RANK_TIME] =
-                infile->fcounters[POSIX_F_SLOWEST_RANK_TIME];
-        }
-        else
+    ev = &queue->events[tail & (POSIX_EVENT_QUEUE_SIZE - 1)];
+    ev->rec_ref = rec_ref;
+    ev->offset = offset;
+    ev->size = size;
+    ev->tm1 = tm1;
+    ev->tm2 = tm2;
+    ev->io_type = io_type;
+    ev->aligned = aligned;
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+
+    return;
+}
+
+/* records all queued events, one thread's queue at a time. Must be called
+ * holding the POSIX lock.
+ */
+static void posix_drain_events()
+{
+    struct posix_event_queue *queue;
+    struct posix_event *ev;
+    unsigned long head, tail;
+
+    pthread_mutex_lock(&posix_shard_list_mutex);
+    queue = posix_runtime->queue_list;
+    pthread_mutex_unlock(&posix_shard_list_mutex);
+
+    for(; queue; queue = queue->next)
+    {
+        head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+        tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+        for(; head != tail; head++)
         {
-            tmp_file.counters[POSIX_SLOWEST_RANK] =
-                inoutfile->counters[POSIX_SLOWEST_RANK];
-            tmp_file.counters[POSIX_SLOWEST_RANK_BYTES] =
-                inoutfile->counters[POSIX_SLOWEST_RANK_BYTES];
-            tmp_file.fcounters[POSIX_F_SLOWEST_RANK_TIME] =
-                inoutfile->fcounters[POSIX_F_SLOWEST_RANK_TIME];
+            ev = &queue->events[head & (POSIX_EVENT_QUEUE_SIZE - 1)];
+            if(ev->io_type == DARSHAN_IO_READ)
+                _POSIX_RECORD_READ(ev->rec_ref, ev->offset, ev->size,
+                    ev->aligned, ev->tm1, ev->tm2);
+            else
+                _POSIX_RECORD_WRITE(ev->rec_ref, ev->offset, ev->size,
+                    ev->aligned, ev->tm1, ev->tm2);
         }
-
-        /* update pointers */
-        *inoutfile = tmp_file;
-        inoutfile++;
-        infile++;
+        atomic_store_explicit(&queue->head, head, memory_order_release);
     }
 
     return;
 }
 
-static void posix_shared_record_variance(MPI_Comm mod_comm,
-    struct darshan_posix_file *inrec_array, struct darshan_posix_file *outrec_array,
-    int shared_rec_count)
+/* frees all event queues. Must be called holding both the POSIX lock and
+ * the shard lock (exclusive), after draining them.
+ */
+static void posix_free_event_queues()
 {
-    MPI_Datatype var_dt;
-    MPI_Op var_op;
-    int i;
-    struct darshan_variance_dt *var_send_buf = NULL;
-    struct darshan_variance_dt *var_recv_buf = NULL;
+    struct posix_event_queue *queue, *tmp;
 
-    PMPI_Type_contiguous(sizeof(struct darshan_variance_dt),
-        MPI_BYTE, &var_dt);
-    PMPI_Type_commit(&var_dt);
+    queue = posix_runtime->queue_list;
+    while(queue)
+    {
+        tmp = queue->next;
+        free(queue);
+        queue = tmp;
+    }
+    posix_runtime->queue_list = NULL;
 
-    PMPI_Op_create(darshan_variance_reduce, 1, &var_op);
+    return;
+}
 
-    var_send_buf = malloc(shared_rec_count * sizeof(struct darshan_variance_dt));
-    if(!var_send_buf)
-        return;
+/* helper thread that periodically records queued events, so that events
+ * don't wait for the next close or for shutdown. It exits once the runtime
+ * instance it was started for is frozen or cleaned up.
+ */
+static void *posix_event_drain_thread(void *arg)
+{
+    struct timespec interval;
+    int epoch = (int)(intptr_t)arg;
+    long interval_ms;
+
+    POSIX_LOCK();
+    interval_ms = posix_event_drain_interval;
+    POSIX_UNLOCK();
+    interval.tv_sec = interval_ms / 1000;
+    interval.tv_nsec = (interval_ms % 1000) * 1000000;
 
-    if(my_rank == 0)
+    while(1)
     {
-        var_recv_buf = malloc(shared_rec_count * sizeof(struct darshan_variance_dt));
+        nanosleep(&interval, NULL);
 
-        if(!var_recv_buf)
-            return;
+        POSIX_LOCK();
+        if(!posix_runtime || posix_runtime->frozen ||
+           posix_runtime->queue_epoch != epoch)
+        {
+            POSIX_UNLOCK();
+            break;
+        }
+        posix_drain_events();
+        POSIX_UNLOCK();
     }
 
-    /* get total i/o time variances for shared records */
+    return(NULL);
+}
+
+/* starts the event drain helper thread. Must be called holding the POSIX
+ * lock; events are just recorded lazily if the thread can't be started.
+ */
+static void posix_start_event_drain_thread(long interval_ms)
+{
+    pthread_t thread;
+    pthread_attr_t attr;
+    sigset_t all_signals, old_signals;
+
+    posix_event_drain_interval = interval_ms;
+
+    if(pthread_attr_init(&attr) != 0)
+        return;
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    /* make sure application signals are never delivered to the thread */
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_SETMASK, &all_signals, &old_signals);
+    (void)pthread_create(&thread, &attr, posix_event_drain_thread,
+        (void *)(intptr_t)posix_runtime->queue_epoch);
+    pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
 
-    for(i=0; i<shared_rec_count; i++)
+    pthread_attr_destroy(&attr);
+
+    return;
+}
+
+#else
+
+/* event queues need C11 atomics; without them, read/write wrappers always
+ * record their counters synchronously and none of these are used
+ */
+static int posix_reserve_event() { return(1); }
+static void posix_enqueue_event(struct posix_file_record_ref *rec_ref,
+    enum darshan_io_type io_type, int64_t offset, int64_t size, int aligned,
+    double tm1, double tm2) { return; }
+static void posix_drain_events() { return; }
+static void posix_free_event_queues() { return; }
+static void posix_start_event_drain_thread(long interval_ms) { return; }
+
+#endif
+
+/* counters of POSIX file records that are merged with a single operation;
+ * the remaining counters are special cases in posix_record_merge()
+ */
+#define POSIX_COUNTER_SPANS(X) \
+    X(sum_valid, POSIX_OPENS, POSIX_RENAME_TARGETS) \
+    X(in, POSIX_RENAMED_FROM, POSIX_MODE) \
+    X(sum, POSIX_BYTES_READ, POSIX_BYTES_WRITTEN) \
+    X(max, POSIX_MAX_BYTE_READ, POSIX_MAX_BYTE_WRITTEN) \
+    X(sum, POSIX_CONSEC_READS, POSIX_MEM_NOT_ALIGNED) \
+    X(in, POSIX_MEM_ALIGNMENT, POSIX_MEM_ALIGNMENT) \
+    X(sum, POSIX_FILE_NOT_ALIGNED, POSIX_FILE_NOT_ALIGNED) \
+    X(in, POSIX_FILE_ALIGNMENT, POSIX_FILE_ALIGNMENT) \
+    X(sum, POSIX_SIZE_READ_0_100, POSIX_SIZE_WRITE_1G_PLUS)
+#define POSIX_FCOUNTER_SPANS(X) \
+    X(min_nonzero, POSIX_F_OPEN_START_TIMESTAMP, POSIX_F_CLOSE_START_TIMESTAMP) \
+    X(max, POSIX_F_OPEN_END_TIMESTAMP, POSIX_F_CLOSE_END_TIMESTAMP) \
+    X(sum, POSIX_F_READ_TIME, POSIX_F_META_TIME)
+
+/* merge the counters of file record 'infile' into 'inoutfile', in the same
+ * manner as records of a file shared across processes are reduced. Note that
+ * 'infile' is modified while merging common value counters.
+ */
+static void posix_record_merge(struct darshan_posix_file *infile,
+    struct darshan_posix_file *inoutfile)
+{
+    struct darshan_posix_file tmp_file;
+    int j, k;
+
+    memset(&tmp_file, 0, sizeof(struct darshan_posix_file));
+    tmp_file.base_rec = inoutfile->base_rec;
+
+    DARSHAN_REDUCE_COUNTER_SPANS(POSIX_COUNTER_SPANS,
+        infile->counters, inoutfile->counters, tmp_file.counters);
+    DARSHAN_REDUCE_FCOUNTER_SPANS(POSIX_FCOUNTER_SPANS,
+        infile->fcounters, inoutfile->fcounters, tmp_file.fcounters);
+
+    /* skip POSIX_MAX_*_TIME_SIZE; handled in floating point section */
+
+    /* first collapse any duplicates */
+    for(j=POSIX_STRIDE1_STRIDE; j<=POSIX_STRIDE4_STRIDE; j++)
+    {
+        for(k=POSIX_STRIDE1_STRIDE; k<=POSIX_STRIDE4_STRIDE; k++)
+        {
+            if(infile->counters[j] == inoutfile->counters[k])
+            {
+                infile->counters[j+4] += inoutfile->counters[k+4];
+                inoutfile->counters[k] = 0;
+                inoutfile->counters[k+4] = 0;
+            }
+        }
+    }
+
+    /* first set */
+    for(j=POSIX_STRIDE1_STRIDE; j<=POSIX_STRIDE4_STRIDE; j++)
+    {
+        DARSHAN_UPDATE_COMMON_VAL_COUNTERS(
+            &(tmp_file.counters[POSIX_STRIDE1_STRIDE]),
+            &(tmp_file.counters[POSIX_STRIDE1_COUNT]),
+            &infile->counters[j], 1, infile->counters[j+4], 1);
+    }
+    /* second set */
+    for(j=POSIX_STRIDE1_STRIDE; j<=POSIX_STRIDE4_STRIDE; j++)
     {
-        var_send_buf[i].n = 1;
-        var_send_buf[i].S = 0;
-        var_send_buf[i].T = inrec_array[i].fcounters[POSIX_F_READ_TIME] +
-                            inrec_array[i].fcounters[POSIX_F_WRITE_TIME] +
-                            inrec_array[i].fcounters[POSIX_F_META_TIME];
+        DARSHAN_UPDATE_COMMON_VAL_COUNTERS(
+            &(tmp_file.counters[POSIX_STRIDE1_STRIDE]),
+            &(tmp_file.counters[POSIX_STRIDE1_COUNT]),
+            &inoutfile->counters[j], 1, inoutfile->counters[j+4], 1);
     }
 
-    PMPI_Reduce(var_send_buf, var_recv_buf, shared_rec_count,
-        var_dt, var_op, 0, mod_comm);
+    /* same for access counts */
 
-    if(my_rank == 0)
+    /* first collapse any duplicates */
+    for(j=POSIX_ACCESS1_ACCESS; j<=POSIX_ACCESS4_ACCESS; j++)
     {
-        for(i=0; i<shared_rec_count; i++)
+        for(k=POSIX_ACCESS1_ACCESS; k<=POSIX_ACCESS4_ACCESS; k++)
         {
-            outrec_array[i].fcounters[POSIX_F_VARIANCE_RANK_TIME] =
-                (var_recv_buf[i].S / var_recv_buf[i].n);
+            if(infile->counters[j] == inoutfile->counters[k])
+            {
+                infile->counters[j+4] += inoutfile->counters[k+4];
+                inoutfile->counters[k] = 0;
+                inoutfile->counters[k+4] = 0;
+            }
         }
     }
 
-    /* get total bytes moved variances for shared records */
+    /* first set */
+    for(j=POSIX_ACCESS1_ACCESS; j<=POSIX_ACCESS4_ACCESS; j++)
+    {
+        DARSHAN_UPDATE_COMMON_VAL_COUNTERS(
+            &(tmp_file.counters[POSIX_ACCESS1_ACCESS]),
+            &(tmp_file.counters[POSIX_ACCESS1_COUNT]),
+            &infile->counters[j], 1, infile->counters[j+4], 1);
+    }
+    /* second set */
+    for(j=POSIX_ACCESS1_ACCESS; j<=POSIX_ACCESS4_ACCESS; j++)
+    {
+        DARSHAN_UPDATE_COMMON_VAL_COUNTERS(
+            &(tmp_file.counters[POSIX_ACCESS1_ACCESS]),
+            &(tmp_file.counters[POSIX_ACCESS1_COUNT]),
+            &inoutfile->counters[j], 1, inoutfile->counters[j+4], 1);
+    }
 
-    for(i=0; i<shared_rec_count; i++)
+    /* max (special case) */
+    if(infile->fcounters[POSIX_F_MAX_READ_TIME] >
+        inoutfile->fcounters[POSIX_F_MAX_READ_TIME])
     {
-        var_send_buf[i].n = 1;
-        var_send_buf[i].S = 0;
-        var_send_buf[i].T = (double)
-                            inrec_array[i].counters[POSIX_BYTES_READ] +
-                            inrec_array[i].counters[POSIX_BYTES_WRITTEN];
+        tmp_file.fcounters[POSIX_F_MAX_READ_TIME] =
+            infile->fcounters[POSIX_F_MAX_READ_TIME];
+        tmp_file.counters[POSIX_MAX_READ_TIME_SIZE] =
+            infile->counters[POSIX_MAX_READ_TIME_SIZE];
+    }
+    else
+    {
+        tmp_file.fcounters[POSIX_F_MAX_READ_TIME] =
+            inoutfile->fcounters[POSIX_F_MAX_READ_TIME];
+        tmp_file.counters[POSIX_MAX_READ_TIME_SIZE] =
+            inoutfile->counters[POSIX_MAX_READ_TIME_SIZE];
     }
 
-    PMPI_Reduce(var_send_buf, var_recv_buf, shared_rec_count,
-        var_dt, var_op, 0, mod_comm);
+    if(infile->fcounters[POSIX_F_MAX_WRITE_TIME] >
+        inoutfile->fcounters[POSIX_F_MAX_WRITE_TIME])
+    {
+        tmp_file.fcounters[POSIX_F_MAX_WRITE_TIME] =
+            infile->fcounters[POSIX_F_MAX_WRITE_TIME];
+        tmp_file.counters[POSIX_MAX_WRITE_TIME_SIZE] =
+            infile->counters[POSIX_MAX_WRITE_TIME_SIZE];
+    }
+    else
+    {
+        tmp_file.fcounters[POSIX_F_MAX_WRITE_TIME] =
+            inoutfile->fcounters[POSIX_F_MAX_WRITE_TIME];
+        tmp_file.counters[POSIX_MAX_WRITE_TIME_SIZE] =
+            inoutfile->counters[POSIX_MAX_WRITE_TIME_SIZE];
+    }
 
-    if(my_rank == 0)
+    /* min (zeroes are ok here; some procs don't do I/O) */
+    if(infile->fcounters[POSIX_F_FASTEST_RANK_TIME] <
+       inoutfile->fcounters[POSIX_F_FASTEST_RANK_TIME])
     {
-        for(i=0; i<shared_rec_count; i++)
-        {
-            outrec_array[i].fcounters[POSIX_F_VARIANCE_RANK_BYTES] =
-                (var_recv_buf[i].S / var_recv_buf[i].n);
-        }
+        tmp_file.counters[POSIX_FASTEST_RANK] =
+            infile->counters[POSIX_FASTEST_RANK];
+        tmp_file.counters[POSIX_FASTEST_RANK_BYTES] =
+            infile->counters[POSIX_FASTEST_RANK_BYTES];
+        tmp_file.fcounters[POSIX_F_FASTEST_RANK_TIME] =
+            infile->fcounters[POSIX_F_FASTEST_RANK_TIME];
+    }
+    else
+    {
+        tmp_file.counters[POSIX_FASTEST_RANK] =
+            inoutfile->counters[POSIX_FASTEST_RANK];
+        tmp_file.counters[POSIX_FASTEST_RANK_BYTES] =
+            inoutfile->counters[POSIX_FASTEST_RANK_BYTES];
+        tmp_file.fcounters[POSIX_F_FASTEST_RANK_TIME] =
+            inoutfile->fcounters[POSIX_F_FASTEST_RANK_TIME];
     }
 
-    PMPI_Type_free(&var_dt);
-    PMPI_Op_free(&var_op);
-    free(var_send_buf);
-    free(var_recv_buf);
+    /* max */
+    if(infile->fcounters[POSIX_F_SLOWEST_RANK_TIME] >
+       inoutfile->fcounters[POSIX_F_SLOWEST_RANK_TIME])
+    {
+        tmp_file.counters[POSIX_SLOWEST_RANK] =
+            infile->counters[POSIX_SLOWEST_RANK];
+        tmp_file.counters[POSIX_SLOWEST_RANK_BYTES] =
+            infile->counters[POSIX_SLOWEST_RANK_BYTES];
+        tmp_file.fcounters[POSIX_F_SLOWEST_RANK_TIME] =
+            infile->fcounters[POSIX_F_SLOWEST_RANK_TIME];
+    }
+    else
+    {
+        tmp_file.counters[POSIX_SLOWEST_RANK] =
+            inoutfile->counters[POSIX_SLOWEST_RANK];
+        tmp_file.counters[POSIX_SLOWEST_RANK_BYTES] =
+            inoutfile->counters[POSIX_SLOWEST_RANK_BYTES];
+        tmp_file.fcounters[POSIX_F_SLOWEST_RANK_TIME] =
+            inoutfile->fcounters[POSIX_F_SLOWEST_RANK_TIME];
+    }
+
+    *inoutfile = tmp_file;
+    return;
+}
+
+#ifdef HAVE_MPI
+static void posix_record_reduction_op(void* infile_v, void* inoutfile_v,
+    int *len, MPI_Datatype *datatype)
+{
+    struct darshan_posix_file *infile = infile_v;
+    struct darshan_posix_file *inoutfile = inoutfile_v;
+    int i;
+
+    for(i=0; i<*len; i++)
+    {
+        posix_record_merge(infile, inoutfile);
+        inoutfile->base_rec.id = infile->base_rec.id;
+        inoutfile->base_rec.rank = -1;
+
+        /* update pointers */
+        inoutfile++;
+        infile++;
+    }
 
     return;
 }
@@ -2383,9 +3549,9 @@ char *darshan_posix_lookup_record_name(int fd)
     POSIX_LOCK();
     if(posix_runtime)
     {
-        rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash,
-            &fd, sizeof(fd));
-        if(rec_ref)
+        rec_ref = posix_fd_lookup(fd);
+        /* the names of overflow records don't identify a single file */
+        if(rec_ref && !rec_ref->overflow && !rec_ref->evicted)
             rec_name = darshan_core_lookup_record_name(rec_ref->file_rec->base_rec.id);
     }
     POSIX_UNLOCK();
@@ -2495,14 +3661,25 @@ static void posix_mpi_redux(
     struct darshan_posix_file *posix_rec_buf = (struct darshan_posix_file *)posix_buf;
     double posix_time;
     struct darshan_posix_file *red_send_buf = NULL;
-    struct darshan_posix_file *red_recv_buf = NULL;
-    MPI_Datatype red_type;
-    MPI_Op red_op;
+    int kept_rec_count;
     int i;
 
     POSIX_LOCK();
+    POSIX_SHARD_WRLOCK();
     assert(posix_runtime);
 
+    /* record any queued events and fold any per-thread read/write shards
+     * into the file records
+     */
+    if(posix_event_queue)
+        posix_drain_events();
+    if(posix_sharded)
+        posix_fold_thread_shards();
+    darshan_iter_record_refs(posix_runtime->rec_id_hash,
+        &posix_clear_evicted_file_records, NULL);
+    darshan_iter_record_refs(posix_runtime->rec_id_hash,
+        &posix_finalize_file_records, NULL);
+
     /* allow DXT a chance to filter traces based on dynamic triggers */
     dxt_posix_filter_dynamic_traces(darshan_posix_rec_id_to_file);
 
@@ -2552,53 +3729,32 @@ static void posix_mpi_redux(
     /* make send_buf point to the shared files at the end of sorted array */
     red_send_buf = &(posix_rec_buf[posix_rec_count-shared_rec_count]);
 
-    /* allocate memory for the reduction output on rank 0 */
-    if(my_rank == 0)
-    {
-        red_recv_buf = malloc(shared_rec_count * sizeof(struct darshan_posix_file));
-        if(!red_recv_buf)
-        {
-            POSIX_UNLOCK();
-            return;
-        }
-    }
-
-    /* construct a datatype for a POSIX file record.  This is serving no purpose
-     * except to make sure we can do a reduction on proper boundaries
+    /* queue the shared records to be reduced along with those of other
+     * modules, storing the time and bytes this rank contributes to the
+     * variance counters
      */
-    PMPI_Type_contiguous(sizeof(struct darshan_posix_file),
-        MPI_BYTE, &red_type);
-    PMPI_Type_commit(&red_type);
-
-    /* register a POSIX file record reduction operator */
-    PMPI_Op_create(posix_record_reduction_op, 1, &red_op);
-
-    /* reduce shared POSIX file records */
-    PMPI_Reduce(red_send_buf, red_recv_buf,
-        shared_rec_count, red_type, red_op, 0, mod_comm);
-
-    /* get the time and byte variances for shared files */
-    posix_shared_record_variance(mod_comm, red_send_buf, red_recv_buf,
-        shared_rec_count);
-
-    /* update module state to account for shared file reduction */
-    if(my_rank == 0)
-    {
-        /* overwrite local shared records with globally reduced records */
-        int tmp_ndx = posix_rec_count - shared_rec_count;
-        memcpy(&(posix_rec_buf[tmp_ndx]), red_recv_buf,
-            shared_rec_count * sizeof(struct darshan_posix_file));
-        free(red_recv_buf);
-    }
-    else
+    for(i = 0; i < shared_rec_count; i++)
     {
-        /* drop shared records on non-zero ranks */
-        posix_runtime->file_rec_count -= shared_rec_count;
+        red_send_buf[i].fcounters[POSIX_F_VARIANCE_RANK_TIME] =
+            red_send_buf[i].fcounters[POSIX_F_READ_TIME] +
+            red_send_buf[i].fcounters[POSIX_F_WRITE_TIME] +
+            red_send_buf[i].fcounters[POSIX_F_META_TIME];
+        red_send_buf[i].fcounters[POSIX_F_VARIANCE_RANK_BYTES] = (double)
+            red_send_buf[i].counters[POSIX_BYTES_READ] +
+            red_send_buf[i].counters[POSIX_BYTES_WRITTEN];
     }
+    kept_rec_count = darshan_core_reduce_shared_records(red_send_buf, shared_rec_count,
+        sizeof(struct darshan_posix_file), posix_record_reduction_op,
+        offsetof(struct darshan_posix_file, fcounters[POSIX_F_VARIANCE_RANK_TIME]),
+        offsetof(struct darshan_posix_file, fcounters[POSIX_F_VARIANCE_RANK_BYTES]));
+
+    /* drop the shared records this rank doesn't keep. darshan-core
+     * overwrites the kept records (moved to the start of the shared
+     * records) with the reduced records.
+     */
+    posix_runtime->file_rec_count -= shared_rec_count - kept_rec_count;
 
-    PMPI_Type_free(&red_type);
-    PMPI_Op_free(&red_op);
-
+    POSIX_SHARD_WRUNLOCK();
     POSIX_UNLOCK();
     return;
 }
@@ -2611,14 +3767,28 @@ static void posix_output(
     int posix_rec_count;
 
     POSIX_LOCK();
+    POSIX_SHARD_WRLOCK();
     assert(posix_runtime);
 
+    /* record any queued events and fold any per-thread read/write shards
+     * into the file records
+     */
+    if(posix_event_queue)
+        posix_drain_events();
+    if(posix_sharded)
+        posix_fold_thread_shards();
+    darshan_iter_record_refs(posix_runtime->rec_id_hash,
+        &posix_clear_evicted_file_records, NULL);
+    darshan_iter_record_refs(posix_runtime->rec_id_hash,
+        &posix_finalize_file_records, NULL);
+
     /* just pass back our updated total buffer size -- no need to update buffer */
     posix_rec_count = posix_runtime->file_rec_count;
     *posix_buf_sz = posix_rec_count * sizeof(struct darshan_posix_file);
 
     posix_runtime->frozen = 1;
 
+    POSIX_SHARD_WRUNLOCK();
     POSIX_UNLOCK();
     return;
 }
@@ -2626,17 +3796,29 @@ static void posix_output(
 static void posix_cleanup()
 {
     POSIX_LOCK();
+    POSIX_SHARD_WRLOCK();
     assert(posix_runtime);
 
     /* cleanup internal structures used for instrumenting */
+    if(posix_event_queue)
+    {
+        posix_drain_events();
+        posix_free_event_queues();
+    }
+    if(posix_sharded)
+        posix_fold_thread_shards();
+    darshan_iter_record_refs(posix_runtime->rec_id_hash,
+        &posix_clear_evicted_file_records, NULL);
     darshan_iter_record_refs(posix_runtime->rec_id_hash,
         &posix_finalize_file_records, NULL);
-    darshan_clear_record_refs(&(posix_runtime->fd_hash), 0);
+    posix_fd_clear();
+    darshan_clear_record_refs(&(posix_runtime->path_cache_hash), 1);
     darshan_clear_record_refs(&(posix_runtime->rec_id_hash), 1);
 
     free(posix_runtime);
     posix_runtime = NULL;
 
+    POSIX_SHARD_WRUNLOCK();
     POSIX_UNLOCK();
     return;
 }
@@ -72,6 +72,7 @@
 #include <fcntl.h>
 #include <stdarg.h>
 #include <string.h>
+#include <stddef.h>
 #include <time.h>
 #include <stdlib.h>
 #include <errno.h>
@@ -134,6 +135,7 @@ struct stdio_file_record_ref
     double last_read_end;
     double last_write_end;
     int fs_type;
+    int overflow; /* file_rec is an overflow record shared by many files */
 };
 
 /* The stdio_runtime structure maintains necessary state for storing
@@ -158,12 +160,11 @@ static void stdio_runtime_initialize(
     void);
 static struct stdio_file_record_ref *stdio_track_new_file_record(
     darshan_record_id rec_id, const char *path);
+static struct stdio_file_record_ref *stdio_track_overflow_record(
+    darshan_record_id file_rec_id, const char *path);
 #ifdef HAVE_MPI
 static void stdio_record_reduction_op(void* infile_v, void* inoutfile_v,
     int *len, MPI_Datatype *datatype);
-static void stdio_shared_record_variance(
-    MPI_Comm mod_comm, struct darshan_stdio_file *inrec_array,
-    struct darshan_stdio_file *outrec_array, int shared_rec_count);
 static void stdio_mpi_redux(
     void *stdio_buf, MPI_Comm mod_comm,
     darshan_record_id *shared_recs, int shared_rec_count);
@@ -1022,6 +1023,7 @@ static void stdio_runtime_initialize()
     darshan_module_funcs mod_funcs = {
 #ifdef HAVE_MPI
     .mod_redux_func = &stdio_mpi_redux,
+    .mod_redux_partial = 1,
 #endif
     .mod_output_func = &stdio_output,
     .mod_cleanup_func = &stdio_cleanup
@@ -1094,7 +1096,9 @@ static struct stdio_file_record_ref *stdio_track_new_file_record(
         darshan_delete_record_ref(&(stdio_runtime->rec_id_hash),
             &rec_id, sizeof(darshan_record_id));
         free(rec_ref);
-        return(NULL);
+
+        /* fall back to accounting this file to its overflow record */
+        return(stdio_track_overflow_record(rec_id, path));
     }
 
     /* registering this file record was successful, so initialize some fields */
@@ -1107,14 +1111,77 @@ static struct stdio_file_record_ref *stdio_track_new_file_record(
     return(rec_ref);
 }
 
+/* returns the reference to the overflow record that the file 'file_rec_id'
+ * at 'path' is accounted to when it can't be tracked individually,
+ * registering the overflow record if needed
+ */
+static struct stdio_file_record_ref *stdio_track_overflow_record(
+    darshan_record_id file_rec_id, const char *path)
+{
+    struct darshan_stdio_file *file_rec;
+    struct stdio_file_record_ref *rec_ref;
+    struct darshan_fs_info fs_info;
+    darshan_record_id rec_id;
+    int ret;
+
+    file_rec = darshan_core_register_overflow_record(
+        file_rec_id,
+        path,
+        DARSHAN_STDIO_MOD,
+        sizeof(struct darshan_stdio_file),
+        &rec_id,
+        &fs_info);
+    if(!file_rec)
+        return(NULL);
+
+    rec_ref = darshan_lookup_record_ref(stdio_runtime->rec_id_hash,
+        &rec_id, sizeof(darshan_record_id));
+    if(rec_ref)
+        return(rec_ref);
+
+    rec_ref = malloc(sizeof(*rec_ref));
+    if(!rec_ref)
+        return(NULL);
+    memset(rec_ref, 0, sizeof(*rec_ref));
+
+    ret = darshan_add_record_ref(&(stdio_runtime->rec_id_hash), &rec_id,
+        sizeof(darshan_record_id), rec_ref);
+    if(ret == 0)
+    {
+        free(rec_ref);
+        return(NULL);
+    }
+
+    file_rec->base_rec.id = rec_id;
+    file_rec->base_rec.rank = my_rank;
+    rec_ref->fs_type = fs_info.fs_type;
+    rec_ref->file_rec = file_rec;
+    rec_ref->overflow = 1;
+    stdio_runtime->file_rec_count++;
+
+    return(rec_ref);
+}
+
 #ifdef HAVE_MPI
+/* counters of shared STDIO file records that are reduced with a single
+ * operation; the remaining counters are special cases in
+ * stdio_record_reduction_op()
+ */
+#define STDIO_COUNTER_SPANS(X) \
+    X(sum, STDIO_OPENS, STDIO_BYTES_READ) \
+    X(max, STDIO_MAX_BYTE_READ, STDIO_MAX_BYTE_WRITTEN)
+#define STDIO_FCOUNTER_SPANS(X) \
+    X(sum, STDIO_F_META_TIME, STDIO_F_READ_TIME) \
+    X(min_nonzero, STDIO_F_OPEN_START_TIMESTAMP, STDIO_F_READ_START_TIMESTAMP) \
+    X(max, STDIO_F_OPEN_END_TIMESTAMP, STDIO_F_READ_END_TIMESTAMP)
+
 static void stdio_record_reduction_op(void* infile_v, void* inoutfile_v,
     int *len, MPI_Datatype *datatype)
 {
     struct darshan_stdio_file tmp_file;
     struct darshan_stdio_file *infile = infile_v;
     struct darshan_stdio_file *inoutfile = inoutfile_v;
-    int i, j;
+    int i;
 
     assert(stdio_runtime);
 
@@ -1124,45 +1191,10 @@ static void stdio_record_reduction_op(void* infile_v, void* inoutfile_v,
         tmp_file.base_rec.id = infile->base_rec.id;
         tmp_file.base_rec.rank = -1;
 
-        /* sum */
-        for(j=STDIO_OPENS; j<=STDIO_BYTES_READ; j++)
-        {
-            tmp_file.counters[j] = infile->counters[j] + inoutfile->counters[j];
-        }
-        
-        /* max */
-        for(j=STDIO_MAX_BYTE_READ; j<=STDIO_MAX_BYTE_WRITTEN; j++)
-        {
-            if(infile->counters[j] > inoutfile->counters[j])
-                tmp_file.counters[j] = infile->counters[j];
-            else
-                tmp_file.counters[j] = inoutfile->counters[j];
-        }
-
-        /* sum */
-        for(j=STDIO_F_META_TIME; j<=STDIO_F_READ_TIME; j++)
-        {
-            tmp_file.fcounters[j] = infile->fcounters[j] + inoutfile->fcounters[j];
-        }
-
-        /* min non-zero (if available) value */
-        for(j=STDIO_F_OPEN_START_TIMESTAMP; j<=STDIO_F_READ_START_TIMESTAMP; j++)
-        {
-            if((infile->fcounters[j] < inoutfile->fcounters[j] &&
-               infile->fcounters[j] > 0) || inoutfile->fcounters[j] == 0) 
-                tmp_file.fcounters[j] = infile->fcounters[j];
-            else
-                tmp_file.fcounters[j] = inoutfile->fcounters[j];
-        }
-
-        /* max */
-        for(j=STDIO_F_OPEN_END_TIMESTAMP; j<=STDIO_F_READ_END_TIMESTAMP; j++)
-        {
-            if(infile->fcounters[j] > inoutfile->fcounters[j])
-                tmp_file.fcounters[j] = infile->fcounters[j];
-            else
-                tmp_file.fcounters[j] = inoutfile->fcounters[j];
-        }
+        DARSHAN_REDUCE_COUNTER_SPANS(STDIO_COUNTER_SPANS,
+            infile->counters, inoutfile->counters, tmp_file.counters);
+        DARSHAN_REDUCE_FCOUNTER_SPANS(STDIO_FCOUNTER_SPANS,
+            infile->fcounters, inoutfile->fcounters, tmp_file.fcounters);
 
         /* min (zeroes are ok here; some procs don't do I/O) */
         if(infile->fcounters[STDIO_F_FASTEST_RANK_TIME] <
@@ -1214,88 +1246,6 @@ static void stdio_record_reduction_op(void* infile_v, void* inoutfile_v,
 
     return;
 }
-
-static void stdio_shared_record_variance(MPI_Comm mod_comm,
-    struct darshan_stdio_file *inrec_array, struct darshan_stdio_file *outrec_array,
-    int shared_rec_count)
-{
-    MPI_Datatype var_dt;
-    MPI_Op var_op;
-    int i;
-    struct darshan_variance_dt *var_send_buf = NULL;
-    struct darshan_variance_dt *var_recv_buf = NULL;
-
-    PMPI_Type_contiguous(sizeof(struct darshan_variance_dt),
-        MPI_BYTE, &var_dt);
-    PMPI_Type_commit(&var_dt);
-
-    PMPI_Op_create(darshan_variance_reduce, 1, &var_op);
-
-    var_send_buf = malloc(shared_rec_count * sizeof(struct darshan_variance_dt));
-    if(!var_send_buf)
-        return;
-
-    if(my_rank == 0)
-    {
-        var_recv_buf = malloc(shared_rec_count * sizeof(struct darshan_variance_dt));
-
-        if(!var_recv_buf)
-            return;
-    }
-
-    /* get total i/o time variances for shared records */
-
-    for(i=0; i<shared_rec_count; i++)
-    {
-        var_send_buf[i].n = 1;
-        var_send_buf[i].S = 0;
-        var_send_buf[i].T = inrec_array[i].fcounters[STDIO_F_READ_TIME] +
-                            inrec_array[i].fcounters[STDIO_F_WRITE_TIME] +
-                            inrec_array[i].fcounters[STDIO_F_META_TIME];
-    }
-
-    PMPI_Reduce(var_send_buf, var_recv_buf, shared_rec_count,
-        var_dt, var_op, 0, mod_comm);
-
-    if(my_rank == 0)
-    {
-        for(i=0; i<shared_rec_count; i++)
-        {
-            outrec_array[i].fcounters[STDIO_F_VARIANCE_RANK_TIME] =
-                (var_recv_buf[i].S / var_recv_buf[i].n);
-        }
-    }
-
-    /* get total bytes moved variances for shared records */
-
-    for(i=0; i<shared_rec_count; i++)
-    {
-        var_send_buf[i].n = 1;
-        var_send_buf[i].S = 0;
-        var_send_buf[i].T = (double)
-                            inrec_array[i].counters[STDIO_BYTES_READ] +
-                            inrec_array[i].counters[STDIO_BYTES_WRITTEN];
-    }
-
-    PMPI_Reduce(var_send_buf, var_recv_buf, shared_rec_count,
-        var_dt, var_op, 0, mod_comm);
-
-    if(my_rank == 0)
-    {
-        for(i=0; i<shared_rec_count; i++)
-        {
-            outrec_array[i].fcounters[STDIO_F_VARIANCE_RANK_BYTES] =
-                (var_recv_buf[i].S / var_recv_buf[i].n);
-        }
-    }
-
-    PMPI_Type_free(&var_dt);
-    PMPI_Op_free(&var_op);
-    free(var_send_buf);
-    free(var_recv_buf);
-
-    return;
-}
 #endif
 
 char *darshan_stdio_lookup_record_name(FILE *stream)
@@ -1308,7 +1258,8 @@ char *darshan_stdio_lookup_record_name(FILE *stream)
     {
         rec_ref = darshan_lookup_record_ref(stdio_runtime->stream_hash,
             &stream, sizeof(stream));
-        if(rec_ref)
+        /* the names of overflow records don't identify a single file */
+        if(rec_ref && !rec_ref->overflow)
             rec_name = darshan_core_lookup_record_name(rec_ref->file_rec->base_rec.id);
     }
     STDIO_UNLOCK();
@@ -1332,9 +1283,7 @@ static void stdio_mpi_redux(
     struct darshan_stdio_file *stdio_rec_buf = (struct darshan_stdio_file *)stdio_buf;
     double stdio_time;
     struct darshan_stdio_file *red_send_buf = NULL;
-    struct darshan_stdio_file *red_recv_buf = NULL;
-    MPI_Datatype red_type;
-    MPI_Op red_op;
+    int kept_rec_count;
     int i;
 
     STDIO_LOCK();
@@ -1386,52 +1335,30 @@ static void stdio_mpi_redux(
     /* make *send_buf point to the shared files at the end of sorted array */
     red_send_buf = &(stdio_rec_buf[stdio_rec_count-shared_rec_count]);
 
-    /* allocate memory for the reduction output on rank 0 */
-    if(my_rank == 0)
-    {
-        red_recv_buf = malloc(shared_rec_count * sizeof(struct darshan_stdio_file));
-        if(!red_recv_buf)
-        {
-            STDIO_UNLOCK();
-            return;
-        }
-    }
-
-    /* construct a datatype for a STDIO file record.  This is serving no purpose
-     * except to make sure we can do a reduction on proper boundaries
+    /* queue the shared records to be reduced along with those of other
+     * modules, storing the time and bytes this rank contributes to the
+     * variance counters
      */
-    PMPI_Type_contiguous(sizeof(struct darshan_stdio_file),
-        MPI_BYTE, &red_type);
-    PMPI_Type_commit(&red_type);
-
-    /* register a STDIO file record reduction operator */
-    PMPI_Op_create(stdio_record_reduction_op, 1, &red_op);
-
-    /* reduce shared STDIO file records */
-    PMPI_Reduce(red_send_buf, red_recv_buf,
-        shared_rec_count, red_type, red_op, 0, mod_comm);
-
-    /* get the time and byte variances for shared files */
-    stdio_shared_record_variance(mod_comm, red_send_buf, red_recv_buf,
-        shared_rec_count);
-
-    /* update module state to account for shared file reduction */
-    if(my_rank == 0)
-    {
-        /* overwrite local shared records with globally reduced records */
-        int tmp_ndx = stdio_rec_count - shared_rec_count;
-        memcpy(&(stdio_rec_buf[tmp_ndx]), red_recv_buf,
-            shared_rec_count * sizeof(struct darshan_stdio_file));
-        free(red_recv_buf);
-    }
-    else
+    for(i = 0; i < shared_rec_count; i++)
     {
-        /* drop shared records on non-zero ranks */
-        stdio_runtime->file_rec_count -= shared_rec_count;
+        red_send_buf[i].fcounters[STDIO_F_VARIANCE_RANK_TIME] =
+            red_send_buf[i].fcounters[STDIO_F_READ_TIME] +
+            red_send_buf[i].fcounters[STDIO_F_WRITE_TIME] +
+            red_send_buf[i].fcounters[STDIO_F_META_TIME];
+        red_send_buf[i].fcounters[STDIO_F_VARIANCE_RANK_BYTES] = (double)
+            red_send_buf[i].counters[STDIO_BYTES_READ] +
+            red_send_buf[i].counters[STDIO_BYTES_WRITTEN];
     }
-
-    PMPI_Type_free(&red_type);
-    PMPI_Op_free(&red_op);
+    kept_rec_count = darshan_core_reduce_shared_records(red_send_buf, shared_rec_count,
+        sizeof(struct darshan_stdio_file), stdio_record_reduction_op,
+        offsetof(struct darshan_stdio_file, fcounters[STDIO_F_VARIANCE_RANK_TIME]),
+        offsetof(struct darshan_stdio_file, fcounters[STDIO_F_VARIANCE_RANK_BYTES]));
+
+    /* drop the shared records this rank doesn't keep. darshan-core
+     * overwrites the kept records (moved to the start of the shared
+     * records) with the reduced records.
+     */
+    stdio_runtime->file_rec_count -= shared_rec_count - kept_rec_count;
 
     STDIO_UNLOCK();
     return;
@@ -26,6 +26,14 @@
     #include <x86intrin.h>
 #endif
 
+/* unless a fixed RDTSCP frequency was configured, use the TSC for timing if
+ * it is found to be invariant and can be calibrated at runtime
+ */
+#if defined(HAVE_RDTSCP_INTRINSIC) && defined(HAVE_CPUID_H) && \
+    !defined(__DARSHAN_RDTSCP_FREQUENCY)
+#define __DARSHAN_TSC_TIMER
+#endif
+
 #include "uthash.h"
 #include "darshan-log-format.h"
 #include "darshan-common.h"
@@ -45,6 +53,21 @@
 /* Environment variable to override memory per module */
 #define DARSHAN_MOD_MEM_OVERRIDE "DARSHAN_MODMEM"
 
+/* Environment variable to override memory for record names */
+#define DARSHAN_NAME_MEM_OVERRIDE "DARSHAN_NAMEMEM"
+
+/* Environment variable to set per-module memory budgets */
+#define DARSHAN_MOD_MEM_BUDGETS_OVERRIDE "DARSHAN_MODMEM_BUDGETS"
+
+/* Environment variable to set the policy for records that don't fit in memory */
+#define DARSHAN_RECORD_OVERFLOW_OVERRIDE "DARSHAN_RECORD_OVERFLOW"
+
+/* Environment variable to back darshan's memory regions with huge pages */
+#define DARSHAN_HUGE_PAGES_OVERRIDE "DARSHAN_HUGEPAGES"
+
+/* Environment variable to select the log compression method and level */
+#define DARSHAN_LOG_COMP_OVERRIDE "DARSHAN_LOGCOMP"
+
 /* Environment variable to enable profiling without MPI */
 #define DARSHAN_ENABLE_NONMPI "DARSHAN_ENABLE_NONMPI"
 
@@ -65,8 +88,59 @@
 #define DARSHAN_MOD_MEM_MAX (4 * 1024 * 1024) /* 4 MiB default */
 #endif
 
-/* default name record buf can store 2048 records of size 100 bytes */
-#define DARSHAN_NAME_RECORD_BUF_SIZE (2048 * 100)
+/* minimum time (in seconds) spent calibrating the TSC frequency */
+#define DARSHAN_TSC_CALIBRATION_TIME 0.01
+
+/* Maximum runtime memory consumption per process for name records;
+ * the default can store 10240 records of size 100 bytes
+ */
+#define DARSHAN_NAME_MEM_MAX (10240 * 100)
+
+/* module record memory is reserved up front but only committed in chunks
+ * of this size as records are registered, and name records are allocated
+ * in chunks of this size, so that memory use grows with the number of
+ * records rather than with the configured quotas
+ */
+#define DARSHAN_MOD_MEM_CHUNK_SIZE (64 * 1024)
+#define DARSHAN_NAME_MEM_CHUNK_SIZE (64 * 1024)
+
+/* longest name whose memory is reused after its record is evicted */
+#define DARSHAN_NAME_FREE_LEN_MAX __DARSHAN_PATH_MAX
+
+/* memory that may be used past the module and name memory quotas for
+ * overflow records, which aggregate records that didn't fit in memory
+ */
+#define DARSHAN_OVERFLOW_MEM_MAX (64 * 1024)
+
+/* overflow records are named after the mount point they aggregate */
+#define DARSHAN_OVERFLOW_RECORD_NAME "<darshan-other-files>"
+
+/* policies for handling records that don't fit in module memory */
+enum darshan_record_overflow_policy
+{
+    /* drop the record and mark the module's data partial */
+    DARSHAN_RECORD_OVERFLOW_DROP = 0,
+    /* fold the record into its mount point's overflow record */
+    DARSHAN_RECORD_OVERFLOW_AGGREGATE,
+    /* modules that support it evict a low-traffic record into its mount
+     * point's overflow record to make room, otherwise the new record is
+     * aggregated
+     */
+    DARSHAN_RECORD_OVERFLOW_EVICT,
+};
+
+/* huge page backing for darshan's larger memory regions */
+enum darshan_huge_page_mode
+{
+    /* use regular pages */
+    DARSHAN_HUGE_PAGES_NONE = 0,
+    /* ask for transparent huge pages (madvise) */
+    DARSHAN_HUGE_PAGES_THP,
+    /* allocate explicit huge pages (MAP_HUGETLB), falling back to
+     * transparent huge pages if none are available
+     */
+    DARSHAN_HUGE_PAGES_HUGETLB,
+};
 
 /* maximum buffer size for full paths, for internal use only */
 #define __DARSHAN_PATH_MAX 4096
@@ -105,9 +179,30 @@ struct darshan_core_name_record_ref
     struct darshan_name_record *name_record;
     uint64_t mod_flags;
     uint64_t global_mod_flags;
+    /* number of processes that registered this record, and the lowest
+     * of their ranks, as determined at shutdown time
+     */
+    int global_rank_count;
+    int global_first_rank;
+    /* for records shared by a subset of processes, the rank this process
+     * sends its record to when reducing it over a binomial tree of the
+     * sharing processes, and the step in which it does so (-1 on the lowest
+     * sharing rank, which keeps the reduced record)
+     */
+    int global_redux_parent;
+    int global_redux_step;
     UT_hash_handle hlink;
 };
 
+/* chunk of memory for storing name records */
+struct darshan_core_name_chunk
+{
+    struct darshan_core_name_chunk *next;
+    size_t size;
+    size_t used;
+    char buf[];
+};
+
 /* in memory structure to keep up with job level data */
 struct darshan_core_runtime
 {
@@ -123,7 +218,16 @@ struct darshan_core_runtime
     size_t mod_mem_used;
     struct darshan_core_name_record_ref *name_hash;
     size_t name_mem_used;
+    struct darshan_core_name_chunk *name_chunk_head;
+    struct darshan_core_name_chunk *name_chunk_tail;
+    /* name records removed from the name hash, whose memory can be reused
+     * by names of the same length (see darshan_remove_name_record_ref())
+     */
+    struct darshan_name_record **name_free_slots;
+    int name_dead_count;
     char *comp_buf;
+    size_t comp_buf_size;
+    int comp_buf_huge_pages;
 #ifdef __DARSHAN_ENABLE_MMAP_LOGS
     char mmap_log_name[__DARSHAN_PATH_MAX];
 #endif
@@ -139,16 +243,28 @@ struct darshan_core_runtime
  */
 extern struct darshan_core_runtime *__darshan_core;
 extern double __darshan_core_wtime_offset;
+#ifdef __DARSHAN_TSC_TIMER
+/* seconds per TSC tick, or 0 if the TSC is not used for timing */
+extern double __darshan_core_tsc_period;
+#endif
 #ifdef HAVE_STDATOMIC_H
 extern atomic_flag __darshan_core_mutex;
 #define __DARSHAN_CORE_LOCK() \
     while (atomic_flag_test_and_set(&__darshan_core_mutex))
 #define __DARSHAN_CORE_UNLOCK() \
     atomic_flag_clear(&__darshan_core_mutex)
+/* set (with release semantics) once __darshan_core is fully initialized and
+ * cleared before it is torn down, so wrappers can check whether
+ * instrumentation is enabled with a plain load rather than the core lock
+ */
+extern atomic_int __darshan_core_enabled;
+#define __DARSHAN_CORE_SET_ENABLED(__enabled) \
+    atomic_store_explicit(&__darshan_core_enabled, __enabled, memory_order_release)
 #else
 extern pthread_mutex_t __darshan_core_mutex;
 #define __DARSHAN_CORE_LOCK() pthread_mutex_lock(&__darshan_core_mutex)
 #define __DARSHAN_CORE_UNLOCK() pthread_mutex_unlock(&__darshan_core_mutex)
+#define __DARSHAN_CORE_SET_ENABLED(__enabled)
 #endif
 
 /* macros for declaring wrapper functions and calling MPI routines
@@ -218,7 +334,8 @@ extern pthread_mutex_t __darshan_core_mutex;
  * module developers _may_ define a 'darshan_module_redux' function
  * to run collective MPI operations at shutdown time. Typically this
  * functionality has been used to reduce records shared globablly (given
- * in the 'shared_recs' array) into a single data record. Set to NULL
+ * in the 'shared_recs' array) into a single data record, which should be
+ * done with darshan_core_reduce_shared_records(). Set to NULL
  * avoid any reduction steps.
  */
 typedef void (*darshan_module_redux)(
@@ -247,6 +364,13 @@ typedef struct darshan_module_funcs
 {
 #ifdef HAVE_MPI
     darshan_module_redux mod_redux_func;
+    /* set if 'mod_redux_func' runs no collectives of its own, queueing all
+     * shared records with darshan_core_reduce_shared_records(). Such
+     * modules are also given records shared by a subset of processes, and
+     * their redux function is only called on the processes that share
+     * records.
+     */
+    int mod_redux_partial;
 #endif
     darshan_module_output mod_output_func;
     darshan_module_cleanup mod_cleanup_func;
@@ -295,6 +419,93 @@ void *darshan_core_register_record(
     int rec_len,
     struct darshan_fs_info *fs_info);
 
+/* darshan_core_record_overflow_policy()
+ *
+ * Returns the darshan_record_overflow_policy modules should follow when
+ * darshan_core_register_record() fails to register a record.
+ */
+int darshan_core_record_overflow_policy(
+    void);
+
+/* darshan_core_register_overflow_record()
+ *
+ * Register (or look up) the overflow record that module 'mod_id' should
+ * account the record 'rec_id' named 'name' to, after failing to register
+ * it with `darshan_core_register_record` (or evicting it). Each module has
+ * one overflow record per mount point, named after the mount point; its
+ * record id is returned in 'overflow_rec_id'. 'rec_len' and 'fs_info' are
+ * as for `darshan_core_register_record`. Overflow records are zeroed when
+ * first registered, and the caller is responsible for initializing them.
+ * Returns a pointer to the overflow record, or NULL if the overflow policy
+ * is to drop records or the overflow record can't be registered.
+ */
+void *darshan_core_register_overflow_record(
+    darshan_record_id rec_id,
+    const char *name,
+    darshan_module_id mod_id,
+    int rec_len,
+    darshan_record_id *overflow_rec_id,
+    struct darshan_fs_info *fs_info);
+
+/* darshan_core_replace_record()
+ *
+ * Replace record 'old_rec_id', which module 'mod_id' has evicted into an
+ * overflow record, with the record 'new_rec_id' named 'name', after
+ * failing to register the new record. The module reuses the evicted
+ * record's memory for the new record. 'fs_info' is as for
+ * `darshan_core_register_record`. Returns 1 on success, 0 if the new
+ * record's name can't be stored.
+ */
+int darshan_core_replace_record(
+    darshan_record_id old_rec_id,
+    darshan_record_id new_rec_id,
+    const char *name,
+    darshan_module_id mod_id,
+    struct darshan_fs_info *fs_info);
+
+/* darshan_core_huge_page_alloc()
+ *
+ * Allocate 'size' bytes of zeroed memory backed by huge pages, for large
+ * regions that are accessed at random. Returns NULL if huge pages are not
+ * enabled (see DARSHAN_HUGEPAGES), if rounding 'size' up to whole huge pages
+ * would waste more than an eighth of it, or if the memory can't be mapped,
+ * in which case the caller should fall back to malloc. The memory must be released
+ * with darshan_core_huge_page_free(), passing the same 'size'.
+ */
+void *darshan_core_huge_page_alloc(
+    size_t size);
+
+void darshan_core_huge_page_free(
+    void *buf,
+    size_t size);
+
+#ifdef HAVE_MPI
+/* darshan_core_reduce_shared_records()
+ *
+ * Queue the 'rec_count' shared records of 'rec_size' bytes each at
+ * 'rec_buf' to be reduced with the record reduction operator 'rec_op'.
+ * Module redux functions call this rather than running their own
+ * reductions: once every module's redux function has been called,
+ * darshan-core reduces the shared records of all modules together, and
+ * overwrites the records at 'rec_buf' with the result on the process that
+ * keeps them (rank 0 for records shared by all processes, or the lowest
+ * sharing rank for records shared by a subset), so 'rec_buf' must remain
+ * valid until the module's output function is called. The records this
+ * process keeps are moved to the start of 'rec_buf', and their count is
+ * returned; the module should drop the others. If 'var_time_off' and
+ * 'var_bytes_off' are not negative, they are the offsets of two double
+ * counters in each record, which hold the rank's total I/O time and bytes
+ * moved when queued and are replaced with the variance of these values
+ * across the sharing ranks.
+ */
+int darshan_core_reduce_shared_records(
+    void *rec_buf,
+    int rec_count,
+    int rec_size,
+    MPI_User_function *rec_op,
+    int var_time_off,
+    int var_bytes_off);
+#endif
 
 /* darshan_core_lookup_record_name()
  *
@@ -309,9 +520,17 @@ char *darshan_core_lookup_record_name(
  * false (0) otherwise. If instrumentation is disabled, modules should
  * no longer update any file records as part of the intercepted function
  * wrappers.
+ *
+ * NOTE: instrumentation may be disabled at any point after this returns.
+ * darshan-core functions called by modules recheck the core state under
+ * the core lock, and modules stop updating records once their output
+ * functions have been called at shutdown.
  */
 static inline int darshan_core_disabled_instrumentation(void)
 {
+#ifdef HAVE_STDATOMIC_H
+    return(!atomic_load_explicit(&__darshan_core_enabled, memory_order_acquire));
+#else
     int ret;
 
     __DARSHAN_CORE_LOCK();
@@ -322,6 +541,7 @@ static inline int darshan_core_disabled_instrumentation(void)
     __DARSHAN_CORE_UNLOCK();
 
     return(ret);
+#endif
 }
 
 /* retrieve absolute wtime */
@@ -337,6 +557,13 @@ static inline double darshan_core_wtime_absolute(void)
 #else
     /* normal path */
     struct timespec tp;
+#ifdef __DARSHAN_TSC_TIMER
+    unsigned flag;
+
+    /* TSC frequency was calibrated at initialization time */
+    if(__darshan_core_tsc_period > 0)
+        return((double)__rdtscp(&flag) * __darshan_core_tsc_period);
+#endif
     /* some notes on what function to use to retrieve time as of 2021-05:
      * - clock_gettime() is faster than MPI_Wtime() across platforms
      * - clock_gettime() is at least competitive with gettimeofday()
@@ -385,12 +612,32 @@ void darshan_core_shutdown(int write_log);
 uint32_t darshan_hashlittle(const void *key, size_t length, uint32_t initval);
 uint64_t darshan_hash(const register unsigned char *k, register uint64_t length, register uint64_t level);
 
+/* structure to track the ids of records a module failed to register or
+ * folded into overflow records, so each record is counted once however
+ * often its registration is retried
+ */
+struct darshan_core_missed_record
+{
+    darshan_record_id id;
+    int folded;
+    UT_hash_handle hlink;
+};
+
 /* structure to track registered modules */
 struct darshan_core_module
 {
+    darshan_module_id mod_id;
     void *rec_buf_start;
     void *rec_buf_p;
     size_t rec_mem_avail;
+    size_t rec_mem_reserved;
+    uint64_t rec_dropped;
+    uint64_t rec_folded;
+    struct darshan_core_missed_record *missed_hash;
+    /* overflow records, indexed by mount point (the last entry is for
+     * records not on any known mount point)
+     */
+    void *overflow_recs[DARSHAN_MAX_MNTS + 1];
     darshan_module_funcs mod_funcs;
 };
 
@@ -402,7 +649,10 @@ struct darshan_core_module
  * shutdown functionality (including a possible data reduction step when
  * using MPI). 'inout_mod_buf_size' is an input/output argument, with it
  * being set to the requested amount of module memory on input, and set to
- * the amount allocated by darshan-core on output. If Darshan is built with
+ * the amount allocated by darshan-core on output. Unless mmap logs are
+ * enabled, a module that requests a nonzero amount of memory may register
+ * records beyond this amount, up to the module memory quota, as memory is
+ * committed on demand. If Darshan is built with
  * MPI support, 'rank' is a pointer to an integer which will contain the
  * calling process's MPI rank on return. If given, 'sys_mem_alignment' is a
  * pointer to an integer which will contain the memory alignment value Darshan
@@ -5,6 +5,11 @@
 
 /* Benchmark to measure Chutzpah overhead.  This is an MPI program that uses
  * exactly one process to perform I/O on /dev/zero for testing purposes
+ *
+ * The cost of each timer backend available to darshan_core_wtime() is
+ * also measured: clock_gettime() and, on x86 platforms with an invariant
+ * TSC, RDTSCP ticks converted to seconds using a frequency calibrated
+ * against CLOCK_MONOTONIC.
  */
 
 /* Arguments: an integer specifying the number of iterations to run of each
@@ -16,9 +21,57 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#include <cpuid.h>
+#define HAVE_TSC_TIMER
+#endif
 
 #include <mpi.h>
 
+static double clock_wtime(clockid_t clk)
+{
+    struct timespec tp;
+    clock_gettime(clk, &tp);
+    return(((double)tp.tv_sec) + 1.0e-9 * ((double)tp.tv_nsec));
+}
+
+#ifdef HAVE_TSC_TIMER
+static double tsc_period = 0;
+
+/* returns the calibrated TSC frequency, or 0 if the TSC is unsuitable */
+static double tsc_calibrate(void)
+{
+    unsigned int eax, ebx, ecx, edx;
+    unsigned int flag;
+    unsigned long long ts1, ts2;
+    double t1, t2;
+
+    if(!__get_cpuid(0x80000001, &eax, &ebx, &ecx, &edx) || !(edx & (1 << 27)))
+        return(0);
+    if(!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1 << 8)))
+        return(0);
+
+    t1 = clock_wtime(CLOCK_MONOTONIC);
+    ts1 = __rdtscp(&flag);
+    do
+    {
+        t2 = clock_wtime(CLOCK_MONOTONIC);
+        ts2 = __rdtscp(&flag);
+    } while(t2 - t1 < 0.01);
+
+    return((double)(ts2 - ts1) / (t2 - t1));
+}
+
+static double tsc_wtime(void)
+{
+    unsigned int flag;
+    return((double)__rdtscp(&flag) * tsc_period);
+}
+#endif
+
 int main(int argc, char **argv) 
 {
     int nprocs;
@@ -28,6 +81,10 @@ int main(int argc, char **argv)
     int fd;
     int iters;
     double time1, time2, read1, read2, host1, host2;
+    double rt1, rt2, mono1, mono2;
+#ifdef HAVE_TSC_TIMER
+    double tsc1 = 0, tsc2 = 0, tsc_freq;
+#endif
     char onechar;
     char host[256];
 
@@ -70,6 +127,35 @@ int main(int argc, char **argv)
     }
     time2 = MPI_Wtime();
 
+    /* compare the cost of the darshan_core_wtime() backends */
+    rt1 = MPI_Wtime();
+    for(i=0; i<iters; i++)
+    {
+        read1 = clock_wtime(CLOCK_REALTIME);
+    }
+    rt2 = MPI_Wtime();
+
+    mono1 = MPI_Wtime();
+    for(i=0; i<iters; i++)
+    {
+        read1 = clock_wtime(CLOCK_MONOTONIC);
+    }
+    mono2 = MPI_Wtime();
+
+#ifdef HAVE_TSC_TIMER
+    tsc_freq = tsc_calibrate();
+    if(tsc_freq > 0)
+    {
+        tsc_period = 1.0 / tsc_freq;
+        tsc1 = MPI_Wtime();
+        for(i=0; i<iters; i++)
+        {
+            read1 = tsc_wtime();
+        }
+        tsc2 = MPI_Wtime();
+    }
+#endif
+
     sleep(1);
 
     fd = open(argv[1], O_RDONLY);
@@ -115,6 +201,14 @@ int main(int argc, char **argv)
     /* print out some timing info */
     printf("#<op>\t<iters>\t<total (s)>\t<per op (s)>\n");
     printf("wtime\t%d\t%.9f\t%.9f\n", iters, time2-time1, (time2-time1)/(double)iters);
+    printf("clock_gettime(REALTIME)\t%d\t%.9f\t%.9f\n", iters, rt2-rt1, (rt2-rt1)/(double)iters);
+    printf("clock_gettime(MONOTONIC)\t%d\t%.9f\t%.9f\n", iters, mono2-mono1, (mono2-mono1)/(double)iters);
+#ifdef HAVE_TSC_TIMER
+    if(tsc_freq > 0)
+        printf("tsc(%.0f Hz)\t%d\t%.9f\t%.9f\n", tsc_freq, iters, tsc2-tsc1, (tsc2-tsc1)/(double)iters);
+    else
+        printf("tsc\t%d\tunsupported\tunsupported\n", iters);
+#endif
     printf("read\t%d\t%.9f\t%.9f\n", iters, read2-read1, (read2-read1)/(double)iters);
     printf("gethostname\t%d\t%.9f\t%.9f\n", iters, host2-host1, (host2-host1)/(double)iters);
 
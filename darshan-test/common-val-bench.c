@@ -0,0 +1,182 @@
+/*
+ *  (C) 2021 by Argonne National Laboratory.
+ *      See COPYRIGHT in top-level directory.
+ */
+
+/* Benchmark to compare the per-operation cost of tracking common values
+ * (e.g., the POSIX_ACCESS* and POSIX_STRIDE* counters) using the fixed-size
+ * common value table against the previous approach of keeping a tsearch()
+ * tree of values and re-sorting the 4 common value counters on every
+ * operation.
+ *
+ * This benchmark only needs the darshan-common.h header, e.g.:
+ *
+ *   cc -O2 -I../darshan-runtime/lib common-val-bench.c -o common-val-bench
+ */
+
+/* Arguments: the number of operations to run for each access pattern */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <search.h>
+#include <assert.h>
+#include <time.h>
+
+#include "uthash.h"
+#include "darshan-common.h"
+
+#define NPATTERNS 4
+
+static const char *pattern_names[NPATTERNS] = {
+    "constant", "4 values", "32 values", "1024 values"};
+static const int pattern_nvals[NPATTERNS] = {1, 4, 32, 1024};
+
+static double wtime(void)
+{
+    struct timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return(((double)tp.tv_sec) + 1.0e-9 * ((double)tp.tv_nsec));
+}
+
+/* previous tsearch()-based implementation of common value tracking */
+static int legacy_vals_compare(const void *a_p, const void *b_p)
+{
+    const struct darshan_common_val_counter* a = a_p;
+    const struct darshan_common_val_counter* b = b_p;
+
+    return(memcmp(a->vals, b->vals, sizeof(*(a->vals)) * a->nvals));
+}
+
+static struct darshan_common_val_counter *legacy_track_common_val_counters(
+    void **common_val_root, int64_t *vals, int nvals, int *common_val_count)
+{
+    struct darshan_common_val_counter* counter;
+    struct darshan_common_val_counter* found = NULL;
+    struct darshan_common_val_counter tmp_counter;
+    void* tmp;
+
+    memcpy(tmp_counter.vals, vals, sizeof(*vals) * nvals);
+    tmp_counter.nvals = nvals;
+    tmp_counter.freq = 1;
+    tmp = tfind(&tmp_counter, common_val_root, legacy_vals_compare);
+    if(tmp)
+    {
+        found = *(struct darshan_common_val_counter**)tmp;
+        found->freq++;
+    }
+    else if(*common_val_count < DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT)
+    {
+        counter = malloc(sizeof(*counter));
+        if(!counter)
+            return(NULL);
+
+        memcpy(counter->vals, vals, sizeof(*vals) * nvals);
+        counter->nvals = nvals;
+        counter->freq = 1;
+
+        tmp = tsearch(counter, common_val_root, legacy_vals_compare);
+        found = *(struct darshan_common_val_counter**)tmp;
+        (*common_val_count)++;
+    }
+
+    return(found);
+}
+
+int main(int argc, char **argv)
+{
+    int iters;
+    int ret;
+    int p, i;
+    int64_t *vals;
+    double time1, time2;
+    double legacy_ns, table_ns;
+    int64_t legacy_val[4], legacy_cnt[4];
+    int64_t table_val[4], table_cnt[4];
+    void *root;
+    int root_count;
+    struct darshan_common_val_counter *cvc;
+    struct darshan_common_val_table table;
+
+    if(argc != 2)
+    {
+        fprintf(stderr, "Usage: %s <ops per pattern>\n", argv[0]);
+        return(-1);
+    }
+    ret = sscanf(argv[1], "%d", &iters);
+    if(ret != 1 || iters < 1)
+    {
+        fprintf(stderr, "Usage: %s <ops per pattern>\n", argv[0]);
+        return(-1);
+    }
+
+    vals = malloc(iters * sizeof(*vals));
+    if(!vals)
+    {
+        perror("malloc");
+        return(-1);
+    }
+
+    printf("#<pattern>\t<ops>\t<tsearch (ns/op)>\t<table (ns/op)>\t<speedup>\n");
+
+    for(p=0; p<NPATTERNS; p++)
+    {
+        /* skewed sizes, so that the common values are well defined */
+        srand(p + 1);
+        for(i=0; i<iters; i++)
+        {
+            if(rand() % 2)
+                vals[i] = 4096 * (1 + (rand() % pattern_nvals[p]));
+            else
+                vals[i] = 4096 * (1 + (rand() % ((pattern_nvals[p] + 1) / 2)));
+        }
+
+        /* previous implementation: tree lookup and counter update per op */
+        root = NULL;
+        root_count = 0;
+        memset(legacy_val, 0, sizeof(legacy_val));
+        memset(legacy_cnt, 0, sizeof(legacy_cnt));
+        time1 = wtime();
+        for(i=0; i<iters; i++)
+        {
+            cvc = legacy_track_common_val_counters(&root, &vals[i], 1,
+                &root_count);
+            if(cvc) DARSHAN_UPDATE_COMMON_VAL_COUNTERS(legacy_val, legacy_cnt,
+                cvc->vals, 1, cvc->freq, 0);
+        }
+        time2 = wtime();
+        legacy_ns = (time2 - time1) * 1e9 / iters;
+        tdestroy(root, free);
+
+        /* common value table: counters are only computed at finalize time,
+         * which is included in the measurement
+         */
+        memset(&table, 0, sizeof(table));
+        memset(table_val, 0, sizeof(table_val));
+        memset(table_cnt, 0, sizeof(table_cnt));
+        time1 = wtime();
+        for(i=0; i<iters; i++)
+            darshan_common_val_table_add(&table, vals[i], 1);
+        for(i=0; i<table.count; i++)
+            DARSHAN_UPDATE_COMMON_VAL_COUNTERS(table_val, table_cnt,
+                &(table.vals[i]), 1, table.freqs[i], 1);
+        time2 = wtime();
+        table_ns = (time2 - time1) * 1e9 / iters;
+
+        if(memcmp(legacy_val, table_val, sizeof(legacy_val)) ||
+           memcmp(legacy_cnt, table_cnt, sizeof(legacy_cnt)))
+        {
+            fprintf(stderr, "Error: common values differ for pattern '%s'\n",
+                pattern_names[p]);
+            return(-1);
+        }
+
+        printf("%s\t%d\t%.2f\t%.2f\t%.2f\n", pattern_names[p], iters,
+            legacy_ns, table_ns, legacy_ns / table_ns);
+    }
+
+    free(vals);
+    return(0);
+}
@@ -3,6 +3,17 @@
  *      See COPYRIGHT in top-level directory.
  */
 
+/* To compare writing the log from all processes against writing it through
+ * one process per node, run the benchmark with and without
+ * DARSHAN_NODE_AGGREGATION and compare the reported shutdown times, e.g.:
+ *
+ *   mpiexec -n 256 -env LD_PRELOAD libdarshan.so \
+ *       -env DARSHAN_INTERNAL_TIMING 1 ./darshan-shutdown-bench
+ *   mpiexec -n 256 -env LD_PRELOAD libdarshan.so \
+ *       -env DARSHAN_INTERNAL_TIMING 1 -env DARSHAN_NODE_AGGREGATION 1 \
+ *       ./darshan-shutdown-bench
+ */
+
 /* Arguments: an integer specifying the number of iterations to run of each
  * test phase
  */
@@ -0,0 +1,326 @@
+/*
+ *  (C) 2021 by Argonne National Laboratory.
+ *      See COPYRIGHT in top-level directory.
+ */
+
+/* Benchmark to compare the compression ratio of the log compression methods
+ * against the time they add to Darshan's shutdown.  The log file regions
+ * (job record, name records and module data) of each log are inflated into
+ * memory and then compressed again region by region, with each method and
+ * level, the same way darshan-core compresses them at shutdown time.
+ *
+ * The logs must be in the current log format and zlib compressed, so
+ * convert older logs (e.g., the ones in example-output) first:
+ *
+ *   for f in example-output/mpi-io-test-*.darshan; do
+ *       darshan-convert $f /tmp/`basename $f`; done
+ *   cc -O2 -DHAVE_LIBZSTD -DHAVE_LIBLZ4 -I../include log-compression-bench.c \
+ *       -o log-compression-bench -lz -lzstd -llz4
+ *   ./log-compression-bench 5 /tmp/mpi-io-test-*.darshan
+ *
+ * zstd and lz4 are optional; leave out their -D flag and library to build
+ * the benchmark without them.
+ */
+
+/* Arguments: the number of times to repeat each compression (the best time
+ * is reported), followed by one or more log files
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#ifdef HAVE_LIBZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_LIBLZ4
+#include <lz4frame.h>
+#endif
+
+#include "darshan-log-format.h"
+
+/* job record region, name record region, and module regions */
+#define MAX_REGIONS (DARSHAN_MAX_MODS + 2)
+
+struct bench_method
+{
+    const char *name;
+    enum darshan_comp_type type;
+    int level;
+};
+
+static struct bench_method methods[] =
+{
+    {"zlib", DARSHAN_ZLIB_COMP, 1},
+    {"zlib", DARSHAN_ZLIB_COMP, Z_DEFAULT_COMPRESSION},
+    {"zlib", DARSHAN_ZLIB_COMP, 9},
+#ifdef HAVE_LIBZSTD
+    {"zstd", DARSHAN_ZSTD_COMP, 1},
+    {"zstd", DARSHAN_ZSTD_COMP, 3},
+    {"zstd", DARSHAN_ZSTD_COMP, 9},
+    {"zstd", DARSHAN_ZSTD_COMP, 19},
+#endif
+#ifdef HAVE_LIBLZ4
+    {"lz4", DARSHAN_LZ4_COMP, 0},
+    {"lz4", DARSHAN_LZ4_COMP, 9},
+#endif
+};
+#define NUM_METHODS (sizeof(methods) / sizeof(methods[0]))
+
+struct bench_region
+{
+    char *buf;
+    size_t len;
+};
+
+static double wtime(void)
+{
+    struct timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return(((double)tp.tv_sec) + 1.0e-9 * ((double)tp.tv_nsec));
+}
+
+/* inflate a log file region, which may hold one zlib stream per process
+ * that wrote it
+ */
+static int inflate_region(char *in, size_t in_len, struct bench_region *region)
+{
+    z_stream strm;
+    size_t size = in_len * 4 + 4096;
+    int ret;
+
+    region->buf = malloc(size);
+    region->len = 0;
+    if(!region->buf)
+        return(-1);
+
+    memset(&strm, 0, sizeof(strm));
+    if(inflateInit(&strm) != Z_OK)
+        return(-1);
+    strm.next_in = (unsigned char *)in;
+    strm.avail_in = in_len;
+    while(strm.avail_in > 0)
+    {
+        if(region->len == size)
+        {
+            size *= 2;
+            region->buf = realloc(region->buf, size);
+            if(!region->buf)
+                break;
+        }
+        strm.next_out = (unsigned char *)region->buf + region->len;
+        strm.avail_out = size - region->len;
+        ret = inflate(&strm, Z_NO_FLUSH);
+        region->len = size - strm.avail_out;
+        if(ret == Z_STREAM_END)
+            inflateReset(&strm);
+        else if(ret != Z_OK)
+            break;
+    }
+    inflateEnd(&strm);
+
+    return((region->buf && strm.avail_in == 0) ? 0 : -1);
+}
+
+/* read the log file regions of a current format, zlib compressed log */
+static int read_regions(const char *path, struct bench_region *regions,
+    int *region_count)
+{
+    struct darshan_header hdr;
+    struct darshan_log_map maps[MAX_REGIONS];
+    struct stat statbuf;
+    char *in;
+    int fd;
+    int i;
+    int ret = 0;
+
+    fd = open(path, O_RDONLY);
+    if(fd < 0 || fstat(fd, &statbuf) < 0)
+    {
+        perror(path);
+        return(-1);
+    }
+    if(pread(fd, &hdr, sizeof(hdr), 0) != sizeof(hdr) ||
+       hdr.magic_nr != DARSHAN_MAGIC_NR ||
+       strcmp(hdr.version_string, DARSHAN_LOG_VERSION) != 0 ||
+       hdr.comp_type != DARSHAN_ZLIB_COMP)
+    {
+        fprintf(stderr, "%s: not a zlib compressed version %s log, convert "
+            "it with darshan-convert first.\n", path, DARSHAN_LOG_VERSION);
+        close(fd);
+        return(-1);
+    }
+
+    /* the job record follows the header and precedes the name records */
+    maps[0].off = sizeof(hdr);
+    maps[0].len = hdr.name_map.off - sizeof(hdr);
+    maps[1] = hdr.name_map;
+    for(i = 0; i < DARSHAN_MAX_MODS; i++)
+        maps[i + 2] = hdr.mod_map[i];
+
+    *region_count = 0;
+    for(i = 0; i < MAX_REGIONS && ret == 0; i++)
+    {
+        if(maps[i].len == 0)
+            continue;
+        in = malloc(maps[i].len);
+        if(!in || pread(fd, in, maps[i].len, maps[i].off) !=
+            (ssize_t)maps[i].len)
+        {
+            free(in);
+            ret = -1;
+            break;
+        }
+        ret = inflate_region(in, maps[i].len, &regions[*region_count]);
+        (*region_count)++;
+        free(in);
+    }
+    close(fd);
+
+    if(ret < 0)
+        fprintf(stderr, "%s: unable to read log file regions.\n", path);
+    return(ret);
+}
+
+static size_t compress_bound(struct bench_method *method, size_t len)
+{
+#ifdef HAVE_LIBZSTD
+    if(method->type == DARSHAN_ZSTD_COMP)
+        return(ZSTD_compressBound(len));
+#endif
+#ifdef HAVE_LIBLZ4
+    if(method->type == DARSHAN_LZ4_COMP)
+        return(LZ4F_HEADER_SIZE_MAX + LZ4F_compressBound(len, NULL));
+#endif
+    return(compressBound(len));
+}
+
+/* compress one region as a single stream, returning the compressed size or
+ * 0 on error
+ */
+static size_t compress_region(struct bench_method *method,
+    struct bench_region *region, char *out, size_t out_size)
+{
+    switch(method->type)
+    {
+#ifdef HAVE_LIBZSTD
+        case DARSHAN_ZSTD_COMP:
+        {
+            size_t ret = ZSTD_compress(out, out_size, region->buf,
+                region->len, method->level);
+            return(ZSTD_isError(ret) ? 0 : ret);
+        }
+#endif
+#ifdef HAVE_LIBLZ4
+        case DARSHAN_LZ4_COMP:
+        {
+            LZ4F_preferences_t prefs;
+            size_t ret;
+
+            memset(&prefs, 0, sizeof(prefs));
+            prefs.frameInfo.blockSizeID = LZ4F_max64KB;
+            prefs.compressionLevel = method->level;
+            ret = LZ4F_compressFrame(out, out_size, region->buf, region->len,
+                &prefs);
+            return(LZ4F_isError(ret) ? 0 : ret);
+        }
+#endif
+        default:
+        {
+            uLongf len = out_size;
+            if(compress2((unsigned char *)out, &len,
+                (unsigned char *)region->buf, region->len,
+                method->level) != Z_OK)
+                return(0);
+            return(len);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    struct bench_region regions[MAX_REGIONS];
+    int region_count;
+    size_t raw_len, comp_len, out_size, len;
+    char *out;
+    int iters;
+    int m, f, r, i;
+    double time1, best;
+
+    if(argc < 3 || sscanf(argv[1], "%d", &iters) != 1 || iters < 1)
+    {
+        fprintf(stderr, "Usage: %s <iterations> <log file> ...\n", argv[0]);
+        return(-1);
+    }
+
+    printf("#<log>\t<method>\t<level>\t<raw bytes>\t<compressed bytes>\t"
+        "<ratio>\t<best time (s)>\t<MB/s>\n");
+    for(f = 2; f < argc; f++)
+    {
+        if(read_regions(argv[f], regions, &region_count) < 0)
+            return(-1);
+
+        raw_len = 0;
+        len = 0;
+        for(r = 0; r < region_count; r++)
+        {
+            raw_len += regions[r].len;
+            if(regions[r].len > len)
+                len = regions[r].len;
+        }
+        out_size = 0;
+        for(m = 0; m < (int)NUM_METHODS; m++)
+        {
+            if(compress_bound(&methods[m], len) > out_size)
+                out_size = compress_bound(&methods[m], len);
+        }
+        out = malloc(out_size);
+        if(!out)
+        {
+            perror("malloc");
+            return(-1);
+        }
+
+        for(m = 0; m < (int)NUM_METHODS; m++)
+        {
+            best = 0;
+            comp_len = 0;
+            for(i = 0; i < iters; i++)
+            {
+                comp_len = 0;
+                time1 = wtime();
+                for(r = 0; r < region_count; r++)
+                {
+                    len = compress_region(&methods[m], &regions[r], out,
+                        out_size);
+                    if(len == 0 && regions[r].len > 0)
+                    {
+                        fprintf(stderr, "Error: %s compression failed.\n",
+                            methods[m].name);
+                        return(-1);
+                    }
+                    comp_len += len;
+                }
+                time1 = wtime() - time1;
+                if(i == 0 || time1 < best)
+                    best = time1;
+            }
+
+            printf("%s\t%s\t%d\t%zu\t%zu\t%.2f\t%.6f\t%.1f\n", argv[f],
+                methods[m].name, methods[m].level, raw_len, comp_len,
+                (double)raw_len / comp_len, best,
+                (raw_len / (1024.0 * 1024.0)) / best);
+        }
+
+        free(out);
+        for(r = 0; r < region_count; r++)
+            free(regions[r].buf);
+    }
+
+    return(0);
+}
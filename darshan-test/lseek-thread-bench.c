@@ -0,0 +1,161 @@
+/*
+ *  (C) 2021 by Argonne National Laboratory.
+ *      See COPYRIGHT in top-level directory.
+ */
+
+/* Benchmark to measure contention in the instrumentation fast path as the
+ * number of application threads grows.  Each thread repeatedly calls
+ * lseek(), which is cheap in the kernel, on its own descriptor for a shared
+ * file, so the measured cost is dominated by the wrapper itself (checking
+ * whether instrumentation is enabled, timing, and updating the record).
+ *
+ * This is not an MPI program; run it with Darshan preloaded and
+ * DARSHAN_ENABLE_NONMPI set, e.g.:
+ *
+ *   LD_PRELOAD=libdarshan.so DARSHAN_ENABLE_NONMPI=1 ./lseek-thread-bench /tmp/foo 64 1000000
+ *
+ * Use a file in an excluded directory (e.g., /dev/zero) to measure wrappers
+ * that do not update any record.
+ */
+
+/* Arguments: the file to seek in (created if needed), the maximum number of
+ * threads to test, and the number of operations per thread
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+
+struct thread_args
+{
+    const char *path;
+    int iters;
+    pthread_barrier_t *barrier;
+    int err;
+};
+
+static double wtime(void)
+{
+    struct timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return(((double)tp.tv_sec) + 1.0e-9 * ((double)tp.tv_nsec));
+}
+
+static void *bench_thread(void *arg)
+{
+    struct thread_args *targs = arg;
+    int fd;
+    int i;
+
+    fd = open(targs->path, O_CREAT|O_RDWR, 0644);
+    if(fd < 0)
+    {
+        perror("open");
+        targs->err = 1;
+    }
+
+    /* start all threads at the same time */
+    pthread_barrier_wait(targs->barrier);
+
+    if(fd >= 0)
+    {
+        for(i=0; i<targs->iters; i++)
+        {
+            if(lseek(fd, (off_t)(i % 4096), SEEK_SET) < 0)
+            {
+                perror("lseek");
+                targs->err = 1;
+                break;
+            }
+        }
+    }
+
+    pthread_barrier_wait(targs->barrier);
+
+    if(fd >= 0)
+        close(fd);
+
+    return(NULL);
+}
+
+int main(int argc, char **argv)
+{
+    int max_threads;
+    int iters;
+    int nthreads;
+    int i;
+    int ret;
+    double time1, time2;
+    pthread_t *threads;
+    struct thread_args *targs;
+    pthread_barrier_t barrier;
+
+    if(argc != 4)
+    {
+        fprintf(stderr, "Usage: %s <file> <max threads> <ops per thread>\n", argv[0]);
+        return(-1);
+    }
+
+    ret = sscanf(argv[2], "%d", &max_threads);
+    if(ret != 1 || max_threads < 1)
+    {
+        fprintf(stderr, "Usage: %s <file> <max threads> <ops per thread>\n", argv[0]);
+        return(-1);
+    }
+    ret = sscanf(argv[3], "%d", &iters);
+    if(ret != 1 || iters < 1)
+    {
+        fprintf(stderr, "Usage: %s <file> <max threads> <ops per thread>\n", argv[0]);
+        return(-1);
+    }
+
+    threads = malloc(max_threads * sizeof(*threads));
+    targs = malloc(max_threads * sizeof(*targs));
+    if(!threads || !targs)
+    {
+        perror("malloc");
+        return(-1);
+    }
+
+    printf("#<threads>\t<ops>\t<total (s)>\t<ns/op per thread>\t<ops/s>\n");
+
+    for(nthreads=1; nthreads<=max_threads; nthreads*=2)
+    {
+        /* one extra barrier participant for the timing thread */
+        pthread_barrier_init(&barrier, NULL, nthreads+1);
+        for(i=0; i<nthreads; i++)
+        {
+            targs[i].path = argv[1];
+            targs[i].iters = iters;
+            targs[i].barrier = &barrier;
+            targs[i].err = 0;
+            pthread_create(&threads[i], NULL, bench_thread, &targs[i]);
+        }
+
+        pthread_barrier_wait(&barrier);
+        time1 = wtime();
+        pthread_barrier_wait(&barrier);
+        time2 = wtime();
+
+        for(i=0; i<nthreads; i++)
+        {
+            pthread_join(threads[i], NULL);
+            if(targs[i].err)
+                return(-1);
+        }
+        pthread_barrier_destroy(&barrier);
+
+        printf("%d\t%ld\t%.6f\t%.1f\t%.1f\n", nthreads, (long)iters*nthreads,
+            time2-time1, (time2-time1)*1e9/iters,
+            ((double)iters*nthreads)/(time2-time1));
+    }
+
+    free(threads);
+    free(targs);
+    return(0);
+}
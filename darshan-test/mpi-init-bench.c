@@ -0,0 +1,71 @@
+/*
+ *  (C) 2021 by Argonne National Laboratory.
+ *      See COPYRIGHT in top-level directory.
+ */
+
+/* Benchmark to measure the time spent in MPI_Init(), which includes
+ * Darshan's initialization (e.g., the discovery of mounted file systems)
+ * when the benchmark runs with Darshan preloaded.  MPI_Init() can only be
+ * called once per process, so the benchmark is run several times and
+ * reports the slowest and average process each time.
+ *
+ * Compare runs with and without Darshan preloaded, and across Darshan
+ * versions, with many processes per node, e.g.:
+ *
+ *   for i in 1 2 3 4 5; do mpiexec -n 128 ./mpi-init-bench; done
+ *   for i in 1 2 3 4 5; do mpiexec -n 128 -env LD_PRELOAD libdarshan.so \
+ *       ./mpi-init-bench; done
+ *
+ * With DARSHAN_INTERNAL_TIMING set, Darshan also reports the time of its
+ * own initialization ("darshan:init").
+ */
+
+/* Arguments: none
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#include <mpi.h>
+
+static double wtime(void)
+{
+    struct timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return(((double)tp.tv_sec) + 1.0e-9 * ((double)tp.tv_nsec));
+}
+
+int main(int argc, char **argv)
+{
+    double time1, init_time, max_time, sum_time;
+    int rank, nprocs;
+
+    time1 = wtime();
+    MPI_Init(&argc, &argv);
+    init_time = wtime() - time1;
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+    if(argc != 1)
+    {
+        if(rank == 0)
+            fprintf(stderr, "Usage: %s\n", argv[0]);
+        MPI_Finalize();
+        return(-1);
+    }
+
+    MPI_Reduce(&init_time, &max_time, 1, MPI_DOUBLE, MPI_MAX, 0,
+        MPI_COMM_WORLD);
+    MPI_Reduce(&init_time, &sum_time, 1, MPI_DOUBLE, MPI_SUM, 0,
+        MPI_COMM_WORLD);
+
+    if(rank == 0)
+    {
+        printf("#<nprocs>\t<max MPI_Init (s)>\t<avg MPI_Init (s)>\n");
+        printf("%d\t%.6f\t%.6f\n", nprocs, max_time, sum_time / nprocs);
+    }
+
+    MPI_Finalize();
+    return(0);
+}
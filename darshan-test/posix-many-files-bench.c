@@ -0,0 +1,151 @@
+/*
+ *  (C) 2021 by Argonne National Laboratory.
+ *      See COPYRIGHT in top-level directory.
+ */
+
+/* Benchmark to measure the per-operation cost of the instrumented POSIX
+ * wrappers when an application accesses many files at random, so that
+ * Darshan's per-file state is spread across a large working set.  The
+ * benchmark opens the requested number of files (raising the open file
+ * limit if needed), and then issues small pread() calls and fstat() calls
+ * to files chosen at random.
+ *
+ * This is not an MPI program; compare runs with and without Darshan
+ * preloaded, and with and without huge pages, e.g.:
+ *
+ *   ./posix-many-files-bench /tmp 16384 1000000
+ *   LD_PRELOAD=libdarshan.so DARSHAN_ENABLE_NONMPI=1 DARSHAN_MODMEM=64 \
+ *       ./posix-many-files-bench /tmp 16384 1000000
+ *   LD_PRELOAD=libdarshan.so DARSHAN_ENABLE_NONMPI=1 DARSHAN_MODMEM=64 \
+ *       DARSHAN_HUGEPAGES=thp ./posix-many-files-bench /tmp 16384 1000000
+ */
+
+/* Arguments: a directory to create test files in, the number of files, and
+ * the number of operations to issue
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <fcntl.h>
+#include <time.h>
+
+#define ACCESS_SIZE 64
+
+static double wtime(void)
+{
+    struct timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return(((double)tp.tv_sec) + 1.0e-9 * ((double)tp.tv_nsec));
+}
+
+/* xorshift, so that the access order doesn't depend on the libc */
+static unsigned long next_rand(unsigned long *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return(*state);
+}
+
+int main(int argc, char **argv)
+{
+    char path[256];
+    char buf[ACCESS_SIZE];
+    struct rlimit rlim;
+    struct stat statbuf;
+    unsigned long rand_state = 88172645463325252UL;
+    int nfiles;
+    int iters;
+    int *fds;
+    int i;
+    int ret;
+    double time1, time2, time3;
+
+    if(argc != 4)
+    {
+        fprintf(stderr, "Usage: %s <directory> <files> <ops>\n", argv[0]);
+        return(-1);
+    }
+
+    ret = sscanf(argv[2], "%d", &nfiles);
+    if(ret != 1 || nfiles < 1)
+    {
+        fprintf(stderr, "Usage: %s <directory> <files> <ops>\n", argv[0]);
+        return(-1);
+    }
+    ret = sscanf(argv[3], "%d", &iters);
+    if(ret != 1 || iters < 1)
+    {
+        fprintf(stderr, "Usage: %s <directory> <files> <ops>\n", argv[0]);
+        return(-1);
+    }
+
+    /* make room for all of the files to be open at once */
+    if(getrlimit(RLIMIT_NOFILE, &rlim) == 0 && rlim.rlim_cur < nfiles + 16)
+    {
+        rlim.rlim_cur = nfiles + 16;
+        if(rlim.rlim_cur > rlim.rlim_max)
+            rlim.rlim_cur = rlim.rlim_max;
+        (void)setrlimit(RLIMIT_NOFILE, &rlim);
+    }
+
+    fds = malloc(nfiles * sizeof(*fds));
+    if(!fds)
+    {
+        perror("malloc");
+        return(-1);
+    }
+    memset(buf, 'a', ACCESS_SIZE);
+
+    time1 = wtime();
+    for(i=0; i<nfiles; i++)
+    {
+        snprintf(path, 256, "%s/posix-many-files-bench.%d.%d", argv[1],
+            (int)getpid(), i);
+        fds[i] = open(path, O_CREAT|O_RDWR|O_TRUNC, 0644);
+        if(fds[i] < 0)
+        {
+            perror("open");
+            return(-1);
+        }
+        if(pwrite(fds[i], buf, ACCESS_SIZE, 0) != ACCESS_SIZE)
+        {
+            perror("pwrite");
+            return(-1);
+        }
+    }
+    time2 = wtime();
+
+    for(i=0; i<iters; i++)
+    {
+        if(pread(fds[next_rand(&rand_state) % nfiles], buf, ACCESS_SIZE, 0)
+            != ACCESS_SIZE ||
+           fstat(fds[next_rand(&rand_state) % nfiles], &statbuf) < 0)
+        {
+            perror("pread/fstat");
+            return(-1);
+        }
+    }
+    time3 = wtime();
+
+    /* each iteration is one pread and one fstat */
+    printf("#<files>\t<open (s)>\t<ops>\t<total (s)>\t<ns/op>\n");
+    printf("%d\t%.6f\t%ld\t%.6f\t%.1f\n", nfiles, time2-time1, 2L*iters,
+        time3-time2, ((time3-time2)*1.0e9)/(2.0*iters));
+
+    for(i=0; i<nfiles; i++)
+    {
+        snprintf(path, 256, "%s/posix-many-files-bench.%d.%d", argv[1],
+            (int)getpid(), i);
+        close(fds[i]);
+        unlink(path);
+    }
+    free(fds);
+
+    return(0);
+}
@@ -0,0 +1,203 @@
+/*
+ *  (C) 2021 by Argonne National Laboratory.
+ *      See COPYRIGHT in top-level directory.
+ */
+
+/* Benchmark to measure the per-operation cost of the instrumented POSIX
+ * read/write wrappers, including the number of L1 data cache accesses and
+ * misses they cause.  A single thread issues small pwrite() and pread()
+ * calls at sequential and strided offsets within a small file, which stays
+ * in the page cache, so the cost is dominated by the system call and the
+ * instrumentation.  Cache events are counted with perf_event_open(); if
+ * they are not available (e.g. due to kernel.perf_event_paranoid), only
+ * the timings are reported.
+ *
+ * This is not an MPI program; compare runs with and without Darshan
+ * preloaded, e.g.:
+ *
+ *   ./posix-rw-bench /tmp 1000000
+ *   LD_PRELOAD=libdarshan.so DARSHAN_ENABLE_NONMPI=1 ./posix-rw-bench /tmp 1000000
+ *
+ * The difference between the two runs is the cost of the instrumentation.
+ */
+
+/* Arguments: a directory to create the test file in, and the number of
+ * operations to issue in each test
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <time.h>
+#include <linux/perf_event.h>
+
+#define ACCESS_SIZE 64
+#define FILE_SIZE (1024*1024)
+
+enum bench_event
+{
+    BENCH_L1D_ACCESSES = 0,
+    BENCH_L1D_MISSES,
+    BENCH_NUM_EVENTS
+};
+
+static const char *event_names[BENCH_NUM_EVENTS] =
+{
+    "L1D accesses",
+    "L1D misses"
+};
+
+static double wtime(void)
+{
+    struct timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return(((double)tp.tv_sec) + 1.0e-9 * ((double)tp.tv_nsec));
+}
+
+/* opens a user space L1 data cache counter for the calling thread, or
+ * returns -1 if the event is not available
+ */
+static int open_l1d_event(int miss)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_L1D |
+        (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+        ((miss ? PERF_COUNT_HW_CACHE_RESULT_MISS :
+            PERF_COUNT_HW_CACHE_RESULT_ACCESS) << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+static void run_test(const char *name, int fd, int iters, int stride,
+    int *event_fds)
+{
+    char buf[ACCESS_SIZE];
+    uint64_t counts[BENCH_NUM_EVENTS] = {0};
+    off_t off = 0;
+    double time1, time2;
+    int i;
+
+    memset(buf, 'a', ACCESS_SIZE);
+
+    for(i=0; i<BENCH_NUM_EVENTS; i++)
+    {
+        if(event_fds[i] < 0)
+            continue;
+        ioctl(event_fds[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(event_fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+    time1 = wtime();
+
+    for(i=0; i<iters; i++)
+    {
+        if(pwrite(fd, buf, ACCESS_SIZE, off) != ACCESS_SIZE ||
+           pread(fd, buf, ACCESS_SIZE, off) != ACCESS_SIZE)
+        {
+            perror("pwrite/pread");
+            exit(-1);
+        }
+        off = (off + stride) % (FILE_SIZE - ACCESS_SIZE);
+    }
+
+    time2 = wtime();
+    for(i=0; i<BENCH_NUM_EVENTS; i++)
+    {
+        if(event_fds[i] < 0)
+            continue;
+        ioctl(event_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        if(read(event_fds[i], &counts[i], sizeof(counts[i])) !=
+            sizeof(counts[i]))
+            counts[i] = 0;
+    }
+
+    /* each iteration is one pwrite and one pread */
+    printf("%s\t%ld\t%.6f\t%.1f", name, 2L*iters, time2-time1,
+        ((time2-time1)*1.0e9)/(2.0*iters));
+    for(i=0; i<BENCH_NUM_EVENTS; i++)
+    {
+        if(event_fds[i] < 0)
+            printf("\tn/a");
+        else
+            printf("\t%.2f", (double)counts[i]/(2.0*iters));
+    }
+    printf("\n");
+
+    return;
+}
+
+int main(int argc, char **argv)
+{
+    char path[256];
+    int iters;
+    int fd;
+    int event_fds[BENCH_NUM_EVENTS];
+    int i;
+    int ret;
+
+    if(argc != 3)
+    {
+        fprintf(stderr, "Usage: %s <directory> <ops per test>\n", argv[0]);
+        return(-1);
+    }
+
+    ret = sscanf(argv[2], "%d", &iters);
+    if(ret != 1 || iters < 1)
+    {
+        fprintf(stderr, "Usage: %s <directory> <ops per test>\n", argv[0]);
+        return(-1);
+    }
+
+    snprintf(path, 256, "%s/posix-rw-bench.%d", argv[1], (int)getpid());
+    fd = open(path, O_CREAT|O_RDWR|O_TRUNC, 0644);
+    if(fd < 0)
+    {
+        perror("open");
+        return(-1);
+    }
+    if(ftruncate(fd, FILE_SIZE) < 0)
+    {
+        perror("ftruncate");
+        return(-1);
+    }
+
+    event_fds[BENCH_L1D_ACCESSES] = open_l1d_event(0);
+    event_fds[BENCH_L1D_MISSES] = open_l1d_event(1);
+    for(i=0; i<BENCH_NUM_EVENTS; i++)
+    {
+        if(event_fds[i] < 0)
+            fprintf(stderr, "Warning: %s event not available.\n",
+                event_names[i]);
+    }
+
+    /* warm up the page cache and the instrumentation's file record */
+    run_test("#warmup", fd, iters/10 + 1, ACCESS_SIZE, event_fds);
+
+    printf("#<test>\t<ops>\t<total (s)>\t<ns/op>\t<%s/op>\t<%s/op>\n",
+        event_names[BENCH_L1D_ACCESSES], event_names[BENCH_L1D_MISSES]);
+    run_test("sequential", fd, iters, ACCESS_SIZE, event_fds);
+    run_test("strided", fd, iters, 4096 + ACCESS_SIZE, event_fds);
+
+    for(i=0; i<BENCH_NUM_EVENTS; i++)
+    {
+        if(event_fds[i] >= 0)
+            close(event_fds[i]);
+    }
+    close(fd);
+    unlink(path);
+
+    return(0);
+}
@@ -0,0 +1,179 @@
+/*
+ *  (C) 2021 by Argonne National Laboratory.
+ *      See COPYRIGHT in top-level directory.
+ */
+
+/* Benchmark to measure the throughput of instrumented POSIX read/write
+ * wrappers as the number of application threads grows.  Each thread
+ * repeatedly issues small pwrite() and pread() calls against its own file,
+ * so any scaling limits come from the instrumentation rather than from
+ * contention on the files themselves.
+ *
+ * This is not an MPI program; run it with Darshan preloaded and
+ * DARSHAN_ENABLE_NONMPI set, with and without DARSHAN_POSIX_SHARDED, e.g.:
+ *
+ *   LD_PRELOAD=libdarshan.so DARSHAN_ENABLE_NONMPI=1 ./posix-thread-bench /tmp 64 100000
+ *   LD_PRELOAD=libdarshan.so DARSHAN_ENABLE_NONMPI=1 DARSHAN_POSIX_SHARDED=1 \
+ *       ./posix-thread-bench /tmp 64 100000
+ */
+
+/* Arguments: a directory to create test files in, the maximum number of
+ * threads to test, and the number of operations per thread
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+
+#define ACCESS_SIZE 4096
+#define FILE_BLOCKS 256
+
+struct thread_args
+{
+    const char *dir;
+    int id;
+    int iters;
+    pthread_barrier_t *barrier;
+    int err;
+};
+
+static double wtime(void)
+{
+    struct timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return(((double)tp.tv_sec) + 1.0e-9 * ((double)tp.tv_nsec));
+}
+
+static void *bench_thread(void *arg)
+{
+    struct thread_args *targs = arg;
+    char path[256];
+    char buf[ACCESS_SIZE];
+    int fd;
+    int i;
+
+    snprintf(path, 256, "%s/posix-thread-bench.%d.%d", targs->dir,
+        (int)getpid(), targs->id);
+    memset(buf, targs->id, ACCESS_SIZE);
+
+    fd = open(path, O_CREAT|O_RDWR|O_TRUNC, 0644);
+    if(fd < 0)
+    {
+        perror("open");
+        targs->err = 1;
+    }
+
+    /* start all threads at the same time */
+    pthread_barrier_wait(targs->barrier);
+
+    if(fd >= 0)
+    {
+        for(i=0; i<targs->iters; i++)
+        {
+            if(pwrite(fd, buf, ACCESS_SIZE,
+                (off_t)(i % FILE_BLOCKS) * ACCESS_SIZE) != ACCESS_SIZE ||
+               pread(fd, buf, ACCESS_SIZE,
+                (off_t)(i % FILE_BLOCKS) * ACCESS_SIZE) != ACCESS_SIZE)
+            {
+                perror("pwrite/pread");
+                targs->err = 1;
+                break;
+            }
+        }
+    }
+
+    pthread_barrier_wait(targs->barrier);
+
+    if(fd >= 0)
+    {
+        close(fd);
+        unlink(path);
+    }
+
+    return(NULL);
+}
+
+int main(int argc, char **argv)
+{
+    int max_threads;
+    int iters;
+    int nthreads;
+    int i;
+    int ret;
+    double time1, time2;
+    pthread_t *threads;
+    struct thread_args *targs;
+    pthread_barrier_t barrier;
+
+    if(argc != 4)
+    {
+        fprintf(stderr, "Usage: %s <directory> <max threads> <ops per thread>\n", argv[0]);
+        return(-1);
+    }
+
+    ret = sscanf(argv[2], "%d", &max_threads);
+    if(ret != 1 || max_threads < 1)
+    {
+        fprintf(stderr, "Usage: %s <directory> <max threads> <ops per thread>\n", argv[0]);
+        return(-1);
+    }
+    ret = sscanf(argv[3], "%d", &iters);
+    if(ret != 1 || iters < 1)
+    {
+        fprintf(stderr, "Usage: %s <directory> <max threads> <ops per thread>\n", argv[0]);
+        return(-1);
+    }
+
+    threads = malloc(max_threads * sizeof(*threads));
+    targs = malloc(max_threads * sizeof(*targs));
+    if(!threads || !targs)
+    {
+        perror("malloc");
+        return(-1);
+    }
+
+    printf("#<threads>\t<ops>\t<total (s)>\t<ops/s>\t<ops/s per thread>\n");
+
+    for(nthreads=1; nthreads<=max_threads; nthreads*=2)
+    {
+        /* one extra barrier participant for the timing thread */
+        pthread_barrier_init(&barrier, NULL, nthreads+1);
+        for(i=0; i<nthreads; i++)
+        {
+            targs[i].dir = argv[1];
+            targs[i].id = i;
+            targs[i].iters = iters;
+            targs[i].barrier = &barrier;
+            targs[i].err = 0;
+            pthread_create(&threads[i], NULL, bench_thread, &targs[i]);
+        }
+
+        pthread_barrier_wait(&barrier);
+        time1 = wtime();
+        pthread_barrier_wait(&barrier);
+        time2 = wtime();
+
+        for(i=0; i<nthreads; i++)
+        {
+            pthread_join(threads[i], NULL);
+            if(targs[i].err)
+                return(-1);
+        }
+        pthread_barrier_destroy(&barrier);
+
+        /* each iteration is one pwrite and one pread */
+        printf("%d\t%ld\t%.6f\t%.1f\t%.1f\n", nthreads, 2L*iters*nthreads,
+            time2-time1, (2.0*iters*nthreads)/(time2-time1),
+            (2.0*iters)/(time2-time1));
+    }
+
+    free(threads);
+    free(targs);
+    return(0);
+}
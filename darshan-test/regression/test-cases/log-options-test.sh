@@ -0,0 +1,78 @@
+#!/bin/bash
+
+PROG=mpi-io-test
+
+# compile
+$DARSHAN_CC $DARSHAN_TESTDIR/test-cases/src/${PROG}.c -o $DARSHAN_TMP/${PROG}
+if [ $? -ne 0 ]; then
+    echo "Error: failed to compile ${PROG}" 1>&2
+    exit 1
+fi
+
+# run with each option that changes how Darshan allocates its memory or
+# writes its log, and check that the log holds the same counters for the
+# test's file as a log written with the default options. zstd and lz4 are
+# skipped if the runtime or darshan-util was built without them.
+export DXT_ENABLE_IO_TRACE=
+
+for OPTION in default DARSHAN_NODE_AGGREGATION=1 DARSHAN_HUGEPAGES=thp \
+              DARSHAN_HUGEPAGES=hugetlb DARSHAN_LOGCOMP=zstd DARSHAN_LOGCOMP=lz4; do
+    # set log file path; remove previous log if present
+    export DARSHAN_LOGFILE=$DARSHAN_TMP/${PROG}-options-${OPTION##*=}.darshan
+    rm -f ${DARSHAN_LOGFILE}
+    if [ "$OPTION" != "default" ]; then
+        export $OPTION
+    fi
+
+    # execute
+    $DARSHAN_RUNJOB $DARSHAN_TMP/${PROG} -f $DARSHAN_TMP/${PROG}.tmp.dat
+    if [ $? -ne 0 ]; then
+        echo "Error: failed to execute ${PROG} with ${OPTION}" 1>&2
+        exit 1
+    fi
+    if [ "$OPTION" != "default" ]; then
+        unset ${OPTION%%=*}
+    fi
+
+    # parse log
+    $DARSHAN_PATH/bin/darshan-parser $DARSHAN_LOGFILE > $DARSHAN_LOGFILE.txt 2> $DARSHAN_LOGFILE.err
+    if [ $? -ne 0 ]; then
+        if grep -q "invalid compression type" $DARSHAN_LOGFILE.err; then
+            echo "Skipping ${OPTION}: not supported by darshan-util" 1>&2
+            continue
+        fi
+        cat $DARSHAN_LOGFILE.err 1>&2
+        echo "Error: failed to parse ${DARSHAN_LOGFILE}" 1>&2
+        exit 1
+    fi
+    case $OPTION in
+        DARSHAN_LOGCOMP=*)
+            METHOD=`echo ${OPTION##*=} | tr a-z A-Z`
+            if ! grep -q "^# compression method: $METHOD$" $DARSHAN_LOGFILE.txt; then
+                echo "Skipping ${OPTION}: not supported by the runtime library" 1>&2
+                continue
+            fi ;;
+    esac
+
+    # check results
+    if grep -q "^# metadata: mem_partial = " $DARSHAN_LOGFILE.txt; then
+        echo "Error: records dropped in ${DARSHAN_LOGFILE}" 1>&2
+        exit 1
+    fi
+    awk -v f=$DARSHAN_TMP/${PROG}.tmp.dat '$1 !~ /^#/ && $1 != "HEATMAP" && $6 == f && $4 !~ /TIME|FASTEST|SLOWEST|VARIANCE/' \
+        $DARSHAN_LOGFILE.txt | sort > $DARSHAN_LOGFILE.counters
+    if [ ! -s $DARSHAN_LOGFILE.counters ]; then
+        echo "Error: no records of ${PROG}.tmp.dat in ${DARSHAN_LOGFILE}" 1>&2
+        exit 1
+    fi
+    if [ "$OPTION" = "default" ]; then
+        DEFAULT_COUNTERS=$DARSHAN_LOGFILE.counters
+    elif ! cmp -s $DEFAULT_COUNTERS $DARSHAN_LOGFILE.counters; then
+        echo "Error: counters in ${DARSHAN_LOGFILE} differ from the default options' ones" 1>&2
+        exit 1
+    fi
+done
+
+unset DXT_ENABLE_IO_TRACE
+
+exit 0
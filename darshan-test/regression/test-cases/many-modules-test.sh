@@ -0,0 +1,54 @@
+#!/bin/bash
+
+PROG=mpi-io-test
+
+# compile
+$DARSHAN_CC $DARSHAN_TESTDIR/test-cases/src/${PROG}.c -o $DARSHAN_TMP/${PROG}
+if [ $? -ne 0 ]; then
+    echo "Error: failed to compile ${PROG}" 1>&2
+    exit 1
+fi
+
+# enable dxt tracing, so that the log holds more module regions (POSIX,
+# MPI-IO, STDIO, DXT_POSIX, DXT_MPIIO, HEATMAP) than are written in a single
+# batch at shutdown; run with both serial and threaded compression
+export DXT_ENABLE_IO_TRACE=
+
+for THREADS in 0 2; do
+    # set log file path; remove previous log if present
+    export DARSHAN_LOGFILE=$DARSHAN_TMP/${PROG}-many-modules-${THREADS}.darshan
+    rm -f ${DARSHAN_LOGFILE}
+    export DARSHAN_COMPRESS_THREADS=$THREADS
+
+    # execute
+    $DARSHAN_RUNJOB $DARSHAN_TMP/${PROG} -f $DARSHAN_TMP/${PROG}.tmp.dat
+    if [ $? -ne 0 ]; then
+        echo "Error: failed to execute ${PROG}" 1>&2
+        exit 1
+    fi
+
+    # parse log
+    $DARSHAN_PATH/bin/darshan-parser $DARSHAN_LOGFILE > $DARSHAN_LOGFILE.txt
+    if [ $? -ne 0 ]; then
+        echo "Error: failed to parse ${DARSHAN_LOGFILE}" 1>&2
+        exit 1
+    fi
+
+    # check results
+    MODULES=`grep -c "^# [A-Z_-]* module: " $DARSHAN_LOGFILE.txt`
+    if [ "$MODULES" -le 4 ]; then
+        echo "Error: expected more than 4 modules in ${DARSHAN_LOGFILE}, found $MODULES" 1>&2
+        exit 1
+    fi
+    for MOD in POSIX MPI-IO DXT_POSIX DXT_MPIIO; do
+        if ! grep -q "^# $MOD module: " $DARSHAN_LOGFILE.txt; then
+            echo "Error: no $MOD module data in ${DARSHAN_LOGFILE}" 1>&2
+            exit 1
+        fi
+    done
+done
+
+unset DXT_ENABLE_IO_TRACE
+unset DARSHAN_COMPRESS_THREADS
+
+exit 0
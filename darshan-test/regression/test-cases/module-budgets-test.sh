@@ -0,0 +1,72 @@
+#!/bin/bash
+
+PROG=record-overflow-test
+NFILES=2000
+
+# compile
+$DARSHAN_CC $DARSHAN_TESTDIR/test-cases/src/${PROG}.c -o $DARSHAN_TMP/${PROG}
+if [ $? -ne 0 ]; then
+    echo "Error: failed to compile ${PROG}" 1>&2
+    exit 1
+fi
+
+# give modules far less memory than the files written need, and check that
+# the records POSIX drops depend on the per-module budgets: reserving most
+# of the quota for STDIO (which records nothing here) must leave POSIX less
+# memory than sharing the whole quota, and budgeting the whole quota to
+# POSIX must not leave it less
+export DARSHAN_MODMEM=1
+
+for BUDGETS in none STDIO:0.75 POSIX:1; do
+    # set log file path; remove previous log and files if present
+    export DARSHAN_LOGFILE=$DARSHAN_TMP/${PROG}-budgets-${BUDGETS%%:*}.darshan
+    rm -f ${DARSHAN_LOGFILE}
+    rm -rf $DARSHAN_TMP/${PROG}.tmp.d
+    mkdir -p $DARSHAN_TMP/${PROG}.tmp.d
+    if [ "$BUDGETS" = "none" ]; then
+        unset DARSHAN_MODMEM_BUDGETS
+    else
+        export DARSHAN_MODMEM_BUDGETS=$BUDGETS
+    fi
+
+    # execute
+    $DARSHAN_RUNJOB $DARSHAN_TMP/${PROG} -d $DARSHAN_TMP/${PROG}.tmp.d -n $NFILES
+    if [ $? -ne 0 ]; then
+        echo "Error: failed to execute ${PROG}" 1>&2
+        exit 1
+    fi
+
+    # parse log
+    $DARSHAN_PATH/bin/darshan-parser --show-incomplete $DARSHAN_LOGFILE > $DARSHAN_LOGFILE.txt
+    if [ $? -ne 0 ]; then
+        echo "Error: failed to parse ${DARSHAN_LOGFILE}" 1>&2
+        exit 1
+    fi
+
+    # check results
+    DROPPED=`grep "^# metadata: mem_partial = " $DARSHAN_LOGFILE.txt | grep -o "POSIX:[0-9]*" | cut -d ':' -f 2`
+    if [ -z "$DROPPED" ]; then
+        echo "Error: no dropped POSIX records in ${DARSHAN_LOGFILE}" 1>&2
+        exit 1
+    fi
+    case $BUDGETS in
+        none)
+            SHARED_DROPPED=$DROPPED ;;
+        STDIO:*)
+            if [ "$DROPPED" -le "$SHARED_DROPPED" ]; then
+                echo "Error: POSIX dropped $DROPPED records with budgets $BUDGETS, expected more than $SHARED_DROPPED" 1>&2
+                exit 1
+            fi ;;
+        POSIX:*)
+            if [ "$DROPPED" -gt "$SHARED_DROPPED" ]; then
+                echo "Error: POSIX dropped $DROPPED records with budgets $BUDGETS, expected at most $SHARED_DROPPED" 1>&2
+                exit 1
+            fi ;;
+    esac
+done
+
+rm -rf $DARSHAN_TMP/${PROG}.tmp.d
+unset DARSHAN_MODMEM
+unset DARSHAN_MODMEM_BUDGETS
+
+exit 0
@@ -0,0 +1,90 @@
+#!/bin/bash
+
+PROG=record-overflow-test
+NFILES=2000
+
+# compile
+$DARSHAN_CC $DARSHAN_TESTDIR/test-cases/src/${PROG}.c -o $DARSHAN_TMP/${PROG}
+if [ $? -ne 0 ]; then
+    echo "Error: failed to compile ${PROG}" 1>&2
+    exit 1
+fi
+
+# give modules far less memory than the files written need, and check what
+# each record overflow policy does with the records that don't fit
+export DARSHAN_MODMEM=1
+
+for POLICY in drop aggregate evict; do
+    # set log file path; remove previous log and files if present
+    export DARSHAN_LOGFILE=$DARSHAN_TMP/${PROG}-${POLICY}.darshan
+    rm -f ${DARSHAN_LOGFILE}
+    rm -rf $DARSHAN_TMP/${PROG}.tmp.d
+    mkdir -p $DARSHAN_TMP/${PROG}.tmp.d
+    export DARSHAN_RECORD_OVERFLOW=$POLICY
+
+    # execute
+    $DARSHAN_RUNJOB $DARSHAN_TMP/${PROG} -d $DARSHAN_TMP/${PROG}.tmp.d -n $NFILES
+    if [ $? -ne 0 ]; then
+        echo "Error: failed to execute ${PROG}" 1>&2
+        exit 1
+    fi
+
+    # parse log
+    $DARSHAN_PATH/bin/darshan-parser --show-incomplete $DARSHAN_LOGFILE > $DARSHAN_LOGFILE.txt
+    if [ $? -ne 0 ]; then
+        echo "Error: failed to parse ${DARSHAN_LOGFILE}" 1>&2
+        exit 1
+    fi
+
+    # check results
+    if [ "$POLICY" = "drop" ]; then
+        if ! grep -q "^# metadata: mem_partial = .*POSIX" $DARSHAN_LOGFILE.txt; then
+            echo "Error: POSIX records not marked partial in ${DARSHAN_LOGFILE}" 1>&2
+            exit 1
+        fi
+        continue
+    fi
+
+    if ! grep -q "^# metadata: mem_folded = .*POSIX" $DARSHAN_LOGFILE.txt; then
+        echo "Error: no folded POSIX records in ${DARSHAN_LOGFILE}" 1>&2
+        exit 1
+    fi
+    if grep -q "^# metadata: mem_partial = .*POSIX" $DARSHAN_LOGFILE.txt; then
+        echo "Error: POSIX records marked partial in ${DARSHAN_LOGFILE}" 1>&2
+        exit 1
+    fi
+
+    # every operation must be counted once, whether in a file's own record
+    # or in the aggregate record its file was folded into
+    NPROCS=`grep "^# nprocs: " $DARSHAN_LOGFILE.txt | cut -d ' ' -f 3`
+    for COUNTER in POSIX_OPENS POSIX_WRITES POSIX_READS POSIX_BYTES_WRITTEN; do
+        case $COUNTER in
+            POSIX_OPENS|POSIX_WRITES) PER_FILE=2 ;;
+            POSIX_READS) PER_FILE=1 ;;
+            POSIX_BYTES_WRITTEN) PER_FILE=200 ;;
+        esac
+        EXPECTED=$(( NPROCS * NFILES * PER_FILE ))
+        TOTAL=`awk -v c=$COUNTER '$1 == "POSIX" && $4 == c { s += $5 } END { print s }' $DARSHAN_LOGFILE.txt`
+        if [ "$TOTAL" != "$EXPECTED" ]; then
+            echo "Error: $COUNTER total is $TOTAL in ${DARSHAN_LOGFILE}, expected $EXPECTED" 1>&2
+            exit 1
+        fi
+    done
+
+    # aggregate records don't track access sizes or strides across files
+    if ! grep -q "<darshan-other-files>" $DARSHAN_LOGFILE.txt; then
+        echo "Error: no aggregate POSIX record in ${DARSHAN_LOGFILE}" 1>&2
+        exit 1
+    fi
+    COMMON=`awk '$1 == "POSIX" && $6 ~ /<darshan-other-files>$/ && ($4 == "POSIX_ACCESS1_COUNT" || $4 == "POSIX_STRIDE1_COUNT") { s += $5 } END { print s + 0 }' $DARSHAN_LOGFILE.txt`
+    if [ "$COMMON" -ne 0 ]; then
+        echo "Error: aggregate POSIX record in ${DARSHAN_LOGFILE} has common access values" 1>&2
+        exit 1
+    fi
+done
+
+rm -rf $DARSHAN_TMP/${PROG}.tmp.d
+unset DARSHAN_MODMEM
+unset DARSHAN_RECORD_OVERFLOW
+
+exit 0
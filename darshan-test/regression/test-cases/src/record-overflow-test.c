@@ -0,0 +1,126 @@
+/*
+ *  (C) 2021 by Argonne National Laboratory.
+ *      See COPYRIGHT in top-level directory.
+ */
+
+/* Each process opens, writes and reads back many small files, so that
+ * Darshan runs out of record memory when run with a small DARSHAN_MODMEM.
+ * Every file is opened twice and written twice.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <mpi.h>
+#include <errno.h>
+#include <getopt.h>
+#include <sys/stat.h>
+
+/* DEFAULT VALUES FOR OPTIONS */
+static char    opt_dir[256] = ".";
+static int     opt_nfiles = 1000;
+
+/* function prototypes */
+static int parse_args(int argc, char **argv);
+static void usage(void);
+
+/* global vars */
+static int mynod = 0;
+static int nprocs = 1;
+
+int main(int argc, char **argv)
+{
+   char path[512];
+   char buffer[100] = {0};
+   int fd;
+   int i;
+
+   /* startup MPI and determine the rank of this process */
+   MPI_Init(&argc,&argv);
+   MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+   MPI_Comm_rank(MPI_COMM_WORLD, &mynod);
+
+   /* parse the command line arguments */
+   parse_args(argc, argv);
+
+   for(i=0; i<opt_nfiles; i++)
+   {
+      snprintf(path, sizeof(path), "%s/file.%d.%d", opt_dir, mynod, i);
+
+      /* write two blocks with a gap between them */
+      fd = open(path, O_WRONLY|O_TRUNC|O_CREAT, S_IRUSR|S_IWUSR);
+      if(fd<0)
+      {
+         perror("open");
+         return(-1);
+      }
+      if(write(fd, buffer, sizeof(buffer)) != sizeof(buffer) ||
+         pwrite(fd, buffer, sizeof(buffer), 1000) != sizeof(buffer))
+      {
+         perror("write");
+         return(-1);
+      }
+      close(fd);
+
+      /* read the first block back */
+      fd = open(path, O_RDONLY);
+      if(fd<0)
+      {
+         perror("open");
+         return(-1);
+      }
+      if(read(fd, buffer, sizeof(buffer)) != sizeof(buffer))
+      {
+         perror("read");
+         return(-1);
+      }
+      close(fd);
+   }
+
+   MPI_Finalize();
+   return(0);
+}
+
+static int parse_args(int argc, char **argv)
+{
+   int c;
+
+   while ((c = getopt(argc, argv, "d:n:")) != EOF) {
+      switch (c) {
+         case 'd': /* directory */
+            strncpy(opt_dir, optarg, 255);
+            break;
+         case 'n': /* number of files per process */
+            opt_nfiles = atoi(optarg);
+            break;
+         case '?': /* unknown */
+            if (mynod == 0)
+                usage();
+            exit(1);
+         default:
+            break;
+      }
+   }
+   return(0);
+}
+
+static void usage(void)
+{
+    printf("Usage: record-overflow-test [<OPTIONS>...]\n");
+    printf("\n<OPTIONS> is one of\n");
+    printf(" -d       directory to create files in [default: .]\n");
+    printf(" -n       number of files per process [default: 1000]\n");
+    printf(" -h       print this help\n");
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 3
+ *  c-basic-offset: 3
+ *  tab-width: 3
+ *
+ * vim: ts=3
+ * End:
+ */
@@ -0,0 +1,128 @@
+/*
+ *  (C) 2021 by Argonne National Laboratory.
+ *      See COPYRIGHT in top-level directory.
+ */
+
+/* Processes are split into groups of a given size, and the processes of
+ * each group write and read back their own block of a file shared only
+ * within the group, so that every file is shared by a subset of the
+ * processes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <mpi.h>
+#include <errno.h>
+#include <getopt.h>
+#include <sys/stat.h>
+
+/* DEFAULT VALUES FOR OPTIONS */
+static char    opt_dir[256] = ".";
+static int     opt_group = 2;
+
+/* function prototypes */
+static int parse_args(int argc, char **argv);
+static void usage(void);
+
+/* global vars */
+static int mynod = 0;
+static int nprocs = 1;
+
+int main(int argc, char **argv)
+{
+   char path[512];
+   char buffer[100] = {0};
+   off_t offset;
+   int fd;
+
+   /* startup MPI and determine the rank of this process */
+   MPI_Init(&argc,&argv);
+   MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+   MPI_Comm_rank(MPI_COMM_WORLD, &mynod);
+
+   /* parse the command line arguments */
+   parse_args(argc, argv);
+
+   snprintf(path, sizeof(path), "%s/file.%d", opt_dir, mynod / opt_group);
+   offset = (off_t)(mynod % opt_group) * sizeof(buffer);
+
+   /* write this process's block of the group's file */
+   fd = open(path, O_WRONLY|O_CREAT, S_IRUSR|S_IWUSR);
+   if(fd<0)
+   {
+      perror("open");
+      return(-1);
+   }
+   if(pwrite(fd, buffer, sizeof(buffer), offset) != sizeof(buffer))
+   {
+      perror("write");
+      return(-1);
+   }
+   close(fd);
+
+   MPI_Barrier(MPI_COMM_WORLD);
+
+   /* read it back */
+   fd = open(path, O_RDONLY);
+   if(fd<0)
+   {
+      perror("open");
+      return(-1);
+   }
+   if(pread(fd, buffer, sizeof(buffer), offset) != sizeof(buffer))
+   {
+      perror("read");
+      return(-1);
+   }
+   close(fd);
+
+   MPI_Finalize();
+   return(0);
+}
+
+static int parse_args(int argc, char **argv)
+{
+   int c;
+
+   while ((c = getopt(argc, argv, "d:g:")) != EOF) {
+      switch (c) {
+         case 'd': /* directory */
+            strncpy(opt_dir, optarg, 255);
+            break;
+         case 'g': /* number of processes sharing a file */
+            opt_group = atoi(optarg);
+            if (opt_group < 1)
+               opt_group = 1;
+            break;
+         case '?': /* unknown */
+            if (mynod == 0)
+                usage();
+            exit(1);
+         default:
+            break;
+      }
+   }
+   return(0);
+}
+
+static void usage(void)
+{
+    printf("Usage: subset-shared-test [<OPTIONS>...]\n");
+    printf("\n<OPTIONS> is one of\n");
+    printf(" -d       directory to create files in [default: .]\n");
+    printf(" -g       number of processes sharing a file [default: 2]\n");
+    printf(" -h       print this help\n");
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 3
+ *  c-basic-offset: 3
+ *  tab-width: 3
+ *
+ * vim: ts=3
+ * End:
+ */
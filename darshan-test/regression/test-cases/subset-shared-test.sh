@@ -0,0 +1,73 @@
+#!/bin/bash
+
+PROG=subset-shared-test
+GROUP=2
+
+# compile
+$DARSHAN_CC $DARSHAN_TESTDIR/test-cases/src/${PROG}.c -o $DARSHAN_TMP/${PROG}
+if [ $? -ne 0 ]; then
+    echo "Error: failed to compile ${PROG}" 1>&2
+    exit 1
+fi
+
+# set log file path; remove previous log and files if present
+export DARSHAN_LOGFILE=$DARSHAN_TMP/${PROG}.darshan
+rm -f ${DARSHAN_LOGFILE}
+rm -rf $DARSHAN_TMP/${PROG}.tmp.d
+mkdir -p $DARSHAN_TMP/${PROG}.tmp.d
+
+# execute
+$DARSHAN_RUNJOB $DARSHAN_TMP/${PROG} -d $DARSHAN_TMP/${PROG}.tmp.d -g $GROUP
+if [ $? -ne 0 ]; then
+    echo "Error: failed to execute ${PROG}" 1>&2
+    exit 1
+fi
+
+# parse log
+$DARSHAN_PATH/bin/darshan-parser $DARSHAN_LOGFILE > $DARSHAN_LOGFILE.txt
+if [ $? -ne 0 ]; then
+    echo "Error: failed to parse ${DARSHAN_LOGFILE}" 1>&2
+    exit 1
+fi
+
+# check results
+# every file shared by a group of processes must be reduced to a single
+# shared (rank -1) record holding the operations of all of the group's
+# processes, while a file used by a single process keeps its own record
+NPROCS=`grep "^# nprocs: " $DARSHAN_LOGFILE.txt | cut -d ' ' -f 3`
+NGROUPS=$(( (NPROCS + GROUP - 1) / GROUP ))
+for (( G = 0; G < NGROUPS; G++ )); do
+    SIZE=$(( NPROCS - G * GROUP ))
+    if [ $SIZE -gt $GROUP ]; then
+        SIZE=$GROUP
+    fi
+    if [ $SIZE -gt 1 ]; then
+        RANK=-1
+    else
+        RANK=$(( G * GROUP ))
+    fi
+    FILE="/file[.]$G$"
+
+    RECORDS=`awk -v f="$FILE" '$1 == "POSIX" && $4 == "POSIX_OPENS" && $6 ~ f' $DARSHAN_LOGFILE.txt | wc -l`
+    if [ "$RECORDS" -ne 1 ]; then
+        echo "Error: found $RECORDS POSIX records of file.$G in ${DARSHAN_LOGFILE}, expected 1" 1>&2
+        exit 1
+    fi
+    for COUNTER in POSIX_OPENS POSIX_WRITES POSIX_READS POSIX_BYTES_WRITTEN; do
+        case $COUNTER in
+            POSIX_OPENS) PER_PROC=2 ;;
+            POSIX_WRITES|POSIX_READS) PER_PROC=1 ;;
+            POSIX_BYTES_WRITTEN) PER_PROC=100 ;;
+        esac
+        EXPECTED=$(( SIZE * PER_PROC ))
+        VALUE=`awk -v f="$FILE" -v r=$RANK -v c=$COUNTER '$1 == "POSIX" && $2 == r && $4 == c && $6 ~ f { print $5 }' $DARSHAN_LOGFILE.txt`
+        if [ "$VALUE" != "$EXPECTED" ]; then
+            echo "Error: $COUNTER of file.$G on rank $RANK is $VALUE in ${DARSHAN_LOGFILE}, expected $EXPECTED" 1>&2
+            exit 1
+        fi
+    done
+done
+
+rm -rf $DARSHAN_TMP/${PROG}.tmp.d
+
+exit 0
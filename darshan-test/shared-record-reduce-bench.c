@@ -0,0 +1,263 @@
+/*
+ *  (C) 2021 by Argonne National Laboratory.
+ *      See COPYRIGHT in top-level directory.
+ */
+
+/* Benchmark to compare the cost of reducing the counters of shared POSIX
+ * file records with the previous hand-written loops against the span
+ * reduction macros in darshan-common.h.  Synthetic records are reduced
+ * pairwise, as the MPI reduction operator would when combining the records
+ * of two processes; the special cases that are not covered by the spans
+ * (common values and fastest/slowest ranks) are left out, as they are the
+ * same in both variants.  The results are checked against those of the
+ * previous loops.
+ *
+ * The span reduction functions use AVX2 or AVX-512 instructions if the
+ * benchmark is compiled for them, so build it once per instruction set to
+ * compare, e.g.:
+ *
+ *   cc -O2 -I../include -I../darshan-runtime/lib shared-record-reduce-bench.c \
+ *       -o shared-record-reduce-bench
+ *   cc -O2 -mavx2 -I../include -I../darshan-runtime/lib \
+ *       shared-record-reduce-bench.c -o shared-record-reduce-bench-avx2
+ *   cc -O2 -mavx512f -I../include -I../darshan-runtime/lib \
+ *       shared-record-reduce-bench.c -o shared-record-reduce-bench-avx512
+ */
+
+/* Arguments: the number of records to reduce (default 1M), and the number
+ * of times to repeat each reduction (default 5)
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "uthash.h"
+#include "darshan-log-format.h"
+#include "darshan-posix-log-format.h"
+#include "darshan-common.h"
+
+/* same spans as in darshan-posix.c */
+#define POSIX_COUNTER_SPANS(X) \
+    X(sum_valid, POSIX_OPENS, POSIX_RENAME_TARGETS) \
+    X(in, POSIX_RENAMED_FROM, POSIX_MODE) \
+    X(sum, POSIX_BYTES_READ, POSIX_BYTES_WRITTEN) \
+    X(max, POSIX_MAX_BYTE_READ, POSIX_MAX_BYTE_WRITTEN) \
+    X(sum, POSIX_CONSEC_READS, POSIX_MEM_NOT_ALIGNED) \
+    X(in, POSIX_MEM_ALIGNMENT, POSIX_MEM_ALIGNMENT) \
+    X(sum, POSIX_FILE_NOT_ALIGNED, POSIX_FILE_NOT_ALIGNED) \
+    X(in, POSIX_FILE_ALIGNMENT, POSIX_FILE_ALIGNMENT) \
+    X(sum, POSIX_SIZE_READ_0_100, POSIX_SIZE_WRITE_1G_PLUS)
+#define POSIX_FCOUNTER_SPANS(X) \
+    X(min_nonzero, POSIX_F_OPEN_START_TIMESTAMP, POSIX_F_CLOSE_START_TIMESTAMP) \
+    X(max, POSIX_F_OPEN_END_TIMESTAMP, POSIX_F_CLOSE_END_TIMESTAMP) \
+    X(sum, POSIX_F_READ_TIME, POSIX_F_META_TIME)
+
+#if defined(__AVX512F__)
+#define SPANS_NAME "spans-avx512"
+#elif defined(__AVX2__)
+#define SPANS_NAME "spans-avx2"
+#else
+#define SPANS_NAME "spans-scalar"
+#endif
+
+enum bench_variant
+{
+    BENCH_LEGACY = 0,
+    BENCH_SPANS,
+    BENCH_NUM_VARIANTS
+};
+
+static const char *variant_names[BENCH_NUM_VARIANTS] =
+{
+    "legacy", SPANS_NAME
+};
+
+static double wtime(void)
+{
+    struct timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return(((double)tp.tv_sec) + 1.0e-9 * ((double)tp.tv_nsec));
+}
+
+/* xorshift, so that the records don't depend on the libc */
+static uint64_t next_rand(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return(*state);
+}
+
+/* fill in the records of one synthetic process, including some zero
+ * timestamps and invalid (-1) counters
+ */
+static void fill_records(struct darshan_posix_file *recs, int count,
+    uint64_t seed)
+{
+    uint64_t state = seed;
+    int i, j;
+
+    for(i = 0; i < count; i++)
+    {
+        recs[i].base_rec.id = i;
+        recs[i].base_rec.rank = -1;
+        for(j = 0; j < POSIX_NUM_INDICES; j++)
+            recs[i].counters[j] = next_rand(&state) % 100000;
+        if(next_rand(&state) % 16 == 0)
+            recs[i].counters[POSIX_MMAPS] = -1;
+        for(j = 0; j < POSIX_F_NUM_INDICES; j++)
+        {
+            if(next_rand(&state) % 4 == 0)
+                recs[i].fcounters[j] = 0;
+            else
+                recs[i].fcounters[j] = (next_rand(&state) % 1000000) / 1000.0;
+        }
+    }
+
+    return;
+}
+
+/* counter loops of the previous POSIX record reduction operator */
+static void legacy_reduce(struct darshan_posix_file *infile,
+    struct darshan_posix_file *inoutfile, struct darshan_posix_file *tmp_file)
+{
+    int j;
+
+    for(j=POSIX_OPENS; j<=POSIX_RENAME_TARGETS; j++)
+    {
+        tmp_file->counters[j] = infile->counters[j] + inoutfile->counters[j];
+        if(tmp_file->counters[j] < 0)
+            tmp_file->counters[j] = -1;
+    }
+    tmp_file->counters[POSIX_RENAMED_FROM] = infile->counters[POSIX_RENAMED_FROM];
+    tmp_file->counters[POSIX_MODE] = infile->counters[POSIX_MODE];
+    for(j=POSIX_BYTES_READ; j<=POSIX_BYTES_WRITTEN; j++)
+        tmp_file->counters[j] = infile->counters[j] + inoutfile->counters[j];
+    for(j=POSIX_MAX_BYTE_READ; j<=POSIX_MAX_BYTE_WRITTEN; j++)
+    {
+        tmp_file->counters[j] = (
+            (infile->counters[j] > inoutfile->counters[j]) ?
+            infile->counters[j] :
+            inoutfile->counters[j]);
+    }
+    for(j=POSIX_CONSEC_READS; j<=POSIX_MEM_NOT_ALIGNED; j++)
+        tmp_file->counters[j] = infile->counters[j] + inoutfile->counters[j];
+    tmp_file->counters[POSIX_MEM_ALIGNMENT] = infile->counters[POSIX_MEM_ALIGNMENT];
+    for(j=POSIX_FILE_NOT_ALIGNED; j<=POSIX_FILE_NOT_ALIGNED; j++)
+        tmp_file->counters[j] = infile->counters[j] + inoutfile->counters[j];
+    tmp_file->counters[POSIX_FILE_ALIGNMENT] = infile->counters[POSIX_FILE_ALIGNMENT];
+    for(j=POSIX_SIZE_READ_0_100; j<=POSIX_SIZE_WRITE_1G_PLUS; j++)
+        tmp_file->counters[j] = infile->counters[j] + inoutfile->counters[j];
+
+    for(j=POSIX_F_OPEN_START_TIMESTAMP; j<=POSIX_F_CLOSE_START_TIMESTAMP; j++)
+    {
+        if((infile->fcounters[j] < inoutfile->fcounters[j] &&
+           infile->fcounters[j] > 0) || inoutfile->fcounters[j] == 0)
+            tmp_file->fcounters[j] = infile->fcounters[j];
+        else
+            tmp_file->fcounters[j] = inoutfile->fcounters[j];
+    }
+    for(j=POSIX_F_OPEN_END_TIMESTAMP; j<=POSIX_F_CLOSE_END_TIMESTAMP; j++)
+    {
+        if(infile->fcounters[j] > inoutfile->fcounters[j])
+            tmp_file->fcounters[j] = infile->fcounters[j];
+        else
+            tmp_file->fcounters[j] = inoutfile->fcounters[j];
+    }
+    for(j=POSIX_F_READ_TIME; j<=POSIX_F_META_TIME; j++)
+        tmp_file->fcounters[j] = infile->fcounters[j] + inoutfile->fcounters[j];
+
+    return;
+}
+
+/* reduce 'in' into 'inout' with the given variant, the same way as the
+ * MPI reduction operator does (through a temporary record)
+ */
+static void reduce_records(int variant, struct darshan_posix_file *in,
+    struct darshan_posix_file *inout, int count)
+{
+    struct darshan_posix_file tmp_file;
+    int i;
+
+    for(i = 0; i < count; i++)
+    {
+        memset(&tmp_file, 0, sizeof(tmp_file));
+        tmp_file.base_rec = inout[i].base_rec;
+        switch(variant)
+        {
+            case BENCH_LEGACY:
+                legacy_reduce(&in[i], &inout[i], &tmp_file);
+                break;
+            case BENCH_SPANS:
+                DARSHAN_REDUCE_COUNTER_SPANS(POSIX_COUNTER_SPANS,
+                    in[i].counters, inout[i].counters, tmp_file.counters);
+                DARSHAN_REDUCE_FCOUNTER_SPANS(POSIX_FCOUNTER_SPANS,
+                    in[i].fcounters, inout[i].fcounters, tmp_file.fcounters);
+                break;
+        }
+        inout[i] = tmp_file;
+    }
+
+    return;
+}
+
+int main(int argc, char **argv)
+{
+    struct darshan_posix_file *in, *inout, *expected;
+    int count = 1000000;
+    int iters = 5;
+    int variant;
+    int i;
+    double time1, time2, best;
+
+    if(argc > 3 || (argc > 1 && (sscanf(argv[1], "%d", &count) != 1 ||
+        count < 1)) || (argc > 2 && (sscanf(argv[2], "%d", &iters) != 1 ||
+        iters < 1)))
+    {
+        fprintf(stderr, "Usage: %s [<records>] [<iterations>]\n", argv[0]);
+        return(-1);
+    }
+
+    in = malloc(count * sizeof(*in));
+    inout = malloc(count * sizeof(*inout));
+    expected = malloc(count * sizeof(*expected));
+    if(!in || !inout || !expected)
+    {
+        perror("malloc");
+        return(-1);
+    }
+    fill_records(in, count, 88172645463325252ULL);
+
+    /* results of a single reduction with the previous loops */
+    fill_records(expected, count, 2463534242ULL);
+    reduce_records(BENCH_LEGACY, in, expected, count);
+
+    printf("#<variant>\t<records>\t<best time (s)>\t<ns/record>\t<result>\n");
+    for(variant = 0; variant < BENCH_NUM_VARIANTS; variant++)
+    {
+        best = 0;
+        for(i = 0; i < iters; i++)
+        {
+            fill_records(inout, count, 2463534242ULL);
+            time1 = wtime();
+            reduce_records(variant, in, inout, count);
+            time2 = wtime();
+            if(i == 0 || time2 - time1 < best)
+                best = time2 - time1;
+        }
+
+        printf("%s\t%d\t%.6f\t%.1f\t%s\n", variant_names[variant], count,
+            best, (best * 1.0e9) / count,
+            memcmp(inout, expected, count * sizeof(*inout)) ? "MISMATCH" : "ok");
+    }
+
+    free(in);
+    free(inout);
+    free(expected);
+
+    return(0);
+}
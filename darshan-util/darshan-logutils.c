@@ -22,11 +22,19 @@
 #ifdef HAVE_LIBBZ2
 #include <bzlib.h>
 #endif
+#ifdef HAVE_LIBZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_LIBLZ4
+#include <lz4frame.h>
+#endif
 
 #include "darshan-logutils.h"
 
 /* default input buffer size for decompression algorithm */
 #define DARSHAN_DEF_COMP_BUF_SZ (1024*1024) /* 1 MiB */
+/* amount of data handed to lz4 at once when compressing */
+#define DARSHAN_LZ4_CHUNK_SZ (64*1024) /* 64 KiB */
 #define __DARSHAN_PATH_MAX 4096
 
 /* special identifers for referring to header, job, and
@@ -36,8 +44,27 @@
 #define DARSHAN_JOB_REGION_ID       (-2)
 #define DARSHAN_NAME_MAP_REGION_ID  (-1)
 
+struct darshan_fd_int_state;
+
+/* functions implementing a compression method. 'init' sets up the
+ * compression/decompression state for reading or writing the log, and
+ * 'write' and 'flush' may be NULL for methods that can only be read.
+ */
+struct darshan_dz_funcs
+{
+    int (*init)(struct darshan_fd_int_state *state);
+    void (*destroy)(struct darshan_fd_int_state *state);
+    int (*read)(darshan_fd fd, struct darshan_log_map map,
+        void *buf, int len, int reset_strm_flag);
+    int (*write)(darshan_fd fd, struct darshan_log_map *map_p,
+        void *buf, int len, int flush_strm_flag);
+    int (*flush)(darshan_fd fd, int region_id);
+};
+
 struct darshan_dz_state
 {
+    /* functions for the log's compression method */
+    const struct darshan_dz_funcs *funcs;
     /* pointer to arbitrary data structure used for managing
      * compression/decompression state (e.g., z_stream
      * structure needed for libz)
@@ -98,23 +125,84 @@ static int darshan_log_dzinit(darshan_fd fd);
 static void darshan_log_dzdestroy(darshan_fd fd);
 static int darshan_log_dzread(darshan_fd fd, int region_id, void *buf, int len);
 static int darshan_log_dzwrite(darshan_fd fd, int region_id, void *buf, int len);
+static const struct darshan_dz_funcs *darshan_log_get_dz_funcs(
+    enum darshan_comp_type comp_type);
+static struct darshan_log_map *darshan_log_get_region_map(darshan_fd fd,
+    int region_id);
+static int darshan_log_libz_init(struct darshan_fd_int_state *state);
+static void darshan_log_libz_destroy(struct darshan_fd_int_state *state);
 static int darshan_log_libz_read(darshan_fd fd, struct darshan_log_map map, 
     void *buf, int len, int reset_strm_flag);
 static int darshan_log_libz_write(darshan_fd fd, struct darshan_log_map *map_p,
     void *buf, int len, int flush_strm_flag);
 static int darshan_log_libz_flush(darshan_fd fd, int region_id);
 #ifdef HAVE_LIBBZ2
+static int darshan_log_bzip2_init(struct darshan_fd_int_state *state);
+static void darshan_log_bzip2_destroy(struct darshan_fd_int_state *state);
 static int darshan_log_bzip2_read(darshan_fd fd, struct darshan_log_map map, 
     void *buf, int len, int reset_strm_flag);
 static int darshan_log_bzip2_write(darshan_fd fd, struct darshan_log_map *map_p,
     void *buf, int len, int flush_strm_flag);
 static int darshan_log_bzip2_flush(darshan_fd fd, int region_id);
 #endif
+#ifdef HAVE_LIBZSTD
+static int darshan_log_zstd_init(struct darshan_fd_int_state *state);
+static void darshan_log_zstd_destroy(struct darshan_fd_int_state *state);
+static int darshan_log_zstd_read(darshan_fd fd, struct darshan_log_map map,
+    void *buf, int len, int reset_strm_flag);
+static int darshan_log_zstd_write(darshan_fd fd, struct darshan_log_map *map_p,
+    void *buf, int len, int flush_strm_flag);
+static int darshan_log_zstd_flush(darshan_fd fd, int region_id);
+#endif
+#ifdef HAVE_LIBLZ4
+static int darshan_log_lz4_init(struct darshan_fd_int_state *state);
+static void darshan_log_lz4_destroy(struct darshan_fd_int_state *state);
+static int darshan_log_lz4_read(darshan_fd fd, struct darshan_log_map map,
+    void *buf, int len, int reset_strm_flag);
+static int darshan_log_lz4_write(darshan_fd fd, struct darshan_log_map *map_p,
+    void *buf, int len, int flush_strm_flag);
+static int darshan_log_lz4_flush(darshan_fd fd, int region_id);
+#endif
 static int darshan_log_dzload(darshan_fd fd, struct darshan_log_map map);
 static int darshan_log_dzunload(darshan_fd fd, struct darshan_log_map *map_p);
+static int darshan_log_noz_init(struct darshan_fd_int_state *state);
+static void darshan_log_noz_destroy(struct darshan_fd_int_state *state);
 static int darshan_log_noz_read(darshan_fd fd, struct darshan_log_map map,
     void *buf, int len, int reset_strm_flag);
 
+static const struct darshan_dz_funcs darshan_libz_funcs =
+{
+    darshan_log_libz_init, darshan_log_libz_destroy, darshan_log_libz_read,
+    darshan_log_libz_write, darshan_log_libz_flush
+};
+#ifdef HAVE_LIBBZ2
+static const struct darshan_dz_funcs darshan_bzip2_funcs =
+{
+    darshan_log_bzip2_init, darshan_log_bzip2_destroy, darshan_log_bzip2_read,
+    darshan_log_bzip2_write, darshan_log_bzip2_flush
+};
+#endif
+#ifdef HAVE_LIBZSTD
+static const struct darshan_dz_funcs darshan_zstd_funcs =
+{
+    darshan_log_zstd_init, darshan_log_zstd_destroy, darshan_log_zstd_read,
+    darshan_log_zstd_write, darshan_log_zstd_flush
+};
+#endif
+#ifdef HAVE_LIBLZ4
+static const struct darshan_dz_funcs darshan_lz4_funcs =
+{
+    darshan_log_lz4_init, darshan_log_lz4_destroy, darshan_log_lz4_read,
+    darshan_log_lz4_write, darshan_log_lz4_flush
+};
+#endif
+/* uncompressed logs can only be read */
+static const struct darshan_dz_funcs darshan_noz_funcs =
+{
+    darshan_log_noz_init, darshan_log_noz_destroy, darshan_log_noz_read,
+    NULL, NULL
+};
+
 
 /* filtered namerecs test */
 static int darshan_log_get_filtered_namerecs(void *name_rec_buf, int buf_len, int swap_flag, struct darshan_name_record_ref **hash, darshan_record_id *whitelist, int whitelist_count);
@@ -900,23 +988,14 @@ void darshan_log_close(darshan_fd fd)
     if(state->creat_flag)
     {
         /* flush the last region of the log to file */
-        switch(fd->comp_type)
+        ret = -1;
+        if(state->dz.funcs->flush)
+            ret = state->dz.funcs->flush(fd, state->dz.prev_reg_id);
+        if(ret != 0)
         {
-            case DARSHAN_ZLIB_COMP:
-                ret = darshan_log_libz_flush(fd, state->dz.prev_reg_id);
-                if(ret == 0)
-                    break;
-#ifdef HAVE_LIBBZ2
-            case DARSHAN_BZIP2_COMP:
-                ret = darshan_log_bzip2_flush(fd, state->dz.prev_reg_id);
-                if(ret == 0)
-                    break;
-#endif 
-            default:
-                /* if flush fails, remove the output log file */
-                state->err = -1;
-                fprintf(stderr, "Error: final flush to log file failed.\n");
-                break;
+            /* if flush fails, remove the output log file */
+            state->err = -1;
+            fprintf(stderr, "Error: final flush to log file failed.\n");
         }
 
         /* if no errors flushing, write the log header before closing */
@@ -1397,6 +1476,13 @@ static int darshan_log_dzinit(darshan_fd fd)
     struct darshan_fd_int_state *state = fd->state;
     int ret;
 
+    state->dz.funcs = darshan_log_get_dz_funcs(fd->comp_type);
+    if(!state->dz.funcs)
+    {
+        fprintf(stderr, "Error: invalid compression type.\n");
+        return(-1);
+    }
+
     /* initialize buffers for staging compressed data
      * to/from log file
      */
@@ -1406,92 +1492,11 @@ static int darshan_log_dzinit(darshan_fd fd)
     state->dz.size = 0;
     state->dz.prev_reg_id = DARSHAN_HEADER_REGION_ID;
 
-    switch(fd->comp_type)
+    ret = state->dz.funcs->init(state);
+    if(ret < 0)
     {
-        case DARSHAN_ZLIB_COMP:
-        {
-            z_stream *tmp_zstrm = malloc(sizeof(*tmp_zstrm));
-            if(!tmp_zstrm)
-            {
-                free(state->dz.buf);
-                return(-1);
-            }
-            tmp_zstrm->zalloc = Z_NULL;
-            tmp_zstrm->zfree = Z_NULL;
-            tmp_zstrm->opaque = Z_NULL;
-            tmp_zstrm->avail_in = 0;
-            tmp_zstrm->next_in = Z_NULL;
-
-            /* TODO: worth using {inflate/deflate}Init2 ?? */
-            if(!(state->creat_flag))
-            {
-                /* read only file, init inflate algorithm */
-                ret = inflateInit(tmp_zstrm);
-            }
-            else
-            {
-                /* write only file, init deflate algorithm */
-                ret = deflateInit(tmp_zstrm, Z_DEFAULT_COMPRESSION);
-                tmp_zstrm->avail_out = DARSHAN_DEF_COMP_BUF_SZ;
-                tmp_zstrm->next_out = state->dz.buf;
-            }
-            if(ret != Z_OK)
-            {
-                free(tmp_zstrm);
-                free(state->dz.buf);
-                return(-1);
-            }
-            state->dz.comp_dat = tmp_zstrm;
-            break;
-        }
-#ifdef HAVE_LIBBZ2
-        case DARSHAN_BZIP2_COMP:
-        {
-            bz_stream *tmp_bzstrm = malloc(sizeof(*tmp_bzstrm));
-            if(!tmp_bzstrm)
-            {
-                free(state->dz.buf);
-                return(-1);
-            }
-            tmp_bzstrm->bzalloc = NULL;
-            tmp_bzstrm->bzfree = NULL;
-            tmp_bzstrm->opaque = NULL;
-            tmp_bzstrm->avail_in = 0;
-            tmp_bzstrm->next_in = NULL;
-
-            if(!(state->creat_flag))
-            {
-                /* read only file, init decompress algorithm */
-                ret = BZ2_bzDecompressInit(tmp_bzstrm, 1, 0);
-            }
-            else
-            {
-                /* write only file, init compress algorithm */
-                ret = BZ2_bzCompressInit(tmp_bzstrm, 9, 1, 30);
-                tmp_bzstrm->avail_out = DARSHAN_DEF_COMP_BUF_SZ;
-                tmp_bzstrm->next_out = (char *)state->dz.buf;
-            }
-            if(ret != BZ_OK)
-            {
-                free(tmp_bzstrm);
-                free(state->dz.buf);
-                return(-1);
-            }
-            state->dz.comp_dat = tmp_bzstrm;
-            break;
-        }
-#endif
-        case DARSHAN_NO_COMP:
-        {
-            /* we just track an offset into the staging buffers for no_comp */
-            int *buf_off = malloc(sizeof(int));
-            *buf_off = 0;
-            state->dz.comp_dat = buf_off;
-            break;
-        }
-        default:
-            fprintf(stderr, "Error: invalid compression type.\n");
-            return(-1);
+        free(state->dz.buf);
+        return(-1);
     }
 
     return(0);
@@ -1501,28 +1506,7 @@ static void darshan_log_dzdestroy(darshan_fd fd)
 {
     struct darshan_fd_int_state *state = fd->state;
 
-    switch(fd->comp_type)
-    {
-        case DARSHAN_ZLIB_COMP:
-            if(!(state->creat_flag))
-                inflateEnd((z_stream *)state->dz.comp_dat);
-            else
-                deflateEnd((z_stream *)state->dz.comp_dat);
-            break;
-#ifdef HAVE_LIBBZ2
-        case DARSHAN_BZIP2_COMP:
-            if(!(state->creat_flag))
-                BZ2_bzDecompressEnd((bz_stream *)state->dz.comp_dat);
-            else
-                BZ2_bzCompressEnd((bz_stream *)state->dz.comp_dat);
-            break;
-#endif
-        case DARSHAN_NO_COMP:
-            /* do nothing */
-            break;
-        default:
-            fprintf(stderr, "Error: invalid compression type.\n");
-    }
+    state->dz.funcs->destroy(state);
 
     free(state->dz.comp_dat);
     free(state->dz.buf);
@@ -1532,7 +1516,6 @@ static void darshan_log_dzdestroy(darshan_fd fd)
 static int darshan_log_dzread(darshan_fd fd, int region_id, void *buf, int len)
 {
     struct darshan_fd_int_state *state = fd->state;
-    struct darshan_log_map map;
     int reset_strm_flag = 0;
     int ret;
 
@@ -1541,33 +1524,11 @@ static int darshan_log_dzread(darshan_fd fd, int region_id, void *buf, int len)
     {
         state->dz.eor = 0;
         state->dz.size = 0;
-        reset_strm_flag = 1; /* reset libz/bzip2 streams */
+        reset_strm_flag = 1; /* reset decompression streams */
     }
 
-    if(region_id == DARSHAN_JOB_REGION_ID)
-        map = fd->job_map;
-    else if(region_id == DARSHAN_NAME_MAP_REGION_ID)
-        map = fd->name_map;
-    else
-        map = fd->mod_map[region_id];
-
-    switch(fd->comp_type)
-    {
-        case DARSHAN_ZLIB_COMP:
-            ret = darshan_log_libz_read(fd, map, buf, len, reset_strm_flag);
-            break;
-#ifdef HAVE_LIBBZ2
-        case DARSHAN_BZIP2_COMP:
-            ret = darshan_log_bzip2_read(fd, map, buf, len, reset_strm_flag);
-            break;
-#endif
-        case DARSHAN_NO_COMP:
-            ret = darshan_log_noz_read(fd, map, buf, len, reset_strm_flag);
-            break;
-        default:
-            fprintf(stderr, "Error: invalid compression type.\n");
-            return(-1);
-    }
+    ret = state->dz.funcs->read(fd, *darshan_log_get_region_map(fd, region_id),
+        buf, len, reset_strm_flag);
 
     state->dz.prev_reg_id = region_id;
     return(ret);
@@ -1576,7 +1537,6 @@ static int darshan_log_dzread(darshan_fd fd, int region_id, void *buf, int len)
 static int darshan_log_dzwrite(darshan_fd fd, int region_id, void *buf, int len)
 {
     struct darshan_fd_int_state *state = fd->state;
-    struct darshan_log_map *map_p;
     int flush_strm_flag = 0;
     int ret;
 
@@ -1593,34 +1553,101 @@ static int darshan_log_dzwrite(darshan_fd fd, int region_id, void *buf, int len)
             flush_strm_flag = 1;
     }
 
-    if(region_id == DARSHAN_JOB_REGION_ID)
-        map_p = &(fd->job_map);
-    else if(region_id == DARSHAN_NAME_MAP_REGION_ID)
-        map_p = &(fd->name_map);
-    else
-        map_p = &(fd->mod_map[region_id]);
+    if(!state->dz.funcs->write)
+    {
+        fprintf(stderr,
+            "Error: uncompressed writing of log files is not supported.\n");
+        return(-1);
+    }
+    ret = state->dz.funcs->write(fd, darshan_log_get_region_map(fd, region_id),
+        buf, len, flush_strm_flag);
 
-    switch(fd->comp_type)
+    state->dz.prev_reg_id = region_id;
+    return(ret);
+}
+
+/* returns the functions implementing the given compression method, or NULL
+ * if it is unknown or Darshan was built without support for it
+ */
+static const struct darshan_dz_funcs *darshan_log_get_dz_funcs(
+    enum darshan_comp_type comp_type)
+{
+    switch(comp_type)
     {
         case DARSHAN_ZLIB_COMP:
-            ret = darshan_log_libz_write(fd, map_p, buf, len, flush_strm_flag);
-            break;
+            return(&darshan_libz_funcs);
 #ifdef HAVE_LIBBZ2
         case DARSHAN_BZIP2_COMP:
-            ret = darshan_log_bzip2_write(fd, map_p, buf, len, flush_strm_flag);
-            break;
+            return(&darshan_bzip2_funcs);
+#endif
+#ifdef HAVE_LIBZSTD
+        case DARSHAN_ZSTD_COMP:
+            return(&darshan_zstd_funcs);
+#endif
+#ifdef HAVE_LIBLZ4
+        case DARSHAN_LZ4_COMP:
+            return(&darshan_lz4_funcs);
 #endif
         case DARSHAN_NO_COMP:
-            fprintf(stderr,
-                "Error: uncompressed writing of log files is not supported.\n");
-            return(-1);
+            return(&darshan_noz_funcs);
         default:
-            fprintf(stderr, "Error: invalid compression type.\n");
-            return(-1);
+            return(NULL);
     }
+}
 
-    state->dz.prev_reg_id = region_id;
-    return(ret);
+static struct darshan_log_map *darshan_log_get_region_map(darshan_fd fd,
+    int region_id)
+{
+    if(region_id == DARSHAN_JOB_REGION_ID)
+        return(&(fd->job_map));
+    else if(region_id == DARSHAN_NAME_MAP_REGION_ID)
+        return(&(fd->name_map));
+    else
+        return(&(fd->mod_map[region_id]));
+}
+
+static int darshan_log_libz_init(struct darshan_fd_int_state *state)
+{
+    int ret;
+    z_stream *tmp_zstrm = malloc(sizeof(*tmp_zstrm));
+    if(!tmp_zstrm)
+        return(-1);
+    tmp_zstrm->zalloc = Z_NULL;
+    tmp_zstrm->zfree = Z_NULL;
+    tmp_zstrm->opaque = Z_NULL;
+    tmp_zstrm->avail_in = 0;
+    tmp_zstrm->next_in = Z_NULL;
+
+    /* TODO: worth using {inflate/deflate}Init2 ?? */
+    if(!(state->creat_flag))
+    {
+        /* read only file, init inflate algorithm */
+        ret = inflateInit(tmp_zstrm);
+    }
+    else
+    {
+        /* write only file, init deflate algorithm */
+        ret = deflateInit(tmp_zstrm, Z_DEFAULT_COMPRESSION);
+        tmp_zstrm->avail_out = DARSHAN_DEF_COMP_BUF_SZ;
+        tmp_zstrm->next_out = state->dz.buf;
+    }
+    if(ret != Z_OK)
+    {
+        free(tmp_zstrm);
+        return(-1);
+    }
+    state->dz.comp_dat = tmp_zstrm;
+
+    return(0);
+}
+
+static void darshan_log_libz_destroy(struct darshan_fd_int_state *state)
+{
+    if(!(state->creat_flag))
+        inflateEnd((z_stream *)state->dz.comp_dat);
+    else
+        deflateEnd((z_stream *)state->dz.comp_dat);
+    return;
 }
 
 static int darshan_log_libz_read(darshan_fd fd, struct darshan_log_map map,
@@ -1743,18 +1770,11 @@ static int darshan_log_libz_flush(darshan_fd fd, int region_id)
     struct darshan_fd_int_state *state = fd->state;
     int ret;
     int tmp_out_bytes;
-    struct darshan_log_map *map_p;
+    struct darshan_log_map *map_p = darshan_log_get_region_map(fd, region_id);
     z_stream *z_strmp = (z_stream *)state->dz.comp_dat;
 
     assert(z_strmp);
 
-    if(region_id == DARSHAN_JOB_REGION_ID)
-        map_p = &(fd->job_map);
-    else if(region_id == DARSHAN_NAME_MAP_REGION_ID)
-        map_p = &(fd->name_map);
-    else
-        map_p = &(fd->mod_map[region_id]);
-
     /* make sure deflate finishes this stream */
     z_strmp->avail_in = 0;
     z_strmp->next_in = NULL;
@@ -1785,6 +1805,49 @@ static int darshan_log_libz_flush(darshan_fd fd, int region_id)
 }
 
 #ifdef HAVE_LIBBZ2
+static int darshan_log_bzip2_init(struct darshan_fd_int_state *state)
+{
+    int ret;
+    bz_stream *tmp_bzstrm = malloc(sizeof(*tmp_bzstrm));
+    if(!tmp_bzstrm)
+        return(-1);
+    tmp_bzstrm->bzalloc = NULL;
+    tmp_bzstrm->bzfree = NULL;
+    tmp_bzstrm->opaque = NULL;
+    tmp_bzstrm->avail_in = 0;
+    tmp_bzstrm->next_in = NULL;
+
+    if(!(state->creat_flag))
+    {
+        /* read only file, init decompress algorithm */
+        ret = BZ2_bzDecompressInit(tmp_bzstrm, 1, 0);
+    }
+    else
+    {
+        /* write only file, init compress algorithm */
+        ret = BZ2_bzCompressInit(tmp_bzstrm, 9, 1, 30);
+        tmp_bzstrm->avail_out = DARSHAN_DEF_COMP_BUF_SZ;
+        tmp_bzstrm->next_out = (char *)state->dz.buf;
+    }
+    if(ret != BZ_OK)
+    {
+        free(tmp_bzstrm);
+        return(-1);
+    }
+    state->dz.comp_dat = tmp_bzstrm;
+
+    return(0);
+}
+
+static void darshan_log_bzip2_destroy(struct darshan_fd_int_state *state)
+{
+    if(!(state->creat_flag))
+        BZ2_bzDecompressEnd((bz_stream *)state->dz.comp_dat);
+    else
+        BZ2_bzCompressEnd((bz_stream *)state->dz.comp_dat);
+    return;
+}
+
 static int darshan_log_bzip2_read(darshan_fd fd, struct darshan_log_map map,
     void *buf, int len, int reset_strm_flag)
 {
@@ -1908,18 +1971,11 @@ static int darshan_log_bzip2_flush(darshan_fd fd, int region_id)
     struct darshan_fd_int_state *state = fd->state;
     int ret;
     int tmp_out_bytes;
-    struct darshan_log_map *map_p;
+    struct darshan_log_map *map_p = darshan_log_get_region_map(fd, region_id);
     bz_stream *bz_strmp = (bz_stream *)state->dz.comp_dat;
 
     assert(bz_strmp);
 
-    if(region_id == DARSHAN_JOB_REGION_ID)
-        map_p = &(fd->job_map);
-    else if(region_id == DARSHAN_NAME_MAP_REGION_ID)
-        map_p = &(fd->name_map);
-    else
-        map_p = &(fd->mod_map[region_id]);
-
     /* make sure deflate finishes this stream */
     bz_strmp->avail_in = 0;
     bz_strmp->next_in = NULL;
@@ -1951,6 +2007,431 @@ static int darshan_log_bzip2_flush(darshan_fd fd, int region_id)
 }
 #endif
 
+#ifdef HAVE_LIBZSTD
+struct darshan_zstd_state
+{
+    ZSTD_DCtx *dctx;
+    ZSTD_CCtx *cctx;
+    /* compressed input remaining in the staging buffer, when reading */
+    ZSTD_inBuffer in;
+    /* set if the last read filled the output buffer, in which case the
+     * decompressor may hold more output for the next read
+     */
+    int pending;
+};
+
+static int darshan_log_zstd_init(struct darshan_fd_int_state *state)
+{
+    struct darshan_zstd_state *zs = calloc(1, sizeof(*zs));
+    if(!zs)
+        return(-1);
+
+    if(!(state->creat_flag))
+        zs->dctx = ZSTD_createDCtx();
+    else
+        zs->cctx = ZSTD_createCCtx();
+    if(!zs->dctx && !zs->cctx)
+    {
+        free(zs);
+        return(-1);
+    }
+    state->dz.comp_dat = zs;
+
+    return(0);
+}
+
+static void darshan_log_zstd_destroy(struct darshan_fd_int_state *state)
+{
+    struct darshan_zstd_state *zs = state->dz.comp_dat;
+
+    ZSTD_freeDCtx(zs->dctx);
+    ZSTD_freeCCtx(zs->cctx);
+    return;
+}
+
+static int darshan_log_zstd_read(darshan_fd fd, struct darshan_log_map map,
+    void *buf, int len, int reset_strm_flag)
+{
+    struct darshan_fd_int_state *state = fd->state;
+    struct darshan_zstd_state *zs = state->dz.comp_dat;
+    ZSTD_outBuffer out = {buf, len, 0};
+    size_t ret;
+
+    assert(zs);
+
+    if(reset_strm_flag)
+    {
+        zs->in.size = zs->in.pos = 0;
+        zs->pending = 0;
+        ZSTD_DCtx_reset(zs->dctx, ZSTD_reset_session_only);
+    }
+
+    /* we just decompress until the output buffer is full, assuming there
+     * is enough compressed data in file to satisfy the request size. A
+     * region holds one zstd frame per process that wrote it, which the
+     * decompressor handles back to back.
+     */
+    while(out.pos < out.size)
+    {
+        /* check if we need more compressed data */
+        if(zs->in.pos == zs->in.size && !zs->pending)
+        {
+            /* if the eor flag is set, clear it and return -- future
+             * reads of this log region will restart at the beginning
+             */
+            if(state->dz.eor)
+            {
+                state->dz.eor = 0;
+                break;
+            }
+
+            /* read more data from input file */
+            if(darshan_log_dzload(fd, map) < 0)
+                return(-1);
+            assert(state->dz.size > 0);
+
+            zs->in.src = state->dz.buf;
+            zs->in.size = state->dz.size;
+            zs->in.pos = 0;
+        }
+
+        ret = ZSTD_decompressStream(zs->dctx, &out, &zs->in);
+        if(ZSTD_isError(ret))
+        {
+            fprintf(stderr, "Error: unable to decompress darshan log data.\n");
+            return(-1);
+        }
+        zs->pending = (out.pos == out.size);
+    }
+
+    return(out.pos);
+}
+
+static int darshan_log_zstd_write(darshan_fd fd, struct darshan_log_map *map_p,
+    void *buf, int len, int flush_strm_flag)
+{
+    struct darshan_fd_int_state *state = fd->state;
+    struct darshan_zstd_state *zs = state->dz.comp_dat;
+    ZSTD_inBuffer in = {buf, len, 0};
+    ZSTD_outBuffer out;
+    size_t ret;
+
+    assert(zs);
+
+    /* flush compressed output buffer if we are moving to a new log region */
+    if(flush_strm_flag)
+    {
+        if(darshan_log_zstd_flush(fd, state->dz.prev_reg_id) < 0)
+            return(-1);
+    }
+
+    /* compress input data until none left */
+    while(in.pos < in.size)
+    {
+        /* if we are out of output, flush to log file */
+        if(state->dz.size == DARSHAN_DEF_COMP_BUF_SZ)
+        {
+            if(darshan_log_dzunload(fd, map_p) < 0)
+                return(-1);
+        }
+
+        out.dst = state->dz.buf;
+        out.size = DARSHAN_DEF_COMP_BUF_SZ;
+        out.pos = state->dz.size;
+        ret = ZSTD_compressStream2(zs->cctx, &out, &in, ZSTD_e_continue);
+        if(ZSTD_isError(ret))
+        {
+            fprintf(stderr, "Error: unable to compress darshan log data.\n");
+            return(-1);
+        }
+        state->dz.size = out.pos;
+    }
+
+    return(in.pos);
+}
+
+static int darshan_log_zstd_flush(darshan_fd fd, int region_id)
+{
+    struct darshan_fd_int_state *state = fd->state;
+    struct darshan_log_map *map_p = darshan_log_get_region_map(fd, region_id);
+    struct darshan_zstd_state *zs = state->dz.comp_dat;
+    ZSTD_inBuffer in = {NULL, 0, 0};
+    ZSTD_outBuffer out;
+    size_t ret;
+
+    assert(zs);
+
+    /* make sure zstd finishes this frame */
+    do
+    {
+        out.dst = state->dz.buf;
+        out.size = DARSHAN_DEF_COMP_BUF_SZ;
+        out.pos = state->dz.size;
+        ret = ZSTD_compressStream2(zs->cctx, &out, &in, ZSTD_e_end);
+        if(ZSTD_isError(ret))
+        {
+            fprintf(stderr, "Error: unable to compress darshan log data.\n");
+            return(-1);
+        }
+        state->dz.size = out.pos;
+
+        if(state->dz.size)
+        {
+            /* flush to file */
+            if(darshan_log_dzunload(fd, map_p) < 0)
+                return(-1);
+        }
+    } while(ret != 0);
+
+    return(0);
+}
+#endif
+
+#ifdef HAVE_LIBLZ4
+struct darshan_lz4_state
+{
+    LZ4F_dctx *dctx;
+    LZ4F_cctx *cctx;
+    LZ4F_preferences_t prefs;
+    /* compressed input remaining in the staging buffer, when reading */
+    size_t in_pos;
+    size_t in_size;
+    /* set if the last read filled the output buffer, in which case the
+     * decompressor may hold more output for the next read
+     */
+    int pending;
+    /* set once the frame header of the current region is written */
+    int frame_started;
+};
+
+static int darshan_log_lz4_init(struct darshan_fd_int_state *state)
+{
+    struct darshan_lz4_state *lz = calloc(1, sizeof(*lz));
+    LZ4F_errorCode_t ret;
+
+    if(!lz)
+        return(-1);
+
+    if(!(state->creat_flag))
+        ret = LZ4F_createDecompressionContext(&lz->dctx, LZ4F_VERSION);
+    else
+    {
+        ret = LZ4F_createCompressionContext(&lz->cctx, LZ4F_VERSION);
+        lz->prefs.frameInfo.blockSizeID = LZ4F_max64KB;
+    }
+    if(LZ4F_isError(ret))
+    {
+        free(lz);
+        return(-1);
+    }
+    state->dz.comp_dat = lz;
+
+    return(0);
+}
+
+static void darshan_log_lz4_destroy(struct darshan_fd_int_state *state)
+{
+    struct darshan_lz4_state *lz = state->dz.comp_dat;
+
+    if(lz->dctx)
+        LZ4F_freeDecompressionContext(lz->dctx);
+    if(lz->cctx)
+        LZ4F_freeCompressionContext(lz->cctx);
+    return;
+}
+
+static int darshan_log_lz4_read(darshan_fd fd, struct darshan_log_map map,
+    void *buf, int len, int reset_strm_flag)
+{
+    struct darshan_fd_int_state *state = fd->state;
+    struct darshan_lz4_state *lz = state->dz.comp_dat;
+    size_t total_bytes = 0;
+    size_t dst_size, src_size;
+    size_t ret;
+
+    assert(lz);
+
+    if(reset_strm_flag)
+    {
+        lz->in_pos = lz->in_size = 0;
+        lz->pending = 0;
+        LZ4F_resetDecompressionContext(lz->dctx);
+    }
+
+    /* we just decompress until the output buffer is full, assuming there
+     * is enough compressed data in file to satisfy the request size. A
+     * region holds one lz4 frame per process that wrote it, which the
+     * decompressor handles back to back.
+     */
+    while(total_bytes < (size_t)len)
+    {
+        /* check if we need more compressed data */
+        if(lz->in_pos == lz->in_size && !lz->pending)
+        {
+            /* if the eor flag is set, clear it and return -- future
+             * reads of this log region will restart at the beginning
+             */
+            if(state->dz.eor)
+            {
+                state->dz.eor = 0;
+                break;
+            }
+
+            /* read more data from input file */
+            if(darshan_log_dzload(fd, map) < 0)
+                return(-1);
+            assert(state->dz.size > 0);
+
+            lz->in_pos = 0;
+            lz->in_size = state->dz.size;
+        }
+
+        dst_size = len - total_bytes;
+        src_size = lz->in_size - lz->in_pos;
+        ret = LZ4F_decompress(lz->dctx, (char *)buf + total_bytes, &dst_size,
+            state->dz.buf + lz->in_pos, &src_size, NULL);
+        if(LZ4F_isError(ret))
+        {
+            fprintf(stderr, "Error: unable to decompress darshan log data.\n");
+            return(-1);
+        }
+        lz->in_pos += src_size;
+        total_bytes += dst_size;
+        lz->pending = (total_bytes == (size_t)len);
+    }
+
+    return(total_bytes);
+}
+
+/* make room for 'size' bytes of compressed output in the staging buffer */
+static int darshan_log_lz4_reserve(darshan_fd fd, struct darshan_log_map *map_p,
+    size_t size)
+{
+    struct darshan_fd_int_state *state = fd->state;
+
+    if(DARSHAN_DEF_COMP_BUF_SZ - state->dz.size < size)
+        return(darshan_log_dzunload(fd, map_p));
+    return(0);
+}
+
+static int darshan_log_lz4_begin(darshan_fd fd, struct darshan_log_map *map_p)
+{
+    struct darshan_fd_int_state *state = fd->state;
+    struct darshan_lz4_state *lz = state->dz.comp_dat;
+    size_t ret;
+
+    if(darshan_log_lz4_reserve(fd, map_p, LZ4F_HEADER_SIZE_MAX) < 0)
+        return(-1);
+    ret = LZ4F_compressBegin(lz->cctx, state->dz.buf + state->dz.size,
+        DARSHAN_DEF_COMP_BUF_SZ - state->dz.size, &lz->prefs);
+    if(LZ4F_isError(ret))
+    {
+        fprintf(stderr, "Error: unable to compress darshan log data.\n");
+        return(-1);
+    }
+    state->dz.size += ret;
+    lz->frame_started = 1;
+
+    return(0);
+}
+
+static int darshan_log_lz4_write(darshan_fd fd, struct darshan_log_map *map_p,
+    void *buf, int len, int flush_strm_flag)
+{
+    struct darshan_fd_int_state *state = fd->state;
+    struct darshan_lz4_state *lz = state->dz.comp_dat;
+    int total_bytes = 0;
+    int chunk_size;
+    size_t ret;
+
+    assert(lz);
+
+    /* flush compressed output buffer if we are moving to a new log region */
+    if(flush_strm_flag)
+    {
+        if(darshan_log_lz4_flush(fd, state->dz.prev_reg_id) < 0)
+            return(-1);
+    }
+
+    if(!lz->frame_started && darshan_log_lz4_begin(fd, map_p) < 0)
+        return(-1);
+
+    /* compress input data until none left, in chunks small enough that
+     * their compressed output is bounded well within the staging buffer
+     */
+    while(total_bytes < len)
+    {
+        chunk_size = len - total_bytes;
+        if(chunk_size > DARSHAN_LZ4_CHUNK_SZ)
+            chunk_size = DARSHAN_LZ4_CHUNK_SZ;
+
+        if(darshan_log_lz4_reserve(fd, map_p,
+            LZ4F_compressBound(chunk_size, &lz->prefs)) < 0)
+            return(-1);
+
+        ret = LZ4F_compressUpdate(lz->cctx, state->dz.buf + state->dz.size,
+            DARSHAN_DEF_COMP_BUF_SZ - state->dz.size,
+            (char *)buf + total_bytes, chunk_size, NULL);
+        if(LZ4F_isError(ret))
+        {
+            fprintf(stderr, "Error: unable to compress darshan log data.\n");
+            return(-1);
+        }
+        state->dz.size += ret;
+        total_bytes += chunk_size;
+    }
+
+    return(total_bytes);
+}
+
+static int darshan_log_lz4_flush(darshan_fd fd, int region_id)
+{
+    struct darshan_fd_int_state *state = fd->state;
+    struct darshan_log_map *map_p = darshan_log_get_region_map(fd, region_id);
+    struct darshan_lz4_state *lz = state->dz.comp_dat;
+    size_t ret;
+
+    assert(lz);
+
+    /* make sure lz4 finishes this frame */
+    if(!lz->frame_started && darshan_log_lz4_begin(fd, map_p) < 0)
+        return(-1);
+    if(darshan_log_lz4_reserve(fd, map_p,
+        LZ4F_compressBound(0, &lz->prefs)) < 0)
+        return(-1);
+    ret = LZ4F_compressEnd(lz->cctx, state->dz.buf + state->dz.size,
+        DARSHAN_DEF_COMP_BUF_SZ - state->dz.size, NULL);
+    if(LZ4F_isError(ret))
+    {
+        fprintf(stderr, "Error: unable to compress darshan log data.\n");
+        return(-1);
+    }
+    state->dz.size += ret;
+    lz->frame_started = 0;
+
+    /* flush to file */
+    return(darshan_log_dzunload(fd, map_p));
+}
+#endif
+
+static int darshan_log_noz_init(struct darshan_fd_int_state *state)
+{
+    /* we just track an offset into the staging buffers for no_comp */
+    int *buf_off = malloc(sizeof(int));
+    if(!buf_off)
+        return(-1);
+    *buf_off = 0;
+    state->dz.comp_dat = buf_off;
+
+    return(0);
+}
+
+static void darshan_log_noz_destroy(struct darshan_fd_int_state *state)
+{
+    /* do nothing */
+    return;
+}
+
 static int darshan_log_noz_read(darshan_fd fd, struct darshan_log_map map,
     void *buf, int len, int reset_strm_flag)
 {
@@ -49,6 +49,8 @@ enum darshan_comp_type
     DARSHAN_ZLIB_COMP,
     DARSHAN_BZIP2_COMP,
     DARSHAN_NO_COMP,
+    DARSHAN_ZSTD_COMP,
+    DARSHAN_LZ4_COMP,
 };
 
 typedef uint64_t darshan_record_id;
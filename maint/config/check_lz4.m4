@@ -0,0 +1,39 @@
+dnl @synopsis CHECK_LZ4()
+dnl
+dnl This macro searches for an installed lz4 frame library. If --with-lz4=DIR
+dnl is specified, it will look for DIR/include/lz4frame.h and DIR/lib/liblz4.
+dnl If --without-lz4 is specified, the library is not searched at all.
+dnl
+dnl lz4 is optional in Darshan, so if either the header file (lz4frame.h) or
+dnl the library (liblz4) is not found, configure only warns, unless it was
+dnl explicitly requested with --with-lz4.
+dnl
+dnl The macro defines the symbol HAVE_LIBLZ4 and sets LIBLZ4 to the
+dnl linker flags for the library if it is found.
+
+AC_DEFUN([CHECK_LZ4],
+[
+AC_ARG_WITH(lz4,
+[  --with-lz4=DIR root directory path of lz4 installation [defaults to
+                    checking the usual places]
+  --without-lz4 to disable lz4 usage completely],
+[], [with_lz4=check])
+
+if test "x$with_lz4" != xno ; then
+  if test -d "$with_lz4" ; then
+    LDFLAGS="$LDFLAGS -L${with_lz4}/lib"
+    CPPFLAGS="$CPPFLAGS -I${with_lz4}/include"
+  fi
+  AC_CHECK_HEADER(lz4frame.h,
+    [AC_CHECK_LIB(lz4, LZ4F_compressBegin, [LIBLZ4=-llz4])])
+  if test "x$LIBLZ4" != x ; then
+    AC_DEFINE(HAVE_LIBLZ4, 1, [Define if lz4 is available])
+    LIBS="$LIBLZ4 $LIBS"
+  elif test "x$with_lz4" = xcheck ; then
+    AC_MSG_WARN(liblz4 not found; Darshan will not support lz4 compressed logs.)
+  else
+    AC_MSG_ERROR(liblz4 not found)
+  fi
+fi
+AC_SUBST(LIBLZ4)
+])
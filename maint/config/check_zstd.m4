@@ -0,0 +1,39 @@
+dnl @synopsis CHECK_ZSTD()
+dnl
+dnl This macro searches for an installed zstd library. If --with-zstd=DIR
+dnl is specified, it will look for DIR/include/zstd.h and DIR/lib/libzstd.
+dnl If --without-zstd is specified, the library is not searched at all.
+dnl
+dnl zstd is optional in Darshan, so if either the header file (zstd.h) or
+dnl the library (libzstd) is not found, configure only warns, unless it was
+dnl explicitly requested with --with-zstd.
+dnl
+dnl The macro defines the symbol HAVE_LIBZSTD and sets LIBZSTD to the
+dnl linker flags for the library if it is found.
+
+AC_DEFUN([CHECK_ZSTD],
+[
+AC_ARG_WITH(zstd,
+[  --with-zstd=DIR root directory path of zstd installation [defaults to
+                    checking the usual places]
+  --without-zstd to disable zstd usage completely],
+[], [with_zstd=check])
+
+if test "x$with_zstd" != xno ; then
+  if test -d "$with_zstd" ; then
+    LDFLAGS="$LDFLAGS -L${with_zstd}/lib"
+    CPPFLAGS="$CPPFLAGS -I${with_zstd}/include"
+  fi
+  AC_CHECK_HEADER(zstd.h,
+    [AC_CHECK_LIB(zstd, ZSTD_compressStream2, [LIBZSTD=-lzstd])])
+  if test "x$LIBZSTD" != x ; then
+    AC_DEFINE(HAVE_LIBZSTD, 1, [Define if zstd is available])
+    LIBS="$LIBZSTD $LIBS"
+  elif test "x$with_zstd" = xcheck ; then
+    AC_MSG_WARN(libzstd not found; Darshan will not support zstd compressed logs.)
+  else
+    AC_MSG_ERROR(libzstd not found)
+  fi
+fi
+AC_SUBST(LIBZSTD)
+])